@@ -3,14 +3,30 @@ from bottleneck.benchmark.bench_detailed import bench_detailed
 from bottleneck.tests.util import get_functions
 
 from . import slow
+from ._accumulate import (NanArgmaxAcc, NanArgminAcc, NanMaxAcc, NanMeanAcc,
+                          NanMinAcc, NanStdAcc, NanSumAcc, NanVarAcc)
+from ._outofcore import get_outofcore, set_outofcore
 from ._pytesttester import PytestTester
+from ._scratch import release_scratch, scratch_high_water
+from ._submit import submit, submit_async
+from ._threads import (get_gil_threshold, get_num_threads, num_threads,
+                       set_gil_threshold, set_num_threads)
+from .group import (group_count, group_nanfirst, group_nanlast, group_nanmax,
+                    group_nanmean, group_nanmin, group_nanstd, group_nansum,
+                    group_nanvar)
 from .move import (move_argmax, move_argmin, move_max, move_mean, move_median,
                    move_min, move_rank, move_std, move_sum, move_var)
 from .nonreduce import replace
 from .nonreduce_axis import (argpartition, nanrankdata, partition, push,
                              rankdata)
-from .reduce import (allnan, anynan, median, nanargmax, nanargmin, nanmax,
-                     nanmean, nanmedian, nanmin, nanstd, nansum, nanvar, ss)
+from .reduce import (allnan, anynan, batch, median, nanargmax, nanargmin,
+                     nanmax, nanmean, nanmedian, nanmin, nanpercentile,
+                     nanquantile, nanstd, nansum, nanvar, nanwmean, nanwstd,
+                     nanwsum, nanwvar, segment_allnan, segment_anynan,
+                     segment_median, segment_nanargmax, segment_nanargmin,
+                     segment_nanmax, segment_nanmean, segment_nanmedian,
+                     segment_nanmin, segment_nanstd, segment_nansum,
+                     segment_nanvar, segment_ss, ss)
 
 test = PytestTester(__name__)
 del PytestTester
@@ -0,0 +1,444 @@
+"""Accumulators that reduce an array fed to them one chunk at a time."""
+
+import numpy as np
+
+from . import reduce
+
+__all__ = [
+    "NanSumAcc",
+    "NanMeanAcc",
+    "NanVarAcc",
+    "NanStdAcc",
+    "NanMinAcc",
+    "NanMaxAcc",
+    "NanArgminAcc",
+    "NanArgmaxAcc",
+]
+
+
+class _Accumulator:
+    """
+    Base class of the accumulators.
+
+    The state of a subclass is a tuple of arrays with the shape of the
+    reduced output. Subclasses provide _chunk, which reduces one chunk to a
+    state, _combine, which combines the state of the data seen so far with
+    the state of the data that follows it, and _result. Accumulators hold
+    nothing but numpy arrays and numbers, so they can be pickled and sent to
+    another process, where they can be merged with other accumulators.
+    """
+
+    # whether chunks of zero length along axis are ignored
+    _skip_empty = False
+
+    def __init__(self):
+        self._axis = None
+        self._shape = None
+        self._n = 0
+        self._dtype = None
+        self._state = None
+
+    def update(self, a, axis=None):
+        """
+        Add the next chunk of data to the accumulator.
+
+        Parameters
+        ----------
+        a : array_like
+            Next chunk of data. If `a` is not an array, a conversion is
+            attempted.
+        axis : {int, None}, optional
+            Axis along which the chunks are concatenated and the reduction
+            is done. The default (axis=None) reduces the flattened chunks.
+            All chunks given to an accumulator must use the same axis and
+            have the same shape apart from the length along axis.
+
+        Returns
+        -------
+        self : accumulator
+            The accumulator, so that calls can be chained.
+
+        """
+        a = np.asarray(a)
+        if axis is None:
+            shape = ()
+            length = a.size
+        else:
+            if a.ndim == 0:
+                raise ValueError("`axis` must be None for 0d input")
+            axis = int(axis)
+            if axis < -a.ndim or axis >= a.ndim:
+                raise ValueError("axis(=%d) out of bounds" % axis)
+            if axis < 0:
+                axis += a.ndim
+            shape = a.shape[:axis] + a.shape[axis + 1 :]
+            length = a.shape[axis]
+        self._check(axis, shape)
+        if self._dtype is None:
+            self._dtype = a.dtype.newbyteorder("=")
+        if length == 0 and self._skip_empty:
+            return self
+        state = self._chunk(a, axis)
+        if self._state is None:
+            self._state = state
+        else:
+            self._state = self._combine(self._state, state, self._n)
+        self._n += length
+        return self
+
+    def merge(self, other):
+        """
+        Add the data seen by another accumulator of the same type.
+
+        The data seen by `other` is taken to follow the data seen by this
+        accumulator, which matters only for the indices of the argmin and
+        argmax accumulators. `other` is not changed.
+
+        Parameters
+        ----------
+        other : accumulator
+            Accumulator of the same type as this one.
+
+        Returns
+        -------
+        self : accumulator
+            The accumulator, so that calls can be chained.
+
+        """
+        if type(other) is not type(self):
+            raise TypeError("cannot merge %s into %s" % (type(other), type(self)))
+        if other._shape is None:
+            return self
+        self._check(other._axis, other._shape)
+        if self._dtype is None:
+            self._dtype = other._dtype
+        if other._state is not None:
+            if self._state is None:
+                self._state = other._state
+            else:
+                self._state = self._combine(self._state, other._state, self._n)
+        self._n += other._n
+        return self
+
+    def result(self):
+        """
+        Reduction of all the data seen so far.
+
+        Returns
+        -------
+        y : {scalar, ndarray}
+            The same as a single call of the reduction function on the
+            concatenation of the chunks along axis, to within rounding.
+
+        """
+        if self._shape is None:
+            raise ValueError("no data has been given to the accumulator")
+        if self._state is None:
+            raise ValueError("zero-size array to reduction operation")
+        y = self._result()
+        return y.item() if y.ndim == 0 else y
+
+    def _check(self, axis, shape):
+        if self._shape is None:
+            self._axis = axis
+            self._shape = shape
+        elif axis != self._axis:
+            raise ValueError("`axis` must be the same for every chunk")
+        elif shape != self._shape:
+            raise ValueError("chunk shapes do not match along the other axes")
+
+    def _float_dtype(self):
+        return self._dtype if self._dtype.kind == "f" else np.dtype(np.float64)
+
+
+class NanSumAcc(_Accumulator):
+    """
+    Accumulator of the sum of array elements, treating NaNs as zero.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the sum with `result`.
+
+    See Also
+    --------
+    bottleneck.nansum: Sum of array elements, treating NaNs as zero.
+
+    Examples
+    --------
+    >>> acc = bn.NanSumAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 3.0]).result()
+    6.0
+
+    """
+
+    def _chunk(self, a, axis):
+        return (np.asarray(reduce.nansum(a, axis)),)
+
+    def _combine(self, state, other, n):
+        return (state[0] + other[0],)
+
+    def _result(self):
+        return self._state[0]
+
+
+class NanMeanAcc(_Accumulator):
+    """
+    Accumulator of the mean of array elements, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the mean with
+    `result`. The count and mean of each chunk are computed in one pass and
+    combined in float64.
+
+    See Also
+    --------
+    bottleneck.nanmean: Mean of array elements, ignoring NaNs.
+
+    Examples
+    --------
+    >>> acc = bn.NanMeanAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 3.0]).result()
+    2.0
+
+    """
+
+    # highest moment computed by _nanmoments
+    _moment = 1
+
+    def _chunk(self, a, axis):
+        y = reduce._nanmoments(a, axis, self._moment)
+        return y[..., 0], y[..., 1], y[..., 2]
+
+    def _combine(self, state, other, n):
+        na, ma, sa = state
+        nb, mb, sb = other
+        count = na + nb
+        delta = mb - ma
+        with np.errstate(invalid="ignore", divide="ignore"):
+            # the weighted sum, unlike ma + delta * nb / count, keeps
+            # infinities that are in one chunk only
+            mean = np.where(count > 0, (na * ma + nb * mb) / count, 0)
+            ssqdm = sa + sb + delta * delta * np.where(count > 0, na * nb / count, 0)
+        return count, mean, ssqdm
+
+    def _result(self):
+        count, mean, ssqdm = self._state
+        y = np.where(count > 0, mean, np.nan)
+        return y.astype(self._float_dtype())
+
+
+class NanVarAcc(NanMeanAcc):
+    """
+    Accumulator of the variance of array elements, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the variance with
+    `result`. The count, mean and sum of squared deviations of each chunk
+    are computed with the two pass algorithm of nanvar and combined in
+    float64 with the update formula of Chan, Golub and LeVeque.
+
+    Parameters
+    ----------
+    ddof : int, optional
+        Means Delta Degrees of Freedom. The divisor used in calculations
+        is ``N - ddof``, where ``N`` represents the number of non-NaN
+        elements. By default `ddof` is zero.
+
+    See Also
+    --------
+    bottleneck.nanvar: Variance of array elements, ignoring NaNs.
+
+    Examples
+    --------
+    >>> acc = bn.NanVarAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 3.0]).result()
+    0.6666666666666666
+
+    """
+
+    _moment = 2
+
+    def __init__(self, ddof=0):
+        super().__init__()
+        self.ddof = ddof
+
+    def _result(self):
+        count, mean, ssqdm = self._state
+        with np.errstate(invalid="ignore", divide="ignore"):
+            y = np.where(count > self.ddof, ssqdm / (count - self.ddof), np.nan)
+        return y.astype(self._float_dtype())
+
+
+class NanStdAcc(NanVarAcc):
+    """
+    Accumulator of the standard deviation of array elements, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the standard
+    deviation with `result`. The state is that of NanVarAcc.
+
+    Parameters
+    ----------
+    ddof : int, optional
+        Means Delta Degrees of Freedom. The divisor used in calculations
+        is ``N - ddof``, where ``N`` represents the number of non-NaN
+        elements. By default `ddof` is zero.
+
+    See Also
+    --------
+    bottleneck.nanstd: Standard deviation of array elements, ignoring NaNs.
+
+    Examples
+    --------
+    >>> acc = bn.NanStdAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 4.0]).result()
+    1.247219128924647
+
+    """
+
+    def _result(self):
+        return np.sqrt(super()._result())
+
+
+class NanMinAcc(_Accumulator):
+    """
+    Accumulator of the minimum of array elements, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the minimum with
+    `result`. Chunks of zero length along axis are ignored; `result`
+    raises ValueError if all chunks were of zero length.
+
+    See Also
+    --------
+    bottleneck.nanmin: Minimum of array elements, ignoring NaNs.
+
+    Examples
+    --------
+    >>> acc = bn.NanMinAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 0.0]).result()
+    0.0
+
+    """
+
+    _skip_empty = True
+    _reduce = staticmethod(reduce.nanmin)
+    _pick = staticmethod(np.fmin)
+
+    def _chunk(self, a, axis):
+        return (np.asarray(self._reduce(a, axis)),)
+
+    def _combine(self, state, other, n):
+        return (self._pick(state[0], other[0]),)
+
+    def _result(self):
+        return self._state[0]
+
+
+class NanMaxAcc(NanMinAcc):
+    """
+    Accumulator of the maximum of array elements, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the maximum with
+    `result`. Chunks of zero length along axis are ignored; `result`
+    raises ValueError if all chunks were of zero length.
+
+    See Also
+    --------
+    bottleneck.nanmax: Maximum of array elements, ignoring NaNs.
+
+    Examples
+    --------
+    >>> acc = bn.NanMaxAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 0.0]).result()
+    2.0
+
+    """
+
+    _reduce = staticmethod(reduce.nanmax)
+    _pick = staticmethod(np.fmax)
+
+
+class NanArgminAcc(_Accumulator):
+    """
+    Accumulator of the indices of the minimum values, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the indices with
+    `result`. The indices are into the concatenation of the chunks along
+    axis, or of the flattened chunks if axis is None. As with nanargmin,
+    the first occurrence of the minimum wins and `result` raises
+    ValueError for an all-NaN slice.
+
+    See Also
+    --------
+    bottleneck.nanargmin: Indices of the minimum values along an axis.
+
+    Examples
+    --------
+    >>> acc = bn.NanArgminAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 0.0]).result()
+    3
+
+    """
+
+    _skip_empty = True
+    _reduce = staticmethod(reduce.nanmin)
+    _arg = staticmethod(reduce.nanargmin)
+    _better = staticmethod(np.less)
+
+    def _chunk(self, a, axis):
+        empty = np.asarray(reduce.allnan(a, axis))
+        if empty.any():
+            fill = empty if axis is None else np.expand_dims(empty, axis)
+            a = np.where(fill, 0, a)
+        value = np.asarray(self._reduce(a, axis))
+        index = np.asarray(self._arg(a, axis), dtype=np.intp)
+        if empty.any():
+            value = np.where(empty, np.nan, value)
+            index = np.where(empty, -1, index)
+        return value, index
+
+    def _combine(self, state, other, n):
+        value, index = state
+        other_value, other_index = other
+        other_index = np.where(other_index >= 0, other_index + n, -1)
+        take = self._better(other_value, value) & (other_index >= 0)
+        take |= index < 0
+        value = np.where(take, other_value, value)
+        index = np.where(take, other_index, index)
+        return value, index
+
+    def _result(self):
+        index = self._state[1]
+        if (index < 0).any():
+            raise ValueError("All-NaN slice encountered")
+        return index
+
+
+class NanArgmaxAcc(NanArgminAcc):
+    """
+    Accumulator of the indices of the maximum values, ignoring NaNs.
+
+    Feed chunks of an array with `update`, combine accumulators that saw
+    different parts of the array with `merge` and get the indices with
+    `result`. The indices are into the concatenation of the chunks along
+    axis, or of the flattened chunks if axis is None. As with nanargmax,
+    the first occurrence of the maximum wins and `result` raises
+    ValueError for an all-NaN slice.
+
+    See Also
+    --------
+    bottleneck.nanargmax: Indices of the maximum values along an axis.
+
+    Examples
+    --------
+    >>> acc = bn.NanArgmaxAcc()
+    >>> acc.update([1.0, np.nan]).update([2.0, 0.0]).result()
+    2
+
+    """
+
+    _reduce = staticmethod(reduce.nanmax)
+    _arg = staticmethod(reduce.nanargmax)
+    _better = staticmethod(np.greater)
@@ -0,0 +1,41 @@
+"""Reductions over all axes of input that the C functions cannot read."""
+
+import numpy as np
+
+from . import reduce as _reduce
+from ._outofcore import _ACCUMULATORS, _FOLDS
+
+
+def reduce(name, a, descr, block_bytes, kwargs):
+    """
+    Reduce `a` over all axes, called from the C reducer for input that has
+    to be converted to `descr` first (byte swapped, unaligned, ...).
+
+    The input is converted by a buffered iterator, `block_bytes` at a time
+    in C order, and the block results are combined as in the accumulators,
+    so the extra memory does not grow with the size of `a`. Functions that
+    need all of the data at once get one converted copy.
+    """
+    func = getattr(_reduce, name)
+    step = max(1, block_bytes // descr.itemsize)
+    if a.size <= step or (name not in _ACCUMULATORS and name not in _FOLDS):
+        return func(a.astype(descr), **kwargs)
+    blocks = np.nditer(
+        a,
+        flags=["buffered", "external_loop"],
+        op_flags=[["readonly", "aligned", "nbo"]],
+        op_dtypes=[descr],
+        casting="safe",
+        buffersize=step,
+        order="C",
+    )
+    if name in _ACCUMULATORS:
+        acc = _ACCUMULATORS[name](**kwargs)
+        for block in blocks:
+            acc.update(block)
+        return acc.result()
+    y = None
+    for block in blocks:
+        r = func(block)
+        y = r if y is None else _FOLDS[name](y, r)
+    return y.item() if isinstance(y, np.generic) else y
@@ -0,0 +1,225 @@
+"""Reductions of memory-mapped arrays that do not fit in memory."""
+
+import mmap
+
+import numpy as np
+
+from . import _accumulate
+from . import reduce as _reduce
+
+try:
+    from numpy.lib.array_utils import byte_bounds
+except ImportError:
+    from numpy import byte_bounds
+
+__all__ = ["set_outofcore", "get_outofcore"]
+
+_settings = {
+    "enabled": False,
+    "min_bytes": 1 << 28,
+    "block_bytes": 1 << 26,
+    "drop_behind": False,
+}
+
+# reductions whose block results are combined by an accumulator
+_ACCUMULATORS = {
+    "nansum": _accumulate.NanSumAcc,
+    "nanmean": _accumulate.NanMeanAcc,
+    "nanvar": _accumulate.NanVarAcc,
+    "nanstd": _accumulate.NanStdAcc,
+    "nanmin": _accumulate.NanMinAcc,
+    "nanmax": _accumulate.NanMaxAcc,
+    "nanargmin": _accumulate.NanArgminAcc,
+    "nanargmax": _accumulate.NanArgmaxAcc,
+}
+
+# reductions whose block results are combined by a ufunc
+_FOLDS = {
+    "ss": np.add,
+    "anynan": np.logical_or,
+    "allnan": np.logical_and,
+}
+
+
+def set_outofcore(enabled=None, min_bytes=None, block_bytes=None, drop_behind=None):
+    """
+    Set how reductions of memory-mapped arrays are done.
+
+    Once enabled, the reduce functions (nansum, nanmean, median, ...)
+    detect input whose memory is a mapped file, such as an np.memmap, and
+    reduce it out of core when it is at least `min_bytes` long. The file is
+    then read in blocks of about `block_bytes` in the order the data is laid
+    out on disk, so a reduction along any axis reads the file sequentially,
+    at most once. The operating system is advised to read the next block
+    ahead while the current one is reduced. Block results are combined as in
+    the accumulators, so sums, means and variances match an in-memory call
+    to within rounding. median and nanmedian along the outermost axis on disk
+    or over all axes, and nanargmin and nanargmax over all axes of input
+    that is not in C order, cannot be split into blocks and are computed in
+    one call with sequential readahead advice.
+
+    Parameters
+    ----------
+    enabled : {bool, None}, optional
+        Whether memory-mapped input is reduced out of core. False by
+        default, so that mapped input is reduced like any other array.
+    min_bytes : {int, None}, optional
+        Smallest mapped input, in bytes, that is reduced out of core. The
+        default is 256 MiB.
+    block_bytes : {int, None}, optional
+        Size in bytes of the blocks read from the file. The default is
+        64 MiB.
+    drop_behind : {bool, None}, optional
+        Whether to tell the operating system that a block is no longer
+        needed once it is reduced, so that scanning a file does not push
+        other data out of memory. It only applies to files mapped read-only
+        (mode 'r'). False by default.
+
+    Arguments that are None keep their current setting.
+
+    Returns
+    -------
+    old : dict
+        The previous settings, which can be passed back as keyword
+        arguments to restore them.
+
+    Examples
+    --------
+    >>> old = bn.set_outofcore(enabled=True, block_bytes=1 << 24)
+    >>> old['enabled'], old['block_bytes']
+    (False, 67108864)
+    >>> _ = bn.set_outofcore(**old)
+
+    """
+    old = get_outofcore()
+    new = dict(
+        enabled=enabled,
+        min_bytes=min_bytes,
+        block_bytes=block_bytes,
+        drop_behind=drop_behind,
+    )
+    new = {key: value for key, value in new.items() if value is not None}
+    if new.get("min_bytes", 0) < 0:
+        raise ValueError("`min_bytes` must be nonnegative")
+    if new.get("block_bytes", 1) < 1:
+        raise ValueError("`block_bytes` must be positive")
+    _settings.update(new)
+    nbytes = int(_settings["min_bytes"]) if _settings["enabled"] else -1
+    _reduce._set_outofcore_bytes(nbytes)
+    return old
+
+
+def get_outofcore():
+    """
+    The current settings of the out-of-core reductions.
+
+    Returns
+    -------
+    settings : dict
+        The keyword arguments of `set_outofcore`.
+
+    Examples
+    --------
+    >>> bn.get_outofcore()['enabled']
+    False
+
+    """
+    return dict(_settings)
+
+
+def reduce(name, a, axis, kwargs):
+    """Reduce `a`, whose memory is a mapped file, called from the C reducer"""
+    func = getattr(_reduce, name)
+    dims = [d for d in range(a.ndim) if a.shape[d] > 1]
+    if not dims:
+        return func(a, axis, **kwargs)
+    # outermost dimension in memory, which is the one to split into blocks
+    dim = max(dims, key=lambda d: abs(a.strides[d]))
+    row = a.nbytes // a.shape[dim]
+    step = max(1, _settings["block_bytes"] // max(row, 1))
+    blocks = [
+        a[(slice(None),) * dim + (slice(i, i + step),)]
+        for i in range(0, a.shape[dim], step)
+    ]
+    advice = _Advice(a)
+    try:
+        if axis is not None and axis != dim:
+            # the blocks are independent
+            ys = [func(block, axis, **kwargs) for block in advice.walk(blocks)]
+            return np.concatenate(ys, dim if dim < axis else dim - 1)
+        if name in _ACCUMULATORS and (axis is not None or dim == 0 or
+                                      name not in ("nanargmin", "nanargmax")):
+            acc = _ACCUMULATORS[name](**kwargs)
+            for block in advice.walk(blocks):
+                acc.update(block, axis)
+            return acc.result()
+        if name in _FOLDS:
+            y = None
+            for block in advice.walk(blocks):
+                r = func(block, axis)
+                y = r if y is None else _FOLDS[name](y, r)
+            return y.item() if isinstance(y, np.generic) else y
+        # median: one call, with readahead over the whole array
+        advice.sequential()
+        return func(a, axis, **kwargs)
+    finally:
+        advice.normal()
+
+
+class _Advice:
+    """
+    madvise calls on the mapping behind an array. The calls are skipped
+    where the platform does not have them or the mapping cannot be found.
+    """
+
+    def __init__(self, a):
+        self.mm = None
+        if not hasattr(mmap.mmap, "madvise"):
+            return
+        base = a
+        while isinstance(base, np.ndarray):
+            base = base.base
+        if isinstance(base, memoryview):
+            base = base.obj
+        if not isinstance(base, mmap.mmap):
+            return
+        try:
+            view = np.frombuffer(base, np.uint8)
+        except ValueError:
+            # closed mapping
+            return
+        self.readonly = not view.flags.writeable
+        self.start = view.ctypes.data
+        del view
+        self.mm = base
+        self.size = len(base)
+        self.bounds = byte_bounds(a)
+
+    def advise(self, option, bounds):
+        if self.mm is None:
+            return
+        lo = bounds[0] - self.start
+        lo -= lo % mmap.PAGESIZE
+        hi = min(bounds[1] - self.start, self.size)
+        if hi > lo >= 0:
+            try:
+                self.mm.madvise(option, lo, hi - lo)
+            except (OSError, ValueError):
+                pass
+
+    def sequential(self):
+        self.advise(mmap.MADV_SEQUENTIAL, self.bounds)
+
+    def normal(self):
+        self.advise(mmap.MADV_NORMAL, self.bounds)
+
+    def walk(self, blocks):
+        """Yield the blocks, reading the next one ahead of the current"""
+        self.sequential()
+        drop = _settings["drop_behind"] and self.mm is not None and self.readonly
+        for i, block in enumerate(blocks):
+            if i + 1 < len(blocks):
+                self.advise(mmap.MADV_WILLNEED, byte_bounds(blocks[i + 1]))
+            yield block
+            if drop:
+                self.advise(mmap.MADV_DONTNEED, byte_bounds(block))
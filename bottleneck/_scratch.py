@@ -0,0 +1,53 @@
+"""Scratch memory kept by the C functions between calls."""
+
+from . import group, move, nonreduce, nonreduce_axis, reduce
+
+_modules = (reduce, nonreduce, nonreduce_axis, move, group)
+
+__all__ = ["release_scratch", "scratch_high_water"]
+
+
+def release_scratch():
+    """
+    Free the scratch buffers kept by the calling thread.
+
+    Functions such as median, nanmedian, argpartition, move_median and
+    move_min need a temporary buffer. Buffers of up to 1 MiB are kept per
+    thread and reused by later calls so that calling these functions at a
+    high rate on small arrays does not pay for memory allocation every time.
+    Use this function to give that memory back, for example before a long
+    running thread goes idle. Other threads are not affected.
+
+    Examples
+    --------
+    >>> bn.median(np.arange(10.0))
+    4.5
+    >>> bn.release_scratch()
+
+    """
+    for module in _modules:
+        module._release_scratch()
+
+
+def scratch_high_water():
+    """
+    Size in bytes of the largest scratch buffer requested since import.
+
+    The size is the largest request made by any thread in any of the
+    bottleneck extension modules, whether or not the buffer was kept for
+    reuse. It is meant for monitoring memory use.
+
+    Returns
+    -------
+    nbytes : int
+        Size of the largest scratch buffer, in bytes.
+
+    Examples
+    --------
+    >>> bn.median(np.arange(10.0))
+    4.5
+    >>> bn.scratch_high_water() >= 80
+    True
+
+    """
+    return max(module._scratch_high_water() for module in _modules)
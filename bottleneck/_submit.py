@@ -0,0 +1,213 @@
+"""Calls of the C functions that run in the background and return futures."""
+
+import asyncio
+import atexit
+import itertools
+import os
+import threading
+from concurrent.futures import Future
+
+import numpy as np
+
+from . import _pool, group, move, nonreduce, nonreduce_axis, reduce
+
+_modules = (reduce, nonreduce, nonreduce_axis, move, group)
+
+__all__ = ["submit", "submit_async"]
+
+_functions = {
+    name: getattr(module, name)
+    for module in _modules
+    for name in dir(module)
+    if not name.startswith("_")
+}
+
+# functions that write to their input
+_WRITES = frozenset(["replace"])
+
+# inputs of the calls that are not done: key -> (array, writes)
+_lock = threading.Lock()
+_inputs = {}
+_keys = itertools.count()
+
+
+def submit(func, a, *args, **kwargs):
+    """
+    Start a function on a background thread and return a future.
+
+    The call ``bn.submit("nanmedian", a, axis=0)`` returns at once and
+    computes ``bn.nanmedian(a, axis=0)`` on a worker of the thread pool
+    that bn.set_num_threads sizes, so that loading the next chunk of data,
+    or other I/O, overlaps with the reduction of the previous one. The
+    pool has one worker fewer than the thread count, since the calling
+    thread is the other one, but at least one, and at most that many calls
+    run at the same time; the others wait in the order they were
+    submitted. The function releases the GIL while it works on input of
+    at least `bn.get_gil_threshold()` elements and its parallel kernels,
+    such as nanmedian or the group functions, split the work across idle
+    workers.
+    Without pthreads (Windows) the function is computed before `submit`
+    returns, and the future is then already done.
+
+    The future keeps a reference to `a`, which the call reads while it
+    runs: `a` must not be modified until the future is done, or the result
+    is undefined.
+
+    Parameters
+    ----------
+    func : {str, function}
+        Name of a bottleneck function, such as "nanmedian", or the
+        function itself.
+    a : array_like
+        Input array.
+    *args, **kwargs
+        The other arguments of `func`.
+
+    Returns
+    -------
+    future : concurrent.futures.Future
+        Future whose result is the return value of `func`, or that raises
+        its exception.
+
+    Raises
+    ------
+    ValueError
+        If `func` is not a bottleneck function, or if `func` writes to its
+        input, as replace does, and `a` may share memory with the input of
+        a pending call, or the other way round.
+
+    See also
+    --------
+    bottleneck.submit_async: The same for asyncio.
+
+    Examples
+    --------
+    >>> a = np.arange(12.0).reshape(3, 4)
+    >>> future = bn.submit("nanmedian", a, axis=0)
+    >>> future.result()
+    array([4., 5., 6., 7.])
+
+    """
+    name = _lookup(func)
+    func = _functions[name]
+    key = _acquire(a, name in _WRITES)
+    future = Future()
+
+    def call():
+        y = error = None
+        running = future.set_running_or_notify_cancel()
+        try:
+            if running:
+                y = func(a, *args, **kwargs)
+        except BaseException as e:
+            error = e
+        # the input is given back before the future is done, so that code
+        # waiting on the future may submit a call that writes to it
+        _release(key)
+        if error is not None:
+            future.set_exception(error)
+        elif running:
+            future.set_result(y)
+
+    try:
+        _pool._submit(call)
+    except BaseException:
+        _release(key)
+        raise
+    return future
+
+
+def submit_async(func, a, *args, **kwargs):
+    """
+    Start a function on a background thread and return an asyncio future.
+
+    The function is started at once, as by `bn.submit`, and the returned
+    future can be awaited in the running event loop, which keeps running
+    other tasks in the meantime.
+
+    Parameters
+    ----------
+    func : {str, function}
+        Name of a bottleneck function, such as "nanmedian", or the
+        function itself.
+    a : array_like
+        Input array.
+    *args, **kwargs
+        The other arguments of `func`.
+
+    Returns
+    -------
+    future : asyncio.Future
+        Future of the running event loop whose result is the return value
+        of `func`.
+
+    Raises
+    ------
+    RuntimeError
+        If no event loop is running in the calling thread.
+
+    See also
+    --------
+    bottleneck.submit: The same for threads.
+
+    Examples
+    --------
+    >>> import asyncio
+    >>> async def column_medians(chunks):
+    ...     return [await bn.submit_async("median", c, axis=0) for c in chunks]
+    >>> asyncio.run(column_medians([np.eye(3), np.ones((2, 3))]))
+    [array([0., 0., 0.]), array([1., 1., 1.])]
+
+    """
+    loop = asyncio.get_running_loop()
+    return asyncio.wrap_future(submit(func, a, *args, **kwargs), loop=loop)
+
+
+def _lookup(func):
+    """Name of a bottleneck function given as a name or the function"""
+    name = func if isinstance(func, str) else getattr(func, "__name__", None)
+    if _functions.get(name) is None or not (
+        isinstance(func, str) or _functions[name] is func
+    ):
+        raise ValueError("submit does not support `func`=%r" % (func,))
+    return name
+
+
+def _acquire(a, writes):
+    """Record `a` as the input of a pending call; returns its key"""
+    if not isinstance(a, np.ndarray):
+        return None
+    with _lock:
+        for b, b_writes in _inputs.values():
+            if (writes or b_writes) and np.may_share_memory(a, b):
+                raise ValueError(
+                    "`a` may share memory with the input of a pending call "
+                    "and one of the two calls writes to its input"
+                )
+        key = next(_keys)
+        _inputs[key] = (a, writes)
+    return key
+
+
+def _release(key):
+    """Undo _acquire once the call is done"""
+    if key is not None:
+        with _lock:
+            del _inputs[key]
+
+
+def _shutdown():
+    """Let the pool finish the submitted calls before Python exits"""
+    _pool._submit_wait()
+
+
+def _after_fork():
+    """The calls that were pending in the parent never run in the child"""
+    global _lock
+    _lock = threading.Lock()
+    _inputs.clear()
+
+
+atexit.register(_shutdown)
+if hasattr(os, "register_at_fork"):
+    os.register_at_fork(after_in_child=_after_fork)
@@ -0,0 +1,273 @@
+"""Threads used by the parallel C functions."""
+
+import contextlib
+import os
+import time
+
+import numpy as np
+
+from . import _pool, group, move, nonreduce, nonreduce_axis, reduce
+
+_modules = (reduce, nonreduce, nonreduce_axis, move, group)
+
+__all__ = [
+    "set_num_threads",
+    "get_num_threads",
+    "num_threads",
+    "set_gil_threshold",
+    "get_gil_threshold",
+]
+
+_settings = {"threads": 1, "pin": False, "gil_threshold": 4096}
+
+# bounds of the calibrated GIL threshold, in elements
+_GIL_MIN = 1 << 10
+_GIL_MAX = 1 << 20
+
+
+def _cpu_count():
+    """Number of CPUs the process may run on"""
+    try:
+        return len(os.sched_getaffinity(0))
+    except (AttributeError, OSError):
+        return os.cpu_count() or 1
+
+
+def set_num_threads(n, pin=None):
+    """
+    Set the number of threads used by the parallel functions.
+
+    median and nanmedian, the group and segment functions and batch split
+    large inputs into parts that a pool of worker threads reduces at the
+    same time as the calling thread. The workers are started the first time
+    they are needed and are kept between calls. The default is the value of
+    the environment variable BN_NUM_THREADS when bottleneck is imported, or
+    else the number of CPUs the process may run on. Use 1 to do all work in
+    the calling thread, for example when the program already runs one
+    process per CPU.
+
+    Parameters
+    ----------
+    n : int
+        Number of threads, including the calling thread. It is clipped to
+        the range 1 to 257.
+    pin : {bool, None}, optional
+        Whether each worker is bound to one of the CPUs the process may run
+        on, which keeps it next to its cache on machines with many cores.
+        Only Linux supports pinning; elsewhere the flag is ignored. None,
+        the default, keeps the current setting, which is False at import.
+
+    Returns
+    -------
+    old : int
+        The previous number of threads.
+
+    Examples
+    --------
+    >>> old = bn.set_num_threads(2)
+    >>> bn.get_num_threads()
+    2
+    >>> _ = bn.set_num_threads(old)
+
+    """
+    n = int(n)
+    if n < 1:
+        raise ValueError("`n` must be at least 1")
+    n = min(n, 257)
+    old = _settings["threads"]
+    if pin is not None:
+        _settings["pin"] = bool(pin)
+    _settings["threads"] = n
+    _pool._set_num_threads(n, _settings["pin"])
+    return old
+
+
+def get_num_threads():
+    """
+    Number of threads used by the parallel functions.
+
+    Returns
+    -------
+    n : int
+        Number of threads, including the calling thread.
+
+    Examples
+    --------
+    >>> bn.get_num_threads() >= 1
+    True
+
+    """
+    return _settings["threads"]
+
+
+@contextlib.contextmanager
+def num_threads(n, pin=None):
+    """
+    Context manager that sets the number of threads used by the parallel
+    functions and restores the previous setting on exit.
+
+    Parameters
+    ----------
+    n : int
+        Number of threads, including the calling thread.
+    pin : {bool, None}, optional
+        Whether the workers are bound to CPUs; see `set_num_threads`.
+
+    Examples
+    --------
+    >>> a = np.random.rand(1000, 100)
+    >>> with bn.num_threads(1):
+    ...     y = bn.median(a, axis=1)
+
+    """
+    old_pin = _settings["pin"]
+    old = set_num_threads(n, pin)
+    try:
+        yield
+    finally:
+        set_num_threads(old, old_pin)
+
+
+def set_gil_threshold(n=None):
+    """
+    Set the smallest input for which the C functions release the GIL.
+
+    Releasing the global interpreter lock lets other Python threads run
+    while a function works, but releasing it and taking it back costs about
+    as much as a reduction of a few hundred elements. The functions
+    therefore release it only for input of at least `n` elements. The
+    default is the value of the environment variable BN_GIL_THRESHOLD when
+    bottleneck is imported, or else 4096. Calling this function without an
+    argument calibrates the threshold on this machine instead, so that the
+    cost of releasing the GIL is about 1% of the time nansum takes.
+
+    Parameters
+    ----------
+    n : {int, None}, optional
+        Number of elements. 0 always releases the GIL and a negative value
+        never does. None, the default, calibrates the threshold on this
+        machine, which takes a few milliseconds.
+
+    Returns
+    -------
+    old : int
+        The previous threshold.
+
+    Examples
+    --------
+    >>> old = bn.set_gil_threshold(-1)
+    >>> bn.get_gil_threshold()
+    -1
+    >>> _ = bn.set_gil_threshold(old)
+
+    """
+    if n is None:
+        n = _calibrate_gil()
+    n = int(n)
+    old = _settings["gil_threshold"]
+    _settings["gil_threshold"] = n
+    for module in _modules:
+        module._set_gil_threshold(n)
+    return old
+
+
+def get_gil_threshold():
+    """
+    Smallest input, in elements, for which the C functions release the GIL.
+
+    Returns
+    -------
+    n : int
+        Number of elements; a negative value means the GIL is never
+        released.
+
+    Examples
+    --------
+    >>> bn.get_gil_threshold() >= -1
+    True
+
+    """
+    return _settings["gil_threshold"]
+
+
+def _best_time(func, arg, ncalls, repeat=5):
+    """Shortest time of one call of func(arg) over `repeat` runs"""
+    best = float("inf")
+    for i in range(repeat):
+        t0 = time.perf_counter()
+        for j in range(ncalls):
+            func(arg)
+        best = min(best, time.perf_counter() - t0)
+    return best / ncalls
+
+
+def _calibrate_gil():
+    """Elements of float64 nansum that take 100 times as long as releasing
+    and taking back the GIL"""
+    small = np.ones(16)
+    large = np.ones(1 << 16)
+    old = _settings["gil_threshold"]
+    try:
+        for module in _modules:
+            module._set_gil_threshold(-1)
+        hold = _best_time(reduce.nansum, small, 200)
+        per_element = _best_time(reduce.nansum, large, 4) / large.size
+        reduce._set_gil_threshold(0)
+        release = _best_time(reduce.nansum, small, 200)
+    finally:
+        for module in _modules:
+            module._set_gil_threshold(old)
+    n = 100 * max(release - hold, 0.0) / max(per_element, 1e-12)
+    return int(min(max(n, _GIL_MIN), _GIL_MAX))
+
+
+def _default_gil_threshold():
+    """BN_GIL_THRESHOLD, or 4096 if unset or invalid"""
+    try:
+        return int(os.environ["BN_GIL_THRESHOLD"])
+    except (KeyError, ValueError):
+        return 4096
+
+
+def _default_threads():
+    """BN_NUM_THREADS, or the number of usable CPUs if unset or invalid"""
+    try:
+        n = int(os.environ["BN_NUM_THREADS"])
+    except (KeyError, ValueError):
+        n = 0
+    return n if n > 0 else _cpu_count()
+
+
+def _register_threadpoolctl():
+    """Let threadpoolctl find and limit the pool, if threadpoolctl is new
+    enough to take controllers from other libraries"""
+    try:
+        import threadpoolctl
+    except ImportError:
+        return
+    if not hasattr(threadpoolctl, "register"):
+        return
+
+    class BottleneckController(threadpoolctl.LibController):
+        user_api = "bottleneck"
+        internal_api = "bottleneck"
+        filename_prefixes = ("_pool.",)
+        check_symbols = ("PyInit__pool",)
+
+        def get_num_threads(self):
+            return get_num_threads()
+
+        def set_num_threads(self, num_threads):
+            return set_num_threads(num_threads)
+
+        def get_version(self):
+            from . import __version__
+
+            return __version__
+
+    threadpoolctl.register(BottleneckController)
+
+
+set_num_threads(_default_threads())
+set_gil_threshold(_default_gil_threshold())
+_register_threadpoolctl()
@@ -1,6 +1,8 @@
 # flake8: noqa
 
 from bottleneck.slow.reduce import *
+from bottleneck.slow.reduce import _nanmoments
 from bottleneck.slow.nonreduce import *
 from bottleneck.slow.nonreduce_axis import *
 from bottleneck.slow.move import *
+from bottleneck.slow.group import *
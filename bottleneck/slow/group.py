@@ -0,0 +1,133 @@
+import warnings
+
+import numpy as np
+
+__all__ = [
+    "group_nansum",
+    "group_nanmean",
+    "group_nanstd",
+    "group_nanvar",
+    "group_nanmin",
+    "group_nanmax",
+    "group_nanfirst",
+    "group_nanlast",
+    "group_count",
+]
+
+
+def group_nansum(a, labels, ngroups=None, axis=-1):
+    "Slow group_nansum function used for unaccelerated dtypes."
+    a = np.asarray(a)
+    if a.dtype.kind in "biu":
+        dtype = np.uint64 if a.dtype.kind == "u" else np.int64
+    else:
+        dtype = a.dtype
+    return _group(np.nansum, a, labels, ngroups, axis, dtype, 0)
+
+
+def group_nanmean(a, labels, ngroups=None, axis=-1):
+    "Slow group_nanmean function used for unaccelerated dtypes."
+    return _group(np.nanmean, a, labels, ngroups, axis, None, np.nan)
+
+
+def group_nanstd(a, labels, ngroups=None, axis=-1, ddof=0):
+    "Slow group_nanstd function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return np.nanstd(b, axis=axis, ddof=ddof)
+
+    return _group(func, a, labels, ngroups, axis, None, np.nan)
+
+
+def group_nanvar(a, labels, ngroups=None, axis=-1, ddof=0):
+    "Slow group_nanvar function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return np.nanvar(b, axis=axis, ddof=ddof)
+
+    return _group(func, a, labels, ngroups, axis, None, np.nan)
+
+
+def group_nanmin(a, labels, ngroups=None, axis=-1):
+    "Slow group_nanmin function used for unaccelerated dtypes."
+    return _group(np.nanmin, a, labels, ngroups, axis, "same", None)
+
+
+def group_nanmax(a, labels, ngroups=None, axis=-1):
+    "Slow group_nanmax function used for unaccelerated dtypes."
+    return _group(np.nanmax, a, labels, ngroups, axis, "same", None)
+
+
+def group_nanfirst(a, labels, ngroups=None, axis=-1):
+    "Slow group_nanfirst function used for unaccelerated dtypes."
+    return _group(_nanfirst, a, labels, ngroups, axis, "same", None)
+
+
+def group_nanlast(a, labels, ngroups=None, axis=-1):
+    "Slow group_nanlast function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return _nanfirst(b[..., ::-1], axis)
+
+    return _group(func, a, labels, ngroups, axis, "same", None)
+
+
+def group_count(a, labels, ngroups=None, axis=-1):
+    "Slow group_count function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return (~np.isnan(b)).sum(axis)
+
+    return _group(func, a, labels, ngroups, axis, np.intp, 0)
+
+
+def _nanfirst(b, axis):
+    "first non-NaN value along the last axis"
+    mask = ~np.isnan(b)
+    idx = mask.argmax(axis)[..., None]
+    y = np.take_along_axis(b, idx, axis)[..., 0]
+    return np.where(mask.any(axis), y, np.nan)
+
+
+def _group(func, a, labels, ngroups, axis, dtype, empty):
+    """
+    Apply func to each group along the last axis. dtype is the output dtype,
+    with None for float64 or the float dtype of `a` and "same" for the dtype
+    of `a`. empty is the value of an empty group, with None to raise for
+    integer input and to give NaN for float input.
+    """
+    a = np.asarray(a)
+    labels = np.asarray(labels)
+    if labels.dtype.kind not in "biu":
+        raise TypeError("`labels` must be integers")
+    if axis is None:
+        raise ValueError("`axis` cannot be None")
+    a = np.moveaxis(a, axis, -1)
+    if labels.ndim != 1 or labels.size != a.shape[-1]:
+        raise ValueError("`labels` must be 1d with the length of `a` along `axis`")
+    label_max = labels.max() if labels.size else -1
+    if ngroups is None:
+        ngroups = max(label_max, -1) + 1
+    elif ngroups < 0:
+        raise ValueError("`ngroups` must be nonnegative")
+    elif label_max >= ngroups:
+        raise ValueError("`labels` must be less than `ngroups`")
+    if dtype is None:
+        dtype = a.dtype if a.dtype.kind == "f" else np.float64
+    elif dtype == "same":
+        dtype = a.dtype
+    y = np.empty(a.shape[:-1] + (ngroups,), dtype)
+    for g in range(ngroups):
+        b = a[..., labels == g]
+        if b.shape[-1] == 0:
+            if empty is not None:
+                y[..., g] = empty
+            elif a.dtype.kind == "f":
+                y[..., g] = np.nan
+            elif y.size:
+                raise ValueError("group %d is empty" % g)
+            continue
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore")
+            y[..., g] = func(b, axis=-1)
+    return np.moveaxis(y, -1, axis)
@@ -18,37 +18,41 @@ __all__ = [
 ]
 
 
-def move_sum(a, window, min_count=None, axis=-1):
+def move_sum(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_sum for unaccelerated dtype"
-    return move_func(np.nansum, a, window, min_count, axis=axis)
+    return move_func(np.nansum, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_mean(a, window, min_count=None, axis=-1):
+def move_mean(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_mean for unaccelerated dtype"
-    return move_func(np.nanmean, a, window, min_count, axis=axis)
+    return move_func(np.nanmean, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_std(a, window, min_count=None, axis=-1, ddof=0):
+def move_std(a, window, min_count=None, axis=-1, ddof=0, groups=None):
     "Slow move_std for unaccelerated dtype"
-    return move_func(np.nanstd, a, window, min_count, axis=axis, ddof=ddof)
+    return move_func(
+        np.nanstd, a, window, min_count, axis=axis, ddof=ddof, groups=groups
+    )
 
 
-def move_var(a, window, min_count=None, axis=-1, ddof=0):
+def move_var(a, window, min_count=None, axis=-1, ddof=0, groups=None):
     "Slow move_var for unaccelerated dtype"
-    return move_func(np.nanvar, a, window, min_count, axis=axis, ddof=ddof)
+    return move_func(
+        np.nanvar, a, window, min_count, axis=axis, ddof=ddof, groups=groups
+    )
 
 
-def move_min(a, window, min_count=None, axis=-1):
+def move_min(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_min for unaccelerated dtype"
-    return move_func(np.nanmin, a, window, min_count, axis=axis)
+    return move_func(np.nanmin, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_max(a, window, min_count=None, axis=-1):
+def move_max(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_max for unaccelerated dtype"
-    return move_func(np.nanmax, a, window, min_count, axis=axis)
+    return move_func(np.nanmax, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_argmin(a, window, min_count=None, axis=-1):
+def move_argmin(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_argmin for unaccelerated dtype"
 
     def argmin(a, axis):
@@ -71,10 +75,10 @@ def move_argmin(a, window, min_count=None, axis=-1):
                 idx[mask] = np.nan
         return idx
 
-    return move_func(argmin, a, window, min_count, axis=axis)
+    return move_func(argmin, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_argmax(a, window, min_count=None, axis=-1):
+def move_argmax(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_argmax for unaccelerated dtype"
 
     def argmax(a, axis):
@@ -97,23 +101,23 @@ def move_argmax(a, window, min_count=None, axis=-1):
                 idx[mask] = np.nan
         return idx
 
-    return move_func(argmax, a, window, min_count, axis=axis)
+    return move_func(argmax, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_median(a, window, min_count=None, axis=-1):
+def move_median(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_median for unaccelerated dtype"
-    return move_func(np.nanmedian, a, window, min_count, axis=axis)
+    return move_func(np.nanmedian, a, window, min_count, axis=axis, groups=groups)
 
 
-def move_rank(a, window, min_count=None, axis=-1):
+def move_rank(a, window, min_count=None, axis=-1, groups=None):
     "Slow move_rank for unaccelerated dtype"
-    return move_func(lastrank, a, window, min_count, axis=axis)
+    return move_func(lastrank, a, window, min_count, axis=axis, groups=groups)
 
 
 # magic utility functions ---------------------------------------------------
 
 
-def move_func(func, a, window, min_count=None, axis=-1, **kwargs):
+def move_func(func, a, window, min_count=None, axis=-1, groups=None, **kwargs):
     "Generic moving window function implemented with a python loop."
     a = np.asarray(a)
     if min_count is None:
@@ -133,6 +137,21 @@ def move_func(func, a, window, min_count=None, axis=-1, **kwargs):
         raise ValueError("`window` must be at least 1.")
     if window > a.shape[axis]:
         raise ValueError("`window` is too long.")
+    if groups is not None:
+        groups = np.asarray(groups)
+        if groups.dtype.kind not in "biu":
+            raise TypeError("`groups` must be integers")
+        if groups.ndim != 1 or groups.size != a.shape[axis]:
+            raise ValueError("`groups` must be 1d with the length of `a` along `axis`")
+        # restart the window at each run of equal labels
+        ends = np.flatnonzero(groups[1:] != groups[:-1]) + 1
+        ys = [_move(func, b, window, mc, axis, kwargs) for b in np.split(a, ends, axis)]
+        return np.concatenate(ys, axis)
+    return _move(func, a, window, mc, axis, kwargs)
+
+
+def _move(func, a, window, mc, axis, kwargs):
+    "move_func without the argument checks; window can exceed a.shape[axis]"
     if issubclass(a.dtype.type, np.inexact):
         y = np.empty_like(a)
     else:
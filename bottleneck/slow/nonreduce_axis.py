@@ -49,14 +49,19 @@ def push(a, n=None, axis=-1):
     elif ndim == 0:
         return y
     fidx = ~np.isnan(y)
-    recent = np.empty(y.shape[:-1])
+    if y.dtype.kind in "mM":
+        missing = y.dtype.type("NaT")
+        recent = np.empty(y.shape[:-1], y.dtype)
+    else:
+        missing = np.nan
+        recent = np.empty(y.shape[:-1])
     count = np.empty(y.shape[:-1])
-    recent.fill(np.nan)
+    recent.fill(missing)
     count.fill(np.nan)
     with np.errstate(invalid="ignore"):
         for i in range(y.shape[-1]):
             idx = (i - count) > n
-            recent[idx] = np.nan
+            recent[idx] = missing
             idx = ~fidx[..., i]
             y[idx, i] = recent[idx]
             idx = fidx[..., i]
@@ -1,10 +1,15 @@
 import warnings
 import numpy as np
-from numpy import nanmean, nansum
 
 __all__ = [
     "median",
     "nanmedian",
+    "nanquantile",
+    "nanpercentile",
+    "nanwsum",
+    "nanwmean",
+    "nanwvar",
+    "nanwstd",
     "nansum",
     "nanmean",
     "nanvar",
@@ -16,11 +21,28 @@ __all__ = [
     "ss",
     "anynan",
     "allnan",
+    "batch",
+    "segment_nansum",
+    "segment_nanmean",
+    "segment_nanstd",
+    "segment_nanvar",
+    "segment_nanmin",
+    "segment_nanmax",
+    "segment_nanargmin",
+    "segment_nanargmax",
+    "segment_ss",
+    "segment_median",
+    "segment_nanmedian",
+    "segment_anynan",
+    "segment_allnan",
 ]
 
 
 def nanargmin(a, axis=None):
     "Slow nanargmin function used for unaccelerated dtypes."
+    a = np.asarray(a)
+    if a.dtype.kind in "mM":
+        return _nat_arg(np.argmin, a, axis, np.iinfo(np.int64).max)
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
         return np.nanargmin(a, axis=axis)
@@ -28,53 +50,171 @@ def nanargmin(a, axis=None):
 
 def nanargmax(a, axis=None):
     "Slow nanargmax function used for unaccelerated dtypes."
+    a = np.asarray(a)
+    if a.dtype.kind in "mM":
+        return _nat_arg(np.argmax, a, axis, np.iinfo(np.int64).min)
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
         return np.nanargmax(a, axis=axis)
 
 
-def nanvar(a, axis=None, ddof=0):
+def _nat_arg(func, a, axis, fill):
+    "argmin or argmax of datetime64 or timedelta64 that skips NaT"
+    mask = np.isnat(a)
+    if mask.all(axis=axis).any():
+        raise ValueError("All-NaT slice encountered")
+    b = a.astype(np.int64)
+    b[mask] = fill
+    return func(b, axis=axis)
+
+
+def nansum(a, axis=None, where=None):
+    "Slow nansum function used for unaccelerated dtypes."
+    where = True if where is None else where
+    return np.nansum(a, axis=axis, where=where)
+
+
+def nanmean(a, axis=None, where=None):
+    "Slow nanmean function used for unaccelerated dtypes."
+    where = True if where is None else where
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        return np.nanmean(a, axis=axis, where=where)
+
+
+def nanvar(a, axis=None, ddof=0, where=None):
     "Slow nanvar function used for unaccelerated dtypes."
+    where = True if where is None else where
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
-        return np.nanvar(a, axis=axis, ddof=ddof)
+        return np.nanvar(a, axis=axis, ddof=ddof, where=where)
 
 
-def nanstd(a, axis=None, ddof=0):
+def nanstd(a, axis=None, ddof=0, where=None):
     "Slow nanstd function used for unaccelerated dtypes."
+    where = True if where is None else where
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
-        return np.nanstd(a, axis=axis, ddof=ddof)
+        return np.nanstd(a, axis=axis, ddof=ddof, where=where)
 
 
-def nanmin(a, axis=None):
+def nanmin(a, axis=None, where=None):
     "Slow nanmin function used for unaccelerated dtypes."
-    with warnings.catch_warnings():
-        warnings.simplefilter("ignore")
-        return np.nanmin(a, axis=axis)
+    return _nanminmax(np.nanmin, a, axis, where)
 
 
-def nanmax(a, axis=None):
+def nanmax(a, axis=None, where=None):
     "Slow nanmax function used for unaccelerated dtypes."
+    return _nanminmax(np.nanmax, a, axis, where)
+
+
+def _nanminmax(func, a, axis, where):
+    "nanmin or nanmax that skips the elements `where` excludes"
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
-        return np.nanmax(a, axis=axis)
+        if where is None:
+            return func(a, axis=axis)
+        a = np.asarray(a)
+        where = np.broadcast_to(where, a.shape)
+        if a.dtype.kind == "f":
+            return func(np.where(where, a, np.nan), axis=axis)
+        if a.size == 0:
+            return func(a, axis=axis)
+        if not where.any(axis=axis).all():
+            raise ValueError("`where` must include an element of each slice")
+        initial = a.max() if func is np.nanmin else a.min()
+        return func(a, axis=axis, where=where, initial=initial)
 
 
-def median(a, axis=None):
+def median(a, axis=None, approx=False):
     "Slow median function used for unaccelerated dtypes."
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
         return np.median(a, axis=axis)
 
 
-def nanmedian(a, axis=None):
+def nanmedian(a, axis=None, approx=False):
     "Slow nanmedian function used for unaccelerated dtypes."
     with warnings.catch_warnings():
         warnings.simplefilter("ignore")
         return np.nanmedian(a, axis=axis)
 
 
+def nanquantile(a, q, axis=None, method="linear"):
+    "Slow nanquantile function used for unaccelerated dtypes."
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        return np.nanquantile(a, q, axis=axis, method=method)
+
+
+def nanpercentile(a, q, axis=None, method="linear"):
+    "Slow nanpercentile function used for unaccelerated dtypes."
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        return np.nanpercentile(a, q, axis=axis, method=method)
+
+
+def nanwsum(a, weights, axis=None):
+    "Slow nanwsum function used for unaccelerated dtypes."
+    a, w, dtype = _weighted(a, weights, axis)
+    return (a * w).sum(axis).astype(dtype)[()]
+
+
+def nanwmean(a, weights, axis=None):
+    "Slow nanwmean function used for unaccelerated dtypes."
+    a, w, dtype = _weighted(a, weights, axis)
+    sw = w.sum(axis)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        y = np.where(sw != 0, (a * w).sum(axis) / sw, np.nan)
+    return y.astype(dtype)[()]
+
+
+def nanwvar(a, weights, axis=None, ddof=0, reliability=False):
+    "Slow nanwvar function used for unaccelerated dtypes."
+    a, w, dtype = _weighted(a, weights, axis)
+    sw = w.sum(axis, keepdims=True)
+    with np.errstate(invalid="ignore", divide="ignore"):
+        mean = (a * w).sum(axis, keepdims=True) / sw
+        ss = (w * (a - mean) ** 2).sum(axis)
+        sw = sw.sum(axis)
+        if reliability:
+            divisor = sw - ddof * (w * w).sum(axis) / sw
+        else:
+            divisor = sw - ddof
+        y = np.where((sw != 0) & (divisor > 0), ss / divisor, np.nan)
+    return y.astype(dtype)[()]
+
+
+def nanwstd(a, weights, axis=None, ddof=0, reliability=False):
+    "Slow nanwstd function used for unaccelerated dtypes."
+    y = nanwvar(a, weights, axis=axis, ddof=ddof, reliability=reliability)
+    return np.sqrt(y)
+
+
+def _weighted(a, weights, axis):
+    "a and weights with zeros where a is NaN, and the output dtype"
+    a = np.asarray(a)
+    w = np.asarray(weights, dtype=np.float64)
+    if a.shape != w.shape:
+        if axis is None:
+            raise TypeError(
+                "Axis must be specified when shapes of a and weights differ."
+            )
+        if w.ndim != 1:
+            raise TypeError("1D weights expected when shapes of a and weights differ.")
+        if w.shape[0] != a.shape[axis]:
+            raise ValueError("Length of weights not compatible with specified axis.")
+        shape = [1] * a.ndim
+        shape[axis] = -1
+        w = np.broadcast_to(w.reshape(shape), a.shape)
+    dtype = a.dtype.newbyteorder("=") if a.dtype.kind == "f" else np.float64
+    if axis is None:
+        a = a.ravel()
+        w = w.ravel()
+    mask = np.isnan(a)
+    return np.where(mask, 0, a), np.where(mask, 0, w), dtype
+
+
 def ss(a, axis=None):
     "Slow sum of squares used for unaccelerated dtypes."
     a = np.asarray(a)
@@ -90,3 +230,193 @@ def anynan(a, axis=None):
 def allnan(a, axis=None):
     "Slow check for all Nans used for unaccelerated dtypes."
     return np.isnan(a).all(axis)
+
+
+def _nanmoments(a, axis=None, ddof=0):
+    "Slow count, mean and sum of squared deviations used by the accumulators."
+    a = np.asarray(a, dtype=np.float64)
+    if axis is None:
+        a = a.ravel()
+        axis = 0
+    mask = ~np.isnan(a)
+    count = mask.sum(axis)
+    with np.errstate(invalid="ignore"):
+        mean = np.where(mask, a, 0).sum(axis) / count
+    mean = np.where(count > 0, mean, 0)
+    ssqdm = np.zeros_like(mean)
+    if ddof > 1:
+        d = np.where(mask, a - np.expand_dims(mean, axis), 0)
+        ssqdm = (d * d).sum(axis)
+    return np.stack((count, mean, ssqdm), -1).astype(np.float64)
+
+
+def segment_nansum(a, offsets, axis=-1):
+    "Slow segment_nansum function used for unaccelerated dtypes."
+    a = np.asarray(a)
+    if a.dtype.kind in "biu":
+        dtype = np.uint64 if a.dtype.kind == "u" else np.int64
+    else:
+        dtype = a.dtype
+    return _segment(np.nansum, a, offsets, axis, dtype, 0)
+
+
+def segment_nanmean(a, offsets, axis=-1):
+    "Slow segment_nanmean function used for unaccelerated dtypes."
+    return _segment(np.nanmean, a, offsets, axis, None, np.nan)
+
+
+def segment_nanstd(a, offsets, axis=-1, ddof=0):
+    "Slow segment_nanstd function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return np.nanstd(b, axis=axis, ddof=ddof)
+
+    return _segment(func, a, offsets, axis, None, np.nan)
+
+
+def segment_nanvar(a, offsets, axis=-1, ddof=0):
+    "Slow segment_nanvar function used for unaccelerated dtypes."
+
+    def func(b, axis):
+        return np.nanvar(b, axis=axis, ddof=ddof)
+
+    return _segment(func, a, offsets, axis, None, np.nan)
+
+
+def segment_nanmin(a, offsets, axis=-1):
+    "Slow segment_nanmin function used for unaccelerated dtypes."
+    return _segment(np.nanmin, a, offsets, axis, "same", None)
+
+
+def segment_nanmax(a, offsets, axis=-1):
+    "Slow segment_nanmax function used for unaccelerated dtypes."
+    return _segment(np.nanmax, a, offsets, axis, "same", None)
+
+
+def segment_nanargmin(a, offsets, axis=-1):
+    "Slow segment_nanargmin function used for unaccelerated dtypes."
+    return _segment(_first_arg(np.nanmin), a, offsets, axis, np.intp, "raise")
+
+
+def segment_nanargmax(a, offsets, axis=-1):
+    "Slow segment_nanargmax function used for unaccelerated dtypes."
+    return _segment(_first_arg(np.nanmax), a, offsets, axis, np.intp, "raise")
+
+
+def segment_ss(a, offsets, axis=-1):
+    "Slow segment_ss function used for unaccelerated dtypes."
+    a = np.asarray(a)
+    if a.dtype.kind == "f" or a.dtype.type == np.int32:
+        dtype = a.dtype
+    else:
+        dtype = np.uint64 if a.dtype.kind == "u" else np.int64
+    return _segment(ss, a, offsets, axis, dtype, 0)
+
+
+def segment_median(a, offsets, axis=-1):
+    "Slow segment_median function used for unaccelerated dtypes."
+    return _segment(np.median, a, offsets, axis, None, np.nan)
+
+
+def segment_nanmedian(a, offsets, axis=-1):
+    "Slow segment_nanmedian function used for unaccelerated dtypes."
+    return _segment(np.nanmedian, a, offsets, axis, None, np.nan)
+
+
+def segment_anynan(a, offsets, axis=-1):
+    "Slow segment_anynan function used for unaccelerated dtypes."
+    return _segment(anynan, a, offsets, axis, bool, False)
+
+
+def segment_allnan(a, offsets, axis=-1):
+    "Slow segment_allnan function used for unaccelerated dtypes."
+    return _segment(allnan, a, offsets, axis, bool, True)
+
+
+def _first_arg(func):
+    """
+    Index of the first element equal to func, which unlike np.nanargmin
+    does not take the NaN in [nan, inf] for the minimum
+    """
+
+    def arg(b, axis):
+        if np.isnan(b).all(axis).any():
+            raise ValueError("All-NaN slice encountered")
+        return (b == func(b, axis=axis, keepdims=True)).argmax(axis)
+
+    return arg
+
+
+def _segment(func, a, offsets, axis, dtype, empty):
+    """
+    Apply func to each segment along the last axis. dtype is the output
+    dtype, with None for float64 or the float dtype of `a` and "same" for the
+    dtype of `a`. empty is the value of an empty segment, with None to raise
+    for integer input and to give NaN for float input, and "raise" to raise.
+    """
+    a = np.asarray(a)
+    offsets = np.asarray(offsets)
+    if offsets.dtype.kind not in "biu":
+        raise TypeError("`offsets` must be integers")
+    if axis is None:
+        raise ValueError("`axis` cannot be None")
+    a = np.moveaxis(a, axis, -1)
+    if offsets.ndim != 1 or offsets.size == 0:
+        raise ValueError("`offsets` must be 1d with at least one element")
+    if offsets[0] < 0 or offsets[-1] > a.shape[-1]:
+        raise ValueError("`offsets` must be within the length of `a` along `axis`")
+    if (np.diff(offsets) < 0).any():
+        raise ValueError("`offsets` must be nondecreasing")
+    if dtype is None:
+        dtype = a.dtype if a.dtype.kind == "f" else np.float64
+    elif dtype == "same":
+        dtype = a.dtype
+    nseg = offsets.size - 1
+    y = np.empty(a.shape[:-1] + (nseg,), dtype)
+    for s in range(nseg):
+        b = a[..., offsets[s] : offsets[s + 1]]
+        if b.shape[-1] == 0:
+            if empty is None and a.dtype.kind == "f":
+                y[..., s] = np.nan
+            elif empty is None or empty == "raise":
+                if y.size:
+                    raise ValueError("segment %d is empty" % s)
+            else:
+                y[..., s] = empty
+            continue
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore")
+            y[..., s] = func(b, axis=-1)
+    return np.moveaxis(y, -1, axis)
+
+
+def batch(func, arrays, axis=None, ddof=None, stack=False):
+    "Slow batch function used for unaccelerated dtypes."
+    name = func if isinstance(func, str) else getattr(func, "__name__", None)
+    if name not in _BATCH_FUNCS:
+        raise ValueError("batch does not support `func`=%r" % (func,))
+    kwargs = {}
+    if ddof is not None:
+        if name not in ("nanstd", "nanvar"):
+            raise TypeError("%s does not take `ddof`" % name)
+        kwargs["ddof"] = ddof
+    func = globals()[name]
+    y = [func(a, axis=axis, **kwargs) for a in arrays]
+    return np.array(y) if stack else y
+
+
+_BATCH_FUNCS = (
+    "nansum",
+    "nanmean",
+    "nanstd",
+    "nanvar",
+    "nanmin",
+    "nanmax",
+    "nanargmin",
+    "nanargmax",
+    "ss",
+    "median",
+    "nanmedian",
+    "anynan",
+    "allnan",
+)
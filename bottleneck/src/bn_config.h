@@ -0,0 +1,6 @@
+#define HAVE_ATTRIBUTE_OPTIMIZE_OPT_3 1
+/* undef inline */
+#define HAVE_THREAD_LOCAL 1
+#define BN_THREAD_LOCAL _Thread_local
+#define HAVE_FLOAT16 1
+#define HAVE_AVX2 1
@@ -64,6 +64,69 @@ def check_inline(cmd):
     return ""
 
 
+def check_thread_local(cmd):
+    """Return the thread local storage keyword (may be empty)."""
+    cmd._check_compiler()
+    body = textwrap.dedent(
+        """
+        static %(tls)s int counter = 0;
+        int main(void) {
+            counter++;
+            return counter - 1;
+        }
+        """
+    )
+
+    for kw in ["_Thread_local", "__thread", "__declspec(thread)"]:
+        st = cmd.try_compile(body % {"tls": kw}, None, None)
+        if st:
+            return kw
+
+    return ""
+
+
+def check_float16(cmd):
+    """Return True if the compiler supports the _Float16 type."""
+    cmd._check_compiler()
+    body = textwrap.dedent(
+        """
+        int main(void) {
+            volatile _Float16 x = 1;
+            volatile float y = x + x;
+            return y != 2;
+        }
+        """
+    )
+    return cmd.try_compile(body, None, None) != 0
+
+
+def check_avx2(cmd):
+    """Return True if functions may be compiled for AVX2 and picked at run
+    time."""
+    cmd._check_compiler()
+    body = textwrap.dedent(
+        """
+        #include <immintrin.h>
+
+        __attribute__((target("avx2,popcnt")))
+        static int lanes(const float *p)
+        {
+            const __m256i i = _mm256_srlv_epi32(_mm256_set1_epi32(0x76543210),
+                                                _mm256_setzero_si256());
+            __m256 v = _mm256_permutevar8x32_ps(_mm256_loadu_ps(p), i);
+            return __builtin_popcount(_mm256_movemask_ps(v));
+        }
+
+        int main(void)
+        {
+            float a[8] = {0};
+            return __builtin_cpu_supports("avx2") ? lanes(a) : 0;
+        }
+        """
+    )
+    return cmd.try_compile(body, None, None) != 0
+
+
 def check_gcc_function_attribute(cmd, attribute, name):
     """Return True if the given function attribute is supported."""
     cmd._check_compiler()
@@ -111,6 +174,9 @@ def create_config_h(config):
             output.append((config_attr, "0"))
 
     inline_alias = check_inline(config)
+    thread_local = check_thread_local(config)
+    have_float16 = check_float16(config)
+    have_avx2 = check_avx2(config)
 
     with open(config_h, "w") as f:
         for setting in output:
@@ -120,3 +186,13 @@ def create_config_h(config):
             f.write("/* undef inline */\n")
         else:
             f.write("#define inline {}\n".format(inline_alias))
+
+        if thread_local:
+            f.write("#define HAVE_THREAD_LOCAL 1\n")
+            f.write("#define BN_THREAD_LOCAL {}\n".format(thread_local))
+        else:
+            f.write("#define HAVE_THREAD_LOCAL 0\n")
+            f.write("#define BN_THREAD_LOCAL\n")
+
+        f.write("#define HAVE_FLOAT16 {}\n".format(int(have_float16)))
+        f.write("#define HAVE_AVX2 {}\n".format(int(have_avx2)))
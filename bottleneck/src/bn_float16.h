@@ -0,0 +1,18 @@
+// Copyright 2019 Bottleneck Developers
+#ifndef BN_FLOAT16_H_
+#define BN_FLOAT16_H_
+
+#include <bn_config.h>
+
+/* NumPy stores float16 as npy_uint16 bits. Where the compiler has a native
+ * half precision type the float16 functions use it; otherwise they are
+ * compiled against float so the templates still build, but they are never
+ * dispatched to and float16 input is converted to float32 in blocks instead
+ * (see bn_convert). Include after the numpy headers. */
+#if HAVE_FLOAT16
+    typedef _Float16 bn_float16;
+#else
+    typedef float bn_float16;
+#endif
+
+#endif  // BN_FLOAT16_H_
@@ -0,0 +1,59 @@
+// Copyright 2019 Bottleneck Developers
+#ifndef BN_POOL_H_
+#define BN_POOL_H_
+
+#include <Python.h>
+
+/* Settings and counters that one thread may change while others read them
+ * are Py_ssize_t and go through BN_LOAD, BN_STORE and bn_store_max, which
+ * are relaxed atomics in the free-threaded build. Elsewhere they are plain
+ * accesses of aligned words, as before. */
+#ifdef Py_GIL_DISABLED
+    #define BN_LOAD(x) _Py_atomic_load_ssize_relaxed(&(x))
+    #define BN_STORE(x, v) _Py_atomic_store_ssize_relaxed(&(x), (v))
+#else
+    #define BN_LOAD(x) (x)
+    #define BN_STORE(x, v) ((x) = (v))
+#endif
+
+/* sets *x to v if v is larger */
+static inline void
+bn_store_max(Py_ssize_t *x, Py_ssize_t v)
+{
+#ifdef Py_GIL_DISABLED
+    Py_ssize_t old = _Py_atomic_load_ssize_relaxed(x);
+    while (v > old && !_Py_atomic_compare_exchange_ssize(x, &old, v)) {
+    }
+#else
+    if (v > *x) *x = v;
+#endif
+}
+
+/*
+ Parallel kernels split their work into parts that bn_pool_run hands to the
+ pool of worker threads of bottleneck._pool (pool.c), with the calling
+ thread taking parts too. Size the split with bn_pool_parts, which never
+ asks for more parts than the pool has threads. bn_pool_api is what the
+ pool gives the modules that use it, through the capsule BN_POOL_CAPSULE.
+*/
+
+#define BN_POOL_MAX 256
+
+/* elements of work below which splitting costs more than it saves */
+#define BN_POOL_GRAIN (1 << 16)
+
+#define BN_POOL_CAPSULE "bottleneck._pool._C_API"
+
+/* runs part `part` of `nparts` */
+typedef void (*bn_part_t)(void *arg, int part, int nparts);
+
+typedef struct {
+    /* threads kernels may use, including the calling thread; read it with
+       BN_LOAD */
+    Py_ssize_t *threads;
+    /* runs the parts, on the workers if the pool is free; call with the
+       GIL released */
+    void (*run)(bn_part_t fn, void *arg, int nparts);
+} bn_pool_api;
+
+#endif  // BN_POOL_H_
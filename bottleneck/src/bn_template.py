@@ -9,7 +9,7 @@ def make_c_files(
     dirpath: Optional[str] = None, modules: Optional[List[str]] = None
 ) -> None:
     if modules is None:
-        modules = ["reduce", "move", "nonreduce", "nonreduce_axis"]
+        modules = ["reduce", "move", "nonreduce", "nonreduce_axis", "group"]
     if dirpath is None:
         dirpath = os.path.dirname(__file__)
     for module in modules:
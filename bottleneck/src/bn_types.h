@@ -0,0 +1,24 @@
+// Copyright 2019 Bottleneck Developers
+#ifndef BN_TYPES_H_
+#define BN_TYPES_H_
+
+#include <numpy/npy_common.h>
+#include "bn_float16.h"
+
+/* The templates name the C type of a dtype bn_<dtype>: NumPy's npy_<dtype>,
+ * except for float16, whose values NumPy only stores as bits */
+typedef npy_float64  bn_float64;
+typedef npy_float32  bn_float32;
+typedef npy_int64    bn_int64;
+typedef npy_int32    bn_int32;
+typedef npy_int16    bn_int16;
+typedef npy_int8     bn_int8;
+typedef npy_uint64   bn_uint64;
+typedef npy_uint32   bn_uint32;
+typedef npy_uint16   bn_uint16;
+typedef npy_uint8    bn_uint8;
+typedef npy_bool     bn_bool;
+typedef npy_intp     bn_intp;
+typedef npy_datetime bn_datetime;
+
+#endif  // BN_TYPES_H_
@@ -7,30 +7,127 @@
 #define NPY_NO_DEPRECATED_API NPY_1_11_API_VERSION
 #include <numpy/arrayobject.h>
 #include <bn_config.h>
+#include "bn_types.h"
+#include "bn_pool.h"
 
-/* THREADS=1 releases the GIL but increases function call
- * overhead. THREADS=0 does not release the GIL but keeps
- * function call overhead low. Curly brackets are for C89
- * support. */
-#define THREADS 1
-#if THREADS
-    #define BN_BEGIN_ALLOW_THREADS Py_BEGIN_ALLOW_THREADS {
-    #define BN_END_ALLOW_THREADS   ;} Py_END_ALLOW_THREADS
-#else
-    #define BN_BEGIN_ALLOW_THREADS {
-    #define BN_END_ALLOW_THREADS }
-#endif
+/* The GIL is released around loops over at least bn_gil_threshold
+ * elements, so that small calls do not pay to release it and take it back
+ * while large calls let other Python threads run. The threshold is set
+ * from Python with _set_gil_threshold; a negative threshold never releases
+ * the GIL. BN_BEGIN_ALLOW_THREADS counts the elements of the input `a`.
+ * Curly brackets are for C89 support. */
+#define BN_GIL_THRESHOLD 4096
+static Py_ssize_t bn_gil_threshold = BN_GIL_THRESHOLD;
+#define BN_BEGIN_ALLOW_THREADS_N(n) { \
+    PyThreadState *_save = NULL; \
+    Py_ssize_t _bn_gil = BN_LOAD(bn_gil_threshold); \
+    if (_bn_gil >= 0 && (Py_ssize_t)(n) >= _bn_gil) { \
+        _save = PyEval_SaveThread(); \
+    } {
+#define BN_END_ALLOW_THREADS ;} \
+    if (_save != NULL) PyEval_RestoreThread(_save); }
+#define BN_BEGIN_ALLOW_THREADS BN_BEGIN_ALLOW_THREADS_N(PyArray_SIZE(a))
 
 /* for ease of dtype templating */
 #define NPY_float64 NPY_FLOAT64
 #define NPY_float32 NPY_FLOAT32
+#define NPY_float16 NPY_FLOAT16
 #define NPY_int64   NPY_INT64
 #define NPY_int32   NPY_INT32
+#define NPY_int16   NPY_INT16
+#define NPY_int8    NPY_INT8
+#define NPY_uint64  NPY_UINT64
+#define NPY_uint32  NPY_UINT32
+#define NPY_uint16  NPY_UINT16
+#define NPY_uint8   NPY_UINT8
+#define NPY_bool    NPY_BOOL
 #define NPY_intp    NPY_INTP
-#define NPY_MAX_int64 NPY_MAX_INT64
-#define NPY_MAX_int32 NPY_MAX_INT32
-#define NPY_MIN_int64 NPY_MIN_INT64
-#define NPY_MIN_int32 NPY_MIN_INT32
+#define NPY_MAX_int64  NPY_MAX_INT64
+#define NPY_MAX_int32  NPY_MAX_INT32
+#define NPY_MAX_int16  NPY_MAX_INT16
+#define NPY_MAX_int8   NPY_MAX_INT8
+#define NPY_MAX_uint64 NPY_MAX_UINT64
+#define NPY_MAX_uint32 NPY_MAX_UINT32
+#define NPY_MAX_uint16 NPY_MAX_UINT16
+#define NPY_MAX_uint8  NPY_MAX_UINT8
+#define NPY_MAX_bool   1
+#define NPY_MIN_int64  NPY_MIN_INT64
+#define NPY_MIN_int32  NPY_MIN_INT32
+#define NPY_MIN_int16  NPY_MIN_INT16
+#define NPY_MIN_int8   NPY_MIN_INT8
+#define NPY_MIN_uint64 0
+#define NPY_MIN_uint32 0
+#define NPY_MIN_uint16 0
+#define NPY_MIN_uint8  0
+#define NPY_MIN_bool   0
+
+/* python scalar from a C integer of the given dtype */
+#define PyLong_From_int64  PyLong_FromLongLong
+#define PyLong_From_int32  PyLong_FromLongLong
+#define PyLong_From_int16  PyLong_FromLongLong
+#define PyLong_From_int8   PyLong_FromLongLong
+#define PyLong_From_uint64 PyLong_FromUnsignedLongLong
+#define PyLong_From_uint32 PyLong_FromUnsignedLongLong
+#define PyLong_From_uint16 PyLong_FromUnsignedLongLong
+#define PyLong_From_uint8  PyLong_FromUnsignedLongLong
+#define PyLong_From_bool   PyBool_FromLong
+
+/*
+ The dispatchers (reducer, mover, nonreducer, nonreducer_axis) take one
+ function per dtype, in the order given by BN_DTYPE_TABLE. bn_dtype_index
+ returns the position of the dtype of `a` in that table, or -1 if there is
+ no C function for it, in which case the dispatcher calls bottleneck.slow.
+ Input that bn_convert flags has the index of the dtype it is converted to;
+ the dispatchers pass it through bn_blocks (see below).
+
+ datetime64 and timedelta64 come last. Only the functions that make sense
+ for them (BN_DATETIME_TABLE) fill those slots; in the other tables they are
+ NULL, which the dispatchers also send to bottleneck.slow. Both use the same
+ `datetime` function, which works on the int64 storage with NaT as missing.
+*/
+
+#define BN_NDTYPES 14
+
+/* bn_dtype_index is below this for the numeric dtypes, which are all but
+   datetime64 and timedelta64 */
+#define BN_NUMERIC_DTYPES 12
+
+#define BN_DTYPE_FUNCS(prefix) \
+    prefix##float64, prefix##float32, prefix##int64, prefix##int32, \
+    prefix##float16, prefix##int16, prefix##int8, prefix##uint64, \
+    prefix##uint32, prefix##uint16, prefix##uint8, prefix##bool
+
+#define BN_DTYPE_TABLE(prefix) {BN_DTYPE_FUNCS(prefix)}
+
+#define BN_DATETIME_TABLE(prefix) \
+    {BN_DTYPE_FUNCS(prefix), prefix##datetime, prefix##datetime}
+
+static inline int
+bn_dtype_index(PyArrayObject *a)
+{
+    switch (PyArray_TYPE(a)) {
+        case NPY_FLOAT64:   return 0;
+        case NPY_FLOAT32:   return 1;
+        case NPY_INT64:     return 2;
+        case NPY_INT32:     return 3;
+#if HAVE_FLOAT16
+        case NPY_FLOAT16:   return 4;
+#else
+        /* converted to float32 (see bn_convert) */
+        case NPY_FLOAT16:   return 1;
+#endif
+        case NPY_INT16:     return 5;
+        case NPY_INT8:      return 6;
+        case NPY_UINT64:    return 7;
+        case NPY_UINT32:    return 8;
+        case NPY_UINT16:    return 9;
+        case NPY_UINT8:     return 10;
+        case NPY_BOOL:      return 11;
+        case NPY_DATETIME:  return 12;
+        case NPY_TIMEDELTA: return 13;
+        default:            return -1;
+    }
+}
 
 #if PY_MAJOR_VERSION >= 3
     #define PyString_FromString PyBytes_FromString
@@ -78,93 +175,131 @@ static inline float __bn_nanf(void)
 #define F_CONTIGUOUS(a) PyArray_CHKFLAGS(a, NPY_ARRAY_F_CONTIGUOUS)
 #define IS_CONTIGUOUS(a) (C_CONTIGUOUS(a) || F_CONTIGUOUS(a))
 
-/* WIRTH ----------------------------------------------------------------- */
+/* median networks ------------------------------------------------------- */
 
 /*
- WIRTH macro based on:
+ Median selection networks for 3, 5, 7 and 9 values, based on opt_med3,
+ opt_med5, opt_med7 and opt_med9 from:
    Fast median search: an ANSI C implementation
    Nicolas Devillard - ndevilla AT free DOT fr
    July 1998
- which, in turn, took the algorithm from
-   Wirth, Niklaus
-   Algorithms + data structures = programs, p. 366
-   Englewood Cliffs: Prentice-Hall, 1976
 
- Adapted for Bottleneck:
- (C) 2016 Keith Goodman
+ After MEDIAN_NETn(dtype, p) the median of p[0] ... p[n - 1] is in p[n / 2]
+ and the other values are scrambled. SORT2 has no branches so the input must
+ not contain NaNs.
 */
 
-#define WIRTH(dtype) \
-    x = B(dtype, k); \
-    i = l; \
-    j = r; \
-    do { \
-        while (B(dtype, i) < x) i++; \
-        while (x < B(dtype, j)) j--; \
-        if (i <= j) { \
-            npy_##dtype atmp = B(dtype, i); \
-            B(dtype, i) = B(dtype, j); \
-            B(dtype, j) = atmp; \
-            i++; \
-            j--; \
+#define SORT2(dtype, a, b) { \
+    const bn_##dtype a_ = (a); \
+    const bn_##dtype b_ = (b); \
+    (a) = a_ < b_ ? a_ : b_; \
+    (b) = a_ > b_ ? a_ : b_; \
+}
+
+#define MEDIAN_NET3(dtype, p) \
+    SORT2(dtype, p[0], p[1]) SORT2(dtype, p[1], p[2]) \
+    SORT2(dtype, p[0], p[1])
+
+#define MEDIAN_NET5(dtype, p) \
+    SORT2(dtype, p[0], p[1]) SORT2(dtype, p[3], p[4]) \
+    SORT2(dtype, p[0], p[3]) SORT2(dtype, p[1], p[4]) \
+    SORT2(dtype, p[1], p[2]) SORT2(dtype, p[2], p[3]) \
+    SORT2(dtype, p[1], p[2])
+
+#define MEDIAN_NET7(dtype, p) \
+    SORT2(dtype, p[0], p[5]) SORT2(dtype, p[0], p[3]) \
+    SORT2(dtype, p[1], p[6]) SORT2(dtype, p[2], p[4]) \
+    SORT2(dtype, p[0], p[1]) SORT2(dtype, p[3], p[5]) \
+    SORT2(dtype, p[2], p[6]) SORT2(dtype, p[2], p[3]) \
+    SORT2(dtype, p[3], p[6]) SORT2(dtype, p[4], p[5]) \
+    SORT2(dtype, p[1], p[4]) SORT2(dtype, p[1], p[3]) \
+    SORT2(dtype, p[3], p[4])
+
+#define MEDIAN_NET9(dtype, p) \
+    SORT2(dtype, p[1], p[2]) SORT2(dtype, p[4], p[5]) \
+    SORT2(dtype, p[7], p[8]) SORT2(dtype, p[0], p[1]) \
+    SORT2(dtype, p[3], p[4]) SORT2(dtype, p[6], p[7]) \
+    SORT2(dtype, p[1], p[2]) SORT2(dtype, p[4], p[5]) \
+    SORT2(dtype, p[7], p[8]) SORT2(dtype, p[0], p[3]) \
+    SORT2(dtype, p[5], p[8]) SORT2(dtype, p[4], p[7]) \
+    SORT2(dtype, p[3], p[6]) SORT2(dtype, p[1], p[4]) \
+    SORT2(dtype, p[2], p[5]) SORT2(dtype, p[4], p[7]) \
+    SORT2(dtype, p[4], p[2]) SORT2(dtype, p[6], p[4]) \
+    SORT2(dtype, p[4], p[2])
+
+/* module state ---------------------------------------------------------- */
+
+/*
+ Each module keeps the Python objects its functions use in its module state
+ rather than in process globals that threads would race to fill: the
+ bottleneck.slow module and the interned names of the keyword arguments the
+ functions parse. A module defines `module_state`, a struct of PyObject
+ pointers that starts with `slow`, fills it in its Py_mod_exec function and
+ finds it from the module object (`self`) its functions are called with.
+ MODULE_STATE_FUNCS defines the m_traverse, m_clear and m_free functions of
+ its PyModuleDef and MODULE_SLOTS the slots every module shares. The
+ modules do not rely on the GIL, so free-threaded Python keeps it off when
+ they are imported.
+*/
+
+#define STATE(module) ((module_state *)PyModule_GetState(module))
+
+#define MODULE_STATE_LENGTH (sizeof(module_state) / sizeof(PyObject *))
+
+#define MODULE_STATE_FUNCS \
+    static int \
+    module_traverse(PyObject *m, visitproc visit, void *arg) \
+    { \
+        PyObject **p = (PyObject **)STATE(m); \
+        size_t i; \
+        for (i = 0; p != NULL && i < MODULE_STATE_LENGTH; i++) { \
+            Py_VISIT(p[i]); \
         } \
-    } while (i <= j); \
-    if (j < k) l = i; \
-    if (k < i) r = j;
-
-/* partition ------------------------------------------------------------- */
-
-#define PARTITION(dtype) \
-    while (l < r) { \
-        npy_##dtype x; \
-        npy_##dtype al = B(dtype, l); \
-        npy_##dtype ak = B(dtype, k); \
-        npy_##dtype ar = B(dtype, r); \
-        if (al > ak) { \
-            if (ak < ar) { \
-                if (al < ar) { \
-                    B(dtype, k) = al; \
-                    B(dtype, l) = ak; \
-                } else { \
-                    B(dtype, k) = ar; \
-                    B(dtype, r) = ak; \
-                } \
-            } \
-        } else { \
-            if (ak > ar) { \
-                if (al > ar) { \
-                    B(dtype, k) = al; \
-                    B(dtype, l) = ak; \
-                } else { \
-                    B(dtype, k) = ar; \
-                    B(dtype, r) = ak; \
-                } \
-            } \
+        return 0; \
+    } \
+    static int \
+    module_clear(PyObject *m) \
+    { \
+        PyObject **p = (PyObject **)STATE(m); \
+        size_t i; \
+        for (i = 0; p != NULL && i < MODULE_STATE_LENGTH; i++) { \
+            Py_CLEAR(p[i]); \
         } \
-        WIRTH(dtype) \
+        return 0; \
+    } \
+    static void \
+    module_free(void *m) \
+    { \
+        module_clear((PyObject *)m); \
     }
 
-/* slow ------------------------------------------------------------------ */
+#if PY_VERSION_HEX >= 0x030C0000
+    /* sub-interpreters that share the GIL, such as those of mod_wsgi, may
+       import the modules; the settings, such as the thread count and the
+       GIL threshold, and the thread pool are process globals, so those
+       with their own GIL may not */
+    #define BN_SLOT_INTERPRETERS \
+        {Py_mod_multiple_interpreters, \
+         Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#else
+    #define BN_SLOT_INTERPRETERS
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    #define BN_SLOT_GIL {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#else
+    #define BN_SLOT_GIL
+#endif
+#define MODULE_SLOTS BN_SLOT_INTERPRETERS BN_SLOT_GIL
 
-static PyObject *slow_module = NULL;
+/* slow ------------------------------------------------------------------ */
 
+/* calls bottleneck.slow.<name>, given as `slow_module` from module state */
 static PyObject *
-slow(char *name, PyObject *args, PyObject *kwds)
+slow(PyObject *slow_module, char *name, PyObject *args, PyObject *kwds)
 {
     PyObject *func = NULL;
     PyObject *out = NULL;
 
-    if (slow_module == NULL) {
-        /* bottleneck.slow has not been imported during the current
-         * python session. Only import it once per session to save time */
-        slow_module = PyImport_ImportModule("bottleneck.slow");
-        if (slow_module == NULL) {
-            PyErr_SetString(PyExc_RuntimeError,
-                            "Cannot import bottleneck.slow");
-            return NULL;
-        }
-    }
-
     func = PyObject_GetAttrString(slow_module, name);
     if (func == NULL) {
         PyErr_Format(PyExc_RuntimeError,
@@ -188,4 +323,397 @@ slow(char *name, PyObject *args, PyObject *kwds)
     return out;
 }
 
+/* scratch --------------------------------------------------------------- */
+
+/*
+ Temporary buffers (median, nanmedian, argpartition, move_median, move_min,
+ ...) are taken from a per-thread arena that is kept between calls, so small
+ arrays do not pay for a malloc and free on every call. Requests larger than
+ BN_SCRATCH_KEEP bytes are malloc'd and freed as before. Each extension
+ module has its own arena, which is freed when the thread exits (except on
+ Windows, where it is kept until release_scratch). Call bn_scratch_get and
+ bn_scratch_put with the GIL held; the buffer may be used after the GIL is
+ released.
+*/
+
+#define BN_SCRATCH_KEEP (1 << 20)
+
+#if HAVE_THREAD_LOCAL
+static BN_THREAD_LOCAL void   *bn_scratch_buf = NULL;
+static BN_THREAD_LOCAL size_t  bn_scratch_size = 0;
+
+#ifndef _WIN32
+#include <pthread.h>
+
+/* the arena of a thread is also its value of bn_scratch_key, whose
+   destructor frees it when the thread exits */
+static pthread_key_t bn_scratch_key;
+static pthread_once_t bn_scratch_once = PTHREAD_ONCE_INIT;
+static int bn_scratch_keyed = 0;
+
+static void
+bn_scratch_key_create(void)
+{
+    bn_scratch_keyed = pthread_key_create(&bn_scratch_key, free) == 0;
+}
+#endif
+
+/* makes `buf`, of `size` bytes or NULL, the arena of the calling thread */
+static inline void
+bn_scratch_set(void *buf, size_t size)
+{
+    bn_scratch_buf = buf;
+    bn_scratch_size = buf == NULL ? 0 : size;
+#ifndef _WIN32
+    pthread_once(&bn_scratch_once, bn_scratch_key_create);
+    if (bn_scratch_keyed) pthread_setspecific(bn_scratch_key, buf);
+#endif
+}
+#endif
+
+/* largest request since import, in bytes */
+static Py_ssize_t bn_scratch_high_water = 0;
+
+/* returns NULL if out of memory */
+static inline void *
+bn_scratch_get(size_t size)
+{
+    if (size == 0) size = 1;
+    bn_store_max(&bn_scratch_high_water, (Py_ssize_t)size);
+#if HAVE_THREAD_LOCAL
+    if (size <= bn_scratch_size) {
+        return bn_scratch_buf;
+    }
+    if (size <= BN_SCRATCH_KEEP) {
+        /* grow geometrically so slowly growing inputs rarely reallocate */
+        size_t new_size = 2 * bn_scratch_size;
+        if (new_size < size) new_size = size;
+        if (new_size > BN_SCRATCH_KEEP) new_size = BN_SCRATCH_KEEP;
+        free(bn_scratch_buf);
+        bn_scratch_set(malloc(new_size), new_size);
+        return bn_scratch_buf;
+    }
+#endif
+    return malloc(size);
+}
+
+static inline void
+bn_scratch_put(void *buffer)
+{
+#if HAVE_THREAD_LOCAL
+    if (buffer == bn_scratch_buf) return;
+#endif
+    free(buffer);
+}
+
+static PyObject *
+release_scratch(PyObject *self, PyObject *args)
+{
+#if HAVE_THREAD_LOCAL
+    free(bn_scratch_buf);
+    bn_scratch_set(NULL, 0);
+#endif
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+scratch_high_water(PyObject *self, PyObject *args)
+{
+    return PyLong_FromSsize_t(BN_LOAD(bn_scratch_high_water));
+}
+
+#define SCRATCH_METHODS \
+    {"_release_scratch", (PyCFunction)release_scratch, METH_NOARGS, NULL}, \
+    {"_scratch_high_water", (PyCFunction)scratch_high_water, METH_NOARGS, \
+     NULL},
+
+/* thread pool ----------------------------------------------------------- */
+
+/*
+ All modules share the thread pool of bottleneck._pool (see bn_pool.h),
+ whose bn_pool_api each module takes in bn_pool_init when it is imported.
+ Call bn_pool_run with the GIL released.
+*/
+
+static const bn_pool_api *bn_pool = NULL;
+
+/* how many parts to split `work` elements into, at most one per output
+   `nout` and one per thread */
+static inline int
+bn_pool_parts(npy_intp nout, npy_intp work)
+{
+    const Py_ssize_t threads = BN_LOAD(*bn_pool->threads);
+    npy_intp n = work / BN_POOL_GRAIN;
+    if (n > nout) n = nout;
+    if (n > threads) n = threads;
+    return n < 1 ? 1 : (int)n;
+}
+
+static inline void
+bn_pool_run(bn_part_t fn, void *arg, int nparts)
+{
+    if (nparts > 1) {
+        bn_pool->run(fn, arg, nparts);
+    } else {
+        fn(arg, 0, 1);
+    }
+}
+
+/* takes the pool of bottleneck._pool; call from the module exec function */
+static inline int
+bn_pool_init(void)
+{
+    /* PyCapsule_Import would look for _pool as an attribute of the
+       bottleneck package, which is not set while the package imports */
+    PyObject *capsule = NULL;
+    PyObject *pool = PyImport_ImportModule("bottleneck._pool");
+    if (pool != NULL) {
+        capsule = PyObject_GetAttrString(pool, "_C_API");
+        Py_DECREF(pool);
+    }
+    if (capsule == NULL) {
+        return -1;
+    }
+    bn_pool = PyCapsule_GetPointer(capsule, BN_POOL_CAPSULE);
+    Py_DECREF(capsule);
+    return bn_pool == NULL ? -1 : 0;
+}
+
+/* _set_gil_threshold(n) sets bn_gil_threshold of this module and returns
+   the old value */
+static PyObject *
+set_gil_threshold(PyObject *self, PyObject *arg)
+{
+    Py_ssize_t old = BN_LOAD(bn_gil_threshold);
+    Py_ssize_t n = PyArray_PyIntAsIntp(arg);
+    if (error_converting(n)) return NULL;
+    BN_STORE(bn_gil_threshold, n);
+    return PyLong_FromSsize_t(old);
+}
+
+#define THREAD_METHODS \
+    {"_set_gil_threshold", (PyCFunction)set_gil_threshold, METH_O, NULL},
+
+/* converted input ------------------------------------------------------- */
+
+/*
+ Input that the C functions cannot read directly is converted to their
+ working dtype (bn_work_descr) and given to them in blocks of rows:
+
+ - byte swapped input (e.g. big-endian data on a little-endian machine) is
+   converted to native byte order
+ - unaligned input (e.g. a field of a packed structured array) is copied to
+   aligned memory, which the typed kernels assume
+ - float16 input is converted to float32 when the compiler has no _Float16
+
+ Every other dtype without a C function (complex, longdouble, object, ...)
+ still goes to bottleneck.slow: no working dtype gives NumPy's results for
+ them, e.g. complex nanmin orders by real part and then imaginary part.
+
+ Each block is converted into a buffer of about BN_BLOCK_BYTES that is
+ reused for the next block, and the result of each block is copied into the
+ output, so the extra memory does not grow with the size of the input. A
+ block holds at least one row along `axis`, so the input is converted in one
+ piece when it has no other dimension to split (1d input along its axis).
+ Reductions over all axes, and so of 1d input, are instead streamed through
+ bottleneck/_convert.py, which combines the results of flat blocks as the
+ accumulators do; median and nanmedian, which need all of the data at once,
+ still get one converted copy.
+*/
+
+#define BN_BLOCK_BYTES (1 << 18)
+
+/* what the function does with each block */
+typedef enum {
+    BN_BLOCK_REDUCE,  /* returns the block reduced along axis */
+    BN_BLOCK_KEEP,    /* returns an array with the shape of the block */
+    BN_BLOCK_INPLACE  /* modifies the block, which is copied back to `a` */
+} bn_block_mode;
+
+/* calls the C function on one block; `args` holds the other arguments */
+typedef PyObject *(*bn_block_t)(PyArrayObject *a, void *args);
+
+/* does `a` have to be converted before the C functions see it? */
+static inline int
+bn_convert(PyArrayObject *a)
+{
+#if !HAVE_FLOAT16
+    if (PyArray_TYPE(a) == NPY_FLOAT16) return 1;
+#endif
+    return PyArray_ISBYTESWAPPED(a) || !PyArray_ISALIGNED(a);
+}
+
+/* the dtype the C functions work in; returns a new reference */
+static inline PyArray_Descr *
+bn_work_descr(PyArrayObject *a)
+{
+#if !HAVE_FLOAT16
+    if (PyArray_TYPE(a) == NPY_FLOAT16) {
+        return PyArray_DescrFromType(NPY_FLOAT32);
+    }
+#endif
+    return PyArray_DescrNewByteorder(PyArray_DESCR(a), NPY_NATIVE);
+}
+
+/* copy of `a` in the working dtype */
+static inline PyArrayObject *
+bn_converted(PyArrayObject *a)
+{
+    PyArray_Descr *descr = bn_work_descr(a);
+    if (descr == NULL) return NULL;
+    return (PyArrayObject *)PyArray_FromArray(a, descr, NPY_ARRAY_ENSURECOPY);
+}
+
+/* view of a[..., start:start + n, ...] where the slice is on dimension dim */
+static inline PyArrayObject *
+bn_slice(PyArrayObject *a, int dim, npy_intp start, npy_intp n)
+{
+    npy_intp shape[NPY_MAXDIMS];
+    PyArray_Descr *descr = PyArray_DESCR(a);
+    PyObject *view;
+    memcpy(shape, PyArray_SHAPE(a), PyArray_NDIM(a) * sizeof(npy_intp));
+    shape[dim] = n;
+    Py_INCREF(descr);
+    view = PyArray_NewFromDescr(&PyArray_Type, descr, PyArray_NDIM(a), shape,
+                                PyArray_STRIDES(a),
+                                PyArray_BYTES(a) +
+                                start * PyArray_STRIDE(a, dim),
+                                PyArray_FLAGS(a) & NPY_ARRAY_WRITEABLE,
+                                NULL);
+    if (view == NULL) return NULL;
+    Py_INCREF(a);
+    if (PyArray_SetBaseObject((PyArrayObject *)view, (PyObject *)a) < 0) {
+        Py_DECREF(view);
+        return NULL;
+    }
+    return (PyArrayObject *)view;
+}
+
+/* calls func on `a`, converted one block at a time; axis is -1 if func works
+   element by element */
+static PyObject *
+bn_blocks(PyArrayObject *a,
+          int axis,
+          bn_block_mode mode,
+          bn_block_t func,
+          void *args)
+{
+    const int ndim = PyArray_NDIM(a);
+    const int dim = axis == 0 ? 1 : 0;
+    const int ydim = mode == BN_BLOCK_REDUCE && dim > axis ? dim - 1 : dim;
+    npy_intp shape[NPY_MAXDIMS];
+    npy_intp n, step, start, m, row;
+    PyArray_Descr *descr;
+    PyArrayObject *block = NULL, *src = NULL, *dst = NULL, *ys = NULL;
+    PyObject *r = NULL, *y = NULL;
+
+    n = dim < ndim ? PyArray_DIM(a, dim) : 0;
+    row = n > 0 ? PyArray_NBYTES(a) / n : 0;
+    step = row > 0 ? BN_BLOCK_BYTES / row : 0;
+    if (step < 1) step = 1;
+    if (n == 0 || row == 0 || step >= n) {
+        /* one block */
+        block = bn_converted(a);
+        if (block == NULL) return NULL;
+        y = func(block, args);
+        if (y != NULL && mode == BN_BLOCK_INPLACE) {
+            Py_DECREF(y);
+            y = NULL;
+            if (PyArray_CopyInto(a, block) == 0) {
+                Py_INCREF(a);
+                y = (PyObject *)a;
+            }
+        } else if (y != NULL && PyArray_Check(y) &&
+                   PyArray_TYPE((PyArrayObject *)y) == PyArray_TYPE(block) &&
+                   PyArray_TYPE((PyArrayObject *)y) != PyArray_TYPE(a)) {
+            r = PyArray_Cast((PyArrayObject *)y, PyArray_TYPE(a));
+            Py_DECREF(y);
+            y = r;
+        }
+        Py_DECREF(block);
+        return y;
+    }
+
+    descr = bn_work_descr(a);
+    if (descr == NULL) return NULL;
+    memcpy(shape, PyArray_SHAPE(a), ndim * sizeof(npy_intp));
+    shape[dim] = step;
+    block = (PyArrayObject *)PyArray_Empty(ndim, shape, descr, 0);
+    if (block == NULL) return NULL;
+
+    for (start = 0; start < n; start += step) {
+        m = n - start < step ? n - start : step;
+        src = bn_slice(a, dim, start, m);
+        if (src == NULL) goto error;
+        dst = bn_slice(block, dim, 0, m);
+        if (dst == NULL) goto error;
+        if (PyArray_CopyInto(dst, src) < 0) goto error;
+        r = func(dst, args);
+        if (r == NULL) goto error;
+        if (mode == BN_BLOCK_INPLACE) {
+            if (PyArray_CopyInto(src, dst) < 0) goto error;
+        } else {
+            if (y == NULL) {
+                /* the output takes its dtype from the first block, except
+                   that output in the working dtype goes back to the dtype
+                   of `a` (float16 stays float16) */
+                PyArrayObject *r0 = (PyArrayObject *)r;
+                memcpy(shape, PyArray_SHAPE(r0),
+                       PyArray_NDIM(r0) * sizeof(npy_intp));
+                shape[ydim] = n;
+                if (PyArray_TYPE(r0) == PyArray_TYPE(block) &&
+                    PyArray_TYPE(r0) != PyArray_TYPE(a)) {
+                    descr = PyArray_DescrFromType(PyArray_TYPE(a));
+                } else {
+                    descr = PyArray_DESCR(r0);
+                    Py_INCREF(descr);
+                }
+                y = PyArray_Empty(PyArray_NDIM(r0), shape, descr, 0);
+                if (y == NULL) goto error;
+            }
+            ys = bn_slice((PyArrayObject *)y, ydim, start, m);
+            if (ys == NULL) goto error;
+            if (PyArray_CopyInto(ys, (PyArrayObject *)r) < 0) goto error;
+            Py_CLEAR(ys);
+        }
+        Py_CLEAR(r);
+        Py_CLEAR(src);
+        Py_CLEAR(dst);
+    }
+    Py_DECREF(block);
+    if (mode == BN_BLOCK_INPLACE) {
+        Py_INCREF(a);
+        return (PyObject *)a;
+    }
+    return y;
+
+error:
+    Py_XDECREF(ys);
+    Py_XDECREF(r);
+    Py_XDECREF(src);
+    Py_XDECREF(dst);
+    Py_XDECREF(y);
+    Py_DECREF(block);
+    return NULL;
+}
+
+/* mapped files ---------------------------------------------------------- */
+
+/* is the memory of `a` a mapped file, such as that of an np.memmap? */
+static inline int
+bn_file_backed(PyArrayObject *a)
+{
+    PyObject *base = PyArray_BASE(a);
+    while (base != NULL) {
+        if (PyArray_Check(base)) {
+            base = PyArray_BASE((PyArrayObject *)base);
+        } else if (PyMemoryView_Check(base)) {
+            base = PyMemoryView_GET_BUFFER(base)->obj;
+        } else {
+            break;
+        }
+    }
+    return base != NULL && strcmp(Py_TYPE(base)->tp_name, "mmap.mmap") == 0;
+}
+
 #endif  // BOTTLENECK_H_
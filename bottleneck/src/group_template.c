@@ -0,0 +1,1572 @@
+// Copyright 2019 Bottleneck Developers
+#include "bottleneck.h"
+#include "iterators.h"
+
+/*
+ Group functions reduce `a` along `axis` separately for each integer label
+ in `labels`, a 1d array with the length of `a` along `axis`. The output has
+ the shape of `a` with `ngroups` along `axis`. Each slice along `axis` is
+ read once; the running sums, counts and extremes of all groups are kept in
+ dense arrays with one element per group that are reset for each slice.
+ Negative labels are skipped.
+*/
+
+/* function signatures --------------------------------------------------- */
+
+/*
+ Each group function is given as three low-level pieces that group_run puts
+ together. The accumulators of all groups, `size` bytes per group, are kept
+ by the caller; GROUP_ACC resets them and accumulates the elements of a
+ slice, or of a range of one, GROUP_MERGE merges into them the accumulators
+ of the range that follows, and GROUP_OUT writes the output of the groups.
+*/
+
+/* resets `acc` and accumulates the elements of `it` */
+#define GROUP_ACC(name, dtype) \
+    static inline void \
+    name##_acc_##dtype(char *acc, \
+                       group_slice it, \
+                       const npy_intp *labels, \
+                       npy_intp ngroups)
+
+/* merges the accumulators `other` of the range after that of `acc` */
+#define GROUP_MERGE(name, dtype) \
+    static void \
+    name##_merge_##dtype(char *acc, const char *other, npy_intp ngroups)
+
+/* writes the output of the slice `it`; returns -1 or, for integer input,
+   the first empty group, which has no output */
+#define GROUP_OUT(name, dtype) \
+    static inline npy_intp \
+    name##_out_##dtype(const char *acc, \
+                       group_slice it, \
+                       npy_intp ngroups, \
+                       int ddof)
+
+/* the slices of a part of a split by slices; see group_run */
+#define GROUP_SLICES(name, dtype) \
+    static void \
+    name##_slices_##dtype(void *arg, int part, int nparts) \
+    { \
+        group_part_t *p = (group_part_t *)arg; \
+        char *acc = p->buffer + part * p->stride; \
+        iter2 it = *p->it; \
+        const npy_intp end = it.nits * (part + 1) / nparts; \
+        npy_intp empty = -1; \
+        iter2_seek(&it, it.nits * part / nparts); \
+        while (it.its < end && empty < 0) { \
+            name##_acc_##dtype(acc, group_range(&it, 0, it.length), \
+                               p->labels, p->ngroups); \
+            empty = name##_out_##dtype(acc, group_range(&it, 0, 0), \
+                                       p->ngroups, p->ddof); \
+            NEXT2 \
+        } \
+        p->empty[part] = empty; \
+    }
+
+/* low-level functions such as group_nansum_float64, with output of type
+   `out` and `size` bytes of accumulators per group */
+#define GROUP(name, dtype, out, size) \
+    GROUP_SLICES(name, dtype) \
+    static PyObject * \
+    name##_##dtype(PyArrayObject *a, \
+                   const npy_intp *labels, \
+                   npy_intp ngroups, \
+                   int axis, \
+                   int ddof) \
+    { \
+        static const group_kernel kernel = {name##_acc_##dtype, \
+                                            name##_merge_##dtype, \
+                                            name##_out_##dtype, \
+                                            name##_slices_##dtype, \
+                                            size}; \
+        return group_run(a, labels, ngroups, axis, ddof, NPY_##out, \
+                         &kernel, #name); \
+    }
+
+/* top-level functions such as group_nansum */
+#define GROUP_MAIN(name, has_ddof) \
+    static PyObject * \
+    name(PyObject *self, PyObject *args, PyObject *kwds) \
+    { \
+        static const fgroup_t fgroup[BN_NDTYPES] = BN_DTYPE_TABLE(name##_); \
+        return grouper(self, #name, args, kwds, fgroup, has_ddof); \
+    }
+
+/* typedefs and prototypes ----------------------------------------------- */
+
+typedef PyObject *(*fgroup_t)(PyArrayObject *a,
+                              const npy_intp *labels,
+                              npy_intp ngroups,
+                              int axis,
+                              int ddof);
+
+/* a slice of `a`, or a range of one, and the output of the slice, with the
+   fields of an iterator that FOR, AI and YX read */
+typedef struct {
+    char       *pa;
+    char       *py;
+    Py_ssize_t astride;
+    Py_ssize_t ystride;
+    Py_ssize_t length;
+    npy_intp   i;
+} group_slice;
+
+typedef struct {
+    void (*acc)(char *, group_slice, const npy_intp *, npy_intp);
+    void (*merge)(char *, const char *, npy_intp);
+    npy_intp (*out)(const char *, group_slice, npy_intp, int);
+    bn_part_t slices;
+    size_t size;
+} group_kernel;
+
+/* a group function run in parts by the thread pool; see group_run */
+typedef struct {
+    const group_kernel *kernel;
+    const iter2 *it;          /* at the first slice, or at the split one */
+    const npy_intp *labels;
+    npy_intp ngroups;
+    int ddof;
+    char *buffer;             /* the accumulators of part q are at */
+    size_t stride;            /* buffer + q * stride */
+    npy_intp empty[BN_POOL_MAX + 1];
+} group_part_t;
+
+/* elements [i0, i1) of the slice at `it` */
+static inline group_slice
+group_range(const iter2 *it, npy_intp i0, npy_intp i1)
+{
+    group_slice s;
+    s.pa = it->pa + i0 * it->astride;
+    s.py = it->py;
+    s.astride = it->astride;
+    s.ystride = it->ystride;
+    s.length = i1 - i0;
+    s.i = 0;
+    return s;
+}
+
+static PyObject *
+group_run(PyArrayObject *a,
+          const npy_intp *labels,
+          npy_intp ngroups,
+          int axis,
+          int ddof,
+          int type,
+          const group_kernel *kernel,
+          const char *name);
+
+static PyObject *
+grouper(PyObject *self,
+        char *name,
+        PyObject *args,
+        PyObject *kwds,
+        const fgroup_t *fgroup,
+        int has_ddof);
+
+/* output with the shape of `a` with ngroups along axis */
+static inline PyObject *
+group_output(PyArrayObject *a, int axis, npy_intp ngroups, int type)
+{
+    npy_intp shape[NPY_MAXDIMS];
+    memcpy(shape, PyArray_SHAPE(a), PyArray_NDIM(a) * sizeof(npy_intp));
+    shape[axis] = ngroups;
+    return PyArray_EMPTY(PyArray_NDIM(a), shape, type, 0);
+}
+
+#define FOR_GROUPS for (g = 0; g < ngroups; g++)
+
+/* group_nansum ---------------------------------------------------------- */
+
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+GROUP_ACC(group_nansum, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 ai;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)acc;
+    FOR_GROUPS asum[g] = 0;
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) asum[g] += ai;
+    }
+}
+
+GROUP_MERGE(group_nansum, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)acc;
+    const bn_DTYPE1 *bsum = (const bn_DTYPE1 *)other;
+    FOR_GROUPS asum[g] += bsum[g];
+}
+
+GROUP_OUT(group_nansum, DTYPE0) {
+    npy_intp g;
+    const bn_DTYPE1 *asum = (const bn_DTYPE1 *)acc;
+    FOR_GROUPS YX(DTYPE2, g) = asum[g];
+    return -1;
+}
+
+GROUP(group_nansum, DTYPE0, DTYPE2, sizeof(bn_DTYPE1))
+/* dtype end */
+
+/* dtype = [['int64', 'int64'], ['int32', 'int64'], ['int16', 'int64'],
+            ['int8', 'int64'], ['uint64', 'uint64'], ['uint32', 'uint64'],
+            ['uint16', 'uint64'], ['uint8', 'uint64'], ['bool', 'int64']] */
+GROUP_ACC(group_nansum, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)acc;
+    FOR_GROUPS asum[g] = 0;
+    FOR {
+        g = labels[it.i];
+        if (g >= 0) asum[g] += AI(DTYPE0);
+    }
+}
+
+GROUP_MERGE(group_nansum, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)acc;
+    const bn_DTYPE1 *bsum = (const bn_DTYPE1 *)other;
+    FOR_GROUPS asum[g] += bsum[g];
+}
+
+GROUP_OUT(group_nansum, DTYPE0) {
+    npy_intp g;
+    const bn_DTYPE1 *asum = (const bn_DTYPE1 *)acc;
+    FOR_GROUPS YX(DTYPE1, g) = asum[g];
+    return -1;
+}
+
+GROUP(group_nansum, DTYPE0, DTYPE1, sizeof(bn_DTYPE1))
+/* dtype end */
+
+GROUP_MAIN(group_nansum, 0)
+
+
+/* group_nanmean --------------------------------------------------------- */
+
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+GROUP_ACC(group_nanmean, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)(count + ngroups);
+    FOR_GROUPS {
+        count[g] = 0;
+        asum[g] = 0;
+    }
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) {
+            asum[g] += ai;
+            count[g]++;
+        }
+    }
+}
+
+GROUP_MERGE(group_nanmean, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE1 *bsum = (const bn_DTYPE1 *)(bcount + ngroups);
+    FOR_GROUPS {
+        count[g] += bcount[g];
+        asum[g] += bsum[g];
+    }
+}
+
+GROUP_OUT(group_nanmean, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE1 *asum = (const bn_DTYPE1 *)(count + ngroups);
+    FOR_GROUPS {
+        YX(DTYPE2, g) = count[g] > 0 ? asum[g] / count[g] : BN_NAN;
+    }
+    return -1;
+}
+
+GROUP(group_nanmean, DTYPE0, DTYPE2, sizeof(npy_intp) + sizeof(bn_DTYPE1))
+/* dtype end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+GROUP_ACC(group_nanmean, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)(count + ngroups);
+    FOR_GROUPS {
+        count[g] = 0;
+        asum[g] = 0;
+    }
+    FOR {
+        g = labels[it.i];
+        if (g >= 0) {
+            asum[g] += AI(DTYPE0);
+            count[g]++;
+        }
+    }
+}
+
+GROUP_MERGE(group_nanmean, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *asum = (bn_DTYPE1 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE1 *bsum = (const bn_DTYPE1 *)(bcount + ngroups);
+    FOR_GROUPS {
+        count[g] += bcount[g];
+        asum[g] += bsum[g];
+    }
+}
+
+GROUP_OUT(group_nanmean, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE1 *asum = (const bn_DTYPE1 *)(count + ngroups);
+    FOR_GROUPS {
+        YX(DTYPE1, g) = count[g] > 0 ? asum[g] / count[g] : BN_NAN;
+    }
+    return -1;
+}
+
+GROUP(group_nanmean, DTYPE0, DTYPE1, sizeof(npy_intp) + sizeof(bn_DTYPE1))
+/* dtype end */
+
+GROUP_MAIN(group_nanmean, 0)
+
+
+/* group_nanstd, group_nanvar -------------------------------------------- */
+
+/* as in nanvar the means are found in a first pass over the range and the
+   squared deviations from them in a second pass. The means and sums of
+   squared deviations of two ranges are merged as in Chan, Golub and
+   LeVeque, "Updating formulae and a pairwise algorithm for computing
+   sample variances" (1979). */
+
+/* repeat = {'NAME': ['group_nanstd', 'group_nanvar'],
+             'FUNC': ['sqrt',         '']} */
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *amean = (bn_DTYPE1 *)(count + ngroups);
+    bn_DTYPE1 *assqdm = amean + ngroups;
+    FOR_GROUPS {
+        count[g] = 0;
+        amean[g] = 0;
+        assqdm[g] = 0;
+    }
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) {
+            amean[g] += ai;
+            count[g]++;
+        }
+    }
+    FOR_GROUPS {
+        if (count[g] > 0) amean[g] /= count[g];
+    }
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) {
+            ai -= amean[g];
+            assqdm[g] += ai * ai;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 delta, w;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *amean = (bn_DTYPE1 *)(count + ngroups);
+    bn_DTYPE1 *assqdm = amean + ngroups;
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE1 *bmean = (const bn_DTYPE1 *)(bcount + ngroups);
+    const bn_DTYPE1 *bssqdm = bmean + ngroups;
+    FOR_GROUPS {
+        if (bcount[g] == 0) continue;
+        delta = bmean[g] - amean[g];
+        w = (bn_DTYPE1)bcount[g] / (count[g] + bcount[g]);
+        amean[g] += delta * w;
+        assqdm[g] += bssqdm[g] + delta * delta * count[g] * w;
+        count[g] += bcount[g];
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE1 *assqdm = (const bn_DTYPE1 *)(count + ngroups) + ngroups;
+    FOR_GROUPS {
+        if (count[g] > ddof) {
+            YX(DTYPE2, g) = FUNC(assqdm[g] / (count[g] - ddof));
+        } else {
+            YX(DTYPE2, g) = BN_NAN;
+        }
+    }
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE2, sizeof(npy_intp) + 2 * sizeof(bn_DTYPE1))
+/* dtype end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *amean = (bn_DTYPE1 *)(count + ngroups);
+    bn_DTYPE1 *assqdm = amean + ngroups;
+    FOR_GROUPS {
+        count[g] = 0;
+        amean[g] = 0;
+        assqdm[g] = 0;
+    }
+    FOR {
+        g = labels[it.i];
+        if (g >= 0) {
+            amean[g] += AI(DTYPE0);
+            count[g]++;
+        }
+    }
+    FOR_GROUPS {
+        if (count[g] > 0) amean[g] /= count[g];
+    }
+    FOR {
+        g = labels[it.i];
+        if (g >= 0) {
+            ai = AI(DTYPE0) - amean[g];
+            assqdm[g] += ai * ai;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE1 delta, w;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE1 *amean = (bn_DTYPE1 *)(count + ngroups);
+    bn_DTYPE1 *assqdm = amean + ngroups;
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE1 *bmean = (const bn_DTYPE1 *)(bcount + ngroups);
+    const bn_DTYPE1 *bssqdm = bmean + ngroups;
+    FOR_GROUPS {
+        if (bcount[g] == 0) continue;
+        delta = bmean[g] - amean[g];
+        w = (bn_DTYPE1)bcount[g] / (count[g] + bcount[g]);
+        amean[g] += delta * w;
+        assqdm[g] += bssqdm[g] + delta * delta * count[g] * w;
+        count[g] += bcount[g];
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE1 *assqdm = (const bn_DTYPE1 *)(count + ngroups) + ngroups;
+    FOR_GROUPS {
+        if (count[g] > ddof) {
+            YX(DTYPE1, g) = FUNC(assqdm[g] / (count[g] - ddof));
+        } else {
+            YX(DTYPE1, g) = BN_NAN;
+        }
+    }
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE1, sizeof(npy_intp) + 2 * sizeof(bn_DTYPE1))
+/* dtype end */
+
+GROUP_MAIN(NAME, 1)
+/* repeat end */
+
+
+/* group_nanmin, group_nanmax -------------------------------------------- */
+
+/* of equal extremes the later one is kept, by the walk and by the merge */
+
+/* repeat = {'NAME':      ['group_nanmin',   'group_nanmax'],
+             'COMPARE':   ['<=',             '>='],
+             'BIG_FLOAT': ['BN_INFINITY',    '-BN_INFINITY'],
+             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE0 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *extreme = (bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS {
+        count[g] = 0;
+        extreme[g] = BIG_FLOAT;
+    }
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai COMPARE extreme[g]) {
+            extreme[g] = ai;
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *extreme = (bn_DTYPE0 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE0 *bextreme = (const bn_DTYPE0 *)(bcount + ngroups);
+    FOR_GROUPS {
+        if (bcount[g] && (!count[g] || bextreme[g] COMPARE extreme[g])) {
+            extreme[g] = bextreme[g];
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE0 *extreme = (const bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS YX(DTYPE0, g) = count[g] ? extreme[g] : BN_NAN;
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE0, sizeof(npy_intp) + sizeof(bn_DTYPE0))
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE0 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *extreme = (bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS {
+        count[g] = 0;
+        extreme[g] = BIG_INT;
+    }
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0) {
+            if (ai COMPARE extreme[g]) extreme[g] = ai;
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *extreme = (bn_DTYPE0 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE0 *bextreme = (const bn_DTYPE0 *)(bcount + ngroups);
+    FOR_GROUPS {
+        if (bcount[g]) {
+            if (bextreme[g] COMPARE extreme[g]) extreme[g] = bextreme[g];
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE0 *extreme = (const bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS {
+        if (!count[g]) return g;
+        YX(DTYPE0, g) = extreme[g];
+    }
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE0, sizeof(npy_intp) + sizeof(bn_DTYPE0))
+/* dtype end */
+
+GROUP_MAIN(NAME, 0)
+/* repeat end */
+
+
+/* group_nanfirst, group_nanlast ----------------------------------------- */
+
+/* the last value seen of each group is kept, so group_nanfirst walks each
+   range backwards; the merge keeps the value of the later range only for
+   group_nanlast, or when the earlier range has none */
+
+/* repeat = {'NAME': ['group_nanfirst', 'group_nanlast'],
+             'LOOP': ['FOR_REVERSE',    'FOR'],
+             'LAST': ['0',              '1']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE0 ai;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *value = (bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS count[g] = 0;
+    LOOP {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) {
+            value[g] = ai;
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *value = (bn_DTYPE0 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE0 *bvalue = (const bn_DTYPE0 *)(bcount + ngroups);
+    FOR_GROUPS {
+        if (bcount[g] && (LAST || !count[g])) {
+            value[g] = bvalue[g];
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE0 *value = (const bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS YX(DTYPE0, g) = count[g] ? value[g] : BN_NAN;
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE0, sizeof(npy_intp) + sizeof(bn_DTYPE0))
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+GROUP_ACC(NAME, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *value = (bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS count[g] = 0;
+    LOOP {
+        g = labels[it.i];
+        if (g >= 0) {
+            value[g] = AI(DTYPE0);
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_MERGE(NAME, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    bn_DTYPE0 *value = (bn_DTYPE0 *)(count + ngroups);
+    const npy_intp *bcount = (const npy_intp *)other;
+    const bn_DTYPE0 *bvalue = (const bn_DTYPE0 *)(bcount + ngroups);
+    FOR_GROUPS {
+        if (bcount[g] && (LAST || !count[g])) {
+            value[g] = bvalue[g];
+            count[g] = 1;
+        }
+    }
+}
+
+GROUP_OUT(NAME, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    const bn_DTYPE0 *value = (const bn_DTYPE0 *)(count + ngroups);
+    FOR_GROUPS {
+        if (!count[g]) return g;
+        YX(DTYPE0, g) = value[g];
+    }
+    return -1;
+}
+
+GROUP(NAME, DTYPE0, DTYPE0, sizeof(npy_intp) + sizeof(bn_DTYPE0))
+/* dtype end */
+
+GROUP_MAIN(NAME, 0)
+/* repeat end */
+
+
+/* group_count ----------------------------------------------------------- */
+
+/* dtype = [['float64'], ['float32'], ['float16']] */
+GROUP_ACC(group_count, DTYPE0) {
+    npy_intp g;
+    bn_DTYPE0 ai;
+    npy_intp *count = (npy_intp *)acc;
+    FOR_GROUPS count[g] = 0;
+    FOR {
+        ai = AI(DTYPE0);
+        g = labels[it.i];
+        if (g >= 0 && ai == ai) count[g]++;
+    }
+}
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+GROUP_ACC(group_count, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    FOR_GROUPS count[g] = 0;
+    FOR {
+        g = labels[it.i];
+        if (g >= 0) count[g]++;
+    }
+}
+/* dtype end */
+
+/* dtype = [['float64'], ['float32'], ['float16'], ['int64'], ['int32'],
+            ['int16'], ['int8'], ['uint64'], ['uint32'], ['uint16'],
+            ['uint8'], ['bool']] */
+GROUP_MERGE(group_count, DTYPE0) {
+    npy_intp g;
+    npy_intp *count = (npy_intp *)acc;
+    const npy_intp *bcount = (const npy_intp *)other;
+    FOR_GROUPS count[g] += bcount[g];
+}
+
+GROUP_OUT(group_count, DTYPE0) {
+    npy_intp g;
+    const npy_intp *count = (const npy_intp *)acc;
+    FOR_GROUPS YX(intp, g) = count[g];
+    return -1;
+}
+
+GROUP(group_count, DTYPE0, intp, sizeof(npy_intp))
+/* dtype end */
+
+GROUP_MAIN(group_count, 0)
+
+
+/* group_run ------------------------------------------------------------- */
+
+/*
+ The thread pool runs a group function in parts, each with accumulators of
+ its own. Input with enough slices is split into runs of whole slices, and
+ each part writes the output of its slices. Otherwise, as for the long
+ single slice of 1d input, each slice is split into ranges along `axis` and
+ the accumulators of the ranges are merged in order on the calling thread.
+ A slice is only split into ranges longer than ngroups, so that the merge
+ costs less than the walk.
+*/
+
+static void
+group_ranges_part(void *arg, int part, int nparts)
+{
+    group_part_t *p = (group_part_t *)arg;
+    const npy_intp i0 = p->it->length * part / nparts;
+    const npy_intp i1 = p->it->length * (part + 1) / nparts;
+    p->kernel->acc(p->buffer + part * p->stride, group_range(p->it, i0, i1),
+                   p->labels + i0, p->ngroups);
+}
+
+static PyObject *
+group_run(PyArrayObject *a,
+          const npy_intp *labels,
+          npy_intp ngroups,
+          int axis,
+          int ddof,
+          int type,
+          const group_kernel *kernel,
+          const char *name) {
+    iter2 it;
+    int q, nparts, nranges;
+    npy_intp empty = -1;
+    group_part_t p;
+    PyObject *y = group_output(a, axis, ngroups, type);
+    if (y == NULL) return NULL;
+    init_iter2(&it, a, y, axis);
+    nparts = bn_pool_parts(it.nits, it.nits * it.length);
+    nranges = bn_pool_parts(it.length / (ngroups > 1 ? ngroups : 1),
+                            it.length);
+    if (nranges <= nparts) nranges = 1;
+    p.kernel = kernel;
+    p.it = &it;
+    p.labels = labels;
+    p.ngroups = ngroups;
+    p.ddof = ddof;
+    /* parts do not share cache lines */
+    p.stride = (ngroups * kernel->size + 63) & ~(size_t)63;
+    p.buffer = bn_scratch_get((nranges > nparts ? nranges : nparts) *
+                              p.stride);
+    if (p.buffer == NULL) {
+        Py_DECREF(y);
+        MEMORY_ERR("Could not allocate memory for the groups");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    if (nranges > 1) {
+        WHILE {
+            bn_pool_run(group_ranges_part, &p, nranges);
+            for (q = 1; q < nranges; q++) {
+                kernel->merge(p.buffer, p.buffer + q * p.stride, ngroups);
+            }
+            empty = kernel->out(p.buffer, group_range(&it, 0, 0), ngroups,
+                                ddof);
+            if (empty >= 0) break;
+            NEXT2
+        }
+    } else {
+        bn_pool_run(kernel->slices, &p, nparts);
+        for (q = 0; q < nparts && empty < 0; q++) {
+            empty = p.empty[q];
+        }
+    }
+    BN_END_ALLOW_THREADS
+    bn_scratch_put(p.buffer);
+    if (empty >= 0) {
+        /* integer input has no missing value to give an empty group */
+        PyErr_Format(PyExc_ValueError,
+                     "%s: group %zd is empty; integer input has no missing "
+                     "value to return for it", name, empty);
+        Py_DECREF(y);
+        return NULL;
+    }
+    return y;
+}
+
+
+/* module state ---------------------------------------------------------- */
+
+typedef struct {
+    PyObject *slow;
+    PyObject *pystr_a;
+    PyObject *pystr_labels;
+    PyObject *pystr_ngroups;
+    PyObject *pystr_axis;
+    PyObject *pystr_ddof;
+} module_state;
+
+MODULE_STATE_FUNCS
+
+static int
+intern_strings(module_state *st) {
+    st->pystr_a = PyString_InternFromString("a");
+    st->pystr_labels = PyString_InternFromString("labels");
+    st->pystr_ngroups = PyString_InternFromString("ngroups");
+    st->pystr_axis = PyString_InternFromString("axis");
+    st->pystr_ddof = PyString_InternFromString("ddof");
+    return st->pystr_a && st->pystr_labels && st->pystr_ngroups &&
+           st->pystr_axis && st->pystr_ddof;
+}
+
+/* grouper --------------------------------------------------------------- */
+
+/* a, labels, ngroups, axis and, if has_ddof, ddof */
+static inline int
+parse_args(module_state *st,
+           PyObject *args,
+           PyObject *kwds,
+           int has_ddof,
+           PyObject **a,
+           PyObject **labels,
+           PyObject **ngroups,
+           PyObject **axis,
+           PyObject **ddof) {
+    PyObject **dest[5] = {a, labels, ngroups, axis, ddof};
+    PyObject *names[5] = {st->pystr_a, st->pystr_labels, st->pystr_ngroups,
+                          st->pystr_axis, st->pystr_ddof};
+    const Py_ssize_t nparams = has_ddof ? 5 : 4;
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    Py_ssize_t i, nkwds_found = 0;
+    PyObject *tmp;
+    if (nargs > nparams) {
+        TYPE_ERR("wrong number of arguments");
+        return 0;
+    }
+    for (i = 0; i < nargs; i++) {
+        *dest[i] = PyTuple_GET_ITEM(args, i);
+    }
+    for (i = nargs; i < nparams && nkwds_found < nkwds; i++) {
+        tmp = PyDict_GetItem(kwds, names[i]);
+        if (tmp != NULL) {
+            *dest[i] = tmp;
+            nkwds_found++;
+        }
+    }
+    if (nkwds_found != nkwds) {
+        TYPE_ERR("wrong number of keyword arguments");
+        return 0;
+    }
+    if (*a == NULL) {
+        TYPE_ERR("Cannot find `a` keyword input");
+        return 0;
+    }
+    if (*labels == NULL) {
+        TYPE_ERR("Cannot find `labels` keyword input");
+        return 0;
+    }
+    return 1;
+}
+
+/* the arguments of a fgroup_t, for bn_blocks */
+typedef struct {
+    fgroup_t fgroup;
+    const npy_intp *labels;
+    npy_intp ngroups;
+    int axis;
+    int ddof;
+} group_args;
+
+static PyObject *
+group_block(PyArrayObject *a, void *args) {
+    group_args *ga = (group_args *)args;
+    return ga->fgroup(a, ga->labels, ga->ngroups, ga->axis, ga->ddof);
+}
+
+static PyObject *
+grouper(PyObject *self,
+        char *name,
+        PyObject *args,
+        PyObject *kwds,
+        const fgroup_t *fgroup,
+        int has_ddof) {
+
+    module_state *st = STATE(self);
+    int ndim;
+    int axis;
+    int dtype;
+    int ddof = 0;
+    npy_intp i, n, ngroups;
+    npy_intp label_max = -1;
+    const npy_intp *plabels;
+
+    PyArrayObject *a;
+    PyArrayObject *labels = NULL;
+    PyObject *y;
+
+    PyObject *a_obj = NULL;
+    PyObject *labels_obj = NULL;
+    PyObject *ngroups_obj = Py_None;
+    PyObject *axis_obj = NULL;
+    PyObject *ddof_obj = NULL;
+
+    if (!parse_args(st, args, kwds, has_ddof, &a_obj, &labels_obj,
+                    &ngroups_obj, &axis_obj, &ddof_obj)) {
+        return NULL;
+    }
+
+    /* convert to array if necessary */
+    if (PyArray_Check(a_obj)) {
+        a = (PyArrayObject *)a_obj;
+        Py_INCREF(a);
+    } else {
+        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
+        if (a == NULL) {
+            return NULL;
+        }
+    }
+
+    /* dtypes without a C function go to slow */
+    dtype = bn_dtype_index(a);
+    if (dtype < 0 || fgroup[dtype] == NULL) {
+        Py_DECREF(a);
+        return slow(st->slow, name, args, kwds);
+    }
+
+    /* defend against the axis of negativity */
+    ndim = PyArray_NDIM(a);
+    if (axis_obj == NULL) {
+        axis = ndim - 1;
+        if (axis < 0) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+    } else if (axis_obj == Py_None) {
+        VALUE_ERR("`axis` cannot be None");
+        goto error;
+    } else {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer");
+            goto error;
+        }
+        if (axis < 0) {
+            axis += ndim;
+            if (axis < 0) {
+                PyErr_Format(PyExc_ValueError,
+                             "axis(=%d) out of bounds", axis);
+                goto error;
+            }
+        } else if (axis >= ndim) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+    }
+
+    /* ddof */
+    if (ddof_obj != NULL) {
+        ddof = PyArray_PyIntAsInt(ddof_obj);
+        if (error_converting(ddof)) {
+            TYPE_ERR("`ddof` must be an integer");
+            goto error;
+        }
+    }
+
+    /* labels */
+    labels = (PyArrayObject *)PyArray_FROM_OTF(labels_obj, NPY_INTP,
+                                               NPY_ARRAY_IN_ARRAY);
+    if (labels == NULL) {
+        goto error;
+    }
+    n = PyArray_SIZE(labels);
+    if (PyArray_NDIM(labels) != 1 || n != PyArray_DIM(a, axis)) {
+        VALUE_ERR("`labels` must be 1d with the length of `a` along `axis`");
+        goto error;
+    }
+    plabels = (const npy_intp *)PyArray_DATA(labels);
+    for (i = 0; i < n; i++) {
+        if (plabels[i] > label_max) label_max = plabels[i];
+    }
+
+    /* ngroups */
+    if (ngroups_obj == Py_None) {
+        ngroups = label_max + 1;
+    } else {
+        ngroups = PyArray_PyIntAsIntp(ngroups_obj);
+        if (error_converting(ngroups)) {
+            TYPE_ERR("`ngroups` must be an integer or None");
+            goto error;
+        }
+        if (ngroups < 0) {
+            VALUE_ERR("`ngroups` must be nonnegative");
+            goto error;
+        }
+        if (label_max >= ngroups) {
+            VALUE_ERR("`labels` must be less than `ngroups`");
+            goto error;
+        }
+    }
+
+    if (bn_convert(a)) {
+        group_args ga = {fgroup[dtype], plabels, ngroups, axis, ddof};
+        y = bn_blocks(a, axis, BN_BLOCK_KEEP, group_block, &ga);
+    } else {
+        y = fgroup[dtype](a, plabels, ngroups, axis, ddof);
+    }
+
+    Py_DECREF(labels);
+    Py_DECREF(a);
+
+    return y;
+
+error:
+    Py_XDECREF(labels);
+    Py_DECREF(a);
+    return NULL;
+
+}
+
+/* docstrings ------------------------------------------------------------- */
+
+static char group_doc[] =
+"Bottleneck functions that reduce the input array by group along an axis.";
+
+static char group_nansum_doc[] =
+/* MULTILINE STRING BEGIN
+group_nansum(a, labels, ngroups=None, axis=-1)
+
+Sum of each group along the specified axis, ignoring NaNs.
+
+The equivalent numpy code, for each group g:
+
+    >>> np.nansum(a[..., labels == g], axis=-1)
+
+where `axis` is the last axis. Each slice along `axis` is read once; the
+sums of all the groups are accumulated side by side.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label, such as the -1 that pandas uses for missing keys, are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    `ngroups`. Integer sums are int64 (uint64 for unsigned input), and the
+    sum of an empty group or of a group of NaNs is zero.
+
+See also
+--------
+bottleneck.nansum: Sum along specified axis, ignoring NaNs.
+bottleneck.group_nanmean: Mean of each group, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nansum(a, labels)
+array([1., 6., 5.])
+>>> bn.group_nansum(a, labels, ngroups=4)
+array([1., 6., 5., 0.])
+
+MULTILINE STRING END */
+
+static char group_nanmean_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanmean(a, labels, ngroups=None, axis=-1)
+
+Mean of each group along the specified axis, ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    `ngroups`. NaN is returned for an empty group or a group of NaNs.
+
+See also
+--------
+bottleneck.nanmean: Mean along specified axis, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[1, 2, np.nan, 4, 5], [5, 4, 3, 2, 1]])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanmean(a, labels)
+array([[1., 3., 5.],
+       [4., 3., 1.]])
+
+MULTILINE STRING END */
+
+static char group_nanstd_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanstd(a, labels, ngroups=None, axis=-1, ddof=0)
+
+Standard deviation of each group along the specified axis, ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs. As
+in `bottleneck.nanstd` a two-pass algorithm is used: the means of all the
+groups are found in a first pass over each slice and the squared
+deviations in a second pass.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+ddof : int, optional
+    Means Delta Degrees of Freedom. The divisor used in calculations
+    is ``N - ddof``, where ``N`` represents the number of non-NaN elements
+    of the group. By default `ddof` is zero.
+
+Returns
+-------
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    `ngroups`. NaN is returned for a group with ddof or fewer non-NaN
+    elements.
+
+See also
+--------
+bottleneck.nanstd: Standard deviation along specified axis, ignoring NaNs.
+bottleneck.group_nanvar: Variance of each group, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanstd(a, labels)
+array([0., 1., 0.])
+
+MULTILINE STRING END */
+
+static char group_nanvar_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanvar(a, labels, ngroups=None, axis=-1, ddof=0)
+
+Variance of each group along the specified axis, ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs. As
+in `bottleneck.nanvar` a two-pass algorithm is used: the means of all the
+groups are found in a first pass over each slice and the squared
+deviations in a second pass.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+ddof : int, optional
+    Means Delta Degrees of Freedom. The divisor used in calculations
+    is ``N - ddof``, where ``N`` represents the number of non-NaN elements
+    of the group. By default `ddof` is zero.
+
+Returns
+-------
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    `ngroups`. NaN is returned for a group with ddof or fewer non-NaN
+    elements.
+
+See also
+--------
+bottleneck.nanvar: Variance along specified axis, ignoring NaNs.
+bottleneck.group_nanstd: Standard deviation of each group, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanvar(a, labels)
+array([0., 1., 0.])
+>>> bn.group_nanvar(a, labels, ddof=1)
+array([nan,  2., nan])
+
+MULTILINE STRING END */
+
+static char group_nanmin_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanmin(a, labels, ngroups=None, axis=-1)
+
+Minimum of each group along the specified axis, ignoring NaNs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is `ngroups`. For float input NaN is returned for an empty group
+    or a group of NaNs.
+
+Raises
+------
+ValueError
+    If a group of integer input is empty.
+
+See also
+--------
+bottleneck.nanmin: Minimum along specified axis, ignoring NaNs.
+bottleneck.group_nanmax: Maximum of each group, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanmin(a, labels)
+array([1., 2., 5.])
+
+MULTILINE STRING END */
+
+static char group_nanmax_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanmax(a, labels, ngroups=None, axis=-1)
+
+Maximum of each group along the specified axis, ignoring NaNs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is `ngroups`. For float input NaN is returned for an empty group
+    or a group of NaNs.
+
+Raises
+------
+ValueError
+    If a group of integer input is empty.
+
+See also
+--------
+bottleneck.nanmax: Maximum along specified axis, ignoring NaNs.
+bottleneck.group_nanmin: Minimum of each group, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanmax(a, labels)
+array([1., 4., 5.])
+
+MULTILINE STRING END */
+
+static char group_nanfirst_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanfirst(a, labels, ngroups=None, axis=-1)
+
+First non-NaN value of each group along the specified axis.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is `ngroups`. For float input NaN is returned for an empty group
+    or a group of NaNs.
+
+Raises
+------
+ValueError
+    If a group of integer input is empty.
+
+See also
+--------
+bottleneck.group_nanlast: Last non-NaN value of each group.
+
+Examples
+--------
+>>> a = np.array([np.nan, 2, 3, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanfirst(a, labels)
+array([3., 2., 5.])
+
+MULTILINE STRING END */
+
+static char group_nanlast_doc[] =
+/* MULTILINE STRING BEGIN
+group_nanlast(a, labels, ngroups=None, axis=-1)
+
+Last non-NaN value of each group along the specified axis.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is `ngroups`. For float input NaN is returned for an empty group
+    or a group of NaNs.
+
+Raises
+------
+ValueError
+    If a group of integer input is empty.
+
+See also
+--------
+bottleneck.group_nanfirst: First non-NaN value of each group.
+
+Examples
+--------
+>>> a = np.array([1, 2, 3, np.nan, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_nanlast(a, labels)
+array([3., 2., 5.])
+
+MULTILINE STRING END */
+
+static char group_count_doc[] =
+/* MULTILINE STRING BEGIN
+group_count(a, labels, ngroups=None, axis=-1)
+
+Number of non-NaN elements of each group along the specified axis.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+labels : array_like of int
+    1d array with the group label of each element of `a` along `axis`.
+    Labels are in the range 0 to ngroups - 1; elements with a negative
+    label are skipped.
+ngroups : {int, None}, optional
+    The number of groups, which is the length of the output along `axis`.
+    The default (None) is one more than the largest label.
+axis : int, optional
+    Axis along which the groups are reduced. The default (axis=-1) is the
+    last axis.
+
+Returns
+-------
+y : ndarray
+    An integer array with the shape of `a` except that the length along
+    `axis` is `ngroups`.
+
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> labels = np.array([0, 1, 0, 1, 2])
+>>> bn.group_count(a, labels)
+array([1, 2, 1])
+
+MULTILINE STRING END */
+
+/* python wrapper -------------------------------------------------------- */
+
+static PyMethodDef
+group_methods[] = {
+    {"group_nansum",   (PyCFunction)group_nansum,   VARKEY,
+     group_nansum_doc},
+    {"group_nanmean",  (PyCFunction)group_nanmean,  VARKEY,
+     group_nanmean_doc},
+    {"group_nanstd",   (PyCFunction)group_nanstd,   VARKEY,
+     group_nanstd_doc},
+    {"group_nanvar",   (PyCFunction)group_nanvar,   VARKEY,
+     group_nanvar_doc},
+    {"group_nanmin",   (PyCFunction)group_nanmin,   VARKEY,
+     group_nanmin_doc},
+    {"group_nanmax",   (PyCFunction)group_nanmax,   VARKEY,
+     group_nanmax_doc},
+    {"group_nanfirst", (PyCFunction)group_nanfirst, VARKEY,
+     group_nanfirst_doc},
+    {"group_nanlast",  (PyCFunction)group_nanlast,  VARKEY,
+     group_nanlast_doc},
+    {"group_count",    (PyCFunction)group_count,    VARKEY,
+     group_count_doc},
+    SCRATCH_METHODS
+    THREAD_METHODS
+    {NULL, NULL, 0, NULL}
+};
+
+
+static int
+group_exec(PyObject *m)
+{
+    module_state *st = STATE(m);
+    import_array1(-1);
+    if (!intern_strings(st)) {
+        return -1;
+    }
+    st->slow = PyImport_ImportModule("bottleneck.slow");
+    if (st->slow == NULL) {
+        return -1;
+    }
+    if (bn_pool_init() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+group_slots[] = {
+    {Py_mod_exec, (void *)group_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
+static struct PyModuleDef
+group_def = {
+   PyModuleDef_HEAD_INIT,
+   "group",
+   group_doc,
+   sizeof(module_state),
+   group_methods,
+   group_slots,
+   module_traverse,
+   module_clear,
+   module_free
+};
+
+
+PyMODINIT_FUNC
+PyInit_group(void)
+{
+    return PyModuleDef_Init(&group_def);
+}
@@ -0,0 +1,46 @@
+#ifndef INTROSELECT_H_
+#define INTROSELECT_H_
+
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_11_API_VERSION
+#include <numpy/npy_common.h>
+#include <bn_types.h>
+
+/*
+ * bn_select_<dtype>(v, n, k) rearranges v[0] ... v[n - 1] so that v[k] holds
+ * the value it would hold if v were sorted, no value before k is larger and
+ * no value after k is smaller. bn_argselect_<dtype> does the same and applies
+ * every move of v to idx as well. The result is unspecified (but the call
+ * returns) if v contains NaNs.
+ */
+
+void bn_select_float64(npy_float64 *v, npy_intp n, npy_intp k);
+void bn_select_float32(npy_float32 *v, npy_intp n, npy_intp k);
+void bn_select_int64(npy_int64 *v, npy_intp n, npy_intp k);
+void bn_select_int32(npy_int32 *v, npy_intp n, npy_intp k);
+void bn_select_float16(bn_float16 *v, npy_intp n, npy_intp k);
+void bn_select_int16(npy_int16 *v, npy_intp n, npy_intp k);
+void bn_select_int8(npy_int8 *v, npy_intp n, npy_intp k);
+void bn_select_uint64(npy_uint64 *v, npy_intp n, npy_intp k);
+void bn_select_uint32(npy_uint32 *v, npy_intp n, npy_intp k);
+void bn_select_uint16(npy_uint16 *v, npy_intp n, npy_intp k);
+void bn_select_uint8(npy_uint8 *v, npy_intp n, npy_intp k);
+void bn_select_bool(npy_bool *v, npy_intp n, npy_intp k);
+
+void bn_argselect_float64(npy_float64 *v, npy_intp *idx, npy_intp n,
+                          npy_intp k);
+void bn_argselect_float32(npy_float32 *v, npy_intp *idx, npy_intp n,
+                          npy_intp k);
+void bn_argselect_int64(npy_int64 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_int32(npy_int32 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_float16(bn_float16 *v, npy_intp *idx, npy_intp n,
+                          npy_intp k);
+void bn_argselect_int16(npy_int16 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_int8(npy_int8 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_uint64(npy_uint64 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_uint32(npy_uint32 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_uint16(npy_uint16 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_uint8(npy_uint8 *v, npy_intp *idx, npy_intp n, npy_intp k);
+void bn_argselect_bool(npy_bool *v, npy_intp *idx, npy_intp n, npy_intp k);
+
+#endif  // INTROSELECT_H_
@@ -0,0 +1,329 @@
+/*
+   Introselect: quickselect with a median-of-three pivot that switches to a
+   median-of-medians pivot (Blum, Floyd, Pratt, Rivest and Tarjan, 1973) once
+   the partition steps run out, so the worst case is linear.
+
+   The partition loop is the one used by the old WIRTH macro, based on:
+     Fast median search: an ANSI C implementation
+     Nicolas Devillard - ndevilla AT free DOT fr
+     July 1998
+   which, in turn, took the algorithm from
+     Wirth, Niklaus
+     Algorithms + data structures = programs, p. 366
+     Englewood Cliffs: Prentice-Hall, 1976
+
+   Adapted for Bottleneck:
+   (C) 2016 Keith Goodman
+   Released under the Bottleneck license
+*/
+
+#include <bn_config.h>
+#include "introselect.h"
+
+/* ranges this short are insertion sorted */
+#define SMALL_RANGE 16
+
+#define VSWAP(dtype, a, b) { \
+    const bn_##dtype t_ = v[a]; \
+    v[a] = v[b]; \
+    v[b] = t_; \
+}
+
+#define ISWAP(a, b) { \
+    const npy_intp u_ = idx[a]; \
+    idx[a] = idx[b]; \
+    idx[b] = u_; \
+}
+
+#define VISWAP(dtype, a, b) { VSWAP(dtype, a, b) ISWAP(a, b) }
+
+/* median-of-three partition steps allowed per halving of the range */
+static int
+max_depth(npy_intp n) {
+    int depth = 0;
+    while (n >>= 1) depth += 2;
+    return depth;
+}
+
+#if HAVE_AVX2
+
+#include <immintrin.h>
+
+#define BN_AVX2 __attribute__((target("avx2,popcnt")))
+
+/* ranges at least this long are selected with the AVX2 partition step, if
+   the CPU has AVX2; only bn_select of float64 and float32 has one */
+#define VECTOR_MIN_LENGTH 128
+#define VECTOR_select_float64 1
+#define VECTOR_select_float32 1
+
+/* the vectors of either dtype as eight 32-bit lanes and back */
+#define AS_PS_pd(a) _mm256_castpd_ps(a)
+#define AS_PS_ps(a) (a)
+#define FROM_PS_pd(a) _mm256_castps_pd(a)
+#define FROM_PS_ps(a) (a)
+
+static void select_avx2_float64(npy_float64 *v, npy_intp n, npy_intp k);
+static void select_avx2_float32(npy_float32 *v, npy_intp n, npy_intp k);
+
+/* Entry m holds, four bits per lane, the permutation of the eight 32-bit
+   lanes of a vector that moves the lanes whose bit is set in m first and
+   the other lanes after them. A float64 lane is two 32-bit lanes, both set
+   or both clear in the mask of a comparison. */
+static const npy_uint32 lane_order[256] = {
+    0x76543210, 0x76543210, 0x76543201, 0x76543210, 0x76543102, 0x76543120,
+    0x76543021, 0x76543210, 0x76542103, 0x76542130, 0x76542031, 0x76542310,
+    0x76541032, 0x76541320, 0x76540321, 0x76543210, 0x76532104, 0x76532140,
+    0x76532041, 0x76532410, 0x76531042, 0x76531420, 0x76530421, 0x76534210,
+    0x76521043, 0x76521430, 0x76520431, 0x76524310, 0x76510432, 0x76514320,
+    0x76504321, 0x76543210, 0x76432105, 0x76432150, 0x76432051, 0x76432510,
+    0x76431052, 0x76431520, 0x76430521, 0x76435210, 0x76421053, 0x76421530,
+    0x76420531, 0x76425310, 0x76410532, 0x76415320, 0x76405321, 0x76453210,
+    0x76321054, 0x76321540, 0x76320541, 0x76325410, 0x76310542, 0x76315420,
+    0x76305421, 0x76354210, 0x76210543, 0x76215430, 0x76205431, 0x76254310,
+    0x76105432, 0x76154320, 0x76054321, 0x76543210, 0x75432106, 0x75432160,
+    0x75432061, 0x75432610, 0x75431062, 0x75431620, 0x75430621, 0x75436210,
+    0x75421063, 0x75421630, 0x75420631, 0x75426310, 0x75410632, 0x75416320,
+    0x75406321, 0x75463210, 0x75321064, 0x75321640, 0x75320641, 0x75326410,
+    0x75310642, 0x75316420, 0x75306421, 0x75364210, 0x75210643, 0x75216430,
+    0x75206431, 0x75264310, 0x75106432, 0x75164320, 0x75064321, 0x75643210,
+    0x74321065, 0x74321650, 0x74320651, 0x74326510, 0x74310652, 0x74316520,
+    0x74306521, 0x74365210, 0x74210653, 0x74216530, 0x74206531, 0x74265310,
+    0x74106532, 0x74165320, 0x74065321, 0x74653210, 0x73210654, 0x73216540,
+    0x73206541, 0x73265410, 0x73106542, 0x73165420, 0x73065421, 0x73654210,
+    0x72106543, 0x72165430, 0x72065431, 0x72654310, 0x71065432, 0x71654320,
+    0x70654321, 0x76543210, 0x65432107, 0x65432170, 0x65432071, 0x65432710,
+    0x65431072, 0x65431720, 0x65430721, 0x65437210, 0x65421073, 0x65421730,
+    0x65420731, 0x65427310, 0x65410732, 0x65417320, 0x65407321, 0x65473210,
+    0x65321074, 0x65321740, 0x65320741, 0x65327410, 0x65310742, 0x65317420,
+    0x65307421, 0x65374210, 0x65210743, 0x65217430, 0x65207431, 0x65274310,
+    0x65107432, 0x65174320, 0x65074321, 0x65743210, 0x64321075, 0x64321750,
+    0x64320751, 0x64327510, 0x64310752, 0x64317520, 0x64307521, 0x64375210,
+    0x64210753, 0x64217530, 0x64207531, 0x64275310, 0x64107532, 0x64175320,
+    0x64075321, 0x64753210, 0x63210754, 0x63217540, 0x63207541, 0x63275410,
+    0x63107542, 0x63175420, 0x63075421, 0x63754210, 0x62107543, 0x62175430,
+    0x62075431, 0x62754310, 0x61075432, 0x61754320, 0x60754321, 0x67543210,
+    0x54321076, 0x54321760, 0x54320761, 0x54327610, 0x54310762, 0x54317620,
+    0x54307621, 0x54376210, 0x54210763, 0x54217630, 0x54207631, 0x54276310,
+    0x54107632, 0x54176320, 0x54076321, 0x54763210, 0x53210764, 0x53217640,
+    0x53207641, 0x53276410, 0x53107642, 0x53176420, 0x53076421, 0x53764210,
+    0x52107643, 0x52176430, 0x52076431, 0x52764310, 0x51076432, 0x51764320,
+    0x50764321, 0x57643210, 0x43210765, 0x43217650, 0x43207651, 0x43276510,
+    0x43107652, 0x43176520, 0x43076521, 0x43765210, 0x42107653, 0x42176530,
+    0x42076531, 0x42765310, 0x41076532, 0x41765320, 0x40765321, 0x47653210,
+    0x32107654, 0x32176540, 0x32076541, 0x32765410, 0x31076542, 0x31765420,
+    0x30765421, 0x37654210, 0x21076543, 0x21765430, 0x20765431, 0x27654310,
+    0x10765432, 0x17654320, 0x07654321, 0x76543210
+};
+
+#endif
+
+/* repeat = {'NAME':   ['select', 'argselect'],
+             'IPARAM': ['',       ', npy_intp *idx'],
+             'IARG':   ['',       ', idx'],
+             'SWAPS':  ['VSWAP',  'VISWAP']} */
+/* dtype = [['float64'], ['float32'], ['int64'], ['int32'], ['float16'],
+            ['int16'], ['int8'], ['uint64'], ['uint32'], ['uint16'],
+            ['uint8'], ['bool']] */
+
+static void
+NAME_range_DTYPE0(bn_DTYPE0 *v IPARAM, npy_intp l, npy_intp r, npy_intp k,
+                  int depth);
+
+/* Sort v[l] ... v[r] */
+static void
+NAME_sort_DTYPE0(bn_DTYPE0 *v IPARAM, npy_intp l, npy_intp r) {
+    npy_intp i, j;
+    for (i = l + 1; i <= r; i++) {
+        for (j = i; j > l && v[j - 1] > v[j]; j--) {
+            SWAPS(DTYPE0, j - 1, j)
+        }
+    }
+}
+
+/* Return the median of the medians of the groups of five in v[l] ... v[r].
+ * At least 3/10 of the values are no larger, and 3/10 no smaller, than it. */
+static bn_DTYPE0
+NAME_mom_DTYPE0(bn_DTYPE0 *v IPARAM, npy_intp l, npy_intp r) {
+    npy_intp i, g = 0;
+    for (i = l; i + 4 <= r; i += 5) {
+        NAME_sort_DTYPE0(v IARG, i, i + 4);
+        SWAPS(DTYPE0, i + 2, l + g)
+        g++;
+    }
+    NAME_range_DTYPE0(v IARG, l, l + g - 1, l + g / 2, max_depth(g));
+    return v[l + g / 2];
+}
+
+static void
+NAME_range_DTYPE0(bn_DTYPE0 *v IPARAM, npy_intp l, npy_intp r, npy_intp k,
+                  int depth) {
+    npy_intp i, j, m;
+    bn_DTYPE0 x;
+    while (r - l >= SMALL_RANGE) {
+        if (depth-- > 0) {
+            m = l + ((r - l) >> 1);
+            if (v[l] > v[m]) SWAPS(DTYPE0, l, m)
+            if (v[m] > v[r]) SWAPS(DTYPE0, m, r)
+            if (v[l] > v[m]) SWAPS(DTYPE0, l, m)
+            x = v[m];
+        } else {
+            x = NAME_mom_DTYPE0(v IARG, l, r);
+        }
+        i = l;
+        j = r;
+        do {
+            while (v[i] < x) i++;
+            while (x < v[j]) j--;
+            if (i <= j) {
+                SWAPS(DTYPE0, i, j)
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k && k < i) return;
+        if (j < k) l = i;
+        if (k < i) r = j;
+    }
+    NAME_sort_DTYPE0(v IARG, l, r);
+}
+
+void
+bn_NAME_DTYPE0(bn_DTYPE0 *v IPARAM, npy_intp n, npy_intp k) {
+#if HAVE_AVX2 && VECTOR_NAME_DTYPE0
+    if (n >= VECTOR_MIN_LENGTH && __builtin_cpu_supports("avx2")) {
+        NAME_avx2_DTYPE0(v, n, k);
+        return;
+    }
+#endif
+    if (n > 1) {
+        NAME_range_DTYPE0(v IARG, 0, n - 1, k, max_depth(n));
+    }
+}
+/* dtype end */
+/* repeat end */
+
+#if HAVE_AVX2
+
+/*
+   The AVX2 partition step splits a range around x by comparing a vector of
+   values at a time with x and storing the vector, its lanes reordered by
+   lane_order, both at the end of the values found to be below x and at the
+   start of those found to be above it; only the right lanes of each store
+   survive. The first and the last vector of the range are set aside to
+   make room for the stores, and each vector is read from the side with
+   less room left, so the stores never reach values that are still to be
+   read.
+*/
+
+/* dtype = [['float64', 'pd', '__m256d', '4'],
+            ['float32', 'ps', '__m256', '8']] */
+
+/* mask of the 32-bit lanes of a whose values are below x, or no larger
+   than x if not strict */
+static BN_AVX2 inline int
+below_DTYPE0(DTYPE2 a, DTYPE2 x, int strict) {
+    const DTYPE2 m = strict ? _mm256_cmp_DTYPE1(a, x, _CMP_LT_OQ)
+                            : _mm256_cmp_DTYPE1(a, x, _CMP_LE_OQ);
+    return _mm256_movemask_ps(AS_PS_DTYPE1(m));
+}
+
+/* store a, the lanes of mask first, at v[wl] and at v[wr - DTYPE3]; returns
+   the number of values of mask */
+static BN_AVX2 inline int
+store_DTYPE0(bn_DTYPE0 *v, npy_intp wl, npy_intp wr, DTYPE2 a, int mask) {
+    const __m256i shift = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i order = _mm256_and_si256(
+        _mm256_srlv_epi32(_mm256_set1_epi32((int)lane_order[mask]), shift),
+        _mm256_set1_epi32(7));
+    const __m256 b = _mm256_permutevar8x32_ps(AS_PS_DTYPE1(a), order);
+    _mm256_storeu_DTYPE1(v + wl, FROM_PS_DTYPE1(b));
+    _mm256_storeu_DTYPE1(v + wr - DTYPE3, FROM_PS_DTYPE1(b));
+    return __builtin_popcount(mask) * DTYPE3 / 8;
+}
+
+/* Move the values of v[l] ... v[r] that are below x, or no larger than x if
+ * not strict, before the others and return the index of the first of the
+ * others. The range holds at least two vectors of values. */
+static BN_AVX2 npy_intp
+partition_avx2_DTYPE0(bn_DTYPE0 *v, npy_intp l, npy_intp r, bn_DTYPE0 x,
+                      int strict) {
+    const DTYPE2 xv = _mm256_set1_DTYPE1(x);
+    const DTYPE2 first = _mm256_loadu_DTYPE1(v + l);
+    const DTYPE2 last = _mm256_loadu_DTYPE1(v + r + 1 - DTYPE3);
+    npy_intp readl = l + DTYPE3, readr = r + 1 - DTYPE3;
+    npy_intp wl = l, wr = r + 1, i, ntail;
+    int nl;
+    bn_DTYPE0 ai, tail[DTYPE3];
+    DTYPE2 a;
+    while (readr - readl >= DTYPE3) {
+        if (readl - wl <= wr - readr) {
+            a = _mm256_loadu_DTYPE1(v + readl);
+            readl += DTYPE3;
+        } else {
+            readr -= DTYPE3;
+            a = _mm256_loadu_DTYPE1(v + readr);
+        }
+        nl = store_DTYPE0(v, wl, wr, a, below_DTYPE0(a, xv, strict));
+        wl += nl;
+        wr -= DTYPE3 - nl;
+    }
+    ntail = readr - readl;
+    for (i = 0; i < ntail; i++) {
+        tail[i] = v[readl + i];
+    }
+    for (i = 0; i < ntail; i++) {
+        ai = tail[i];
+        if (strict ? ai < x : ai <= x) {
+            v[wl++] = ai;
+        } else {
+            v[--wr] = ai;
+        }
+    }
+    nl = store_DTYPE0(v, wl, wr, first, below_DTYPE0(first, xv, strict));
+    wl += nl;
+    wr -= DTYPE3 - nl;
+    wl += store_DTYPE0(v, wl, wr, last, below_DTYPE0(last, xv, strict));
+    return wl;
+}
+
+/* bn_select_DTYPE0 with the AVX2 partition step, which puts the values
+   equal to x on one side; when they are all of the range they are moved
+   to its end and, if k lands among them, the selection is done */
+static BN_AVX2 void
+select_avx2_DTYPE0(bn_DTYPE0 *v, npy_intp n, npy_intp k) {
+    npy_intp l = 0, r = n - 1, m, s;
+    int depth = max_depth(n);
+    bn_DTYPE0 x;
+    while (r - l >= SMALL_RANGE) {
+        if (depth-- > 0) {
+            m = l + ((r - l) >> 1);
+            if (v[l] > v[m]) VSWAP(DTYPE0, l, m)
+            if (v[m] > v[r]) VSWAP(DTYPE0, m, r)
+            if (v[l] > v[m]) VSWAP(DTYPE0, l, m)
+            x = v[m];
+        } else {
+            x = select_mom_DTYPE0(v, l, r);
+        }
+        if (x != x) {
+            /* NaN in the input: the result is unspecified but the scalar
+               partition step still ends */
+            select_range_DTYPE0(v, l, r, k, depth);
+            return;
+        }
+        s = partition_avx2_DTYPE0(v, l, r, x, 0);
+        if (s > r) {
+            s = partition_avx2_DTYPE0(v, l, r, x, 1);
+            if (k >= s) return;
+        }
+        if (k < s) {
+            r = s - 1;
+        } else {
+            l = s;
+        }
+    }
+    select_sort_DTYPE0(v, l, r);
+}
+/* dtype end */
+
+#endif
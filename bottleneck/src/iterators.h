@@ -10,12 +10,51 @@
    and PyArray_ITER_NEXT.
 */
 
+/* coalescing ------------------------------------------------------------ */
+
+/*
+ The dimensions that NEXT, NEXT2 and NEXT3 walk (all but axis) are
+ coalesced: length-1 dimensions, such as those added by np.newaxis, are
+ dropped and each dimension that continues its neighbour in memory in every
+ array (strides[k][i - 1] == shape[i] * strides[k][i]) is merged into it, so
+ that a[:, ::2, :] walks one dimension fewer. The walk stays in C order over
+ the dimensions, which the functions that write their output with YPP rely
+ on. Broadcast (zero stride) dimensions merge with each other but are not
+ dropped, since each of their elements is visited. The shape of the output
+ is kept in yshape.
+
+ shape and the n arrays in strides hold ndim dimensions; the coalesced
+ dimensions are written over them and their number is returned.
+*/
+static inline int
+coalesce_dims(int ndim, npy_intp *shape, npy_intp **strides, int n)
+{
+    int i, k, j = -1;
+    for (i = 0; i < ndim; i++) {
+        if (shape[i] == 1) continue;
+        if (j >= 0) {
+            for (k = 0; k < n; k++) {
+                if (strides[k][j] != shape[i] * strides[k][i]) break;
+            }
+            if (k == n) {
+                shape[j] *= shape[i];
+                for (k = 0; k < n; k++) strides[k][j] = strides[k][i];
+                continue;
+            }
+        }
+        j++;
+        shape[j] = shape[i];
+        for (k = 0; k < n; k++) strides[k][j] = strides[k][i];
+    }
+    return j + 1;
+}
+
 /* one input array ------------------------------------------------------- */
 
 /* these iterators are used mainly by reduce functions such as nansum */
 
 struct _iter {
-    int        ndim_m2; /* ndim - 2 */
+    int        ndim_m2; /* number of coalesced dimensions NEXT walks - 1 */
     int        axis;    /* axis to not iterate over */
     Py_ssize_t length;  /* a.shape[axis] */
     Py_ssize_t astride; /* a.strides[axis] */
@@ -27,7 +66,8 @@ struct _iter {
     npy_intp   astrides[NPY_MAXDIMS]; /* a.strides, a.strides[axis] removed */
     npy_intp   shape[NPY_MAXDIMS];    /* a.shape, a.shape[axis] removed */
     char       *pa;     /* pointer to data corresponding to indices */
-    PyArrayObject *a_ravel; /* NULL or pointer to ravelled input array */
+    int        ndim;    /* a.ndim */
+    npy_intp   yshape[NPY_MAXDIMS];   /* shape before coalescing */
 };
 typedef struct _iter iter;
 
@@ -39,157 +79,209 @@ init_iter_one(iter *it, PyArrayObject *a, int axis)
     const npy_intp *shape = PyArray_SHAPE(a);
     const npy_intp *strides = PyArray_STRIDES(a);
     const npy_intp item_size = PyArray_ITEMSIZE(a);
+    npy_intp *loop_strides[1];
 
+    it->ndim = ndim;
     it->axis = axis;
     it->its = 0;
     it->nits = 1;
     it->pa = PyArray_BYTES(a);
 
-    it->ndim_m2 = -1;
     it->length = 1;
     it->astride = 0;
 
-    if (ndim != 0) {
-        it->ndim_m2 = ndim - 2;
-        for (i = 0; i < ndim; i++) {
-            if (i == axis) {
-                it->astride = strides[i];
-                it->length = shape[i];
-            } else {
-                it->indices[j] = 0;
-                it->astrides[j] = strides[i];
-                it->shape[j] = shape[i];
-                it->nits *= shape[i];
-                j++;
-            }
+    for (i = 0; i < ndim; i++) {
+        if (i == axis) {
+            it->astride = strides[i];
+            it->length = shape[i];
+        } else {
+            it->astrides[j] = strides[i];
+            it->shape[j] = shape[i];
+            it->yshape[j] = shape[i];
+            it->nits *= shape[i];
+            j++;
         }
     }
+    loop_strides[0] = it->astrides;
+    it->ndim_m2 = coalesce_dims(j, it->shape, loop_strides, 1) - 1;
+    for (i = 0; i <= it->ndim_m2; i++) {
+        it->indices[i] = 0;
+    }
     it->stride = it->astride / item_size;
 }
 
 /*
- * If both ravel != 0 and it.a_ravel != NULL then you are responsible for
- * calling Py_DECREF(it.a_ravel) after you are done with the iterator.
- * See nanargmin for an example.
+ * The array is walked as LENGTH elements along the innermost coalesced
+ * dimension times nits steps of NEXT over the others. A flat loop over all
+ * elements is found whenever the array is one strided run of memory, such
+ * as a C or F contiguous array, a[:, ::2] or a[..., None]. With anyorder
+ * the dimensions are first given positive strides and ordered by
+ * decreasing stride, so that any such layout is found; without it the
+ * elements are walked in C order, so that the flat C index of AI is
+ * its * LENGTH + INDEX, which nanargmin relies on. The array is never
+ * copied.
  */
 static inline void
-init_iter_all(iter *it, PyArrayObject *a, int ravel, int anyorder)
+init_iter_all(iter *it, PyArrayObject *a, int anyorder)
 {
-    int i, j = 0;
+    int i, j, n;
     const int ndim = PyArray_NDIM(a);
-    const npy_intp *shape = PyArray_SHAPE(a);
-    const npy_intp *strides = PyArray_STRIDES(a);
     const npy_intp item_size = PyArray_ITEMSIZE(a);
+    npy_intp *loop_strides[1];
+    npy_intp tmp;
 
+    it->ndim = ndim;
     it->axis = 0;
     it->its = 0;
     it->nits = 1;
-    it->a_ravel = NULL;
-
-    /* The fix for relaxed strides checking in numpy and the fix for
-     * issue #183 has left this if..else tree in need of a refactor from the
-     * the ground up */
-    if (ndim == 1) {
-        it->ndim_m2 = -1;
-        it->length = shape[0];
-        it->astride = strides[0];
-    } else if (ndim == 0) {
-        it->ndim_m2 = -1;
-        it->length = 1;
-        it->astride = 0;
-    } else if (C_CONTIGUOUS(a) && !F_CONTIGUOUS(a)) {
-        /* The &&! in the next two else ifs is to deal with relaxed
-         * stride checking introduced in numpy 1.12.0; see gh #161 */
-        it->ndim_m2 = -1;
-        it->axis = ndim - 1;
-        it->length = PyArray_SIZE(a);
-        it->astride = 0;
-        for (i=ndim-1; i > -1; i--) {
-            /* protect against length zero  strides such as in
-             * np.ones((2, 2))[..., np.newaxis] */
-            if (strides[i] == 0) {
-                continue;
-            }
-            it->astride = strides[i];
-            break;
-       }
-    } else if (F_CONTIGUOUS(a) && !C_CONTIGUOUS(a)) {
-        if (anyorder || !ravel) {
-            it->ndim_m2 = -1;
-            it->length = PyArray_SIZE(a);
-            it->astride = 0;
-            for (i=0; i < ndim; i++) {
-                /* protect against length zero  strides such as in
-                 * np.ones((2, 2), order='F')[np.newaxis, ...] */
-                if (strides[i] == 0) {
-                    continue;
-                }
-                it->astride = strides[i];
-                break;
-           }
-        } else {
-            it->ndim_m2 = -1;
-            if (anyorder) {
-                a = (PyArrayObject *)PyArray_Ravel(a, NPY_ANYORDER);
-            } else {
-                a = (PyArrayObject *)PyArray_Ravel(a, NPY_CORDER);
+    it->pa = PyArray_BYTES(a);
+
+    for (i = 0; i < ndim; i++) {
+        it->shape[i] = PyArray_DIM(a, i);
+        it->astrides[i] = PyArray_STRIDE(a, i);
+    }
+    if (anyorder) {
+        for (i = 0; i < ndim; i++) {
+            if (it->astrides[i] < 0) {
+                it->pa += (it->shape[i] - 1) * it->astrides[i];
+                it->astrides[i] = -it->astrides[i];
             }
-            it->a_ravel = a;
-            it->length = PyArray_DIM(a, 0);
-            it->astride = PyArray_STRIDE(a, 0);
-        }
-    } else if (ravel) {
-        it->ndim_m2 = -1;
-        if (anyorder) {
-            a = (PyArrayObject *)PyArray_Ravel(a, NPY_ANYORDER);
-        } else {
-            a = (PyArrayObject *)PyArray_Ravel(a, NPY_CORDER);
         }
-        it->a_ravel = a;
-        it->length = PyArray_DIM(a, 0);
-        it->astride = PyArray_STRIDE(a, 0);
-    } else {
-        it->ndim_m2 = ndim - 2;
-        it->astride = strides[0];
+        /* insertion sort, which keeps the C order of equal strides */
         for (i = 1; i < ndim; i++) {
-            if (strides[i] < it->astride) {
-                it->astride = strides[i];
-                it->axis = i;
-            }
-        }
-        it->length = shape[it->axis];
-        for (i = 0; i < ndim; i++) {
-            if (i != it->axis) {
-                it->indices[j] = 0;
-                it->astrides[j] = strides[i];
-                it->shape[j] = shape[i];
-                it->nits *= shape[i];
-                j++;
+            for (j = i; j > 0 && it->astrides[j - 1] < it->astrides[j]; j--) {
+                tmp = it->astrides[j];
+                it->astrides[j] = it->astrides[j - 1];
+                it->astrides[j - 1] = tmp;
+                tmp = it->shape[j];
+                it->shape[j] = it->shape[j - 1];
+                it->shape[j - 1] = tmp;
             }
         }
     }
+    loop_strides[0] = it->astrides;
+    n = coalesce_dims(ndim, it->shape, loop_strides, 1);
 
+    it->ndim_m2 = -1;
+    if (PyArray_SIZE(a) == 0) {
+        it->length = 0;
+        it->astride = 0;
+    } else if (n <= 1) {
+        it->length = n == 0 ? 1 : it->shape[0];
+        it->astride = n == 0 ? 0 : it->astrides[0];
+    } else {
+        it->ndim_m2 = n - 2;
+        it->length = it->shape[n - 1];
+        it->astride = it->astrides[n - 1];
+        for (i = 0; i < n - 1; i++) {
+            it->indices[i] = 0;
+            it->nits *= it->shape[i];
+        }
+    }
     it->stride = it->astride / item_size;
-    it->pa = PyArray_BYTES(a);
 }
 
+/* the first test steps along the innermost dimension, which is what NEXT
+   does on all but one in shape[ndim_m2] calls */
 #define NEXT \
-    for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
-        if (it.indices[it.i] < it.shape[it.i] - 1) { \
-            it.pa += it.astrides[it.i]; \
-            it.indices[it.i]++; \
-            break; \
+    if (it.ndim_m2 >= 0 && \
+        it.indices[it.ndim_m2] < it.shape[it.ndim_m2] - 1) { \
+        it.pa += it.astrides[it.ndim_m2]; \
+        it.indices[it.ndim_m2]++; \
+    } else { \
+        for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
+            if (it.indices[it.i] < it.shape[it.i] - 1) { \
+                it.pa += it.astrides[it.i]; \
+                it.indices[it.i]++; \
+                break; \
+            } \
+            it.pa -= it.indices[it.i] * it.astrides[it.i]; \
+            it.indices[it.i] = 0; \
         } \
-        it.pa -= it.indices[it.i] * it.astrides[it.i]; \
-        it.indices[it.i] = 0; \
     } \
     it.its++;
 
+/* moves an iterator from init_iter_one that has not started to iteration
+   its, so that parts of one walk can run on different threads; the indices
+   left are zero, and no dimension is looked at when its is 0, which may be
+   the end of an empty walk */
+static inline void
+iter_seek(iter *it, npy_intp its)
+{
+    int i;
+    npy_intp k = its;
+    for (i = it->ndim_m2; i > -1 && k > 0; i--) {
+        it->indices[i] = k % it->shape[i];
+        it->pa += it->indices[i] * it->astrides[i];
+        k /= it->shape[i];
+    }
+    it->its = its;
+}
+
+/* loop interchange ------------------------------------------------------ */
+
+/*
+ REDUCE_ONE walks the axis in its inner FOR loop. When the axis has a larger
+ stride than the innermost of the other dimensions, as in nansum(a, axis=0)
+ of a C order array, every step of that loop lands on a new cache line. The
+ tiled walk interchanges the loops: for each tile of up to BN_TILE outputs
+ along the innermost other dimension it keeps a tile of accumulators and
+ steps along the axis in the outer loop, reading the tile as one short run
+ of memory per step. The values reach each accumulator in the same order,
+ so the results are the same as those of the plain walk.
+
+ tiles_pay is the cost model. While `a` fits in cache the plain walk's
+ strided reads are cheap and it is kept. Beyond that each of its reads
+ costs a cache line, against tstride bytes for the tiled walk, whose loop
+ over a tile is worth starting only if the tile spans at least half a line.
+*/
+
+#define BN_TILE 1024
+#define BN_CACHE_LINE 64
+#define BN_CACHE_BYTES (1 << 20)
+
+static inline int
+tiles_pay(const iter *it, npy_intp nbytes)
+{
+    npy_intp tlen, tstride, astride;
+    if (it->ndim_m2 < 0 || it->length < 2) return 0;
+    if (nbytes < BN_CACHE_BYTES) return 0;
+    tlen = it->shape[it->ndim_m2];
+    tstride = it->astrides[it->ndim_m2];
+    astride = it->astride;
+    if (tstride < 0) tstride = -tstride;
+    if (astride < 0) astride = -astride;
+    if (tstride >= astride) return 0;
+    if (tlen > BN_TILE) tlen = BN_TILE;
+    return tlen * tstride >= BN_CACHE_LINE / 2;
+}
+
+/* call after INIT_ONE if tiles_pay(&it, PyArray_NBYTES(a)); WHILE and NEXT
+   then walk rows of tlen outputs, which FOR_TILES splits into tiles of tn
+   outputs starting at t0 */
+#define INIT_TILES \
+    const npy_intp tlen = it.shape[it.ndim_m2]; \
+    const npy_intp tstride = it.astrides[it.ndim_m2]; \
+    npy_intp t, t0, tn; \
+    it.nits /= tlen; \
+    it.ndim_m2--;
+
+#define FOR_TILES \
+    for (t0 = 0, tn = tlen < BN_TILE ? tlen : BN_TILE; t0 < tlen; \
+         t0 += tn, tn = tlen - t0 < BN_TILE ? tlen - t0 : BN_TILE)
+
+#define FOR_T          for (t = 0; t < tn; t++)
+
+/* element t of the tile at step INDEX along the axis */
+#define AT(dtype) \
+    *(bn_##dtype *)(it.pa + it.i * it.astride + (t0 + t) * tstride)
+
 /* two input arrays ------------------------------------------------------ */
 
 /* this iterator is used mainly by moving window functions such as move_sum */
 
 struct _iter2 {
+    int        ndim;
     int        ndim_m2;
     int        axis;
     Py_ssize_t length;
@@ -202,8 +294,12 @@ struct _iter2 {
     npy_intp   astrides[NPY_MAXDIMS];
     npy_intp   ystrides[NPY_MAXDIMS];
     npy_intp   shape[NPY_MAXDIMS];
+    npy_intp   yshape[NPY_MAXDIMS];
     char       *pa;
     char       *py;
+    npy_intp   iseg;    /* index of the current segment along axis */
+    npy_intp   nseg;    /* number of segments along axis */
+    const npy_intp *seg; /* NULL or the nseg + 1 boundaries of the segments */
 };
 typedef struct _iter2 iter2;
 
@@ -215,18 +311,22 @@ init_iter2(iter2 *it, PyArrayObject *a, PyObject *y, int axis)
     const npy_intp *shape = PyArray_SHAPE(a);
     const npy_intp *astrides = PyArray_STRIDES(a);
     const npy_intp *ystrides = PyArray_STRIDES((PyArrayObject *)y);
+    npy_intp *loop_strides[2];
 
     /* to avoid compiler warning of uninitialized variables */
     it->length = 0;
     it->astride = 0;
     it->ystride = 0;
 
-    it->ndim_m2 = ndim - 2;
+    it->ndim = ndim;
     it->axis = axis;
     it->its = 0;
     it->nits = 1;
     it->pa = PyArray_BYTES(a);
     it->py = PyArray_BYTES((PyArrayObject *)y);
+    it->iseg = 0;
+    it->nseg = 1;
+    it->seg = NULL;
 
     for (i = 0; i < ndim; i++) {
         if (i == axis) {
@@ -234,35 +334,95 @@ init_iter2(iter2 *it, PyArrayObject *a, PyObject *y, int axis)
             it->ystride = ystrides[i];
             it->length = shape[i];
         } else {
-            it->indices[j] = 0;
             it->astrides[j] = astrides[i];
             it->ystrides[j] = ystrides[i];
             it->shape[j] = shape[i];
+            it->yshape[j] = shape[i];
             it->nits *= shape[i];
             j++;
         }
     }
+    loop_strides[0] = it->astrides;
+    loop_strides[1] = it->ystrides;
+    it->ndim_m2 = coalesce_dims(j, it->shape, loop_strides, 2) - 1;
+    for (i = 0; i <= it->ndim_m2; i++) {
+        it->indices[i] = 0;
+    }
 }
 
 #define NEXT2 \
-    for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
-        if (it.indices[it.i] < it.shape[it.i] - 1) { \
-            it.pa += it.astrides[it.i]; \
-            it.py += it.ystrides[it.i]; \
-            it.indices[it.i]++; \
-            break; \
+    if (it.ndim_m2 >= 0 && \
+        it.indices[it.ndim_m2] < it.shape[it.ndim_m2] - 1) { \
+        it.pa += it.astrides[it.ndim_m2]; \
+        it.py += it.ystrides[it.ndim_m2]; \
+        it.indices[it.ndim_m2]++; \
+    } else { \
+        for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
+            if (it.indices[it.i] < it.shape[it.i] - 1) { \
+                it.pa += it.astrides[it.i]; \
+                it.py += it.ystrides[it.i]; \
+                it.indices[it.i]++; \
+                break; \
+            } \
+            it.pa -= it.indices[it.i] * it.astrides[it.i]; \
+            it.py -= it.indices[it.i] * it.ystrides[it.i]; \
+            it.indices[it.i] = 0; \
         } \
-        it.pa -= it.indices[it.i] * it.astrides[it.i]; \
-        it.py -= it.indices[it.i] * it.ystrides[it.i]; \
-        it.indices[it.i] = 0; \
     } \
     it.its++;
 
+/* iter_seek for an iter2 */
+static inline void
+iter2_seek(iter2 *it, npy_intp its)
+{
+    int i;
+    npy_intp k = its;
+    for (i = it->ndim_m2; i > -1 && k > 0; i--) {
+        it->indices[i] = k % it->shape[i];
+        it->pa += it->indices[i] * it->astrides[i];
+        it->py += it->indices[i] * it->ystrides[i];
+        k /= it->shape[i];
+    }
+    it->its = its;
+}
+
+/*
+ * Split each slice along axis into the segments [seg[k], seg[k + 1]), with
+ * seg[0] == 0 and seg[nseg] == a.shape[axis]. The loop body then sees one
+ * segment at a time, as though it were a slice of its own, and NEXT2_SEG
+ * moves to the next segment before moving to the next slice. Used by the
+ * moving window functions to restart the window at each group.
+ */
+static inline void
+init_iter2_seg(iter2 *it, const npy_intp *seg, npy_intp nseg)
+{
+    it->seg = seg;
+    it->nseg = nseg;
+    it->length = seg[1];
+}
+
+#define NEXT2_SEG \
+    if (it.iseg < it.nseg - 1) { \
+        it.pa += it.length * it.astride; \
+        it.py += it.length * it.ystride; \
+        it.iseg++; \
+        it.length = it.seg[it.iseg + 1] - it.seg[it.iseg]; \
+    } else { \
+        if (it.iseg > 0) { \
+            it.pa -= it.seg[it.iseg] * it.astride; \
+            it.py -= it.seg[it.iseg] * it.ystride; \
+            it.iseg = 0; \
+            it.length = it.seg[1]; \
+        } \
+        NEXT2 \
+    }
+
 /* three input arrays ---------------------------------------------------- */
 
 /* this iterator is used mainly by rankdata and nanrankdata */
 
 struct _iter3 {
+    int        ndim;
     int        ndim_m2;
     int        axis;
     Py_ssize_t length;
@@ -277,6 +437,7 @@ struct _iter3 {
     npy_intp   ystrides[NPY_MAXDIMS];
     npy_intp   zstrides[NPY_MAXDIMS];
     npy_intp   shape[NPY_MAXDIMS];
+    npy_intp   yshape[NPY_MAXDIMS];
     char       *pa;
     char       *py;
     char       *pz;
@@ -292,6 +453,7 @@ init_iter3(iter3 *it, PyArrayObject *a, PyObject *y, PyObject *z, int axis)
     const npy_intp *astrides = PyArray_STRIDES(a);
     const npy_intp *ystrides = PyArray_STRIDES((PyArrayObject *)y);
     const npy_intp *zstrides = PyArray_STRIDES((PyArrayObject *)z);
+    npy_intp *loop_strides[3];
 
     /* to avoid compiler warning of uninitialized variables */
     it->length = 0;
@@ -299,7 +461,7 @@ init_iter3(iter3 *it, PyArrayObject *a, PyObject *y, PyObject *z, int axis)
     it->ystride = 0;
     it->zstride = 0;
 
-    it->ndim_m2 = ndim - 2;
+    it->ndim = ndim;
     it->axis = axis;
     it->its = 0;
     it->nits = 1;
@@ -314,30 +476,45 @@ init_iter3(iter3 *it, PyArrayObject *a, PyObject *y, PyObject *z, int axis)
             it->zstride = zstrides[i];
             it->length = shape[i];
         } else {
-            it->indices[j] = 0;
             it->astrides[j] = astrides[i];
             it->ystrides[j] = ystrides[i];
             it->zstrides[j] = zstrides[i];
             it->shape[j] = shape[i];
+            it->yshape[j] = shape[i];
             it->nits *= shape[i];
             j++;
         }
     }
+    loop_strides[0] = it->astrides;
+    loop_strides[1] = it->ystrides;
+    loop_strides[2] = it->zstrides;
+    it->ndim_m2 = coalesce_dims(j, it->shape, loop_strides, 3) - 1;
+    for (i = 0; i <= it->ndim_m2; i++) {
+        it->indices[i] = 0;
+    }
 }
 
 #define NEXT3 \
-    for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
-        if (it.indices[it.i] < it.shape[it.i] - 1) { \
-            it.pa += it.astrides[it.i]; \
-            it.py += it.ystrides[it.i]; \
-            it.pz += it.zstrides[it.i]; \
-            it.indices[it.i]++; \
-            break; \
+    if (it.ndim_m2 >= 0 && \
+        it.indices[it.ndim_m2] < it.shape[it.ndim_m2] - 1) { \
+        it.pa += it.astrides[it.ndim_m2]; \
+        it.py += it.ystrides[it.ndim_m2]; \
+        it.pz += it.zstrides[it.ndim_m2]; \
+        it.indices[it.ndim_m2]++; \
+    } else { \
+        for (it.i = it.ndim_m2; it.i > -1; it.i--) { \
+            if (it.indices[it.i] < it.shape[it.i] - 1) { \
+                it.pa += it.astrides[it.i]; \
+                it.py += it.ystrides[it.i]; \
+                it.pz += it.zstrides[it.i]; \
+                it.indices[it.i]++; \
+                break; \
+            } \
+            it.pa -= it.indices[it.i] * it.astrides[it.i]; \
+            it.py -= it.indices[it.i] * it.ystrides[it.i]; \
+            it.pz -= it.indices[it.i] * it.zstrides[it.i]; \
+            it.indices[it.i] = 0; \
         } \
-        it.pa -= it.indices[it.i] * it.astrides[it.i]; \
-        it.py -= it.indices[it.i] * it.ystrides[it.i]; \
-        it.pz -= it.indices[it.i] * it.zstrides[it.i]; \
-        it.indices[it.i] = 0; \
     } \
     it.its++;
 
@@ -345,15 +522,16 @@ init_iter3(iter3 *it, PyArrayObject *a, PyObject *y, PyObject *z, int axis)
 
 /* most of these macros assume iterator is named `it` */
 
-#define  NDIM           it.ndim_m2 + 2
-#define  SHAPE          it.shape
+#define  NDIM           it.ndim
+#define  SHAPE          it.yshape
 #define  SIZE           it.nits * it.length
 #define  LENGTH         it.length
 #define  INDEX          it.i
 
 #define  WHILE          while (it.its < it.nits)
-#define  WHILE0         it.i = 0; while (it.i < min_count - 1)
-#define  WHILE1         while (it.i < window)
+#define  WHILE0         it.i = 0; \
+                        while (it.i < min_count - 1 && it.i < it.length)
+#define  WHILE1         while (it.i < window && it.i < it.length)
 #define  WHILE2         while (it.i < it.length)
 
 #define  FOR            for (it.i = 0; it.i < it.length; it.i++)
@@ -361,20 +539,20 @@ init_iter3(iter3 *it, PyArrayObject *a, PyObject *y, PyObject *z, int axis)
 
 #define  RESET          it.its = 0;
 
-#define  PA(dtype)      (npy_##dtype *)(it.pa)
+#define  PA(dtype)      (bn_##dtype *)(it.pa)
 
-#define  A0(dtype)      *(npy_##dtype *)(it.pa)
-#define  AI(dtype)      *(npy_##dtype *)(it.pa + it.i * it.astride)
-#define  AX(dtype, x)   *(npy_##dtype *)(it.pa + (x) * it.astride)
-#define  AOLD(dtype)    *(npy_##dtype *)(it.pa + (it.i - window) * it.astride)
+#define  A0(dtype)      *(bn_##dtype *)(it.pa)
+#define  AI(dtype)      *(bn_##dtype *)(it.pa + it.i * it.astride)
+#define  AX(dtype, x)   *(bn_##dtype *)(it.pa + (x) * it.astride)
+#define  AOLD(dtype)    *(bn_##dtype *)(it.pa + (it.i - window) * it.astride)
 
 #define  SI(pa)         pa[it.i * it.stride]    
 
 #define  YPP            *py++
-#define  YI(dtype)      *(npy_##dtype *)(it.py + it.i++ * it.ystride)
-#define  YX(dtype, x)   *(npy_##dtype *)(it.py + (x) * it.ystride)
+#define  YI(dtype)      *(bn_##dtype *)(it.py + it.i++ * it.ystride)
+#define  YX(dtype, x)   *(bn_##dtype *)(it.py + (x) * it.ystride)
 
-#define  ZX(dtype, x)   *(npy_##dtype *)(it.pz + (x) * it.zstride)
+#define  ZX(dtype, x)   *(bn_##dtype *)(it.pz + (x) * it.zstride)
 
 #define FILL_Y(value) \
     npy_intp _i; \
@@ -2,12 +2,31 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
 #include <assert.h>
 #include <bn_config.h>
+#include <bn_float16.h>
 
 typedef size_t idx_t;
-typedef double ai_t;
+
+/* Compact index stored in the heaps. A window never exceeds INT_MAX (the
+ * window is parsed as a C int) so 32 bits are enough. */
+typedef uint32_t sidx_t;
+
+/* The values in the moving window are kept in their native dtype */
+typedef double     mm_float64;
+typedef float      mm_float32;
+typedef bn_float16 mm_float16;
+typedef int64_t    mm_int64;
+typedef int32_t    mm_int32;
+typedef int16_t    mm_int16;
+typedef int8_t     mm_int8;
+typedef uint64_t   mm_uint64;
+typedef uint32_t   mm_uint32;
+typedef uint16_t   mm_uint16;
+typedef uint8_t    mm_uint8;
+typedef uint8_t    mm_bool;
 
 #if BINARY_TREE==1
     #define NUM_CHILDREN 2
@@ -25,44 +44,80 @@ typedef double ai_t;
 #define LH 1
 #define NA 2
 
-#define FIRST_LEAF(n) (idx_t) ceil((n - 1) / (double)NUM_CHILDREN)
-
-struct _mm_node {
-    int              region; /* SH small heap, LH large heap, NA nan array */
-    ai_t             ai;     /* The node's value */
-    idx_t            idx;    /* The node's index in the heap or nan array */
-    struct _mm_node *next;   /* The next node in order of insertion */
-};
-typedef struct _mm_node mm_node;
+/* ceil((n - 1) / NUM_CHILDREN) in integer arithmetic; zero when n is zero */
+#define FIRST_LEAF(n) (((n) + NUM_CHILDREN - 2) / NUM_CHILDREN)
 
+/*
+ * The window is stored as a structure of arrays. Each value lives in a slot
+ * of a ring buffer (`values`) that is overwritten in order of insertion, so
+ * the oldest value is always in slot `oldest` and no linked list is needed.
+ * The heaps and the nan array hold slot numbers; `pos` and `region` map a
+ * slot back to where it currently sits. All arrays share one allocation.
+ */
 struct _mm_handle {
-    idx_t     window;    /* window size */
-    int       odd;       /* is window even (0) or odd (1) */
-    idx_t     min_count; /* Same meaning as in bn.move_median */
-    idx_t     n_s;       /* Number of nodes in the small heap */
-    idx_t     n_l;       /* Number of nodes in the large heap */
-    idx_t     n_n;       /* Number of nodes in the nan array */
-    mm_node **s_heap;    /* The max heap of small ai */
-    mm_node **l_heap;    /* The min heap of large ai */
-    mm_node **n_array;   /* The nan array */
-    mm_node **nodes;     /* s_heap and l_heap point into this array */
-    mm_node  *node_data; /* Pointer to memory location where nodes live */
-    mm_node  *oldest;    /* The oldest node */
-    mm_node  *newest;    /* The newest node (most recent insert) */
-    idx_t s_first_leaf;  /* All nodes this index or greater are leaf nodes */
-    idx_t l_first_leaf;  /* All nodes this index or greater are leaf nodes */
+    idx_t          window;    /* window size */
+    int            odd;       /* is window even (0) or odd (1) */
+    idx_t          min_count; /* Same meaning as in bn.move_median */
+    idx_t          n_s;       /* Number of nodes in the small heap */
+    idx_t          n_l;       /* Number of nodes in the large heap */
+    idx_t          n_n;       /* Number of nodes in the nan array */
+    idx_t          oldest;    /* Ring slot of the oldest value */
+    idx_t s_first_leaf;       /* All nodes this index or greater are leaves */
+    idx_t l_first_leaf;       /* All nodes this index or greater are leaves */
+    void          *values;    /* Ring of window values in native dtype */
+    sidx_t        *s_heap;    /* The max heap of small ai (ring slots) */
+    sidx_t        *l_heap;    /* The min heap of large ai (ring slots) */
+    sidx_t        *n_array;   /* The nan array (ring slots) */
+    sidx_t        *pos;       /* Index of each slot in its heap/nan array */
+    unsigned char *region;    /* Region (SH, LH, NA) of each slot */
 };
 typedef struct _mm_handle mm_handle;
 
+/* handles; itemsize is the size of the dtype of the values in the window */
+mm_handle *mm_new(const idx_t window, idx_t min_count, size_t itemsize);
+mm_handle *mm_new_nan(const idx_t window, idx_t min_count, size_t itemsize);
+
+/* handles in caller-provided memory of mm_size() or mm_size_nan() bytes */
+size_t mm_size(const idx_t window, size_t itemsize);
+size_t mm_size_nan(const idx_t window, size_t itemsize);
+mm_handle *mm_init(void *buffer, const idx_t window, idx_t min_count,
+                   size_t itemsize);
+mm_handle *mm_init_nan(void *buffer, const idx_t window, idx_t min_count,
+                       size_t itemsize);
+
 /* non-nan functions */
-mm_handle *mm_new(const idx_t window, idx_t min_count);
-ai_t mm_update_init(mm_handle *mm, ai_t ai);
-ai_t mm_update(mm_handle *mm, ai_t ai);
+mm_float64 mm_update_init_float64(mm_handle *mm, mm_float64 ai);
+mm_float64 mm_update_init_float32(mm_handle *mm, mm_float32 ai);
+mm_float64 mm_update_init_int64(mm_handle *mm, mm_int64 ai);
+mm_float64 mm_update_init_int32(mm_handle *mm, mm_int32 ai);
+mm_float64 mm_update_init_float16(mm_handle *mm, mm_float16 ai);
+mm_float64 mm_update_init_int16(mm_handle *mm, mm_int16 ai);
+mm_float64 mm_update_init_int8(mm_handle *mm, mm_int8 ai);
+mm_float64 mm_update_init_uint64(mm_handle *mm, mm_uint64 ai);
+mm_float64 mm_update_init_uint32(mm_handle *mm, mm_uint32 ai);
+mm_float64 mm_update_init_uint16(mm_handle *mm, mm_uint16 ai);
+mm_float64 mm_update_init_uint8(mm_handle *mm, mm_uint8 ai);
+mm_float64 mm_update_init_bool(mm_handle *mm, mm_bool ai);
+mm_float64 mm_update_float64(mm_handle *mm, mm_float64 ai);
+mm_float64 mm_update_float32(mm_handle *mm, mm_float32 ai);
+mm_float64 mm_update_int64(mm_handle *mm, mm_int64 ai);
+mm_float64 mm_update_int32(mm_handle *mm, mm_int32 ai);
+mm_float64 mm_update_float16(mm_handle *mm, mm_float16 ai);
+mm_float64 mm_update_int16(mm_handle *mm, mm_int16 ai);
+mm_float64 mm_update_int8(mm_handle *mm, mm_int8 ai);
+mm_float64 mm_update_uint64(mm_handle *mm, mm_uint64 ai);
+mm_float64 mm_update_uint32(mm_handle *mm, mm_uint32 ai);
+mm_float64 mm_update_uint16(mm_handle *mm, mm_uint16 ai);
+mm_float64 mm_update_uint8(mm_handle *mm, mm_uint8 ai);
+mm_float64 mm_update_bool(mm_handle *mm, mm_bool ai);
 
 /* nan functions */
-mm_handle *mm_new_nan(const idx_t window, idx_t min_count);
-ai_t mm_update_init_nan(mm_handle *mm, ai_t ai);
-ai_t mm_update_nan(mm_handle *mm, ai_t ai);
+mm_float64 mm_update_init_nan_float64(mm_handle *mm, mm_float64 ai);
+mm_float64 mm_update_init_nan_float32(mm_handle *mm, mm_float32 ai);
+mm_float64 mm_update_init_nan_float16(mm_handle *mm, mm_float16 ai);
+mm_float64 mm_update_nan_float64(mm_handle *mm, mm_float64 ai);
+mm_float64 mm_update_nan_float32(mm_handle *mm, mm_float32 ai);
+mm_float64 mm_update_nan_float16(mm_handle *mm, mm_float16 ai);
 
 /* functions common to non-nan and nan cases */
 void mm_reset(mm_handle *mm);
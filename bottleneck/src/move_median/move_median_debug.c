@@ -1,16 +1,18 @@
 #include "move_median.h"
 
+typedef mm_float64 ai_t;
+
 ai_t *mm_move_median(ai_t *a, idx_t length, idx_t window, idx_t min_count);
 int mm_assert_equal(ai_t *actual, ai_t *desired, ai_t *input, idx_t length,
                     char *err_msg);
 int mm_unit_test(void);
 void mm_dump(mm_handle *mm);
-void mm_print_binary_heap(mm_node **heap, idx_t n_array, idx_t oldest_idx,
-                          idx_t newest_idx);
+void mm_print_binary_heap(mm_handle *mm, sidx_t *heap, idx_t n_array,
+                          idx_t oldest_idx, idx_t newest_idx);
 void mm_check(mm_handle *mm);
 void mm_print_chain(mm_handle *mm);
 void mm_print_line(void);
-void mm_print_node(mm_node *node);
+void mm_print_node(mm_handle *mm, sidx_t node);
 
 
 int main(void) {
@@ -25,12 +27,12 @@ ai_t *mm_move_median(ai_t *a, idx_t length, idx_t window, idx_t min_count) {
     idx_t i;
 
     out = malloc(length * sizeof(ai_t));
-    mm = mm_new_nan(window, min_count);
+    mm = mm_new_nan(window, min_count, sizeof(ai_t));
     for (i=0; i < length; i++) {
         if (i < window) {
-            out[i] = mm_update_init_nan(mm, a[i]);
+            out[i] = mm_update_init_nan_float64(mm, a[i]);
         } else {
-            out[i] = mm_update_nan(mm, a[i]);
+            out[i] = mm_update_nan_float64(mm, a[i]);
         }
         if (i == window) {
             mm_print_line();
@@ -100,26 +102,33 @@ int mm_unit_test(void) {
 }
 
 
-void mm_print_node(mm_node *node) {
-    printf("\n\n%d small\n", node->region);
-    printf("%d idx\n", node->idx);
-    printf("%f ai\n", node->ai);
-    printf("%p next\n\n", node->next);
+/* value stored in a ring slot */
+#define VAL(mm, node) (((ai_t *)(mm)->values)[node])
+
+/* ring slot of the most recent insert */
+#define NEWEST(mm) \
+    (((mm)->oldest + (mm)->n_s + (mm)->n_l + (mm)->n_n - 1) % (mm)->window)
+
+
+void mm_print_node(mm_handle *mm, sidx_t node) {
+    printf("\n\n%d region\n", mm->region[node]);
+    printf("%d idx\n", (int)mm->pos[node]);
+    printf("%f ai\n", VAL(mm, node));
+    printf("%d slot\n\n", (int)node);
 }
 
 
 void mm_print_chain(mm_handle *mm) {
-    idx_t i;
-    mm_node *node;
+    idx_t i, n;
+    sidx_t node;
 
+    /* before the window is full the oldest value is in slot 0 */
+    n = mm->n_s + mm->n_l + mm->n_n;
     printf("\nchain\n");
-    node = mm->oldest;
-    printf("\t%6.2f region %d idx %d addr %p\n", node->ai, node->region,
-           node->idx, node);
-    for (i=1; i < mm->n_s + mm->n_l + mm->n_n; i++) {
-        node = node->next;
-        printf("\t%6.2f region %d idx %d addr %p\n", node->ai, node->region,
-               node->idx, node);
+    for (i=0; i < n; i++) {
+        node = (sidx_t)((mm->oldest + i) % mm->window);
+        printf("\t%6.2f region %d idx %d slot %d\n", VAL(mm, node),
+               mm->region[node], (int)mm->pos[node], (int)node);
     }
 }
 
@@ -128,50 +137,46 @@ void mm_check(mm_handle *mm) {
 
     int ndiff;
     idx_t i;
-    mm_node *child;
-    mm_node *parent;
+    sidx_t child;
+    sidx_t parent;
 
     // small heap
     for (i=0; i<mm->n_s; i++) {
-        assert(mm->s_heap[i]->idx == i);
-        assert(mm->s_heap[i]->ai == mm->s_heap[i]->ai);
+        assert(mm->pos[mm->s_heap[i]] == i);
+        assert(mm->region[mm->s_heap[i]] == SH);
+        assert(VAL(mm, mm->s_heap[i]) == VAL(mm, mm->s_heap[i]));
         if (i > 0) {
             child = mm->s_heap[i];
-            parent = mm->s_heap[P_IDX(child->idx)];
-            assert(child->ai <= parent->ai);
+            parent = mm->s_heap[P_IDX(i)];
+            assert(VAL(mm, child) <= VAL(mm, parent));
         }
     }
 
     // large heap
     for (i=0; i<mm->n_l; i++) {
-        assert(mm->l_heap[i]->idx == i);
-        assert(mm->l_heap[i]->ai == mm->l_heap[i]->ai);
+        assert(mm->pos[mm->l_heap[i]] == i);
+        assert(mm->region[mm->l_heap[i]] == LH);
+        assert(VAL(mm, mm->l_heap[i]) == VAL(mm, mm->l_heap[i]));
         if (i > 0) {
             child = mm->l_heap[i];
-            parent = mm->l_heap[P_IDX(child->idx)];
-            assert(child->ai >= parent->ai);
+            parent = mm->l_heap[P_IDX(i)];
+            assert(VAL(mm, child) >= VAL(mm, parent));
         }
     }
 
     // nan array
     for (i=0; i<mm->n_n; i++) {
-         assert(mm->n_array[i]->idx == i);
-         assert(mm->n_array[i]->ai != mm->n_array[i]->ai);
+         assert(mm->pos[mm->n_array[i]] == i);
+         assert(mm->region[mm->n_array[i]] == NA);
+         assert(VAL(mm, mm->n_array[i]) != VAL(mm, mm->n_array[i]));
     }
 
     // handle
     assert(mm->window >= mm->n_s + mm->n_l + mm->n_n);
     assert(mm->min_count <= mm->window);
-    if (mm->n_s == 0) {
-        assert(mm->s_first_leaf == 0);
-    } else {
-        assert(mm->s_first_leaf == FIRST_LEAF(mm->n_s));
-    }
-    if (mm->n_l == 0) {
-        assert(mm->l_first_leaf == 0);
-    } else {
-        assert(mm->l_first_leaf == FIRST_LEAF(mm->n_l));
-    }
+    assert(mm->oldest < mm->window);
+    assert(mm->s_first_leaf == FIRST_LEAF(mm->n_s));
+    assert(mm->l_first_leaf == FIRST_LEAF(mm->n_l));
     ndiff = (int)mm->n_s - (int)mm->n_l;
     if (ndiff < 0) {
         ndiff *= -1;
@@ -179,7 +184,7 @@ void mm_check(mm_handle *mm) {
     assert(ndiff <= 1);
 
     if (mm->n_s > 0 && mm->n_l > 0) {
-        assert(mm->s_heap[0]->ai <= mm->l_heap[0]->ai);
+        assert(VAL(mm, mm->s_heap[0]) <= VAL(mm, mm->l_heap[0]));
     }
 }
 
@@ -187,21 +192,25 @@ void mm_check(mm_handle *mm) {
 /* Print the two heaps to the screen */
 void mm_dump(mm_handle *mm) {
     int i;
-    idx_t idx;
+    sidx_t oldest, newest;
 
     if (!mm) {
         printf("mm is empty");
         return;
     }
 
+    oldest = (sidx_t)mm->oldest;
+    newest = (sidx_t)NEWEST(mm);
+
     printf("\nhandle\n");
-    printf("\t%2d window\n", mm->window);
-    printf("\t%2d n_s\n", mm->n_s);
-    printf("\t%2d n_l\n", mm->n_l);
-    printf("\t%2d n_n\n", mm->n_n);
-    printf("\t%2d min_count\n", mm->min_count);
-    printf("\t%2d s_first_leaf\n", mm->s_first_leaf);
-    printf("\t%2d l_first_leaf\n", mm->l_first_leaf);
+    printf("\t%2d window\n", (int)mm->window);
+    printf("\t%2d n_s\n", (int)mm->n_s);
+    printf("\t%2d n_l\n", (int)mm->n_l);
+    printf("\t%2d n_n\n", (int)mm->n_n);
+    printf("\t%2d min_count\n", (int)mm->min_count);
+    printf("\t%2d s_first_leaf\n", (int)mm->s_first_leaf);
+    printf("\t%2d l_first_leaf\n", (int)mm->l_first_leaf);
+    printf("\t%2d oldest slot\n", (int)oldest);
 
     if (NUM_CHILDREN == 2) {
 
@@ -211,44 +220,26 @@ void mm_dump(mm_handle *mm) {
         int idx1;
 
         printf("\nsmall heap\n");
-        idx0 = -1;
-        if (mm->oldest->region == SH) {
-            idx0 = mm->oldest->idx;
-        }
-        idx1 = -1;
-        if (mm->newest->region == SH) {
-            idx1 = mm->newest->idx;
-        }
-        mm_print_binary_heap(mm->s_heap, mm->n_s, idx0, idx1);
+        idx0 = mm->region[oldest] == SH ? (int)mm->pos[oldest] : -1;
+        idx1 = mm->region[newest] == SH ? (int)mm->pos[newest] : -1;
+        mm_print_binary_heap(mm, mm->s_heap, mm->n_s, idx0, idx1);
         printf("\nlarge heap\n");
-        idx0 = -1;
-        if (mm->oldest->region == LH) {
-            idx0 = mm->oldest->idx;
-        }
-        idx1 = -1;
-        if (mm->newest->region == LH) {
-            idx1 = mm->newest->idx;
-        }
-        mm_print_binary_heap(mm->l_heap, mm->n_l, idx0, idx1);
+        idx0 = mm->region[oldest] == LH ? (int)mm->pos[oldest] : -1;
+        idx1 = mm->region[newest] == LH ? (int)mm->pos[newest] : -1;
+        mm_print_binary_heap(mm, mm->l_heap, mm->n_l, idx0, idx1);
         printf("\nnan array\n");
-        idx0 = -1;
-        if (mm->oldest->region == NA) {
-            idx0 = mm->oldest->idx;
-        }
-        idx1 = -1;
-        if (mm->newest->region == NA) {
-            idx1 = mm->newest->idx;
-        }
+        idx0 = mm->region[oldest] == NA ? (int)mm->pos[oldest] : -1;
+        idx1 = mm->region[newest] == NA ? (int)mm->pos[newest] : -1;
         for (i = 0; i < (int)mm->n_n; ++i) {
-            idx = mm->n_array[i]->idx;
+            ai_t ai = VAL(mm, mm->n_array[i]);
             if (i == idx0 && i == idx1) {
-                printf("\t%i >%f<\n", idx, mm->n_array[i]->ai);
+                printf("\t%i >%f<\n", i, ai);
             } else if (i == idx0) {
-                printf("\t%i >%f\n", idx, mm->n_array[i]->ai);
+                printf("\t%i >%f\n", i, ai);
             } else if (i == idx1) {
-                printf("\t%i  %f<\n", idx, mm->n_array[i]->ai);
+                printf("\t%i  %f<\n", i, ai);
             } else {
-                printf("\t%i  %f\n", idx, mm->n_array[i]->ai);
+                printf("\t%i  %f\n", i, ai);
             }
         }
 
@@ -256,22 +247,20 @@ void mm_dump(mm_handle *mm) {
 
         // not a binary heap
 
-        if (mm->oldest)
-            printf("\n\nFirst: %f\n", (double)mm->oldest->ai);
-        if (mm->newest)
-            printf("Last: %f\n", (double)mm->newest->ai);
+        printf("\n\nFirst: %f\n", VAL(mm, oldest));
+        printf("Last: %f\n", VAL(mm, newest));
 
         printf("\n\nSmall heap:\n");
         for (i = 0; i < (int)mm->n_s; ++i) {
-            printf("%i %f\n", (int)mm->s_heap[i]->idx, mm->s_heap[i]->ai);
+            printf("%i %f\n", i, VAL(mm, mm->s_heap[i]));
         }
         printf("\n\nLarge heap:\n");
         for (i = 0; i < (int)mm->n_l; ++i) {
-            printf("%i %f\n", (int)mm->l_heap[i]->idx, mm->l_heap[i]->ai);
+            printf("%i %f\n", i, VAL(mm, mm->l_heap[i]));
         }
         printf("\n\nNaN heap:\n");
         for (i = 0; i < (int)mm->n_n; ++i) {
-            printf("%i %f\n", (int)mm->n_array[i]->idx, mm->n_array[i]->ai);
+            printf("%i %f\n", i, VAL(mm, mm->n_array[i]));
         }
     }
 }
@@ -280,8 +269,8 @@ void mm_dump(mm_handle *mm) {
 /* Code to print a binary tree from http://stackoverflow.com/a/13755783
  * Code modified for bottleneck's needs. */
 void
-mm_print_binary_heap(mm_node **heap, idx_t n_array, idx_t oldest_idx,
-                     idx_t newest_idx) {
+mm_print_binary_heap(mm_handle *mm, sidx_t *heap, idx_t n_array,
+                     idx_t oldest_idx, idx_t newest_idx) {
     const int line_width = 77;
     int print_pos[n_array];
     int i, j, k, pos, x=1, level=0;
@@ -293,11 +282,11 @@ mm_print_binary_heap(mm_node **heap, idx_t n_array, idx_t oldest_idx,
 
         for (k=0; k<pos-x; k++) printf("%c",i==0||i%2?' ':'-');
         if (i == (int)oldest_idx) {
-            printf(">%.2f", heap[i]->ai);
+            printf(">%.2f", VAL(mm, heap[i]));
         } else if (i == (int)newest_idx) {
-            printf("%.2f<", heap[i]->ai);
+            printf("%.2f<", VAL(mm, heap[i]));
         } else {
-            printf("%.2f", heap[i]->ai);
+            printf("%.2f", VAL(mm, heap[i]));
         }
 
         print_pos[i] = x = pos+1;
@@ -0,0 +1,674 @@
+/*
+   Copyright (c) 2011 J. David Lee. All rights reserved.
+   Released under a Simplified BSD license
+
+   Adapted, expanded, and added NaN handling for Bottleneck:
+   Copyright 2016 Keith Goodman
+   Released under the Bottleneck license
+*/
+
+#include "move_median.h"
+
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+
+/* Move the slot at heap index `from` into the hole at heap index `to` */
+#define MOVE_SLOT(heap, pos, to, from) \
+heap[to] = heap[from];                 \
+pos[heap[to]] = (sidx_t)(to)
+
+/* child k of the children that start at heap index i0 becomes idx if its
+ * value compares `op` to ai */
+#define MM_PICK(k, op) \
+    if (v[heap[i0 + (k)]] op ai) { idx = i0 + (k); ai = v[heap[idx]]; }
+
+
+/*
+-----------------------------------------------------------------------------
+  Handles
+-----------------------------------------------------------------------------
+*/
+
+/* The handle and all of its arrays live in a single block of memory of
+ * mm_size() or mm_size_nan() bytes. The handle comes first; it is a multiple
+ * of the pointer size so the values that follow are aligned for any dtype. */
+
+/* bytes of the values, rounded up so that the sidx_t arrays after them are
+ * aligned when the items are 1 or 2 bytes and the window is odd */
+static size_t
+mm_values_nbytes(const idx_t window, size_t itemsize) {
+    const size_t align = sizeof(sidx_t);
+    return (window * itemsize + align - 1) / align * align;
+}
+
+static size_t
+mm_nbytes(const idx_t window, size_t itemsize, idx_t n_heap) {
+    size_t nbytes = sizeof(mm_handle);
+    nbytes += mm_values_nbytes(window, itemsize);    /* values */
+    nbytes += window * sizeof(sidx_t);    /* pos */
+    nbytes += n_heap * sizeof(sidx_t);    /* s_heap, l_heap, n_array */
+    nbytes += window;                     /* region */
+    return nbytes;
+}
+
+
+static mm_handle *
+mm_init_handle(void *buffer, const idx_t window, idx_t min_count,
+               size_t itemsize, idx_t n_heap) {
+    char *p = buffer;
+    mm_handle *mm;
+    if (p == NULL) {
+        return NULL;
+    }
+    mm = (mm_handle *)p;
+    p += sizeof(mm_handle);
+    mm->values = p;
+    p += mm_values_nbytes(window, itemsize);
+    mm->pos = (sidx_t *)p;
+    p += window * sizeof(sidx_t);
+    mm->s_heap = (sidx_t *)p;
+    mm->l_heap = &mm->s_heap[window / 2 + window % 2];
+    mm->n_array = &mm->s_heap[window];
+    p += n_heap * sizeof(sidx_t);
+    mm->region = (unsigned char *)p;
+
+    mm->window = window;
+    mm->odd = window % 2;
+    mm->min_count = min_count;
+
+    mm_reset(mm);
+
+    return mm;
+}
+
+
+size_t
+mm_size(const idx_t window, size_t itemsize) {
+    return mm_nbytes(window, itemsize, window);
+}
+
+
+size_t
+mm_size_nan(const idx_t window, size_t itemsize) {
+    return mm_nbytes(window, itemsize, 2 * window);
+}
+
+
+/* Build a handle in caller-provided memory of mm_size() bytes. Nothing is
+ * allocated so the handle must not be passed to mm_free. */
+mm_handle *
+mm_init(void *buffer, const idx_t window, idx_t min_count, size_t itemsize) {
+    return mm_init_handle(buffer, window, min_count, itemsize, window);
+}
+
+
+/* Same as mm_init but for the nan functions; the buffer must hold
+ * mm_size_nan() bytes */
+mm_handle *
+mm_init_nan(void *buffer, const idx_t window, idx_t min_count,
+            size_t itemsize) {
+    return mm_init_handle(buffer, window, min_count, itemsize, 2 * window);
+}
+
+
+/* At the start of bn.move_median two heaps are created. One heap contains the
+ * small values (a max heap); the other heap contains the large values (a min
+ * heap). The handle, containing information about the heaps, is returned. */
+mm_handle *
+mm_new(const idx_t window, idx_t min_count, size_t itemsize) {
+    return mm_init(malloc(mm_size(window, itemsize)), window, min_count,
+                   itemsize);
+}
+
+
+/* At the start of bn.move_median two heaps and a nan array are created. One
+ * heap contains the small values (a max heap); the other heap contains the
+ * large values (a min heap); the nan array contains the NaNs. The handle,
+ * containing information about the heaps and the nan array is returned. */
+mm_handle *
+mm_new_nan(const idx_t window, idx_t min_count, size_t itemsize) {
+    return mm_init_nan(malloc(mm_size_nan(window, itemsize)), window,
+                       min_count, itemsize);
+}
+
+
+/* At the end of each slice the double heap and nan array are reset (mm_reset)
+ * to prepare for the next slice. In the 2d input array case (with axis=1),
+ * each slice is a row of the input array. */
+void
+mm_reset(mm_handle *mm) {
+    mm->n_l = 0;
+    mm->n_s = 0;
+    mm->n_n = 0;
+    mm->oldest = 0;
+    mm->s_first_leaf = 0;
+    mm->l_first_leaf = 0;
+}
+
+
+/* After bn.move_median is done, free the memory */
+void
+mm_free(mm_handle *mm) {
+    free(mm);
+}
+
+
+/*
+-----------------------------------------------------------------------------
+  Utility functions
+-----------------------------------------------------------------------------
+*/
+
+/* dtype = [['float64'], ['float32'], ['int64'], ['int32'], ['float16'],
+            ['int16'], ['int8'], ['uint64'], ['uint32'], ['uint16'],
+            ['uint8'], ['bool']] */
+
+/* Return the current median */
+static inline mm_float64
+mm_get_median_DTYPE0(mm_handle *mm) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    idx_t n_total = mm->n_l + mm->n_s;
+    if (n_total < mm->min_count)
+        return MM_NAN();
+    if (min(mm->window, n_total) % 2 == 1)
+        return v[mm->s_heap[0]];
+    return ((mm_float64)v[mm->s_heap[0]] + v[mm->l_heap[0]]) / 2.0;
+}
+
+
+/* Return the index of the largest child of the node at idx that is larger
+ * than ai. If no child is larger than ai then idx is returned. */
+static inline idx_t
+mm_get_largest_child_DTYPE0(const mm_DTYPE0 *v, const sidx_t *heap,
+                            idx_t n, idx_t idx, mm_DTYPE0 ai) {
+    idx_t i0 = FC_IDX(idx);
+    idx_t i1 = i0 + NUM_CHILDREN;
+    i1 = min(i1, n);
+
+    if (i0 >= i1) {
+        return idx;
+    }
+    switch (i1 - i0) {
+        case 8: MM_PICK(7, >) /* fall through */
+        case 7: MM_PICK(6, >) /* fall through */
+        case 6: MM_PICK(5, >) /* fall through */
+        case 5: MM_PICK(4, >) /* fall through */
+        case 4: MM_PICK(3, >) /* fall through */
+        case 3: MM_PICK(2, >) /* fall through */
+        case 2: MM_PICK(1, >) /* fall through */
+        case 1: MM_PICK(0, >)
+    }
+
+    return idx;
+}
+
+
+/* Return the index of the smallest child of the node at idx that is smaller
+ * than ai. If no child is smaller than ai then idx is returned. */
+static inline idx_t
+mm_get_smallest_child_DTYPE0(const mm_DTYPE0 *v, const sidx_t *heap,
+                             idx_t n, idx_t idx, mm_DTYPE0 ai) {
+    idx_t i0 = FC_IDX(idx);
+    idx_t i1 = i0 + NUM_CHILDREN;
+    i1 = min(i1, n);
+
+    if (i0 >= i1) {
+        return idx;
+    }
+    switch (i1 - i0) {
+        case 8: MM_PICK(7, <) /* fall through */
+        case 7: MM_PICK(6, <) /* fall through */
+        case 6: MM_PICK(5, <) /* fall through */
+        case 5: MM_PICK(4, <) /* fall through */
+        case 4: MM_PICK(3, <) /* fall through */
+        case 3: MM_PICK(2, <) /* fall through */
+        case 2: MM_PICK(1, <) /* fall through */
+        case 1: MM_PICK(0, <)
+    }
+
+    return idx;
+}
+
+
+/* Move the node at idx up through the small heap to the appropriate
+ * position. The parent at p_idx must be smaller than the node. */
+static inline void
+mm_move_up_small_DTYPE0(mm_handle *mm, idx_t idx, idx_t p_idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    sidx_t *heap = mm->s_heap;
+    sidx_t *pos = mm->pos;
+    const sidx_t node = heap[idx];
+    const mm_DTYPE0 ai = v[node];
+    do {
+        MOVE_SLOT(heap, pos, idx, p_idx);
+        idx = p_idx;
+        if (idx == 0) {
+            break;
+        }
+        p_idx = P_IDX(idx);
+    } while (ai > v[heap[p_idx]]);
+    heap[idx] = node;
+    pos[node] = (sidx_t)idx;
+}
+
+
+/* Move the node at idx down through the small heap to the appropriate
+ * position. */
+static inline void
+mm_move_down_small_DTYPE0(mm_handle *mm, idx_t n, idx_t idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    sidx_t *heap = mm->s_heap;
+    sidx_t *pos = mm->pos;
+    const sidx_t node = heap[idx];
+    const mm_DTYPE0 ai = v[node];
+    idx_t c_idx = mm_get_largest_child_DTYPE0(v, heap, n, idx, ai);
+    if (c_idx == idx) {
+        return;
+    }
+    do {
+        MOVE_SLOT(heap, pos, idx, c_idx);
+        idx = c_idx;
+        c_idx = mm_get_largest_child_DTYPE0(v, heap, n, idx, ai);
+    } while (c_idx != idx);
+    heap[idx] = node;
+    pos[node] = (sidx_t)idx;
+}
+
+
+/* Move the node at idx down (toward the head) through the large heap to the
+ * appropriate position. The parent at p_idx must be larger than the node. */
+static inline void
+mm_move_down_large_DTYPE0(mm_handle *mm, idx_t idx, idx_t p_idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    sidx_t *heap = mm->l_heap;
+    sidx_t *pos = mm->pos;
+    const sidx_t node = heap[idx];
+    const mm_DTYPE0 ai = v[node];
+    do {
+        MOVE_SLOT(heap, pos, idx, p_idx);
+        idx = p_idx;
+        if (idx == 0) {
+            break;
+        }
+        p_idx = P_IDX(idx);
+    } while (ai < v[heap[p_idx]]);
+    heap[idx] = node;
+    pos[node] = (sidx_t)idx;
+}
+
+
+/* Move the node at idx up (toward the leaves) through the large heap to the
+ * appropriate position. */
+static inline void
+mm_move_up_large_DTYPE0(mm_handle *mm, idx_t n, idx_t idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    sidx_t *heap = mm->l_heap;
+    sidx_t *pos = mm->pos;
+    const sidx_t node = heap[idx];
+    const mm_DTYPE0 ai = v[node];
+    idx_t c_idx = mm_get_smallest_child_DTYPE0(v, heap, n, idx, ai);
+    if (c_idx == idx) {
+        return;
+    }
+    do {
+        MOVE_SLOT(heap, pos, idx, c_idx);
+        idx = c_idx;
+        c_idx = mm_get_smallest_child_DTYPE0(v, heap, n, idx, ai);
+    } while (c_idx != idx);
+    heap[idx] = node;
+    pos[node] = (sidx_t)idx;
+}
+
+
+/* Swap the heap heads. */
+static inline void
+mm_swap_heap_heads_DTYPE0(mm_handle *mm, idx_t n_s, idx_t n_l) {
+    const sidx_t s_node = mm->s_heap[0];
+    const sidx_t l_node = mm->l_heap[0];
+    mm->region[s_node] = LH;
+    mm->region[l_node] = SH;
+    mm->s_heap[0] = l_node;
+    mm->l_heap[0] = s_node;
+    mm_move_down_small_DTYPE0(mm, n_s, 0);
+    mm_move_up_large_DTYPE0(mm, n_l, 0);
+}
+
+
+static inline void
+heapify_small_node_DTYPE0(mm_handle *mm, idx_t idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    const sidx_t *s_heap = mm->s_heap;
+    const sidx_t *l_heap = mm->l_heap;
+    const idx_t n_s = mm->n_s;
+    const idx_t n_l = mm->n_l;
+    const mm_DTYPE0 ai = v[s_heap[idx]];
+    idx_t idx2;
+
+    /* Internal or leaf node */
+    if (idx > 0) {
+        idx2 = P_IDX(idx);
+
+        /* Move up */
+        if (ai > v[s_heap[idx2]]) {
+            mm_move_up_small_DTYPE0(mm, idx, idx2);
+
+            /* Maybe swap between heaps */
+            if (ai > v[l_heap[0]]) {
+                mm_swap_heap_heads_DTYPE0(mm, n_s, n_l);
+            }
+        } else if (idx < mm->s_first_leaf) {
+            /* Move down */
+            mm_move_down_small_DTYPE0(mm, n_s, idx);
+        }
+    } else {
+        /* Head node */
+        if (n_l > 0 && ai > v[l_heap[0]]) {
+            mm_swap_heap_heads_DTYPE0(mm, n_s, n_l);
+        } else {
+            mm_move_down_small_DTYPE0(mm, n_s, idx);
+        }
+    }
+}
+
+
+static inline void
+heapify_large_node_DTYPE0(mm_handle *mm, idx_t idx) {
+    const mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    const sidx_t *s_heap = mm->s_heap;
+    const sidx_t *l_heap = mm->l_heap;
+    const idx_t n_s = mm->n_s;
+    const idx_t n_l = mm->n_l;
+    const mm_DTYPE0 ai = v[l_heap[idx]];
+    idx_t idx2;
+
+    /* Internal or leaf node */
+    if (idx > 0) {
+        idx2 = P_IDX(idx);
+
+        /* Move down */
+        if (ai < v[l_heap[idx2]]) {
+            mm_move_down_large_DTYPE0(mm, idx, idx2);
+
+            /* Maybe swap between heaps */
+            if (ai < v[s_heap[0]]) {
+                mm_swap_heap_heads_DTYPE0(mm, n_s, n_l);
+            }
+        } else if (idx < mm->l_first_leaf) {
+            /* Move up */
+            mm_move_up_large_DTYPE0(mm, n_l, idx);
+        }
+    } else {
+        /* Head node */
+        if (n_s > 0 && ai < v[s_heap[0]]) {
+            mm_swap_heap_heads_DTYPE0(mm, n_s, n_l);
+        } else {
+            mm_move_up_large_DTYPE0(mm, n_l, idx);
+        }
+    }
+}
+
+
+/* Insert the value in ring slot `node` into the small or the large heap,
+ * whichever keeps the two heaps balanced. */
+static inline void
+mm_insert_heap_DTYPE0(mm_handle *mm, sidx_t node) {
+    const idx_t n_s = mm->n_s;
+    const idx_t n_l = mm->n_l;
+    if (n_s > n_l) {
+        /* add new node to large heap */
+        mm->l_heap[n_l] = node;
+        mm->region[node] = LH;
+        mm->pos[node] = (sidx_t)n_l;
+        ++mm->n_l;
+        mm->l_first_leaf = FIRST_LEAF(mm->n_l);
+        heapify_large_node_DTYPE0(mm, n_l);
+    } else {
+        /* add new node to small heap */
+        mm->s_heap[n_s] = node;
+        mm->region[node] = SH;
+        mm->pos[node] = (sidx_t)n_s;
+        ++mm->n_s;
+        mm->s_first_leaf = FIRST_LEAF(mm->n_s);
+        heapify_small_node_DTYPE0(mm, n_s);
+    }
+}
+
+
+/*
+-----------------------------------------------------------------------------
+  Top-level non-nan functions
+-----------------------------------------------------------------------------
+*/
+
+/* Insert a new value, ai, into one of the heaps. Use this function when
+ * the heaps contain less than window-1 nodes. Returns the median value.
+ * Once there are window-1 nodes in the heap, switch to using mm_update. */
+mm_float64
+mm_update_init_DTYPE0(mm_handle *mm, mm_DTYPE0 ai) {
+    const sidx_t node = (sidx_t)(mm->n_s + mm->n_l);
+    ((mm_DTYPE0 *)mm->values)[node] = ai;
+
+    if (mm->n_s == 0) {
+        /* the first node to appear in a heap */
+        mm->s_heap[0] = node;
+        mm->region[node] = SH;
+        mm->pos[node] = 0;
+        mm->n_s = 1;
+        mm->s_first_leaf = 0;
+    } else {
+        /* at least one node already exists in the heaps */
+        mm_insert_heap_DTYPE0(mm, node);
+    }
+
+    return mm_get_median_DTYPE0(mm);
+}
+
+
+/* Insert a new value, ai, into the double heap structure. Use this function
+ * when the double heap contains at least window-1 nodes. Returns the median
+ * value. If there are less than window-1 nodes in the heap, use
+ * mm_update_init. */
+mm_float64
+mm_update_DTYPE0(mm_handle *mm, mm_DTYPE0 ai) {
+    /* the newest value overwrites the oldest slot of the ring */
+    mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    const sidx_t node = (sidx_t)mm->oldest;
+    v[node] = ai;
+    mm->oldest = node + 1 == mm->window ? 0 : node + 1;
+
+    /* adjust position of new node in heap if needed */
+    if (mm->region[node] == SH) {
+        heapify_small_node_DTYPE0(mm, mm->pos[node]);
+    } else {
+        heapify_large_node_DTYPE0(mm, mm->pos[node]);
+    }
+
+    /* return the median */
+    if (mm->odd) {
+        return v[mm->s_heap[0]];
+    } else {
+        return ((mm_float64)v[mm->s_heap[0]] + v[mm->l_heap[0]]) / 2.0;
+    }
+}
+/* dtype end */
+
+
+/*
+-----------------------------------------------------------------------------
+  Top-level nan functions
+-----------------------------------------------------------------------------
+*/
+
+/* dtype = [['float64'], ['float32'], ['float16']] */
+
+/* Insert a new value, ai, into one of the heaps or the nan array. Use this
+ * function when there are less than window-1 nodes. Returns the median
+ * value. Once there are window-1 nodes in the heap, switch to using
+ * mm_update_nan. */
+mm_float64
+mm_update_init_nan_DTYPE0(mm_handle *mm, mm_DTYPE0 ai) {
+    const sidx_t node = (sidx_t)(mm->n_s + mm->n_l + mm->n_n);
+    ((mm_DTYPE0 *)mm->values)[node] = ai;
+
+    if (ai != ai) {
+        mm->n_array[mm->n_n] = node;
+        mm->region[node] = NA;
+        mm->pos[node] = (sidx_t)mm->n_n;
+        ++mm->n_n;
+    } else if (mm->n_s == 0) {
+        /* the first node to appear in a heap */
+        mm->s_heap[0] = node;
+        mm->region[node] = SH;
+        mm->pos[node] = 0;
+        mm->n_s = 1;
+        mm->s_first_leaf = 0;
+    } else {
+        /* at least one node already exists in the heaps */
+        mm_insert_heap_DTYPE0(mm, node);
+    }
+
+    return mm_get_median_DTYPE0(mm);
+}
+
+
+/* Insert a new value, ai, into one of the heaps or the nan array. Use this
+ * function when there are at least window-1 nodes. Returns the median value.
+ * If there are less than window-1 nodes, use mm_update_init_nan. */
+mm_float64
+mm_update_nan_DTYPE0(mm_handle *mm, mm_DTYPE0 ai) {
+    sidx_t node2;
+
+    mm_DTYPE0 *v = (mm_DTYPE0 *)mm->values;
+    sidx_t *l_heap = mm->l_heap;
+    sidx_t *s_heap = mm->s_heap;
+    sidx_t *n_array = mm->n_array;
+    sidx_t *pos = mm->pos;
+    unsigned char *region = mm->region;
+
+    /* the newest value overwrites the oldest slot of the ring */
+    const sidx_t node = (sidx_t)mm->oldest;
+    const idx_t idx = pos[node];
+    const idx_t n_s = mm->n_s;
+    const idx_t n_l = mm->n_l;
+    const idx_t n_n = mm->n_n;
+    v[node] = ai;
+    mm->oldest = node + 1 == mm->window ? 0 : node + 1;
+
+    if (ai != ai) {
+        if (region[node] == SH) {
+            /* Oldest node is in the small heap and needs to be moved
+             * to the nan array. Resulting hole in the small heap will be
+             * filled with the rightmost leaf of the last row of the small
+             * heap. */
+
+            /* insert node into nan array */
+            region[node] = NA;
+            pos[node] = (sidx_t)n_n;
+            n_array[n_n] = node;
+            ++mm->n_n;
+
+            /* plug small heap hole */
+            --mm->n_s;
+            if (mm->n_s == 0) {
+                mm->s_first_leaf = 0;
+                if (n_l > 0) {
+                    /* move head node from the large heap to the small heap */
+                    node2 = l_heap[0];
+                    region[node2] = SH;
+                    s_heap[0] = node2;
+                    mm->n_s = 1;
+                    mm->s_first_leaf = 0;
+
+                    /* plug hole in large heap */
+                    MOVE_SLOT(l_heap, pos, 0, mm->n_l - 1);
+                    --mm->n_l;
+                    mm->l_first_leaf = FIRST_LEAF(mm->n_l);
+                    heapify_large_node_DTYPE0(mm, 0);
+                }
+            } else {
+                if (idx != n_s - 1) {
+                    MOVE_SLOT(s_heap, pos, idx, n_s - 1);
+                    heapify_small_node_DTYPE0(mm, idx);
+                }
+                if (mm->n_s < mm->n_l) {
+                    /* move head node from the large heap to the small heap */
+                    node2 = l_heap[0];
+                    pos[node2] = (sidx_t)mm->n_s;
+                    region[node2] = SH;
+                    s_heap[mm->n_s] = node2;
+                    ++mm->n_s;
+                    mm->s_first_leaf = FIRST_LEAF(mm->n_s);
+                    heapify_small_node_DTYPE0(mm, pos[node2]);
+
+                    /* plug hole in large heap */
+                    MOVE_SLOT(l_heap, pos, 0, mm->n_l - 1);
+                    --mm->n_l;
+                    mm->l_first_leaf = FIRST_LEAF(mm->n_l);
+                    heapify_large_node_DTYPE0(mm, 0);
+
+                } else {
+                    mm->s_first_leaf = FIRST_LEAF(mm->n_s);
+                    if (idx < mm->n_s) {
+                        heapify_small_node_DTYPE0(mm, idx);
+                    }
+                }
+            }
+        } else if (region[node] == LH) {
+            /* Oldest node is in the large heap and needs to be moved
+             * to the nan array. Resulting hole in the large heap will be
+             * filled with the rightmost leaf of the last row of the large
+             * heap. */
+
+            /* insert node into nan array */
+            region[node] = NA;
+            pos[node] = (sidx_t)n_n;
+            n_array[n_n] = node;
+            ++mm->n_n;
+
+            /* plug large heap hole */
+            if (idx != n_l - 1) {
+                MOVE_SLOT(l_heap, pos, idx, n_l - 1);
+                heapify_large_node_DTYPE0(mm, idx);
+            }
+            --mm->n_l;
+            mm->l_first_leaf = FIRST_LEAF(mm->n_l);
+            if (mm->n_l + 1 < mm->n_s) {
+                /* move head node from the small heap to the large heap */
+                node2 = s_heap[0];
+                pos[node2] = (sidx_t)mm->n_l;
+                region[node2] = LH;
+                l_heap[mm->n_l] = node2;
+                ++mm->n_l;
+                mm->l_first_leaf = FIRST_LEAF(mm->n_l);
+                heapify_large_node_DTYPE0(mm, pos[node2]);
+
+                /* plug hole in small heap */
+                MOVE_SLOT(s_heap, pos, 0, mm->n_s - 1);
+                --mm->n_s;
+                mm->s_first_leaf = FIRST_LEAF(mm->n_s);
+                heapify_small_node_DTYPE0(mm, 0);
+            }
+            /* reorder large heap if needed */
+            if (idx < mm->n_l) {
+                heapify_large_node_DTYPE0(mm, idx);
+            }
+        }
+        /* else the oldest node was already in the nan array */
+    } else {
+        if (region[node] == SH) {
+            heapify_small_node_DTYPE0(mm, idx);
+        } else if (region[node] == LH) {
+            heapify_large_node_DTYPE0(mm, idx);
+        } else {
+            /* ai is not NaN but oldest node is in nan array */
+            mm_insert_heap_DTYPE0(mm, node);
+
+            /* plug nan array hole */
+            if (idx != n_n - 1) {
+                MOVE_SLOT(n_array, pos, idx, n_n - 1);
+            }
+            --mm->n_n;
+        }
+    }
+    return mm_get_median_DTYPE0(mm);
+}
+/* dtype end */
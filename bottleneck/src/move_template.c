@@ -21,7 +21,8 @@
 #define INIT(dtype) \
     PyObject *y = PyArray_EMPTY(PyArray_NDIM(a), PyArray_SHAPE(a), dtype, 0); \
     iter2 it; \
-    init_iter2(&it, a, y, axis);
+    init_iter2(&it, a, y, axis); \
+    if (seg != NULL) init_iter2_seg(&it, seg, nseg);
 
 /* low-level functions such as move_sum_float64 */
 #define MOVE(name, dtype) \
@@ -30,21 +31,17 @@
                    int           window, \
                    int           min_count, \
                    int           axis, \
-                   int           ddof)
+                   int           ddof, \
+                   const npy_intp *seg, \
+                   npy_intp      nseg)
 
 /* top-level functions such as move_sum */
 #define MOVE_MAIN(name, ddof) \
     static PyObject * \
     name(PyObject *self, PyObject *args, PyObject *kwds) \
     { \
-        return mover(#name, \
-                     args, \
-                     kwds, \
-                     name##_float64, \
-                     name##_float32, \
-                     name##_int64, \
-                     name##_int32, \
-                     ddof); \
+        static const move_t move[BN_NDTYPES] = BN_DTYPE_TABLE(name##_); \
+        return mover(self, #name, args, kwds, move, ddof); \
     }
 
 /* typedefs and prototypes ----------------------------------------------- */
@@ -57,24 +54,24 @@ struct _pairs {
 typedef struct _pairs pairs;
 
 /* function pointer for functions passed to mover */
-typedef PyObject *(*move_t)(PyArrayObject *, int, int, int, int);
+typedef PyObject *(*move_t)(PyArrayObject *, int, int, int, int,
+                            const npy_intp *, npy_intp);
 
 static PyObject *
-mover(char *name,
+mover(PyObject *self,
+      char *name,
       PyObject *args,
       PyObject *kwds,
-      move_t,
-      move_t,
-      move_t,
-      move_t,
+      const move_t *move,
       int has_ddof);
 
 /* move_sum -------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 MOVE(move_sum, DTYPE0) {
     Py_ssize_t count;
-    npy_DTYPE0 asum, ai, aold;
+    bn_DTYPE1 asum, ai, aold;
     INIT(NPY_DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -113,7 +110,7 @@ MOVE(move_sum, DTYPE0) {
             }
             YI(DTYPE0) = count >= min_count ? asum : BN_NAN;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -121,9 +118,12 @@ MOVE(move_sum, DTYPE0) {
 /* dtype end */
 
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(move_sum, DTYPE0) {
-    npy_DTYPE1 asum;
+    bn_DTYPE1 asum;
     INIT(NPY_DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -137,10 +137,10 @@ MOVE(move_sum, DTYPE0) {
             YI(DTYPE1) = asum;
         }
         WHILE2 {
-            asum += AI(DTYPE0) - AOLD(DTYPE0);
+            asum += (bn_DTYPE1)AI(DTYPE0) - AOLD(DTYPE0);
             YI(DTYPE1) = asum;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -153,10 +153,11 @@ MOVE_MAIN(move_sum, 0)
 
 /* move_mean -------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 MOVE(move_mean, DTYPE0) {
     Py_ssize_t count;
-    npy_DTYPE0 asum, ai, aold, count_inv;
+    bn_DTYPE1 asum, ai, aold, count_inv;
     INIT(NPY_DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -198,7 +199,7 @@ MOVE(move_mean, DTYPE0) {
             }
             YI(DTYPE0) = count >= min_count ? asum * count_inv : BN_NAN;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -206,9 +207,12 @@ MOVE(move_mean, DTYPE0) {
 /* dtype end */
 
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(move_mean, DTYPE0) {
-    npy_DTYPE1 asum, window_inv = 1.0 / window;
+    bn_DTYPE1 asum, window_inv = 1.0 / window;
     INIT(NPY_DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -219,14 +223,14 @@ MOVE(move_mean, DTYPE0) {
         }
         WHILE1 {
             asum += AI(DTYPE0);
-            *(npy_DTYPE1*)(it.py + it.i * it.ystride) = (npy_DTYPE1)asum / (it.i + 1);
+            *(bn_DTYPE1*)(it.py + it.i * it.ystride) = (bn_DTYPE1)asum / (it.i + 1);
             it.i++;
         }
         WHILE2 {
-            asum += AI(DTYPE0) - AOLD(DTYPE0);
-            YI(DTYPE1) = (npy_DTYPE1)asum * window_inv;
+            asum += (bn_DTYPE1)AI(DTYPE0) - AOLD(DTYPE0);
+            YI(DTYPE1) = (bn_DTYPE1)asum * window_inv;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -241,10 +245,11 @@ MOVE_MAIN(move_mean, 0)
 
 /* repeat = {'NAME': ['move_std', 'move_var'],
              'FUNC': ['sqrt',     '']} */
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 MOVE(NAME, DTYPE0) {
     Py_ssize_t count;
-    npy_DTYPE0 delta, amean, assqdm, ai, aold, yi, count_inv, ddof_inv;
+    bn_DTYPE1 delta, amean, assqdm, ai, aold, yi, count_inv, ddof_inv;
     INIT(NPY_DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -322,18 +327,21 @@ MOVE(NAME, DTYPE0) {
             }
             YI(DTYPE0) = yi;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
 }
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(NAME, DTYPE0) {
     int winddof = window - ddof;
-    npy_DTYPE1 delta, amean, assqdm, yi, ai, aold;
-    npy_DTYPE1 window_inv = 1.0 / window, winddof_inv = 1.0 / winddof;
+    bn_DTYPE1 delta, amean, assqdm, yi, ai, aold;
+    bn_DTYPE1 window_inv = 1.0 / window, winddof_inv = 1.0 / winddof;
     INIT(NPY_DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -366,7 +374,7 @@ MOVE(NAME, DTYPE0) {
             }
             YI(DTYPE1) = FUNC(assqdm * winddof_inv);
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -443,15 +451,21 @@ MOVE_MAIN(NAME, 1)
    'VALUE': ['extreme_pair->value',           'extreme_pair->value',
              'INDEX-extreme_pair->death+window', 'INDEX-extreme_pair->death+window']
    } */
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64'], ['float32'], ['float16']] */
 MOVE(NAME, DTYPE0) {
-    npy_DTYPE0 ai, aold, yi_tmp;
+    bn_DTYPE0 ai, aold, yi_tmp;
     Py_ssize_t count;
     pairs *extreme_pair;
     pairs *end;
     pairs *last;
-    pairs *ring = (pairs *)malloc(window * sizeof(pairs));
+    pairs *ring;
     INIT(NPY_DTYPE0)
+    ring = (pairs *)bn_scratch_get(window * sizeof(pairs));
+    if (ring == NULL) {
+        Py_DECREF(y);
+        MEMORY_ERR("Could not allocate memory for NAME");
+        return NULL;
+    }
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         count = 0;
@@ -481,23 +495,32 @@ MOVE(NAME, DTYPE0) {
                             if (extreme_pair >= end) extreme_pair = ring;
                         })
         }
-        NEXT2
+        NEXT2_SEG
     }
-    free(ring);
     BN_END_ALLOW_THREADS
+    bn_scratch_put(ring);
     return y;
 }
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(NAME, DTYPE0) {
-    npy_DTYPE0 ai;
-    npy_DTYPE1 yi_tmp;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 yi_tmp;
     pairs *extreme_pair;
     pairs *end;
     pairs *last;
-    pairs *ring = (pairs *)malloc(window * sizeof(pairs));
+    pairs *ring;
     INIT(NPY_DTYPE1)
+    ring = (pairs *)bn_scratch_get(window * sizeof(pairs));
+    if (ring == NULL) {
+        Py_DECREF(y);
+        MEMORY_ERR("Could not allocate memory for NAME");
+        return NULL;
+    }
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         end = ring + window;
@@ -527,10 +550,10 @@ MOVE(NAME, DTYPE0) {
                           if (extreme_pair >= end) extreme_pair = ring;
                       })
         }
-        NEXT2
+        NEXT2_SEG
     }
-    free(ring);
     BN_END_ALLOW_THREADS
+    bn_scratch_put(ring);
     return y;
 }
 /* dtype end */
@@ -540,73 +563,166 @@ MOVE_MAIN(NAME, 0)
 
 /* move_median ----------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* Small odd windows with min_count equal to window do not use the mm_handle
+   heaps. Each window is copied and reduced with a median network instead. */
+
+/* repeat = {'NWIN': ['3', '5', '7', '9']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+MOVE(move_median_NWIN, DTYPE0) {
+    int j, isnan;
+    bn_DTYPE0 ai, p[NWIN];
+    INIT(NPY_DTYPE0)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        WHILE0 {
+            YI(DTYPE0) = BN_NAN;
+        }
+        WHILE2 {
+            isnan = 0;
+            for (j = 0; j < NWIN; j++) {
+                ai = AX(DTYPE0, it.i + j - (NWIN - 1));
+                isnan |= ai != ai;
+                p[j] = ai;
+            }
+            if (isnan) {
+                YI(DTYPE0) = BN_NAN;
+            } else {
+                MEDIAN_NETNWIN(DTYPE0, p)
+                YI(DTYPE0) = p[NWIN / 2];
+            }
+        }
+        NEXT2_SEG
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+MOVE(move_median_NWIN, DTYPE0) {
+    int j;
+    bn_DTYPE0 p[NWIN];
+    INIT(NPY_DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        WHILE0 {
+            YI(DTYPE1) = BN_NAN;
+        }
+        WHILE2 {
+            for (j = 0; j < NWIN; j++) {
+                p[j] = AX(DTYPE0, it.i + j - (NWIN - 1));
+            }
+            MEDIAN_NETNWIN(DTYPE0, p)
+            YI(DTYPE1) = p[NWIN / 2];
+        }
+        NEXT2_SEG
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+/* repeat end */
+
+#define MOVE_MEDIAN_NET(dtype) \
+    if (min_count == window) { \
+        switch (window) { \
+            case 3: return move_median_3_##dtype(a, 3, 3, axis, ddof, \
+                                                 seg, nseg); \
+            case 5: return move_median_5_##dtype(a, 5, 5, axis, ddof, \
+                                                 seg, nseg); \
+            case 7: return move_median_7_##dtype(a, 7, 7, axis, ddof, \
+                                                 seg, nseg); \
+            case 9: return move_median_9_##dtype(a, 9, 9, axis, ddof, \
+                                                 seg, nseg); \
+        } \
+    }
+
+/* dtype = [['float64'], ['float32'], ['float16']] */
 MOVE(move_median, DTYPE0) {
-    npy_DTYPE0 ai;
-    mm_handle *mm = mm_new_nan(window, min_count);
+    bn_DTYPE0 ai;
+    void *buffer;
+    mm_handle *mm;
+    MOVE_MEDIAN_NET(DTYPE0)
     INIT(NPY_DTYPE0)
     if (window == 1) {
-        mm_free(mm);
+        Py_DECREF(y);
         return PyArray_Copy(a);
     }
-    if (mm == NULL) {
+    buffer = bn_scratch_get(mm_size_nan(window, sizeof(bn_DTYPE0)));
+    if (buffer == NULL) {
+        Py_DECREF(y);
         MEMORY_ERR("Could not allocate memory for move_median");
+        return NULL;
     }
+    mm = mm_init_nan(buffer, window, min_count, sizeof(bn_DTYPE0));
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         WHILE0 {
             ai = AI(DTYPE0);
-            YI(DTYPE0) = mm_update_init_nan(mm, ai);
+            YI(DTYPE0) = mm_update_init_nan_DTYPE0(mm, ai);
         }
         WHILE1 {
             ai = AI(DTYPE0);
-            YI(DTYPE0) = mm_update_init_nan(mm, ai);
+            YI(DTYPE0) = mm_update_init_nan_DTYPE0(mm, ai);
         }
         WHILE2 {
             ai = AI(DTYPE0);
-            YI(DTYPE0) = mm_update_nan(mm, ai);
+            YI(DTYPE0) = mm_update_nan_DTYPE0(mm, ai);
         }
         mm_reset(mm);
-        NEXT2
+        NEXT2_SEG
     }
-    mm_free(mm);
     BN_END_ALLOW_THREADS
+    bn_scratch_put(buffer);
     return y;
 }
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(move_median, DTYPE0) {
-    npy_DTYPE0 ai;
-    mm_handle *mm = mm_new(window, min_count);
+    bn_DTYPE0 ai;
+    void *buffer;
+    mm_handle *mm;
+    MOVE_MEDIAN_NET(DTYPE0)
     INIT(NPY_DTYPE1)
     if (window == 1) {
+        Py_DECREF(y);
         return PyArray_CastToType(a,
                                   PyArray_DescrFromType(NPY_DTYPE1),
                                   PyArray_CHKFLAGS(a, NPY_ARRAY_F_CONTIGUOUS));
     }
-    if (mm == NULL) {
+    buffer = bn_scratch_get(mm_size(window, sizeof(bn_DTYPE0)));
+    if (buffer == NULL) {
+        Py_DECREF(y);
         MEMORY_ERR("Could not allocate memory for move_median");
+        return NULL;
     }
+    mm = mm_init(buffer, window, min_count, sizeof(bn_DTYPE0));
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         WHILE0 {
             ai = AI(DTYPE0);
-            YI(DTYPE1) = mm_update_init(mm, ai);
+            YI(DTYPE1) = mm_update_init_DTYPE0(mm, ai);
         }
         WHILE1 {
             ai = AI(DTYPE0);
-            YI(DTYPE1) = mm_update_init(mm, ai);
+            YI(DTYPE1) = mm_update_init_DTYPE0(mm, ai);
         }
         WHILE2 {
             ai = AI(DTYPE0);
-            YI(DTYPE1) = mm_update(mm, ai);
+            YI(DTYPE1) = mm_update_DTYPE0(mm, ai);
         }
         mm_reset(mm);
-        NEXT2
+        NEXT2_SEG
     }
-    mm_free(mm);
     BN_END_ALLOW_THREADS
+    bn_scratch_put(buffer);
     return y;
 }
 /* dtype end */
@@ -619,8 +735,8 @@ MOVE_MAIN(move_median, 0)
 
 #define MOVE_RANK(dtype0, dtype1, limit) \
     Py_ssize_t j; \
-    npy_##dtype0 ai, aj; \
-    npy_##dtype1 g, e, n, r; \
+    bn_##dtype0 ai, aj; \
+    bn_##dtype1 g, e, n, r; \
     ai = AI(dtype0); \
     if (ai == ai) { \
         g = 0; \
@@ -651,34 +767,39 @@ MOVE_MAIN(move_median, 0)
         r = BN_NAN; \
     } \
 
-/* dtype = [['float64', 'float64'], ['float32', 'float32']] */
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
 MOVE(move_rank, DTYPE0) {
-    INIT(NPY_DTYPE1)
+    INIT(NPY_DTYPE2)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         WHILE0 {
-            YI(DTYPE1) = BN_NAN;
+            YI(DTYPE2) = BN_NAN;
         }
         WHILE1 {
             MOVE_RANK(DTYPE0, DTYPE1, 0)
-            YI(DTYPE1) = r;
+            YI(DTYPE2) = r;
         }
         WHILE2 {
             MOVE_RANK(DTYPE0, DTYPE1, INDEX - window + 1)
-            YI(DTYPE1) = r;
+            YI(DTYPE2) = r;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
 }
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 MOVE(move_rank, DTYPE0) {
     Py_ssize_t j;
-    npy_DTYPE0 ai, aj;
-    npy_DTYPE1 g, e, r, window_inv = 0.5 * 1.0 / (window - 1);
+    bn_DTYPE0 ai, aj;
+    bn_DTYPE1 g, e, r, window_inv = 0.5 * 1.0 / (window - 1);
     INIT(NPY_DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -730,7 +851,7 @@ MOVE(move_rank, DTYPE0) {
             }
             YI(DTYPE1) = r;
         }
-        NEXT2
+        NEXT2_SEG
     }
     BN_END_ALLOW_THREADS
     return y;
@@ -741,41 +862,56 @@ MOVE(move_rank, DTYPE0) {
 MOVE_MAIN(move_rank, 0)
 
 
-/* python strings -------------------------------------------------------- */
+/* module state ---------------------------------------------------------- */
+
+typedef struct {
+    PyObject *slow;
+    PyObject *pystr_a;
+    PyObject *pystr_window;
+    PyObject *pystr_min_count;
+    PyObject *pystr_axis;
+    PyObject *pystr_ddof;
+    PyObject *pystr_groups;
+} module_state;
 
-PyObject *pystr_a = NULL;
-PyObject *pystr_window = NULL;
-PyObject *pystr_min_count = NULL;
-PyObject *pystr_axis = NULL;
-PyObject *pystr_ddof = NULL;
+MODULE_STATE_FUNCS
 
 static int
-intern_strings(void) {
-    pystr_a = PyString_InternFromString("a");
-    pystr_window = PyString_InternFromString("window");
-    pystr_min_count = PyString_InternFromString("min_count");
-    pystr_axis = PyString_InternFromString("axis");
-    pystr_ddof = PyString_InternFromString("ddof");
-    return pystr_a && pystr_window && pystr_min_count &&
-           pystr_axis && pystr_ddof;
+intern_strings(module_state *st) {
+    st->pystr_a = PyString_InternFromString("a");
+    st->pystr_window = PyString_InternFromString("window");
+    st->pystr_min_count = PyString_InternFromString("min_count");
+    st->pystr_axis = PyString_InternFromString("axis");
+    st->pystr_ddof = PyString_InternFromString("ddof");
+    st->pystr_groups = PyString_InternFromString("groups");
+    return st->pystr_a && st->pystr_window && st->pystr_min_count &&
+           st->pystr_axis && st->pystr_ddof && st->pystr_groups;
 }
 
 /* mover ----------------------------------------------------------------- */
 
 static inline int
-parse_args(PyObject *args,
+parse_args(module_state *st,
+           PyObject *args,
            PyObject *kwds,
            int has_ddof,
            PyObject **a,
            PyObject **window,
            PyObject **min_count,
            PyObject **axis,
-           PyObject **ddof) {
+           PyObject **ddof,
+           PyObject **groups) {
     const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
     const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
     if (nkwds) {
         int nkwds_found = 0;
         PyObject *tmp;
+        /* groups can only be given by keyword */
+        tmp = PyDict_GetItem(kwds, st->pystr_groups);
+        if (tmp != NULL) {
+            *groups = tmp;
+            nkwds_found++;
+        }
         switch (nargs) {
             case 4:
                 if (has_ddof) {
@@ -784,8 +920,11 @@ parse_args(PyObject *args,
                     TYPE_ERR("wrong number of arguments");
                     return 0;
                 }
+            /* fall through */
             case 3: *min_count = PyTuple_GET_ITEM(args, 2);
+            /* fall through */
             case 2: *window = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1: *a = PyTuple_GET_ITEM(args, 0);
             case 0: break;
             default:
@@ -794,34 +933,38 @@ parse_args(PyObject *args,
         }
         switch (nargs) {
             case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
+                *a = PyDict_GetItem(kwds, st->pystr_a);
                 if (*a == NULL) {
                     TYPE_ERR("Cannot find `a` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 1:
-                *window = PyDict_GetItem(kwds, pystr_window);
+                *window = PyDict_GetItem(kwds, st->pystr_window);
                 if (*window == NULL) {
                     TYPE_ERR("Cannot find `window` keyword input");
                     return 0;
                 }
                 nkwds_found++;
+            /* fall through */
             case 2:
-                tmp = PyDict_GetItem(kwds, pystr_min_count);
+                tmp = PyDict_GetItem(kwds, st->pystr_min_count);
                 if (tmp != NULL) {
                     *min_count = tmp;
                     nkwds_found++;
                 }
+            /* fall through */
             case 3:
-                tmp = PyDict_GetItem(kwds, pystr_axis);
+                tmp = PyDict_GetItem(kwds, st->pystr_axis);
                 if (tmp != NULL) {
                     *axis = tmp;
                     nkwds_found++;
                 }
+            /* fall through */
             case 4:
                 if (has_ddof) {
-                    tmp = PyDict_GetItem(kwds, pystr_ddof);
+                    tmp = PyDict_GetItem(kwds, st->pystr_ddof);
                     if (tmp != NULL) {
                         *ddof = tmp;
                         nkwds_found++;
@@ -837,7 +980,7 @@ parse_args(PyObject *args,
             TYPE_ERR("wrong number of keyword arguments");
             return 0;
         }
-        if (nargs + nkwds_found > 4 + has_ddof) {
+        if (nargs + nkwds_found > 4 + has_ddof + (*groups != NULL)) {
             TYPE_ERR("too many arguments");
             return 0;
         }
@@ -850,10 +993,13 @@ parse_args(PyObject *args,
                     TYPE_ERR("wrong number of arguments");
                     return 0;
                 }
+            /* fall through */
             case 4:
                 *axis = PyTuple_GET_ITEM(args, 3);
+            /* fall through */
             case 3:
                 *min_count = PyTuple_GET_ITEM(args, 2);
+            /* fall through */
             case 2:
                 *window = PyTuple_GET_ITEM(args, 1);
                 *a = PyTuple_GET_ITEM(args, 0);
@@ -868,17 +1014,70 @@ parse_args(PyObject *args,
 
 }
 
+/* the arguments of a move_t, for bn_blocks */
+typedef struct {
+    move_t move;
+    int window;
+    int min_count;
+    int axis;
+    int ddof;
+    const npy_intp *seg;
+    npy_intp nseg;
+} move_args;
 
 static PyObject *
-mover(char *name,
+move_block(PyArrayObject *a, void *args) {
+    move_args *ma = (move_args *)args;
+    return ma->move(a, ma->window, ma->min_count, ma->axis, ma->ddof,
+                    ma->seg, ma->nseg);
+}
+
+/*
+ * The boundaries of the runs of equal labels in `groups`, which must be 1d
+ * integers with the length of the moving window axis. Returns the number of
+ * runs and sets *seg to a malloc'd array of that many plus one boundaries,
+ * or returns -1 with an exception set.
+ */
+static npy_intp
+group_segments(PyObject *groups_obj, npy_intp length, npy_intp **seg) {
+    npy_intp i, nseg = 0;
+    const npy_intp *g;
+    PyArrayObject *groups;
+    groups = (PyArrayObject *)PyArray_FROM_OTF(groups_obj, NPY_INTP,
+                                               NPY_ARRAY_IN_ARRAY);
+    if (groups == NULL) {
+        return -1;
+    }
+    if (PyArray_NDIM(groups) != 1 || PyArray_DIM(groups, 0) != length) {
+        Py_DECREF(groups);
+        VALUE_ERR("`groups` must be 1d with the length of `a` along `axis`");
+        return -1;
+    }
+    *seg = malloc((length + 1) * sizeof(npy_intp));
+    if (*seg == NULL) {
+        Py_DECREF(groups);
+        MEMORY_ERR("Could not allocate memory for `groups`");
+        return -1;
+    }
+    g = (const npy_intp *)PyArray_DATA(groups);
+    (*seg)[0] = 0;
+    for (i = 1; i < length; i++) {
+        if (g[i] != g[i - 1]) (*seg)[++nseg] = i;
+    }
+    (*seg)[++nseg] = length;
+    Py_DECREF(groups);
+    return nseg;
+}
+
+static PyObject *
+mover(PyObject *self,
+      char *name,
       PyObject *args,
       PyObject *kwds,
-      move_t move_float64,
-      move_t move_float32,
-      move_t move_int64,
-      move_t move_int32,
+      const move_t *move,
       int has_ddof) {
 
+    module_state *st = STATE(self);
     int mc;
     int window;
     int axis;
@@ -887,6 +1086,8 @@ mover(char *name,
     int ndim;
 
     Py_ssize_t length;
+    npy_intp nseg = 1;
+    npy_intp *seg = NULL;
 
     PyArrayObject *a;
     PyObject *y;
@@ -896,9 +1097,10 @@ mover(char *name,
     PyObject *min_count_obj = Py_None;
     PyObject *axis_obj = NULL;
     PyObject *ddof_obj = NULL;
+    PyObject *groups_obj = NULL;
 
-    if (!parse_args(args, kwds, has_ddof, &a_obj, &window_obj,
-                    &min_count_obj, &axis_obj, &ddof_obj)) {
+    if (!parse_args(st, args, kwds, has_ddof, &a_obj, &window_obj,
+                    &min_count_obj, &axis_obj, &ddof_obj, &groups_obj)) {
         return NULL;
     }
 
@@ -913,12 +1115,6 @@ mover(char *name,
         }
     }
 
-    /* check for byte swapped input array */
-    if (PyArray_ISBYTESWAPPED(a)) {
-        Py_DECREF(a);
-        return slow(name, args, kwds);
-    }
-
     /* window */
     window = PyArray_PyIntAsInt(window_obj);
     if (error_converting(window)) {
@@ -995,20 +1191,30 @@ mover(char *name,
         goto error;
     }
 
-    dtype = PyArray_TYPE(a);
+    dtype = bn_dtype_index(a);
+
+    if (dtype < 0 || move[dtype] == NULL) {
+        y = slow(st->slow, name, args, kwds);
+        Py_DECREF(a);
+        return y;
+    }
 
-    if (dtype == NPY_float64) {
-        y = move_float64(a, window, mc, axis, ddof);
-    } else if (dtype == NPY_float32) {
-        y = move_float32(a, window, mc, axis, ddof);
-    } else if (dtype == NPY_int64) {
-        y = move_int64(a, window, mc, axis, ddof);
-    } else if (dtype == NPY_int32) {
-        y = move_int32(a, window, mc, axis, ddof);
+    /* groups */
+    if (groups_obj != NULL && groups_obj != Py_None) {
+        nseg = group_segments(groups_obj, length, &seg);
+        if (nseg < 0) {
+            goto error;
+        }
+    }
+
+    if (bn_convert(a)) {
+        move_args ma = {move[dtype], window, mc, axis, ddof, seg, nseg};
+        y = bn_blocks(a, axis, BN_BLOCK_KEEP, move_block, &ma);
     } else {
-        y = slow(name, args, kwds);
+        y = move[dtype](a, window, mc, axis, ddof, seg, nseg);
     }
 
+    free(seg);
     Py_DECREF(a);
 
     return y;
@@ -1026,7 +1232,7 @@ static char move_doc[] =
 
 static char move_sum_doc[] =
 /* MULTILINE STRING BEGIN
-move_sum(a, window, min_count=None, axis=-1)
+move_sum(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window sum along the specified axis, optionally ignoring NaNs.
 
@@ -1048,6 +1254,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1067,7 +1279,7 @@ MULTILINE STRING END */
 
 static char move_mean_doc[] =
 /* MULTILINE STRING BEGIN
-move_mean(a, window, min_count=None, axis=-1)
+move_mean(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window mean along the specified axis, optionally ignoring NaNs.
 
@@ -1089,6 +1301,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1104,11 +1322,16 @@ array([ nan,  1.5,  2.5,  nan,  nan])
 >>> bn.move_mean(a, window=2, min_count=1)
 array([ 1. ,  1.5,  2.5,  3. ,  5. ])
 
+Restart the window at each group:
+
+>>> bn.move_mean([1.0, 2, 3, 4, 5], window=2, groups=[0, 0, 0, 1, 1])
+array([ nan,  1.5,  2.5,  nan,  4.5])
+
 MULTILINE STRING END */
 
 static char move_std_doc[] =
 /* MULTILINE STRING BEGIN
-move_std(a, window, min_count=None, axis=-1, ddof=0)
+move_std(a, window, min_count=None, axis=-1, ddof=0, groups=None)
 
 Moving window standard deviation along the specified axis, optionally
 ignoring NaNs.
@@ -1139,6 +1362,12 @@ ddof : int, optional
     Means Delta Degrees of Freedom. The divisor used in calculations
     is ``N - ddof``, where ``N`` represents the number of elements.
     By default `ddof` is zero.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1158,7 +1387,7 @@ MULTILINE STRING END */
 
 static char move_var_doc[] =
 /* MULTILINE STRING BEGIN
-move_var(a, window, min_count=None, axis=-1, ddof=0)
+move_var(a, window, min_count=None, axis=-1, ddof=0, groups=None)
 
 Moving window variance along the specified axis, optionally ignoring NaNs.
 
@@ -1188,6 +1417,12 @@ ddof : int, optional
     Means Delta Degrees of Freedom. The divisor used in calculations
     is ``N - ddof``, where ``N`` represents the number of elements.
     By default `ddof` is zero.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1207,7 +1442,7 @@ MULTILINE STRING END */
 
 static char move_min_doc[] =
 /* MULTILINE STRING BEGIN
-move_min(a, window, min_count=None, axis=-1)
+move_min(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window minimum along the specified axis, optionally ignoring NaNs.
 
@@ -1226,6 +1461,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1246,7 +1487,7 @@ MULTILINE STRING END */
 
 static char move_max_doc[] =
 /* MULTILINE STRING BEGIN
-move_max(a, window, min_count=None, axis=-1)
+move_max(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window maximum along the specified axis, optionally ignoring NaNs.
 
@@ -1265,6 +1506,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1285,7 +1532,7 @@ MULTILINE STRING END */
 
 static char move_argmin_doc[] =
 /* MULTILINE STRING BEGIN
-move_argmin(a, window, min_count=None, axis=-1)
+move_argmin(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window index of minimum along the specified axis, optionally
 ignoring NaNs.
@@ -1312,6 +1559,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1338,7 +1591,7 @@ MULTILINE STRING END */
 
 static char move_argmax_doc[] =
 /* MULTILINE STRING BEGIN
-move_argmax(a, window, min_count=None, axis=-1)
+move_argmax(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window index of maximum along the specified axis, optionally
 ignoring NaNs.
@@ -1365,6 +1618,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1391,7 +1650,7 @@ MULTILINE STRING END */
 
 static char move_median_doc[] =
 /* MULTILINE STRING BEGIN
-move_median(a, window, min_count=None, axis=-1)
+move_median(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window median along the specified axis, optionally ignoring NaNs.
 
@@ -1410,6 +1669,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1429,7 +1694,7 @@ MULTILINE STRING END */
 
 static char move_rank_doc[] =
 /* MULTILINE STRING BEGIN
-move_rank(a, window, min_count=None, axis=-1)
+move_rank(a, window, min_count=None, axis=-1, groups=None)
 
 Moving window ranking along the specified axis, optionally ignoring NaNs.
 
@@ -1455,6 +1720,12 @@ min_count: {int, None}, optional
 axis : int, optional
     The axis over which the window is moved. By default the last axis
     (axis=-1) is used. An axis of None is not allowed.
+groups : {array_like, None}, optional
+    Integer labels, one per element along `axis`, of input that is sorted
+    by group. The window restarts wherever the label changes, so each run
+    of equal labels gives the same output as calling the function on that
+    run alone; a run shorter than `window` gives the output of the start
+    of a longer run. By default (None) the whole axis is one group.
 
 Returns
 -------
@@ -1500,40 +1771,53 @@ move_methods[] = {
     {"move_argmax", (PyCFunction)move_argmax, VARKEY, move_argmax_doc},
     {"move_median", (PyCFunction)move_median, VARKEY, move_median_doc},
     {"move_rank",   (PyCFunction)move_rank,   VARKEY, move_rank_doc},
+    SCRATCH_METHODS
+    THREAD_METHODS
     {NULL, NULL, 0, NULL}
 };
 
 
-#if PY_MAJOR_VERSION >= 3
+static int
+move_exec(PyObject *m)
+{
+    module_state *st = STATE(m);
+    import_array1(-1);
+    if (!intern_strings(st)) {
+        return -1;
+    }
+    st->slow = PyImport_ImportModule("bottleneck.slow");
+    if (st->slow == NULL) {
+        return -1;
+    }
+    if (bn_pool_init() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+move_slots[] = {
+    {Py_mod_exec, (void *)move_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
 static struct PyModuleDef
 move_def = {
    PyModuleDef_HEAD_INIT,
    "move",
    move_doc,
-   -1,
-   move_methods
+   sizeof(module_state),
+   move_methods,
+   move_slots,
+   module_traverse,
+   module_clear,
+   module_free
 };
-#endif
 
 
 PyMODINIT_FUNC
-#if PY_MAJOR_VERSION >= 3
-#define RETVAL m
 PyInit_move(void)
-#else
-#define RETVAL
-initmove(void)
-#endif
 {
-    #if PY_MAJOR_VERSION >=3
-        PyObject *m = PyModule_Create(&move_def);
-    #else
-        PyObject *m = Py_InitModule3("move", move_methods, move_doc);
-    #endif
-    if (m == NULL) return RETVAL;
-    import_array();
-    if (!intern_strings()) {
-        return RETVAL;
-    }
-    return RETVAL;
+    return PyModuleDef_Init(&move_def);
 }
@@ -2,6 +2,7 @@
 // Copyright 2019 Bottleneck Developers
 #include "bottleneck.h"
 #include "iterators.h"
+#include "introselect/introselect.h"
 
 /* function signatures --------------------------------------------------- */
 
@@ -15,14 +16,17 @@
     static PyObject * \
     name(PyObject *self, PyObject *args, PyObject *kwds) \
     { \
-        return nonreducer_axis(#name, \
-                               args, \
-                               kwds, \
-                               name##_float64, \
-                               name##_float32, \
-                               name##_int64, \
-                               name##_int32, \
-                               parse); \
+        static const nra_t nra[BN_NDTYPES] = BN_DTYPE_TABLE(name##_); \
+        return nonreducer_axis(self, #name, args, kwds, nra, parse); \
+    }
+
+/* top-level functions that also take datetime64 and timedelta64 */
+#define NRA_MAIN_DATETIME(name, parse) \
+    static PyObject * \
+    name(PyObject *self, PyObject *args, PyObject *kwds) \
+    { \
+        static const nra_t nra[BN_NDTYPES] = BN_DATETIME_TABLE(name##_); \
+        return nonreducer_axis(self, #name, args, kwds, nra, parse); \
     }
 
 /* typedefs and prototypes ----------------------------------------------- */
@@ -34,23 +38,21 @@ typedef enum {PARSE_PARTITION, PARSE_RANKDATA, PARSE_PUSH} parse_type;
 typedef PyObject *(*nra_t)(PyArrayObject *, int, int);
 
 static PyObject *
-nonreducer_axis(char *name,
+nonreducer_axis(PyObject *self,
+                char *name,
                 PyObject *args,
                 PyObject *kwds,
-                nra_t,
-                nra_t,
-                nra_t,
-                nra_t,
+                const nra_t *nra,
                 parse_type);
 
 /* partition ------------------------------------------------------------- */
 
-#define B(dtype, i) AX(dtype, i) /* used by PARTITION */
-
-/* dtype = [['float64'], ['float32'], ['int64'], ['int32']] */
+/* dtype = [['float64'], ['float32'], ['int64'], ['int32'], ['float16'],
+            ['int16'], ['int8'], ['uint64'], ['uint32'], ['uint16'],
+            ['uint8'], ['bool']] */
 NRA(partition, DTYPE0) {
     npy_intp i;
-    npy_intp j, l, r, k;
+    bn_DTYPE0 *buffer = NULL;
     iter it;
 
     a = (PyArrayObject *)PyArray_NewCopy(a, NPY_ANYORDER);
@@ -61,18 +63,33 @@ NRA(partition, DTYPE0) {
         PyErr_Format(PyExc_ValueError,
                      "`n` (=%d) must be between 0 and %zd, inclusive.",
                      n, LENGTH - 1);
+        Py_DECREF(a);
         return NULL;
     }
 
+    /* strided slices are partitioned in a contiguous buffer */
+    if (it.astride != sizeof(bn_DTYPE0)) {
+        buffer = bn_scratch_get(LENGTH * sizeof(bn_DTYPE0));
+        if (buffer == NULL) {
+            Py_DECREF(a);
+            MEMORY_ERR("Could not allocate memory for partition");
+            return NULL;
+        }
+    }
+
     BN_BEGIN_ALLOW_THREADS
-    k = n;
     WHILE {
-        l = 0;
-        r = LENGTH - 1;
-        PARTITION(DTYPE0)
+        if (buffer == NULL) {
+            bn_select_DTYPE0((bn_DTYPE0 *)it.pa, LENGTH, n);
+        } else {
+            for (i = 0; i < LENGTH; i++) buffer[i] = AX(DTYPE0, i);
+            bn_select_DTYPE0(buffer, LENGTH, n);
+            for (i = 0; i < LENGTH; i++) AX(DTYPE0, i) = buffer[i];
+        }
         NEXT
     }
     BN_END_ALLOW_THREADS
+    bn_scratch_put(buffer);
 
     return (PyObject *)a;
 }
@@ -83,86 +100,16 @@ NRA_MAIN(partition, PARSE_PARTITION)
 
 /* argpartition ----------------------------------------------------------- */
 
-#define BUFFER_NEW(dtype) dtype *B = malloc(LENGTH * sizeof(dtype));
-#define BUFFER_DELETE free(B);
-
-#define ARGWIRTH(dtype0, dtype1) \
-    x = B[k]; \
-    i = l; \
-    j = r; \
-    do { \
-        while (B[i] < x) i++; \
-        while (x < B[j]) j--; \
-        if (i <= j) { \
-            npy_##dtype0 atmp = B[i]; \
-            B[i] = B[j]; \
-            B[j] = atmp; \
-            ytmp = YX(dtype1, i); \
-            YX(dtype1, i) = YX(dtype1, j); \
-            YX(dtype1, j) = ytmp; \
-            i++; \
-            j--; \
-        } \
-    } while (i <= j); \
-    if (j < k) l = i; \
-    if (k < i) r = j;
-
-#define ARGPARTITION(dtype0, dtype1) \
-    while (l < r) { \
-        npy_##dtype0 x; \
-        npy_##dtype0 al = B[l]; \
-        npy_##dtype0 ak = B[k]; \
-        npy_##dtype0 ar = B[r]; \
-        npy_##dtype1 ytmp; \
-        if (al > ak) { \
-            if (ak < ar) { \
-                if (al < ar) { \
-                    B[k] = al; \
-                    B[l] = ak; \
-                    ytmp = YX(dtype1, k); \
-                    YX(dtype1, k) = YX(dtype1, l); \
-                    YX(dtype1, l) = ytmp; \
-                } else { \
-                    B[k] = ar; \
-                    B[r] = ak; \
-                    ytmp = YX(dtype1, k); \
-                    YX(dtype1, k) = YX(dtype1, r); \
-                    YX(dtype1, r) = ytmp; \
-                } \
-            } \
-        } else { \
-            if (ak > ar) { \
-                if (al > ar) { \
-                    B[k] = al; \
-                    B[l] = ak; \
-                    ytmp = YX(dtype1, k); \
-                    YX(dtype1, k) = YX(dtype1, l); \
-                    YX(dtype1, l) = ytmp; \
-                } else { \
-                    B[k] = ar; \
-                    B[r] = ak; \
-                    ytmp = YX(dtype1, k); \
-                    YX(dtype1, k) = YX(dtype1, r); \
-                    YX(dtype1, r) = ytmp; \
-                } \
-            } \
-        } \
-        ARGWIRTH(dtype0, dtype1) \
-    }
-
-#define ARGPARTSORT(dtype0, dtype1) \
-    for (i = 0; i < LENGTH; i++) { \
-        B[i] = AX(dtype0, i); \
-        YX(dtype1, i) = i; \
-    } \
-    l = 0; \
-    r = LENGTH - 1; \
-    ARGPARTITION(dtype0, dtype1)
-
 /* dtype = [['float64', 'intp'], ['float32', 'intp'],
-            ['int64',   'intp'], ['int32',   'intp']] */
+            ['int64',   'intp'], ['int32',   'intp'],
+            ['float16', 'intp'], ['int16',   'intp'],
+            ['int8',    'intp'], ['uint64',  'intp'],
+            ['uint32',  'intp'], ['uint16',  'intp'],
+            ['uint8',   'intp'], ['bool',    'intp']] */
 NRA(argpartition, DTYPE0) {
     npy_intp i;
+    bn_DTYPE1 *buffer, *idx;
+    bn_DTYPE0 *B;
     PyObject *y = PyArray_EMPTY(PyArray_NDIM(a), PyArray_SHAPE(a),
                                 NPY_DTYPE1, 0);
     iter2 it;
@@ -172,20 +119,38 @@ NRA(argpartition, DTYPE0) {
         PyErr_Format(PyExc_ValueError,
                      "`n` (=%d) must be between 0 and %zd, inclusive.",
                      n, LENGTH - 1);
+        Py_DECREF(y);
+        return NULL;
+    }
+    /* indices first so that both arrays are aligned */
+    buffer = bn_scratch_get(LENGTH *
+                            (sizeof(bn_DTYPE1) + sizeof(bn_DTYPE0)));
+    if (buffer == NULL) {
+        Py_DECREF(y);
+        MEMORY_ERR("Could not allocate memory for argpartition");
         return NULL;
     }
+    B = (bn_DTYPE0 *)(buffer + LENGTH);
     BN_BEGIN_ALLOW_THREADS
-    BUFFER_NEW(npy_DTYPE0)
-    npy_intp j, l, r, k;
-    k = n;
     WHILE {
-        l = 0;
-        r = LENGTH - 1;
-        ARGPARTSORT(DTYPE0, DTYPE1)
+        /* contiguous output slices are used in place */
+        if (it.ystride == sizeof(bn_DTYPE1)) {
+            idx = (bn_DTYPE1 *)it.py;
+        } else {
+            idx = buffer;
+        }
+        for (i = 0; i < LENGTH; i++) {
+            B[i] = AX(DTYPE0, i);
+            idx[i] = i;
+        }
+        bn_argselect_DTYPE0(B, idx, LENGTH, n);
+        if (idx == buffer) {
+            for (i = 0; i < LENGTH; i++) YX(DTYPE1, i) = idx[i];
+        }
         NEXT2
     }
-    BUFFER_DELETE
     BN_END_ALLOW_THREADS
+    bn_scratch_put(buffer);
     return y;
 }
 /* dtype end */
@@ -196,10 +161,14 @@ NRA_MAIN(argpartition, PARSE_PARTITION)
 /* rankdata -------------------------------------------------------------- */
 
 /* dtype = [['float64', 'float64', 'intp'], ['float32', 'float64', 'intp'],
-            ['int64',   'float64', 'intp'], ['int32',   'float64', 'intp']] */
+            ['int64',   'float64', 'intp'], ['int32',   'float64', 'intp'],
+            ['float16', 'float64', 'intp'], ['int16',   'float64', 'intp'],
+            ['int8',    'float64', 'intp'], ['uint64',  'float64', 'intp'],
+            ['uint32',  'float64', 'intp'], ['uint16',  'float64', 'intp'],
+            ['uint8',   'float64', 'intp'], ['bool',    'float64', 'intp']] */
 NRA(rankdata, DTYPE0) {
     Py_ssize_t j=0, k, idx, dupcount=0, i;
-    npy_DTYPE1 old, new, averank, sumranks = 0;
+    bn_DTYPE1 old, new, averank, sumranks = 0;
 
     PyObject *z = PyArray_ArgSort(a, axis, NPY_QUICKSORT);
     PyObject *y = PyArray_EMPTY(PyArray_NDIM(a),
@@ -211,7 +180,7 @@ NRA(rankdata, DTYPE0) {
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         Py_ssize_t size = PyArray_SIZE((PyArrayObject *)y);
-        npy_DTYPE1 *py = (npy_DTYPE1 *)PyArray_DATA(a);
+        bn_DTYPE1 *py = (bn_DTYPE1 *)PyArray_DATA(a);
         for (i = 0; i < size; i++) YPP = BN_NAN;
     } else {
         WHILE {
@@ -258,10 +227,11 @@ NRA_MAIN(rankdata, PARSE_RANKDATA)
 
 /* nanrankdata ----------------------------------------------------------- */
 
-/* dtype = [['float64', 'float64', 'intp'], ['float32', 'float64', 'intp']] */
+/* dtype = [['float64', 'float64', 'intp'], ['float32', 'float64', 'intp'],
+            ['float16', 'float64', 'intp']] */
 NRA(nanrankdata, DTYPE0) {
     Py_ssize_t j=0, k, idx, dupcount=0, i;
-    npy_DTYPE1 old, new, averank, sumranks = 0;
+    bn_DTYPE1 old, new, averank, sumranks = 0;
 
     PyObject *z = PyArray_ArgSort(a, axis, NPY_QUICKSORT);
     PyObject *y = PyArray_EMPTY(PyArray_NDIM(a),
@@ -273,7 +243,7 @@ NRA(nanrankdata, DTYPE0) {
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         Py_ssize_t size = PyArray_SIZE((PyArrayObject *)y);
-        npy_DTYPE1 *py = (npy_DTYPE1 *)PyArray_DATA(a);
+        bn_DTYPE1 *py = (bn_DTYPE1 *)PyArray_DATA(a);
         for (i = 0; i < size; i++) YPP = BN_NAN;
     } else {
         WHILE {
@@ -325,32 +295,33 @@ NRA(nanrankdata, DTYPE0) {
 }
 /* dtype end */
 
+/* integers cannot be NaN so nanrankdata uses rankdata for them */
 static PyObject *
 nanrankdata(PyObject *self, PyObject *args, PyObject *kwds) {
-    return nonreducer_axis("nanrankdata",
-                           args,
-                           kwds,
-                           nanrankdata_float64,
-                           nanrankdata_float32,
-                           rankdata_int64,
-                           rankdata_int32,
+    static const nra_t nra[BN_NDTYPES] = {
+        nanrankdata_float64, nanrankdata_float32, rankdata_int64,
+        rankdata_int32, nanrankdata_float16, rankdata_int16, rankdata_int8,
+        rankdata_uint64, rankdata_uint32, rankdata_uint16, rankdata_uint8,
+        rankdata_bool};
+    return nonreducer_axis(self, "nanrankdata", args, kwds, nra,
                            PARSE_RANKDATA);
 }
 
 
 /* push ------------------------------------------------------------------ */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 NRA(push, DTYPE0) {
     npy_intp index;
-    npy_DTYPE0 ai, ai_last, n_float;
+    bn_DTYPE1 ai, ai_last, n_float;
     PyObject *y = PyArray_Copy(a);
     iter it;
     init_iter_one(&it, (PyArrayObject *)y, axis);
     if (LENGTH == 0 || NDIM == 0) {
         return y;
     }
-    n_float = n < 0 ? BN_INFINITY : (npy_DTYPE0)n;
+    n_float = n < 0 ? BN_INFINITY : (bn_DTYPE1)n;
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         index = 0;
@@ -373,36 +344,76 @@ NRA(push, DTYPE0) {
 }
 /* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
 NRA(push, DTYPE0) {
     PyObject *y = PyArray_Copy(a);
     return y;
 }
 /* dtype end */
 
-NRA_MAIN(push, PARSE_PUSH)
+/* datetime64 and timedelta64; NaT is missing */
+/* dtype = [['datetime']] */
+NRA(push, DTYPE0) {
+    npy_intp index;
+    bn_DTYPE0 ai, ai_last;
+    PyObject *y = PyArray_Copy(a);
+    iter it;
+    init_iter_one(&it, (PyArrayObject *)y, axis);
+    if (LENGTH == 0 || NDIM == 0) {
+        return y;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        index = 0;
+        ai_last = NPY_DATETIME_NAT;
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai != NPY_DATETIME_NAT) {
+                ai_last = ai;
+                index = INDEX;
+            } else {
+                if (n < 0 || INDEX - index <= n) {
+                    AI(DTYPE0) = ai_last;
+                }
+            }
+        }
+        NEXT
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+NRA_MAIN_DATETIME(push, PARSE_PUSH)
+
 
+/* module state ---------------------------------------------------------- */
 
-/* python strings -------------------------------------------------------- */
+typedef struct {
+    PyObject *slow;
+    PyObject *pystr_a;
+    PyObject *pystr_n;
+    PyObject *pystr_kth;
+    PyObject *pystr_axis;
+} module_state;
 
-PyObject *pystr_a = NULL;
-PyObject *pystr_n = NULL;
-PyObject *pystr_kth = NULL;
-PyObject *pystr_axis = NULL;
+MODULE_STATE_FUNCS
 
 static int
-intern_strings(void) {
-    pystr_a = PyString_InternFromString("a");
-    pystr_n = PyString_InternFromString("n");
-    pystr_kth = PyString_InternFromString("kth");
-    pystr_axis = PyString_InternFromString("axis");
-    return pystr_a && pystr_n && pystr_axis;
+intern_strings(module_state *st) {
+    st->pystr_a = PyString_InternFromString("a");
+    st->pystr_n = PyString_InternFromString("n");
+    st->pystr_kth = PyString_InternFromString("kth");
+    st->pystr_axis = PyString_InternFromString("axis");
+    return st->pystr_a && st->pystr_n && st->pystr_kth && st->pystr_axis;
 }
 
 /* nonreducer_axis ------------------------------------------------------- */
 
 static inline int
-parse_partition(PyObject *args,
+parse_partition(module_state *st,
+                PyObject *args,
                 PyObject *kwds,
                 PyObject **a,
                 PyObject **n,
@@ -414,6 +425,7 @@ parse_partition(PyObject *args,
         PyObject *tmp;
         switch (nargs) {
             case 2: *n = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1: *a = PyTuple_GET_ITEM(args, 0);
             case 0: break;
             default:
@@ -422,21 +434,23 @@ parse_partition(PyObject *args,
         }
         switch (nargs) {
             case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
+                *a = PyDict_GetItem(kwds, st->pystr_a);
                 if (*a == NULL) {
                     TYPE_ERR("Cannot find `a` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 1:
-                *n = PyDict_GetItem(kwds, pystr_kth);
+                *n = PyDict_GetItem(kwds, st->pystr_kth);
                 if (*n == NULL) {
                     TYPE_ERR("Cannot find `kth` keyword input");
                     return 0;
                 }
                 nkwds_found++;
+            /* fall through */
             case 2:
-                tmp = PyDict_GetItem(kwds, pystr_axis);
+                tmp = PyDict_GetItem(kwds, st->pystr_axis);
                 if (tmp != NULL) {
                     *axis = tmp;
                     nkwds_found++;
@@ -458,6 +472,7 @@ parse_partition(PyObject *args,
         switch (nargs) {
             case 3:
                 *axis = PyTuple_GET_ITEM(args, 2);
+            /* fall through */
             case 2:
                 *n = PyTuple_GET_ITEM(args, 1);
                 *a = PyTuple_GET_ITEM(args, 0);
@@ -473,7 +488,8 @@ parse_partition(PyObject *args,
 }
 
 static inline int
-parse_rankdata(PyObject *args,
+parse_rankdata(module_state *st,
+               PyObject *args,
                PyObject *kwds,
                PyObject **a,
                PyObject **axis) {
@@ -491,14 +507,15 @@ parse_rankdata(PyObject *args,
         }
         switch (nargs) {
             case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
+                *a = PyDict_GetItem(kwds, st->pystr_a);
                 if (*a == NULL) {
                     TYPE_ERR("Cannot find `a` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 1:
-                tmp = PyDict_GetItem(kwds, pystr_axis);
+                tmp = PyDict_GetItem(kwds, st->pystr_axis);
                 if (tmp != NULL) {
                     *axis = tmp;
                     nkwds_found++;
@@ -520,6 +537,7 @@ parse_rankdata(PyObject *args,
         switch (nargs) {
             case 2:
                 *axis = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1:
                 *a = PyTuple_GET_ITEM(args, 0);
                 break;
@@ -534,7 +552,8 @@ parse_rankdata(PyObject *args,
 }
 
 static inline int
-parse_push(PyObject *args,
+parse_push(module_state *st,
+           PyObject *args,
            PyObject *kwds,
            PyObject **a,
            PyObject **n,
@@ -546,6 +565,7 @@ parse_push(PyObject *args,
         PyObject *tmp;
         switch (nargs) {
             case 2: *n = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1: *a = PyTuple_GET_ITEM(args, 0);
             case 0: break;
             default:
@@ -554,20 +574,22 @@ parse_push(PyObject *args,
         }
         switch (nargs) {
             case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
+                *a = PyDict_GetItem(kwds, st->pystr_a);
                 if (*a == NULL) {
                     TYPE_ERR("Cannot find `a` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 1:
-                tmp = PyDict_GetItem(kwds, pystr_n);
+                tmp = PyDict_GetItem(kwds, st->pystr_n);
                 if (tmp != NULL) {
                     *n = tmp;
                     nkwds_found++;
                 }
+            /* fall through */
             case 2:
-                tmp = PyDict_GetItem(kwds, pystr_axis);
+                tmp = PyDict_GetItem(kwds, st->pystr_axis);
                 if (tmp != NULL) {
                     *axis = tmp;
                     nkwds_found++;
@@ -589,8 +611,10 @@ parse_push(PyObject *args,
         switch (nargs) {
             case 3:
                 *axis = PyTuple_GET_ITEM(args, 2);
+            /* fall through */
             case 2:
                 *n = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1:
                 *a = PyTuple_GET_ITEM(args, 0);
                 break;
@@ -604,16 +628,28 @@ parse_push(PyObject *args,
 
 }
 
+/* the arguments of a nra_t, for bn_blocks */
+typedef struct {
+    nra_t nra;
+    int axis;
+    int n;
+} nra_args;
+
+static PyObject *
+nra_block(PyArrayObject *a, void *args) {
+    nra_args *na = (nra_args *)args;
+    return na->nra(a, na->axis, na->n);
+}
+
 static PyObject *
-nonreducer_axis(char *name,
+nonreducer_axis(PyObject *self,
+                char *name,
                 PyObject *args,
                 PyObject *kwds,
-                nra_t nra_float64,
-                nra_t nra_float32,
-                nra_t nra_int64,
-                nra_t nra_int32,
+                const nra_t *nra,
                 parse_type parse) {
 
+    module_state *st = STATE(self);
     int n;
     int axis;
     int dtype;
@@ -626,15 +662,15 @@ nonreducer_axis(char *name,
     PyObject *axis_obj = NULL;
 
     if (parse == PARSE_PARTITION) {
-        if (!parse_partition(args, kwds, &a_obj, &n_obj, &axis_obj)) {
+        if (!parse_partition(st, args, kwds, &a_obj, &n_obj, &axis_obj)) {
             return NULL;
         }
     } else if (parse == PARSE_RANKDATA) {
-        if (!parse_rankdata(args, kwds, &a_obj, &axis_obj)) {
+        if (!parse_rankdata(st, args, kwds, &a_obj, &axis_obj)) {
             return NULL;
         }
     } else if (parse == PARSE_PUSH) {
-        if (!parse_push(args, kwds, &a_obj, &n_obj, &axis_obj)) {
+        if (!parse_push(st, args, kwds, &a_obj, &n_obj, &axis_obj)) {
             return NULL;
         }
     } else {
@@ -652,12 +688,6 @@ nonreducer_axis(char *name,
         }
     }
 
-    /* check for byte swapped input array */
-    if (PyArray_ISBYTESWAPPED(a)) {
-        Py_DECREF(a);
-        return slow(name, args, kwds);
-    }
-
     /* defend against the axis of negativity */
     if (axis_obj == NULL) {
         if (parse == PARSE_PARTITION || parse == PARSE_PUSH) {
@@ -718,12 +748,21 @@ nonreducer_axis(char *name,
         }
     }
 
-    dtype = PyArray_TYPE(a);
-    if      (dtype == NPY_float64) y = nra_float64(a, axis, n);
-    else if (dtype == NPY_float32) y = nra_float32(a, axis, n);
-    else if (dtype == NPY_int64)   y = nra_int64(a, axis, n);
-    else if (dtype == NPY_int32)   y = nra_int32(a, axis, n);
-    else                           y = slow(name, args, kwds);
+    dtype = bn_dtype_index(a);
+    if (dtype < 0 || nra[dtype] == NULL) {
+        y = slow(st->slow, name, args, kwds);
+#if !HAVE_FLOAT16
+    } else if (parse == PARSE_RANKDATA && PyArray_TYPE(a) == NPY_FLOAT16) {
+        /* the ranks of NaNs follow the order in which numpy sorts them,
+           which depends on the dtype, so float16 stays with numpy */
+        y = slow(st->slow, name, args, kwds);
+#endif
+    } else if (bn_convert(a)) {
+        nra_args na = {nra[dtype], axis, n};
+        y = bn_blocks(a, axis, BN_BLOCK_KEEP, nra_block, &na);
+    } else {
+        y = nra[dtype](a, axis, n);
+    }
 
     Py_DECREF(a);
 
@@ -964,6 +1003,7 @@ Fill missing values (NaNs) with most recent non-missing values.
 
 Filling proceeds along the specified axis from small index values to large
 index values.
+NaT is the missing value of datetime64 and timedelta64 input.
 
 Parameters
 ----------
@@ -1008,40 +1048,53 @@ nra_methods[] = {
     {"rankdata",     (PyCFunction)rankdata,     VARKEY, rankdata_doc},
     {"nanrankdata",  (PyCFunction)nanrankdata,  VARKEY, nanrankdata_doc},
     {"push",         (PyCFunction)push,         VARKEY, push_doc},
+    SCRATCH_METHODS
+    THREAD_METHODS
     {NULL, NULL, 0, NULL}
 };
 
 
-#if PY_MAJOR_VERSION >= 3
+static int
+nonreduce_axis_exec(PyObject *m)
+{
+    module_state *st = STATE(m);
+    import_array1(-1);
+    if (!intern_strings(st)) {
+        return -1;
+    }
+    st->slow = PyImport_ImportModule("bottleneck.slow");
+    if (st->slow == NULL) {
+        return -1;
+    }
+    if (bn_pool_init() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+nonreduce_axis_slots[] = {
+    {Py_mod_exec, (void *)nonreduce_axis_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
 static struct PyModuleDef
 nra_def = {
    PyModuleDef_HEAD_INIT,
    "nonreduce_axis",
    nra_doc,
-   -1,
-   nra_methods
+   sizeof(module_state),
+   nra_methods,
+   nonreduce_axis_slots,
+   module_traverse,
+   module_clear,
+   module_free
 };
-#endif
 
 
 PyMODINIT_FUNC
-#if PY_MAJOR_VERSION >= 3
-#define RETVAL m
 PyInit_nonreduce_axis(void)
-#else
-#define RETVAL
-initnonreduce_axis(void)
-#endif
 {
-    #if PY_MAJOR_VERSION >=3
-        PyObject *m = PyModule_Create(&nra_def);
-    #else
-        PyObject *m = Py_InitModule3("nonreduce_axis", nra_methods, nra_doc);
-    #endif
-    if (m == NULL) return RETVAL;
-    import_array();
-    if (!intern_strings()) {
-        return RETVAL;
-    }
-    return RETVAL;
+    return PyModuleDef_Init(&nra_def);
 }
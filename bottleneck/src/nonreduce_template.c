@@ -9,28 +9,26 @@
 typedef PyObject *(*nr_t)(PyArrayObject *, double, double);
 
 static PyObject *
-nonreducer(char *name,
+nonreducer(PyObject *self,
+           char *name,
            PyObject *args,
            PyObject *kwds,
-           nr_t,
-           nr_t,
-           nr_t,
-           nr_t,
+           const nr_t *nr,
            int inplace);
 
 /* replace --------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64'], ['float32'], ['float16']] */
 static BN_OPT_3 PyObject *
 replace_DTYPE0(PyArrayObject *a, double old, double new) {
     iter it;
-    init_iter_all(&it, a, 0, 1);
+    init_iter_all(&it, a, 1);
     BN_BEGIN_ALLOW_THREADS
-    const npy_DTYPE0 oldf = (npy_DTYPE0)old;
-    const npy_DTYPE0 newf = (npy_DTYPE0)new;
+    const bn_DTYPE0 oldf = (bn_DTYPE0)old;
+    const bn_DTYPE0 newf = (bn_DTYPE0)new;
     if (old == old) {
         WHILE {
-            npy_DTYPE0* array = PA(DTYPE0);
+            bn_DTYPE0* array = PA(DTYPE0);
             FOR {
                 array[it.i] = array[it.i] == oldf ? newf : array[it.i];
             }
@@ -38,7 +36,7 @@ replace_DTYPE0(PyArrayObject *a, double old, double new) {
         }
     } else {
         WHILE {
-            npy_DTYPE0* array = PA(DTYPE0);
+            bn_DTYPE0* array = PA(DTYPE0);
             FOR {
                 array[it.i] = array[it.i] != array[it.i] ? newf : array[it.i];
             }
@@ -52,25 +50,51 @@ replace_DTYPE0(PyArrayObject *a, double old, double new) {
 /* dtype end */
 
 
-/* dtype = [['int64'], ['int32']] */
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
 static BN_OPT_3 PyObject *
 replace_DTYPE0(PyArrayObject *a, double old, double new) {
     iter it;
-    init_iter_all(&it, a, 0, 1);
+    init_iter_all(&it, a, 1);
     if (old == old) {
-        const npy_DTYPE0 oldint = (npy_DTYPE0)old;
-        const npy_DTYPE0 newint = (npy_DTYPE0)new;
-        if (oldint != old) {
+        /* an `old` outside the range of the dtype cannot be in `a` */
+        const int old_in_range = old >= NPY_MIN_DTYPE0 &&
+                                old < NPY_MAX_DTYPE0 + 1.0;
+        const int new_in_range = new >= NPY_MIN_DTYPE0 &&
+                                new < NPY_MAX_DTYPE0 + 1.0;
+        const bn_DTYPE0 oldint = old_in_range ? (bn_DTYPE0)old : 0;
+        bn_DTYPE0 newint = new_in_range ? (bn_DTYPE0)new : 0;
+        /* int64 and int32 were always replaced here and raise ValueError
+         * for any `new` they cannot hold. The other dtypes used to go
+         * through numpy, which raises OverflowError for an integer out of
+         * their range and stores any other integer in a bool array. */
+        const int numpy_errors = NPY_DTYPE0 != NPY_INT64 &&
+                                 NPY_DTYPE0 != NPY_INT32;
+        if (old_in_range ? oldint != old : old != floor(old)) {
             VALUE_ERR("Cannot safely cast `old` to int");
             return NULL;
         }
-        if (newint != new) {
+        if (new_in_range ? newint != new
+                         : !numpy_errors || new != floor(new)) {
             VALUE_ERR("Cannot safely cast `new` to int");
             return NULL;
         }
+        if (!new_in_range) {
+            if (NPY_DTYPE0 != NPY_BOOL || !isfinite(new)) {
+                PyErr_Format(PyExc_OverflowError,
+                             "Python integer %.0f out of bounds for DTYPE0",
+                             new);
+                return NULL;
+            }
+            newint = 1;
+        }
+        if (!old_in_range) {
+            Py_INCREF(a);
+            return (PyObject *)a;
+        }
         BN_BEGIN_ALLOW_THREADS
         WHILE {
-            npy_DTYPE0* array = (npy_DTYPE0 *)it.pa;
+            bn_DTYPE0* array = (bn_DTYPE0 *)it.pa;
             npy_intp i;
             // clang has a large perf regression when using the FOR macro here
             for (i=0; i < it.length; i++) {
@@ -87,35 +111,35 @@ replace_DTYPE0(PyArrayObject *a, double old, double new) {
 
 static PyObject *
 replace(PyObject *self, PyObject *args, PyObject *kwds) {
-    return nonreducer("replace",
-                      args,
-                      kwds,
-                      replace_float64,
-                      replace_float32,
-                      replace_int64,
-                      replace_int32,
-                      1);
+    static const nr_t nr[BN_NDTYPES] = BN_DTYPE_TABLE(replace_);
+    return nonreducer(self, "replace", args, kwds, nr, 1);
 }
 
 
-/* python strings -------------------------------------------------------- */
+/* module state ---------------------------------------------------------- */
 
-PyObject *pystr_a = NULL;
-PyObject *pystr_old = NULL;
-PyObject *pystr_new = NULL;
+typedef struct {
+    PyObject *slow;
+    PyObject *pystr_a;
+    PyObject *pystr_old;
+    PyObject *pystr_new;
+} module_state;
+
+MODULE_STATE_FUNCS
 
 static int
-intern_strings(void) {
-    pystr_a = PyString_InternFromString("a");
-    pystr_old = PyString_InternFromString("old");
-    pystr_new = PyString_InternFromString("new");
-    return pystr_a && pystr_old && pystr_new;
+intern_strings(module_state *st) {
+    st->pystr_a = PyString_InternFromString("a");
+    st->pystr_old = PyString_InternFromString("old");
+    st->pystr_new = PyString_InternFromString("new");
+    return st->pystr_a && st->pystr_old && st->pystr_new;
 }
 
 /* nonreduce ------------------------------------------------------------- */
 
 static inline int
-parse_args(PyObject *args,
+parse_args(module_state *st,
+           PyObject *args,
            PyObject *kwds,
            PyObject **a,
            PyObject **old,
@@ -126,6 +150,7 @@ parse_args(PyObject *args,
         int nkwds_found = 0;
         switch (nargs) {
             case 2: *old = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
             case 1: *a = PyTuple_GET_ITEM(args, 0);
             case 0: break;
             default:
@@ -134,21 +159,23 @@ parse_args(PyObject *args,
         }
         switch (nargs) {
             case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
+                *a = PyDict_GetItem(kwds, st->pystr_a);
                 if (*a == NULL) {
                     TYPE_ERR("Cannot find `a` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 1:
-                *old = PyDict_GetItem(kwds, pystr_old);
+                *old = PyDict_GetItem(kwds, st->pystr_old);
                 if (*old == NULL) {
                     TYPE_ERR("Cannot find `old` keyword input");
                     return 0;
                 }
                 nkwds_found += 1;
+            /* fall through */
             case 2:
-                *new = PyDict_GetItem(kwds, pystr_new);
+                *new = PyDict_GetItem(kwds, st->pystr_new);
                 if (*new == NULL) {
                     TYPE_ERR("Cannot find `new` keyword input");
                     return 0;
@@ -184,15 +211,27 @@ parse_args(PyObject *args,
 
 }
 
+/* the arguments of a nr_t, for bn_blocks */
+typedef struct {
+    nr_t nr;
+    double old;
+    double new;
+} nr_args;
+
+static PyObject *
+nr_block(PyArrayObject *a, void *args) {
+    nr_args *na = (nr_args *)args;
+    return na->nr(a, na->old, na->new);
+}
+
 static PyObject *
-nonreducer(char *name,
+nonreducer(PyObject *self,
+           char *name,
            PyObject *args,
            PyObject *kwds,
-           nr_t nr_float64,
-           nr_t nr_float32,
-           nr_t nr_int64,
-           nr_t nr_int32,
+           const nr_t *nr,
            int inplace) {
+    module_state *st = STATE(self);
     int dtype;
     double old, new;
 
@@ -203,7 +242,7 @@ nonreducer(char *name,
     PyObject *old_obj = NULL;
     PyObject *new_obj = NULL;
 
-    if (!parse_args(args, kwds, &a_obj, &old_obj, &new_obj)) return NULL;
+    if (!parse_args(st, args, kwds, &a_obj, &old_obj, &new_obj)) return NULL;
 
     /* convert to array if necessary */
     if (PyArray_Check(a_obj)) {
@@ -221,12 +260,6 @@ nonreducer(char *name,
         }
     }
 
-    /* check for byte swapped input array */
-    if (PyArray_ISBYTESWAPPED(a)) {
-        Py_DECREF(a);
-        return slow(name, args, kwds);
-    }
-
     /* old */
     if (old_obj == NULL) {
         RUNTIME_ERR("`old_obj` should never be NULL; please report this bug.");
@@ -251,13 +284,16 @@ nonreducer(char *name,
         }
     }
 
-    dtype = PyArray_TYPE(a);
+    dtype = bn_dtype_index(a);
 
-    if      (dtype == NPY_float64) y = nr_float64(a, old, new);
-    else if (dtype == NPY_float32) y = nr_float32(a, old, new);
-    else if (dtype == NPY_int64)   y = nr_int64(a, old, new);
-    else if (dtype == NPY_int32)   y = nr_int32(a, old, new);
-    else                           y = slow(name, args, kwds);
+    if (dtype < 0 || nr[dtype] == NULL) {
+        y = slow(st->slow, name, args, kwds);
+    } else if (bn_convert(a)) {
+        nr_args na = {nr[dtype], old, new};
+        y = bn_blocks(a, -1, BN_BLOCK_INPLACE, nr_block, &na);
+    } else {
+        y = nr[dtype](a, old, new);
+    }
 
     Py_DECREF(a);
 
@@ -326,41 +362,53 @@ MULTILINE STRING END */
 static PyMethodDef
 nonreduce_methods[] = {
     {"replace", (PyCFunction)replace, VARKEY, replace_doc},
+    SCRATCH_METHODS
+    THREAD_METHODS
     {NULL, NULL, 0, NULL}
 };
 
 
-#if PY_MAJOR_VERSION >= 3
+static int
+nonreduce_exec(PyObject *m)
+{
+    module_state *st = STATE(m);
+    import_array1(-1);
+    if (!intern_strings(st)) {
+        return -1;
+    }
+    st->slow = PyImport_ImportModule("bottleneck.slow");
+    if (st->slow == NULL) {
+        return -1;
+    }
+    if (bn_pool_init() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+nonreduce_slots[] = {
+    {Py_mod_exec, (void *)nonreduce_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
 static struct PyModuleDef
 nonreduce_def = {
    PyModuleDef_HEAD_INIT,
    "nonreduce",
    nonreduce_doc,
-   -1,
-   nonreduce_methods
+   sizeof(module_state),
+   nonreduce_methods,
+   nonreduce_slots,
+   module_traverse,
+   module_clear,
+   module_free
 };
-#endif
 
 
 PyMODINIT_FUNC
-#if PY_MAJOR_VERSION >= 3
-#define RETVAL m
 PyInit_nonreduce(void)
-#else
-#define RETVAL
-initnonreduce(void)
-#endif
 {
-    #if PY_MAJOR_VERSION >=3
-        PyObject *m = PyModule_Create(&nonreduce_def);
-    #else
-        PyObject *m = Py_InitModule3("nonreduce", nonreduce_methods,
-                                     nonreduce_doc);
-    #endif
-    if (m == NULL) return RETVAL;
-    import_array();
-    if (!intern_strings()) {
-        return RETVAL;
-    }
-    return RETVAL;
+    return PyModuleDef_Init(&nonreduce_def);
 }
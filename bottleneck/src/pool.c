@@ -0,0 +1,412 @@
+// Copyright 2019 Bottleneck Developers
+#include "bn_pool.h"
+
+/*
+ bottleneck._pool holds the one thread pool of the process. The other
+ extension modules take its bn_pool_api from the capsule _C_API when they
+ are imported (bn_pool_init in bottleneck.h), so their kernels share its
+ workers and the thread count bn.set_num_threads gives it, and together
+ never run more threads than that. Only one kernel at a time uses the pool;
+ a kernel that finds it busy runs its parts on the calling thread. Without
+ pthreads (Windows) the parts always run on the calling thread.
+
+ The workers also run the Python calls queued by _submit (bn.submit), in
+ the order they were queued, when they have no parts to take. A pool that
+ has calls to run keeps at least one worker.
+*/
+
+/* threads kernels may use, including the calling thread */
+static Py_ssize_t bn_pool_threads = 1;
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+
+static int bn_pool_pin = 0;
+static int bn_pool_started = 0;
+static int bn_pool_stopping = 0;
+static pthread_t bn_pool_workers[BN_POOL_MAX];
+static pthread_mutex_t bn_pool_busy = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t bn_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bn_pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t bn_pool_done = PTHREAD_COND_INITIALIZER;
+
+/* the current job, guarded by bn_pool_lock */
+static bn_part_t bn_pool_fn = NULL;
+static void *bn_pool_arg = NULL;
+static int bn_pool_nparts = 0;
+static int bn_pool_next = 0;
+static int bn_pool_finished = 0;
+static unsigned long bn_pool_job = 0;
+
+/* a queued call of `func`, in the interpreter that queued it */
+typedef struct bn_task {
+    PyObject *func;
+    PyInterpreterState *interp;
+    struct bn_task *next;
+} bn_task;
+
+/* the queued calls and the number running, guarded by bn_pool_lock */
+static bn_task *bn_task_head = NULL;
+static bn_task *bn_task_tail = NULL;
+static int bn_task_running = 0;
+static pthread_cond_t bn_task_idle = PTHREAD_COND_INITIALIZER;
+
+/* call with bn_pool_lock held; takes the remaining parts of the job */
+static void
+bn_pool_take_parts(void)
+{
+    int part;
+    while (bn_pool_next < bn_pool_nparts) {
+        part = bn_pool_next++;
+        pthread_mutex_unlock(&bn_pool_lock);
+        bn_pool_fn(bn_pool_arg, part, bn_pool_nparts);
+        pthread_mutex_lock(&bn_pool_lock);
+        if (++bn_pool_finished == bn_pool_nparts) {
+            pthread_cond_signal(&bn_pool_done);
+        }
+    }
+}
+
+/* call with bn_pool_lock held; runs the first queued call */
+static void
+bn_task_run(void)
+{
+    bn_task *task = bn_task_head;
+    PyThreadState *ts;
+    PyObject *y;
+    bn_task_head = task->next;
+    if (bn_task_head == NULL) bn_task_tail = NULL;
+    bn_task_running++;
+    pthread_mutex_unlock(&bn_pool_lock);
+    ts = PyThreadState_New(task->interp);
+    PyEval_RestoreThread(ts);
+    y = PyObject_CallNoArgs(task->func);
+    if (y == NULL) {
+        PyErr_WriteUnraisable(task->func);
+    }
+    Py_XDECREF(y);
+    Py_DECREF(task->func);
+    PyThreadState_Clear(ts);
+    PyThreadState_DeleteCurrent();
+    free(task);
+    pthread_mutex_lock(&bn_pool_lock);
+    if (--bn_task_running == 0 && bn_task_head == NULL) {
+        pthread_cond_broadcast(&bn_task_idle);
+    }
+}
+
+static void *
+bn_pool_worker(void *arg)
+{
+    unsigned long seen;
+#ifdef __linux__
+    /* worker i runs on the i-th CPU the process may use; the calling
+       thread keeps the first */
+    if (bn_pool_pin) {
+        int i, k = 0, id = (int)(Py_intptr_t)arg;
+        cpu_set_t allowed, one;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            int ncpu = CPU_COUNT(&allowed);
+            id %= ncpu;
+            for (i = 0; i < CPU_SETSIZE; i++) {
+                if (CPU_ISSET(i, &allowed) && k++ == id) {
+                    CPU_ZERO(&one);
+                    CPU_SET(i, &one);
+                    sched_setaffinity(0, sizeof(one), &one);
+                    break;
+                }
+            }
+        }
+    }
+#endif
+    pthread_mutex_lock(&bn_pool_lock);
+    seen = bn_pool_job;
+    for (;;) {
+        while (bn_pool_job == seen && bn_task_head == NULL &&
+               !bn_pool_stopping) {
+            pthread_cond_wait(&bn_pool_work, &bn_pool_lock);
+        }
+        if (bn_pool_stopping) break;
+        if (bn_pool_job != seen) {
+            seen = bn_pool_job;
+            bn_pool_take_parts();
+        } else {
+            bn_task_run();
+        }
+    }
+    pthread_mutex_unlock(&bn_pool_lock);
+    return NULL;
+}
+
+/* call with bn_pool_busy held; starts a worker for each thread but the
+   calling one, and at least `least`; workers that cannot be started are
+   done without */
+static void
+bn_pool_start(int least)
+{
+    int n = (int)BN_LOAD(bn_pool_threads) - 1;
+    if (n < least) n = least;
+    while (bn_pool_started < n && bn_pool_started < BN_POOL_MAX) {
+        Py_intptr_t id = bn_pool_started + 1;
+        if (pthread_create(&bn_pool_workers[bn_pool_started], NULL,
+                           bn_pool_worker, (void *)id) != 0) {
+            break;
+        }
+        pthread_mutex_lock(&bn_pool_lock);
+        bn_pool_started++;
+        pthread_mutex_unlock(&bn_pool_lock);
+    }
+}
+
+/* is the calling thread one of the workers? */
+static int
+bn_pool_is_worker(void)
+{
+    int i;
+    for (i = 0; i < bn_pool_started; i++) {
+        if (pthread_equal(pthread_self(), bn_pool_workers[i])) return 1;
+    }
+    return 0;
+}
+
+/* call with bn_pool_busy held */
+static void
+bn_pool_stop(void)
+{
+    int i;
+    pthread_mutex_lock(&bn_pool_lock);
+    bn_pool_stopping = 1;
+    pthread_cond_broadcast(&bn_pool_work);
+    pthread_mutex_unlock(&bn_pool_lock);
+    for (i = 0; i < bn_pool_started; i++) {
+        pthread_join(bn_pool_workers[i], NULL);
+    }
+    pthread_mutex_lock(&bn_pool_lock);
+    bn_pool_started = 0;
+    bn_pool_stopping = 0;
+    pthread_mutex_unlock(&bn_pool_lock);
+}
+
+/* the child of a fork has none of the parent's workers, and the calls
+   they were to run never run */
+static void
+bn_pool_after_fork(void)
+{
+    pthread_mutex_init(&bn_pool_busy, NULL);
+    pthread_mutex_init(&bn_pool_lock, NULL);
+    pthread_cond_init(&bn_pool_work, NULL);
+    pthread_cond_init(&bn_pool_done, NULL);
+    pthread_cond_init(&bn_task_idle, NULL);
+    bn_pool_started = 0;
+    bn_pool_stopping = 0;
+    bn_task_head = NULL;
+    bn_task_tail = NULL;
+    bn_task_running = 0;
+}
+#endif
+
+static void
+bn_pool_run(bn_part_t fn, void *arg, int nparts)
+{
+    int part;
+#ifndef _WIN32
+    if (nparts > 1 && pthread_mutex_trylock(&bn_pool_busy) == 0) {
+        bn_pool_start(0);
+        if (bn_pool_started > 0) {
+            pthread_mutex_lock(&bn_pool_lock);
+            bn_pool_fn = fn;
+            bn_pool_arg = arg;
+            bn_pool_nparts = nparts;
+            bn_pool_next = 0;
+            bn_pool_finished = 0;
+            bn_pool_job++;
+            pthread_cond_broadcast(&bn_pool_work);
+            bn_pool_take_parts();
+            while (bn_pool_finished < nparts) {
+                pthread_cond_wait(&bn_pool_done, &bn_pool_lock);
+            }
+            pthread_mutex_unlock(&bn_pool_lock);
+            pthread_mutex_unlock(&bn_pool_busy);
+            return;
+        }
+        pthread_mutex_unlock(&bn_pool_busy);
+    }
+#endif
+    for (part = 0; part < nparts; part++) {
+        fn(arg, part, nparts);
+    }
+}
+
+/* _set_num_threads(n, pin) sets the thread count and pinning of the pool */
+static PyObject *
+set_num_threads(PyObject *self, PyObject *args)
+{
+    int n, pin;
+    if (!PyArg_ParseTuple(args, "ip", &n, &pin)) {
+        return NULL;
+    }
+    if (n < 1) n = 1;
+    if (n > BN_POOL_MAX + 1) n = BN_POOL_MAX + 1;
+#ifndef _WIN32
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&bn_pool_busy);
+    if ((pin != bn_pool_pin || (n > 1 ? n - 1 : 1) < bn_pool_started) &&
+        !bn_pool_is_worker()) {
+        /* workers are pinned when they start */
+        bn_pool_stop();
+    }
+    bn_pool_pin = pin;
+    BN_STORE(bn_pool_threads, n);
+    if (bn_pool_started == 0 && bn_task_head != NULL) {
+        /* queued calls that the stopped workers left */
+        bn_pool_start(1);
+    }
+    pthread_mutex_unlock(&bn_pool_busy);
+    Py_END_ALLOW_THREADS
+#else
+    BN_STORE(bn_pool_threads, n);
+#endif
+    Py_RETURN_NONE;
+}
+
+/* _submit(func) queues the call func() to run on a worker of the pool and
+   returns at once; without pthreads it calls func() */
+static PyObject *
+submit(PyObject *self, PyObject *func)
+{
+#ifndef _WIN32
+    int started;
+    bn_task *task = malloc(sizeof(bn_task));
+    if (task == NULL) {
+        return PyErr_NoMemory();
+    }
+    Py_INCREF(func);
+    task->func = func;
+    task->interp = PyInterpreterState_Get();
+    task->next = NULL;
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&bn_pool_lock);
+    if (bn_task_tail == NULL) {
+        bn_task_head = task;
+    } else {
+        bn_task_tail->next = task;
+    }
+    bn_task_tail = task;
+    pthread_cond_signal(&bn_pool_work);
+    started = bn_pool_started;
+    pthread_mutex_unlock(&bn_pool_lock);
+    if (started == 0) {
+        /* workers that stop from now on are restarted by set_num_threads,
+           which sees the call in the queue */
+        pthread_mutex_lock(&bn_pool_busy);
+        bn_pool_start(1);
+        pthread_mutex_unlock(&bn_pool_busy);
+    } else if (started < BN_LOAD(bn_pool_threads) - 1 &&
+               pthread_mutex_trylock(&bn_pool_busy) == 0) {
+        /* the thread count went up; a kernel that holds the pool starts
+           the new workers itself */
+        bn_pool_start(1);
+        pthread_mutex_unlock(&bn_pool_busy);
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+#else
+    return PyObject_CallNoArgs(func);
+#endif
+}
+
+/* _submit_wait() waits until the calls queued by _submit are done */
+static PyObject *
+submit_wait(PyObject *self, PyObject *args)
+{
+#ifndef _WIN32
+    Py_BEGIN_ALLOW_THREADS
+    pthread_mutex_lock(&bn_pool_lock);
+    while (bn_task_head != NULL || bn_task_running > 0) {
+        pthread_cond_wait(&bn_task_idle, &bn_pool_lock);
+    }
+    pthread_mutex_unlock(&bn_pool_lock);
+    Py_END_ALLOW_THREADS
+#endif
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef
+pool_methods[] = {
+    {"_set_num_threads", (PyCFunction)set_num_threads, METH_VARARGS, NULL},
+    {"_submit", (PyCFunction)submit, METH_O, NULL},
+    {"_submit_wait", (PyCFunction)submit_wait, METH_NOARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static const bn_pool_api pool_api = {&bn_pool_threads, bn_pool_run};
+
+#ifndef _WIN32
+static int bn_pool_forks = -1;
+
+static void
+bn_pool_register_fork(void)
+{
+    bn_pool_forks = pthread_atfork(NULL, NULL, bn_pool_after_fork);
+}
+
+static pthread_once_t bn_pool_fork_once = PTHREAD_ONCE_INIT;
+#endif
+
+static int
+pool_exec(PyObject *m)
+{
+    PyObject *capsule;
+#ifndef _WIN32
+    /* the fork handler is registered once however many interpreters
+       import the module */
+    pthread_once(&bn_pool_fork_once, bn_pool_register_fork);
+    if (bn_pool_forks != 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "Could not register the thread pool fork handler");
+        return -1;
+    }
+#endif
+    capsule = PyCapsule_New((void *)&pool_api, BN_POOL_CAPSULE, NULL);
+    if (capsule == NULL) {
+        return -1;
+    }
+    if (PyModule_AddObject(m, "_C_API", capsule) < 0) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+pool_slots[] = {
+    {Py_mod_exec, (void *)pool_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL}
+};
+
+static struct PyModuleDef
+pool_def = {
+   PyModuleDef_HEAD_INIT,
+   "_pool",
+   "The thread pool of the parallel functions.",
+   0,
+   pool_methods,
+   pool_slots,
+   NULL,
+   NULL,
+   NULL
+};
+
+
+PyMODINIT_FUNC
+PyInit__pool(void)
+{
+    return PyModuleDef_Init(&pool_def);
+}
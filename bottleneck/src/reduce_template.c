@@ -2,34 +2,50 @@
 // Copyright 2019 Bottleneck Developers
 #include "bottleneck.h"
 #include "iterators.h"
+#include "introselect/introselect.h"
 
 /* init macros ----------------------------------------------------------- */
 
 #define INIT_ALL \
     iter it; \
-    init_iter_all(&it, a, 0, 1);
+    init_iter_all(&it, a, 1);
 
-#define INIT_ALL_RAVEL \
+/* walks `a` in C order; see nanargmin */
+#define INIT_ALL_C_ORDER \
     iter it; \
-    init_iter_all(&it, a, 1, 0);
-
-#define INIT_ALL_RAVEL_ANY_ORDER \
-    iter it; \
-    init_iter_all(&it, a, 1, 1);
-
-/* used with INIT_ALL_RAVEL */
-#define DECREF_INIT_ALL_RAVEL \
-    if (it.a_ravel != NULL) { \
-        Py_DECREF(it.a_ravel); \
-    }
+    init_iter_all(&it, a, 0);
 
 #define INIT_ONE(dtype0, dtype1) \
     iter it; \
     PyObject *y; \
-    npy_##dtype1 *py; \
+    bn_##dtype1 *py; \
     init_iter_one(&it, a, axis); \
     y = PyArray_EMPTY(NDIM - 1, SHAPE, NPY_##dtype0, 0); \
-    py = (npy_##dtype1 *)PyArray_DATA((PyArrayObject *)y);
+    py = (bn_##dtype1 *)PyArray_DATA((PyArrayObject *)y);
+
+/* output with the dtype of `a`, including the unit of datetime64 input */
+#define INIT_ONE_LIKE(dtype) \
+    iter it; \
+    PyObject *y; \
+    bn_##dtype *py; \
+    init_iter_one(&it, a, axis); \
+    Py_INCREF(PyArray_DESCR(a)); \
+    y = PyArray_Empty(NDIM - 1, SHAPE, PyArray_DESCR(a), 0); \
+    py = (bn_##dtype *)PyArray_DATA((PyArrayObject *)y);
+
+/* `a` and the bool array `m` given as `where` have the same shape and are
+   walked together along `axis` */
+#define INIT_M \
+    iter2 it; \
+    init_iter2(&it, a, (PyObject *)m, axis);
+
+#define INIT_M_ONE(dtype0, dtype1) \
+    INIT_M \
+    PyObject *y = PyArray_EMPTY(NDIM - 1, SHAPE, NPY_##dtype0, 0); \
+    bn_##dtype1 *py = (bn_##dtype1 *)PyArray_DATA((PyArrayObject *)y);
+
+/* true if AI is included by `where` */
+#define MI *(npy_bool *)(it.py + it.i * it.ystride)
 
 /* function signatures --------------------------------------------------- */
 
@@ -43,49 +59,185 @@
     static PyObject * \
     name##_one_##dtype(PyArrayObject *a, int axis, int ddof)
 
-/* top-level functions such as nansum */
-#define REDUCE_MAIN(name, has_ddof) \
+/* the `flags` of a reducer: the argument it takes after `a` and `axis`, if
+   any, which its low-level functions get as ddof */
+#define BN_ARG_DDOF   1    /* `ddof`, an integer */
+#define BN_ARG_APPROX 2    /* `approx` of median and nanmedian, a bool */
+#define BN_ARGS (BN_ARG_DDOF | BN_ARG_APPROX)
+
+/* and a property of the reducer: it needs all of the input at once, so
+   input that has to be converted is not reduced a block at a time */
+#define BN_WHOLE_INPUT 4
+
+/* top-level functions such as nansum; the dispatch tables such as
+   nansum_fall are at file scope so that batch can use them */
+#define REDUCE_MAIN(name, flags) \
+    REDUCE_MAIN_TABLE(name, flags, BN_DTYPE_TABLE)
+
+/* top-level functions that also take datetime64 and timedelta64 */
+#define REDUCE_MAIN_DATETIME(name, flags) \
+    REDUCE_MAIN_TABLE(name, flags, BN_DATETIME_TABLE)
+
+/* `table` is BN_DTYPE_TABLE or BN_DATETIME_TABLE */
+#define REDUCE_MAIN_TABLE(name, flags, table) \
+    static const fall_t name##_fall[BN_NDTYPES] = table(name##_all_); \
+    static const fone_t name##_fone[BN_NDTYPES] = table(name##_one_); \
+    static PyObject * \
+    name(PyObject *self, PyObject *args, PyObject *kwds) \
+    { \
+        return reducer(self, #name, args, kwds, name##_fall, name##_fone, \
+                       NULL, NULL, flags); \
+    }
+
+/* low-level functions such as nansum_mall_float64 that skip the elements
+   that `where` excludes; the functions that reduce over all axes iterate
+   along `axis` */
+#define MREDUCE_ALL(name, dtype) \
+    static PyObject * \
+    name##_mall_##dtype(PyArrayObject *a, PyArrayObject *m, int axis, \
+                        int ddof)
+
+/* low-level functions such as nansum_mone_float64 */
+#define MREDUCE_ONE(name, dtype) \
+    static PyObject * \
+    name##_mone_##dtype(PyArrayObject *a, PyArrayObject *m, int axis, \
+                        int ddof)
+
+/* top-level functions such as nansum that also take `where`; `table` is
+   BN_DTYPE_TABLE or BN_DATETIME_TABLE */
+#define REDUCE_MAIN_WHERE(name, flags, table) \
+    static const fall_t name##_fall[BN_NDTYPES] = table(name##_all_); \
+    static const fone_t name##_fone[BN_NDTYPES] = table(name##_one_); \
+    static PyObject * \
+    name(PyObject *self, PyObject *args, PyObject *kwds) \
+    { \
+        static const fm_t mall[BN_NDTYPES] = BN_DTYPE_TABLE(name##_mall_); \
+        static const fm_t mone[BN_NDTYPES] = BN_DTYPE_TABLE(name##_mone_); \
+        return reducer(self, #name, args, kwds, name##_fall, name##_fone, \
+                       mall, mone, flags); \
+    }
+
+/* low-level functions such as nanwmean_all_float64 that take weights; the
+   functions that reduce over all axes iterate along `axis` */
+#define WREDUCE_ALL(name, dtype) \
+    static PyObject * \
+    name##_all_##dtype(PyArrayObject *a, PyArrayObject *w, int axis, \
+                       int ddof, int reliability)
+
+/* low-level functions such as nanwmean_one_float64 */
+#define WREDUCE_ONE(name, dtype) \
+    static PyObject * \
+    name##_one_##dtype(PyArrayObject *a, PyArrayObject *w, int axis, \
+                       int ddof, int reliability)
+
+/* top-level functions such as nanwmean */
+#define WREDUCE_MAIN(name, has_ddof) \
+    static PyObject * \
+    name(PyObject *self, PyObject *args, PyObject *kwds) \
+    { \
+        static const fw_t fall[BN_NDTYPES] = BN_DTYPE_TABLE(name##_all_); \
+        static const fw_t fone[BN_NDTYPES] = BN_DTYPE_TABLE(name##_one_); \
+        return weighter(self, #name, args, kwds, fall, fone, has_ddof); \
+    }
+
+/* the parts of segment functions, such as segment_nansum_part_float64 */
+#define SEGMENT_PART(name, dtype) \
+    static void \
+    name##_part_##dtype(void *arg, int part, int nparts)
+
+/* low-level functions such as segment_nansum_float64, with output of type
+   `out`, a buffer of `itemsize` bytes per element of the longest segment
+   for each part, and `err`, if not NULL, the format of the error raised
+   for the first segment whose part gave up on it */
+#define SEGMENT(name, dtype, out, itemsize, err) \
+    static PyObject * \
+    name##_##dtype(PyArrayObject *a, \
+                   const npy_intp *offsets, \
+                   npy_intp nseg, \
+                   int axis, \
+                   int ddof) \
+    { \
+        return segment_run(a, offsets, nseg, axis, ddof, NPY_##out, \
+                           name##_part_##dtype, itemsize, #name, err); \
+    }
+
+/* top-level functions such as segment_nansum */
+#define SEGMENT_MAIN(name, has_ddof) \
     static PyObject * \
     name(PyObject *self, PyObject *args, PyObject *kwds) \
     { \
-        return reducer(#name, \
-                       args, \
-                       kwds, \
-                       name##_all_float64, \
-                       name##_all_float32, \
-                       name##_all_int64, \
-                       name##_all_int32, \
-                       name##_one_float64, \
-                       name##_one_float32, \
-                       name##_one_int64, \
-                       name##_one_int32, \
-                       has_ddof); \
+        static const fseg_t fseg[BN_NDTYPES] = BN_DTYPE_TABLE(name##_); \
+        return segmenter(self, #name, args, kwds, fseg, has_ddof); \
     }
 
 /* typedefs and prototypes ----------------------------------------------- */
 
 typedef PyObject *(*fall_t)(PyArrayObject *a, int ddof);
 typedef PyObject *(*fone_t)(PyArrayObject *a, int axis, int ddof);
+typedef PyObject *(*fquant_t)(PyArrayObject *a,
+                              int axis,
+                              PyObject *y,
+                              const npy_float64 *q,
+                              const npy_intp *qpos,
+                              npy_intp nq,
+                              int method);
+typedef PyObject *(*fm_t)(PyArrayObject *a,
+                          PyArrayObject *m,
+                          int axis,
+                          int ddof);
+typedef PyObject *(*fw_t)(PyArrayObject *a,
+                          PyArrayObject *w,
+                          int axis,
+                          int ddof,
+                          int reliability);
+typedef PyObject *(*fseg_t)(PyArrayObject *a,
+                            const npy_intp *offsets,
+                            npy_intp nseg,
+                            int axis,
+                            int ddof);
 
 static PyObject *
-reducer(char *name,
+reducer(PyObject *self,
+        char *name,
         PyObject *args,
         PyObject *kwds,
-        fall_t fall_float64,
-        fall_t fall_float32,
-        fall_t fall_int64,
-        fall_t fall_int32,
-        fone_t fone_float64,
-        fone_t fone_float32,
-        fone_t fone_int64,
-        fone_t fone_int32,
-        int has_ddof);
+        const fall_t *fall,
+        const fone_t *fone,
+        const fm_t *mall,
+        const fm_t *mone,
+        int flags);
+
+static PyObject *
+weighter(PyObject *self,
+         char *name,
+         PyObject *args,
+         PyObject *kwds,
+         const fw_t *fall,
+         const fw_t *fone,
+         int has_ddof);
+
+static PyObject *
+quantiler(PyObject *self,
+          char *name,
+          PyObject *args,
+          PyObject *kwds,
+          const fquant_t *fquant_table,
+          int percent);
+
+static PyObject *
+segmenter(PyObject *self,
+          char *name,
+          PyObject *args,
+          PyObject *kwds,
+          const fseg_t *fseg,
+          int has_ddof);
 
 /* nansum ---------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 REDUCE_ALL(nansum, DTYPE0) {
-    npy_DTYPE0 ai, asum = 0;
+    bn_DTYPE1 ai, asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -100,11 +252,27 @@ REDUCE_ALL(nansum, DTYPE0) {
 }
 
 REDUCE_ONE(nansum, DTYPE0) {
-    npy_DTYPE0 ai, asum;
+    bn_DTYPE1 ai, asum;
     INIT_ONE(DTYPE0, DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(0)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai == ai) acc[t] += ai;
+                    }
+                }
+                FOR_T YPP = acc[t];
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
@@ -119,11 +287,45 @@ REDUCE_ONE(nansum, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
+
+MREDUCE_ALL(nansum, DTYPE0) {
+    bn_DTYPE1 ai, asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) asum += ai;
+        }
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(asum);
+}
+
+MREDUCE_ONE(nansum, DTYPE0) {
+    bn_DTYPE1 ai, asum;
+    INIT_M_ONE(DTYPE0, DTYPE0)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        asum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) asum += ai;
+        }
+        YPP = asum;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 /* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
+/* dtype = [['int64', 'int64'], ['int32', 'int32'], ['int16', 'int64'],
+            ['int8', 'int64'], ['uint64', 'uint64'], ['uint32', 'uint64'],
+            ['uint16', 'uint64'], ['uint8', 'uint64'], ['bool', 'int64']] */
 REDUCE_ALL(nansum, DTYPE0) {
-    npy_DTYPE0 asum = 0;
+    bn_DTYPE1 asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -131,15 +333,28 @@ REDUCE_ALL(nansum, DTYPE0) {
         NEXT
     }
     BN_END_ALLOW_THREADS
-    return PyLong_FromLongLong(asum);
+    return PyLong_From_DTYPE1(asum);
 }
 
 REDUCE_ONE(nansum, DTYPE0) {
-    npy_DTYPE0 asum;
-    INIT_ONE(DTYPE0, DTYPE0)
+    bn_DTYPE1 asum;
+    INIT_ONE(DTYPE1, DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(0)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T acc[t] += AT(DTYPE0);
+                }
+                FOR_T YPP = acc[t];
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
@@ -151,17 +366,48 @@ REDUCE_ONE(nansum, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
+
+MREDUCE_ALL(nansum, DTYPE0) {
+    bn_DTYPE1 asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            if (MI) asum += AI(DTYPE0);
+        }
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return PyLong_From_DTYPE1(asum);
+}
+
+MREDUCE_ONE(nansum, DTYPE0) {
+    bn_DTYPE1 asum;
+    INIT_M_ONE(DTYPE1, DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        asum = 0;
+        FOR {
+            if (MI) asum += AI(DTYPE0);
+        }
+        YPP = asum;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 /* dtype end */
 
-REDUCE_MAIN(nansum, 0)
+REDUCE_MAIN_WHERE(nansum, 0, BN_DTYPE_TABLE)
 
 
 /* nanmean ---------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 REDUCE_ALL(nanmean, DTYPE0) {
     Py_ssize_t count = 0;
-    npy_DTYPE0 ai, asum = 0;
+    bn_DTYPE1 ai, asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -184,11 +430,38 @@ REDUCE_ALL(nanmean, DTYPE0) {
 
 REDUCE_ONE(nanmean, DTYPE0) {
     Py_ssize_t count;
-    npy_DTYPE0 ai, asum;
+    bn_DTYPE1 ai, asum;
     INIT_ONE(DTYPE0, DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(BN_NAN)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        Py_ssize_t nans[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = 0;
+                    nans[t] = 0;
+                }
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai == ai) {
+                            acc[t] += ai;
+                        } else {
+                            nans[t]++;
+                        }
+                    }
+                }
+                FOR_T {
+                    count = LENGTH - nans[t];
+                    YPP = count > 0 ? acc[t] / count : BN_NAN;
+                }
+            }
+            NEXT
+        }
     } else {
         WHILE {
             count = 0;
@@ -212,12 +485,56 @@ REDUCE_ONE(nanmean, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
+
+MREDUCE_ALL(nanmean, DTYPE0) {
+    Py_ssize_t count = 0;
+    bn_DTYPE1 ai, asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) {
+                asum += ai;
+                count += 1;
+            }
+        }
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(count > 0 ? asum / count : BN_NAN);
+}
+
+MREDUCE_ONE(nanmean, DTYPE0) {
+    Py_ssize_t count;
+    bn_DTYPE1 ai, asum;
+    INIT_M_ONE(DTYPE0, DTYPE0)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        count = 0;
+        asum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) {
+                asum += ai;
+                count += 1;
+            }
+        }
+        YPP = count > 0 ? asum / count : BN_NAN;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 REDUCE_ALL(nanmean, DTYPE0) {
     Py_ssize_t total_length = 0;
-    npy_DTYPE1 asum = 0;
+    bn_DTYPE1 asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -234,11 +551,24 @@ REDUCE_ALL(nanmean, DTYPE0) {
 }
 
 REDUCE_ONE(nanmean, DTYPE0) {
-    npy_DTYPE1 asum;
+    bn_DTYPE1 asum;
     INIT_ONE(DTYPE1, DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(BN_NAN)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T acc[t] += AT(DTYPE0);
+                }
+                FOR_T YPP = acc[t] / LENGTH;
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
@@ -255,19 +585,59 @@ REDUCE_ONE(nanmean, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
+
+MREDUCE_ALL(nanmean, DTYPE0) {
+    Py_ssize_t count = 0;
+    bn_DTYPE1 asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            if (MI) {
+                asum += AI(DTYPE0);
+                count += 1;
+            }
+        }
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(count > 0 ? asum / count : BN_NAN);
+}
+
+MREDUCE_ONE(nanmean, DTYPE0) {
+    Py_ssize_t count;
+    bn_DTYPE1 asum;
+    INIT_M_ONE(DTYPE1, DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        count = 0;
+        asum = 0;
+        FOR {
+            if (MI) {
+                asum += AI(DTYPE0);
+                count += 1;
+            }
+        }
+        YPP = count > 0 ? asum / count : BN_NAN;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 /* dtype end */
 
-REDUCE_MAIN(nanmean, 0)
+REDUCE_MAIN_WHERE(nanmean, 0, BN_DTYPE_TABLE)
 
 
 /* nanstd, nanvar- ------------------------------------------------------- */
 
 /* repeat = {'NAME': ['nanstd', 'nanvar'],
              'FUNC': ['sqrt',   '']} */
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 REDUCE_ALL(NAME, DTYPE0) {
     Py_ssize_t count = 0;
-    npy_DTYPE0 ai, amean, out, asum = 0;
+    bn_DTYPE1 ai, amean, out, asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -304,11 +674,56 @@ REDUCE_ALL(NAME, DTYPE0) {
 
 REDUCE_ONE(NAME, DTYPE0) {
     Py_ssize_t count;
-    npy_DTYPE0 ai, asum, amean;
+    bn_DTYPE1 ai, asum, amean;
     INIT_ONE(DTYPE0, DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(BN_NAN)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE], mean[BN_TILE];
+        Py_ssize_t cnt[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = 0;
+                    cnt[t] = 0;
+                }
+                /* cnt counts the NaNs first, which are rare */
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai == ai) {
+                            acc[t] += ai;
+                        } else {
+                            cnt[t]++;
+                        }
+                    }
+                }
+                FOR_T {
+                    cnt[t] = LENGTH - cnt[t];
+                    mean[t] = cnt[t] > 0 ? acc[t] / cnt[t] : 0;
+                    acc[t] = 0;
+                }
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai == ai) {
+                            ai -= mean[t];
+                            acc[t] += ai * ai;
+                        }
+                    }
+                }
+                FOR_T {
+                    if (cnt[t] > ddof) {
+                        YPP = FUNC(acc[t] / (cnt[t] - ddof));
+                    } else {
+                        YPP = BN_NAN;
+                    }
+                }
+            }
+            NEXT
+        }
     } else {
         WHILE {
             count = 0;
@@ -341,13 +756,89 @@ REDUCE_ONE(NAME, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
+
+MREDUCE_ALL(NAME, DTYPE0) {
+    Py_ssize_t count = 0;
+    bn_DTYPE1 ai, amean, out, asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) {
+                asum += ai;
+                count++;
+            }
+        }
+        NEXT2
+    }
+    if (count > ddof) {
+        amean = asum / count;
+        asum = 0;
+        RESET
+        WHILE {
+            FOR {
+                ai = AI(DTYPE0);
+                if (MI && ai == ai) {
+                    ai -= amean;
+                    asum += ai * ai;
+                }
+            }
+            NEXT2
+        }
+        out = FUNC(asum / (count - ddof));
+    } else {
+        out = BN_NAN;
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(out);
+}
+
+MREDUCE_ONE(NAME, DTYPE0) {
+    Py_ssize_t count;
+    bn_DTYPE1 ai, asum, amean;
+    INIT_M_ONE(DTYPE0, DTYPE0)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        count = 0;
+        asum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai == ai) {
+                asum += ai;
+                count++;
+            }
+        }
+        if (count > ddof) {
+            amean = asum / count;
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (MI && ai == ai) {
+                    ai -= amean;
+                    asum += ai * ai;
+                }
+            }
+            asum = FUNC(asum / (count - ddof));
+        } else {
+            asum = BN_NAN;
+        }
+        YPP = asum;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 /* dtype end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
 REDUCE_ALL(NAME, DTYPE0) {
-    npy_DTYPE1 out;
+    bn_DTYPE1 out;
     Py_ssize_t size = 0;
-    npy_DTYPE1 ai, amean, asum = 0;
+    bn_DTYPE1 ai, amean, asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -375,13 +866,36 @@ REDUCE_ALL(NAME, DTYPE0) {
 }
 
 REDUCE_ONE(NAME, DTYPE0) {
-    npy_DTYPE1 ai, asum, amean, length_inv, length_ddof_inv;
+    bn_DTYPE1 ai, asum, amean, length_inv, length_ddof_inv;
     INIT_ONE(DTYPE1, DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     length_inv = 1.0 / LENGTH;
     length_ddof_inv = 1.0 / (LENGTH - ddof);
     if (LENGTH == 0) {
         FILL_Y(BN_NAN)
+    } else if (LENGTH > ddof && tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE], mean[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T acc[t] += AT(DTYPE0);
+                }
+                FOR_T {
+                    mean[t] = acc[t] * length_inv;
+                    acc[t] = 0;
+                }
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0) - mean[t];
+                        acc[t] += ai * ai;
+                    }
+                }
+                FOR_T YPP = FUNC(acc[t] * length_ddof_inv);
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
@@ -404,23 +918,93 @@ REDUCE_ONE(NAME, DTYPE0) {
     BN_END_ALLOW_THREADS
     return y;
 }
-/* dtype end */
-
-REDUCE_MAIN(NAME, 1)
-/* repeat end */
-
-
-/* nanmin, nanmax -------------------------------------------------------- */
 
-/* repeat = {'NAME':      ['nanmin',         'nanmax'],
-             'COMPARE':   ['<=',             '>='],
-             'BIG_FLOAT': ['BN_INFINITY',    '-BN_INFINITY'],
-             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0']} */
-/* dtype = [['float64'], ['float32']] */
-REDUCE_ALL(NAME, DTYPE0) {
-    npy_DTYPE0 ai, extreme = BIG_FLOAT;
-    int allnan = 1;
-    INIT_ALL
+MREDUCE_ALL(NAME, DTYPE0) {
+    Py_ssize_t count = 0;
+    bn_DTYPE1 ai, amean, out, asum = 0;
+    INIT_M
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            if (MI) {
+                asum += AI(DTYPE0);
+                count++;
+            }
+        }
+        NEXT2
+    }
+    if (count > ddof) {
+        amean = asum / count;
+        asum = 0;
+        RESET
+        WHILE {
+            FOR {
+                if (MI) {
+                    ai = AI(DTYPE0) - amean;
+                    asum += ai * ai;
+                }
+            }
+            NEXT2
+        }
+        out = FUNC(asum / (count - ddof));
+    } else {
+        out = BN_NAN;
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(out);
+}
+
+MREDUCE_ONE(NAME, DTYPE0) {
+    Py_ssize_t count;
+    bn_DTYPE1 ai, asum, amean;
+    INIT_M_ONE(DTYPE1, DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        count = 0;
+        asum = 0;
+        FOR {
+            if (MI) {
+                asum += AI(DTYPE0);
+                count++;
+            }
+        }
+        if (count > ddof) {
+            amean = asum / count;
+            asum = 0;
+            FOR {
+                if (MI) {
+                    ai = AI(DTYPE0) - amean;
+                    asum += ai * ai;
+                }
+            }
+            asum = FUNC(asum / (count - ddof));
+        } else {
+            asum = BN_NAN;
+        }
+        YPP = asum;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+REDUCE_MAIN_WHERE(NAME, BN_ARG_DDOF, BN_DTYPE_TABLE)
+/* repeat end */
+
+
+/* nanmin, nanmax -------------------------------------------------------- */
+
+/* repeat = {'NAME':      ['nanmin',         'nanmax'],
+             'COMPARE':   ['<=',             '>='],
+             'BIG_FLOAT': ['BN_INFINITY',    '-BN_INFINITY'],
+             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0'],
+             'BIG_TIME':  ['NPY_MAX_INT64',  'NPY_MIN_INT64']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+REDUCE_ALL(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme = BIG_FLOAT;
+    int allnan = 1;
+    INIT_ALL
     if (SIZE == 0) {
         VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
                   "So Bottleneck too.");
@@ -443,7 +1027,7 @@ REDUCE_ALL(NAME, DTYPE0) {
 }
 
 REDUCE_ONE(NAME, DTYPE0) {
-    npy_DTYPE0 ai, extreme;
+    bn_DTYPE0 ai, extreme;
     int allnan;
     INIT_ONE(DTYPE0, DTYPE0)
     if (LENGTH == 0) {
@@ -452,28 +1036,108 @@ REDUCE_ONE(NAME, DTYPE0) {
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        char empty[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = BIG_FLOAT;
+                    empty[t] = 1;
+                }
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t]) {
+                            acc[t] = ai;
+                            empty[t] = 0;
+                        }
+                    }
+                }
+                FOR_T YPP = empty[t] ? BN_NAN : acc[t];
+            }
+            NEXT
+        }
+    } else {
+        WHILE {
+            extreme = BIG_FLOAT;
+            allnan = 1;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    allnan = 0;
+                }
+            }
+            if (allnan) extreme = BN_NAN;
+            YPP = extreme;
+            NEXT
+        }
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+
+MREDUCE_ALL(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme = BIG_FLOAT;
+    int allnan = 1;
+    INIT_M
+    if (SIZE == 0) {
+        VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (MI && ai COMPARE extreme) {
+                extreme = ai;
+                allnan = 0;
+            }
+        }
+        NEXT2
+    }
+    if (allnan) extreme = BN_NAN;
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(extreme);
+}
+
+MREDUCE_ONE(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme;
+    int allnan;
+    INIT_M_ONE(DTYPE0, DTYPE0)
+    if (LENGTH == 0) {
+        Py_DECREF(y);
+        VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
     WHILE {
         extreme = BIG_FLOAT;
         allnan = 1;
         FOR {
             ai = AI(DTYPE0);
-            if (ai COMPARE extreme) {
+            if (MI && ai COMPARE extreme) {
                 extreme = ai;
                 allnan = 0;
             }
         }
         if (allnan) extreme = BN_NAN;
         YPP = extreme;
-        NEXT
+        NEXT2
     }
     BN_END_ALLOW_THREADS
     return y;
 }
 /* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
 REDUCE_ALL(NAME, DTYPE0) {
-    npy_DTYPE0 ai, extreme = BIG_INT;
+    bn_DTYPE0 ai, extreme = BIG_INT;
     INIT_ALL
     if (SIZE == 0) {
         VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
@@ -489,11 +1153,11 @@ REDUCE_ALL(NAME, DTYPE0) {
         NEXT
     }
     BN_END_ALLOW_THREADS
-    return PyLong_FromLongLong(extreme);
+    return PyLong_From_DTYPE0(extreme);
 }
 
 REDUCE_ONE(NAME, DTYPE0) {
-    npy_DTYPE0 ai, extreme;
+    bn_DTYPE0 ai, extreme;
     INIT_ONE(DTYPE0, DTYPE0)
     if (LENGTH == 0) {
         VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
@@ -501,53 +1165,232 @@ REDUCE_ONE(NAME, DTYPE0) {
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = BIG_INT;
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t]) acc[t] = ai;
+                    }
+                }
+                FOR_T YPP = acc[t];
+            }
+            NEXT
+        }
+    } else {
+        WHILE {
+            extreme = BIG_INT;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) extreme = ai;
+            }
+            YPP = extreme;
+            NEXT
+        }
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+
+/* integers have no NaN to return for a slice without elements */
+MREDUCE_ALL(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme = BIG_INT;
+    int empty = 1;
+    INIT_M
+    if (SIZE == 0) {
+        VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            if (MI) {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) extreme = ai;
+                empty = 0;
+            }
+        }
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    if (empty) {
+        VALUE_ERR("`where` must include an element of integer input");
+        return NULL;
+    }
+    return PyLong_From_DTYPE0(extreme);
+}
+
+MREDUCE_ONE(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme;
+    int empty, any_empty = 0;
+    INIT_M_ONE(DTYPE0, DTYPE0)
+    if (LENGTH == 0) {
+        Py_DECREF(y);
+        VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
     WHILE {
         extreme = BIG_INT;
+        empty = 1;
         FOR {
-            ai = AI(DTYPE0);
-            if (ai COMPARE extreme) extreme = ai;
+            if (MI) {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) extreme = ai;
+                empty = 0;
+            }
         }
+        any_empty |= empty;
         YPP = extreme;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    if (any_empty) {
+        Py_DECREF(y);
+        VALUE_ERR("`where` must include an element of each slice of "
+                  "integer input");
+        return NULL;
+    }
+    return y;
+}
+/* dtype end */
+
+/* datetime64 and timedelta64; NaT is missing */
+/* dtype = [['datetime']] */
+REDUCE_ALL(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme = BIG_TIME;
+    int allnat = 1;
+    INIT_ALL
+    if (SIZE == 0) {
+        VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai COMPARE extreme && ai != NPY_DATETIME_NAT) {
+                extreme = ai;
+                allnat = 0;
+            }
+        }
         NEXT
     }
+    if (allnat) extreme = NPY_DATETIME_NAT;
+    BN_END_ALLOW_THREADS
+    return PyArray_Scalar(&extreme, PyArray_DESCR(a), NULL);
+}
+
+REDUCE_ONE(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme;
+    int allnat;
+    INIT_ONE_LIKE(DTYPE0)
+    if (LENGTH == 0) {
+        VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        char empty[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = BIG_TIME;
+                    empty[t] = 1;
+                }
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t] && ai != NPY_DATETIME_NAT) {
+                            acc[t] = ai;
+                            empty[t] = 0;
+                        }
+                    }
+                }
+                FOR_T YPP = empty[t] ? NPY_DATETIME_NAT : acc[t];
+            }
+            NEXT
+        }
+    } else {
+        WHILE {
+            extreme = BIG_TIME;
+            allnat = 1;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme && ai != NPY_DATETIME_NAT) {
+                    extreme = ai;
+                    allnat = 0;
+                }
+            }
+            if (allnat) extreme = NPY_DATETIME_NAT;
+            YPP = extreme;
+            NEXT
+        }
+    }
     BN_END_ALLOW_THREADS
     return y;
 }
 /* dtype end */
 
-REDUCE_MAIN(NAME, 0)
+REDUCE_MAIN_WHERE(NAME, 0, BN_DATETIME_TABLE)
 /* repeat end */
 
 
 /* nanargmin, nanargmax -------------------------------------------------- */
 
+/*
+ With axis=None the C order runs of `a` are walked without a copy. Each run
+ is scanned backwards with COMPARE, which finds the first of its extremes,
+ and replaces the extreme so far only if STRICT, so that ties resolve to the
+ smallest flat index.
+*/
+
 /* repeat = {'NAME':      ['nanargmin',      'nanargmax'],
              'COMPARE':   ['<=',             '>='],
+             'STRICT':    ['<',              '>'],
              'BIG_FLOAT': ['BN_INFINITY',    '-BN_INFINITY'],
-             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0']} */
-/* dtype = [['float64'], ['float32']] */
+             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0'],
+             'BIG_TIME':  ['NPY_MAX_INT64',  'NPY_MIN_INT64']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
 REDUCE_ALL(NAME, DTYPE0) {
-    npy_DTYPE0 ai, extreme = BIG_FLOAT;
+    bn_DTYPE0 ai, run, extreme = BIG_FLOAT;
     int allnan = 1;
-    Py_ssize_t idx = 0;
-    INIT_ALL_RAVEL
+    Py_ssize_t idx = 0, j;
+    INIT_ALL_C_ORDER
     if (SIZE == 0) {
-        DECREF_INIT_ALL_RAVEL
         VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
                   "So Bottleneck too.");
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
-    FOR_REVERSE {
-        ai = AI(DTYPE0);
-        if (ai COMPARE extreme) {
-            extreme = ai;
+    WHILE {
+        run = BIG_FLOAT;
+        j = -1;
+        FOR_REVERSE {
+            ai = AI(DTYPE0);
+            if (ai COMPARE run) {
+                run = ai;
+                j = INDEX;
+            }
+        }
+        if (j >= 0 && (allnan || run STRICT extreme)) {
+            extreme = run;
             allnan = 0;
-            idx = INDEX;
+            idx = it.its * LENGTH + j;
         }
+        NEXT
     }
     BN_END_ALLOW_THREADS
-    DECREF_INIT_ALL_RAVEL
     if (allnan) {
         VALUE_ERR("All-NaN slice encountered");
         return NULL;
@@ -559,7 +1402,7 @@ REDUCE_ALL(NAME, DTYPE0) {
 REDUCE_ONE(NAME, DTYPE0) {
     int allnan, err_code = 0;
     Py_ssize_t idx = 0;
-    npy_DTYPE0 ai, extreme;
+    bn_DTYPE0 ai, extreme;
     INIT_ONE(INTP, intp)
     if (LENGTH == 0) {
         VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
@@ -567,23 +1410,51 @@ REDUCE_ONE(NAME, DTYPE0) {
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
-    WHILE {
-        extreme = BIG_FLOAT;
-        allnan = 1;
-        FOR_REVERSE {
-            ai = AI(DTYPE0);
-            if (ai COMPARE extreme) {
-                extreme = ai;
-                allnan = 0;
-                idx = INDEX;
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        npy_intp at[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = BIG_FLOAT;
+                    at[t] = -1;
+                }
+                FOR_REVERSE {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t]) {
+                            acc[t] = ai;
+                            at[t] = INDEX;
+                        }
+                    }
+                }
+                FOR_T {
+                    if (at[t] < 0) err_code = 1;
+                    YPP = at[t];
+                }
             }
+            NEXT
         }
-        if (allnan == 0) {
-            YPP = idx;
-        } else {
-            err_code = 1;
+    } else {
+        WHILE {
+            extreme = BIG_FLOAT;
+            allnan = 1;
+            FOR_REVERSE {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    allnan = 0;
+                    idx = INDEX;
+                }
+            }
+            if (allnan == 0) {
+                YPP = idx;
+            } else {
+                err_code = 1;
+            }
+            NEXT
         }
-        NEXT
     }
     BN_END_ALLOW_THREADS
     if (err_code) {
@@ -594,33 +1465,41 @@ REDUCE_ONE(NAME, DTYPE0) {
 }
 /* dtype end */
 
-/* dtype = [['int64', 'intp'], ['int32', 'intp']] */
+/* dtype = [['int64', 'intp'], ['int32', 'intp'], ['int16', 'intp'],
+            ['int8', 'intp'], ['uint64', 'intp'], ['uint32', 'intp'],
+            ['uint16', 'intp'], ['uint8', 'intp'], ['bool', 'intp']] */
 REDUCE_ALL(NAME, DTYPE0) {
-    npy_DTYPE1 idx = 0;
-    npy_DTYPE0 ai, extreme = BIG_INT;
-    INIT_ALL_RAVEL
+    bn_DTYPE1 idx = 0, j = 0;
+    bn_DTYPE0 ai, run, extreme = BIG_INT;
+    INIT_ALL_C_ORDER
     if (SIZE == 0) {
-        DECREF_INIT_ALL_RAVEL
         VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
                   "So Bottleneck too.");
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
-    FOR_REVERSE {
-        ai = AI(DTYPE0);
-        if (ai COMPARE extreme) {
-            extreme = ai;
-            idx = INDEX;
+    WHILE {
+        run = BIG_INT;
+        FOR_REVERSE {
+            ai = AI(DTYPE0);
+            if (ai COMPARE run) {
+                run = ai;
+                j = INDEX;
+            }
+        }
+        if (it.its == 0 || run STRICT extreme) {
+            extreme = run;
+            idx = it.its * LENGTH + j;
         }
+        NEXT
     }
     BN_END_ALLOW_THREADS
-    DECREF_INIT_ALL_RAVEL
     return PyLong_FromLongLong(idx);
 }
 
 REDUCE_ONE(NAME, DTYPE0) {
-    npy_DTYPE1 idx = 0;
-    npy_DTYPE0 ai, extreme;
+    bn_DTYPE1 idx = 0;
+    bn_DTYPE0 ai, extreme;
     INIT_ONE(DTYPE1, DTYPE1)
     if (LENGTH == 0) {
         VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
@@ -628,32 +1507,160 @@ REDUCE_ONE(NAME, DTYPE0) {
         return NULL;
     }
     BN_BEGIN_ALLOW_THREADS
-    WHILE {
-        extreme = BIG_INT;
-        FOR_REVERSE {
-            ai = AI(DTYPE0);
-            if (ai COMPARE extreme) {
-                extreme = ai;
-                idx = INDEX;
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        bn_DTYPE1 at[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = BIG_INT;
+                FOR_REVERSE {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t]) {
+                            acc[t] = ai;
+                            at[t] = INDEX;
+                        }
+                    }
+                }
+                FOR_T YPP = at[t];
             }
+            NEXT
+        }
+    } else {
+        WHILE {
+            extreme = BIG_INT;
+            FOR_REVERSE {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    idx = INDEX;
+                }
+            }
+            YPP = idx;
+            NEXT
+        }
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+/* datetime64 and timedelta64; NaT is missing */
+/* dtype = [['datetime']] */
+REDUCE_ALL(NAME, DTYPE0) {
+    bn_DTYPE0 ai, run, extreme = BIG_TIME;
+    int allnat = 1;
+    Py_ssize_t idx = 0, j;
+    INIT_ALL_C_ORDER
+    if (SIZE == 0) {
+        VALUE_ERR("numpy.NAME raises on a.size==0 and axis=None; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        run = BIG_TIME;
+        j = -1;
+        FOR_REVERSE {
+            ai = AI(DTYPE0);
+            if (ai COMPARE run && ai != NPY_DATETIME_NAT) {
+                run = ai;
+                j = INDEX;
+            }
+        }
+        if (j >= 0 && (allnat || run STRICT extreme)) {
+            extreme = run;
+            allnat = 0;
+            idx = it.its * LENGTH + j;
+        }
+        NEXT
+    }
+    BN_END_ALLOW_THREADS
+    if (allnat) {
+        VALUE_ERR("All-NaT slice encountered");
+        return NULL;
+    } else {
+        return PyLong_FromLongLong(idx);
+    }
+}
+
+REDUCE_ONE(NAME, DTYPE0) {
+    int allnat, err_code = 0;
+    Py_ssize_t idx = 0;
+    bn_DTYPE0 ai, extreme;
+    INIT_ONE(INTP, intp)
+    if (LENGTH == 0) {
+        VALUE_ERR("numpy.NAME raises on a.shape[axis]==0; "
+                  "So Bottleneck too.");
+        return NULL;
+    }
+    BN_BEGIN_ALLOW_THREADS
+    if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE0 acc[BN_TILE];
+        npy_intp at[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T {
+                    acc[t] = BIG_TIME;
+                    at[t] = -1;
+                }
+                FOR_REVERSE {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        if (ai COMPARE acc[t] && ai != NPY_DATETIME_NAT) {
+                            acc[t] = ai;
+                            at[t] = INDEX;
+                        }
+                    }
+                }
+                FOR_T {
+                    if (at[t] < 0) err_code = 1;
+                    YPP = at[t];
+                }
+            }
+            NEXT
+        }
+    } else {
+        WHILE {
+            extreme = BIG_TIME;
+            allnat = 1;
+            FOR_REVERSE {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme && ai != NPY_DATETIME_NAT) {
+                    extreme = ai;
+                    allnat = 0;
+                    idx = INDEX;
+                }
+            }
+            if (allnat == 0) {
+                YPP = idx;
+            } else {
+                err_code = 1;
+            }
+            NEXT
         }
-        YPP = idx;
-        NEXT
     }
     BN_END_ALLOW_THREADS
+    if (err_code) {
+        VALUE_ERR("All-NaT slice encountered");
+        return NULL;
+    }
     return y;
 }
 /* dtype end */
 
-REDUCE_MAIN(NAME, 0)
+REDUCE_MAIN_DATETIME(NAME, 0)
 /* repeat end */
 
 
 /* ss ---------------------------------------------------------------- */
 
-/* dtype = [['float64'], ['float32']] */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
 REDUCE_ALL(ss, DTYPE0) {
-    npy_DTYPE0 ai, asum = 0;
+    bn_DTYPE1 ai, asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
@@ -668,11 +1675,27 @@ REDUCE_ALL(ss, DTYPE0) {
 }
 
 REDUCE_ONE(ss, DTYPE0) {
-    npy_DTYPE0 ai, asum;
+    bn_DTYPE1 ai, asum;
     INIT_ONE(DTYPE0, DTYPE0)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(0)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        acc[t] += ai * ai;
+                    }
+                }
+                FOR_T YPP = acc[t];
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
@@ -689,34 +1712,55 @@ REDUCE_ONE(ss, DTYPE0) {
 }
 /* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
+/* the square wraps in the input dtype, as it does in numpy */
+/* dtype = [['int64', 'int64'], ['int32', 'int32'], ['int16', 'int64'],
+            ['int8', 'int64'], ['uint64', 'uint64'], ['uint32', 'uint64'],
+            ['uint16', 'uint64'], ['uint8', 'uint64'], ['bool', 'int64']] */
 REDUCE_ALL(ss, DTYPE0) {
-    npy_DTYPE0 ai, asum = 0;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 asum = 0;
     INIT_ALL
     BN_BEGIN_ALLOW_THREADS
     WHILE {
         FOR {
             ai = AI(DTYPE0);
-            asum += ai * ai;
+            asum += (bn_DTYPE0)(ai * ai);
         }
         NEXT
     }
     BN_END_ALLOW_THREADS
-    return PyLong_FromLongLong(asum);
+    return PyLong_From_DTYPE1(asum);
 }
 
 REDUCE_ONE(ss, DTYPE0) {
-    npy_DTYPE0 ai, asum;
-    INIT_ONE(DTYPE0, DTYPE0)
+    bn_DTYPE0 ai;
+    bn_DTYPE1 asum;
+    INIT_ONE(DTYPE1, DTYPE1)
     BN_BEGIN_ALLOW_THREADS
     if (LENGTH == 0) {
         FILL_Y(0)
+    } else if (tiles_pay(&it, PyArray_NBYTES(a))) {
+        bn_DTYPE1 acc[BN_TILE];
+        INIT_TILES
+        WHILE {
+            FOR_TILES {
+                FOR_T acc[t] = 0;
+                FOR {
+                    FOR_T {
+                        ai = AT(DTYPE0);
+                        acc[t] += (bn_DTYPE0)(ai * ai);
+                    }
+                }
+                FOR_T YPP = acc[t];
+            }
+            NEXT
+        }
     } else {
         WHILE {
             asum = 0;
             FOR {
                 ai = AI(DTYPE0);
-                asum += ai * ai;
+                asum += (bn_DTYPE0)(ai * ai);
             }
             YPP = asum;
             NEXT
@@ -732,1201 +1776,5060 @@ REDUCE_MAIN(ss, 0)
 
 /* median, nanmedian MACROS ---------------------------------------------- */
 
-#define B(dtype, i) buffer[i] /* used by PARTITION */
+#define B(dtype, i) buffer[i]
 
+/* the two middle values are summed in the dtype of med, which is float64 for
+   integer input, so that large integers cannot overflow */
 #define EVEN_ODD(dtype, N) \
     if (N % 2 == 0) { \
-        npy_##dtype amax = B(dtype, 0); \
+        bn_##dtype amax = B(dtype, 0); \
         for (i = 1; i < k; i++) { \
             ai = B(dtype, i); \
             if (ai > amax) amax = ai; \
         } \
-        med = 0.5 * (B(dtype, k) + amax); \
+        med = B(dtype, k); \
+        med = 0.5 * (med + amax); \
     } else { \
         med =  B(dtype, k); \
     } \
 
-#define MEDIAN(dtype) \
-    npy_intp j, l, r, k; \
-    npy_##dtype ai; \
-    l = 0; \
+/* rows this short skip introselect: 3, 5, 7 and 9 values go through a median
+   network and the other lengths are insertion sorted */
+#define SMALL_MEDIAN_LENGTH 16
+
+#define SMALL_MEDIAN(dtype, N) \
+    switch (N) { \
+        case 3: MEDIAN_NET3(dtype, buffer) med = B(dtype, 1); break; \
+        case 5: MEDIAN_NET5(dtype, buffer) med = B(dtype, 2); break; \
+        case 7: MEDIAN_NET7(dtype, buffer) med = B(dtype, 3); break; \
+        case 9: MEDIAN_NET9(dtype, buffer) med = B(dtype, 4); break; \
+        default: \
+            for (i = 1; i < N; i++) { \
+                ai = B(dtype, i); \
+                for (j = i; j > 0 && B(dtype, j - 1) > ai; j--) { \
+                    B(dtype, j) = B(dtype, j - 1); \
+                } \
+                B(dtype, j) = ai; \
+            } \
+            if (N % 2 == 0) { \
+                med = B(dtype, k - 1); \
+                med = 0.5 * (med + B(dtype, k)); \
+            } else { \
+                med = B(dtype, k); \
+            } \
+    }
+
+#define SELECT(dtype, N) \
+    if (N <= SMALL_MEDIAN_LENGTH) { \
+        SMALL_MEDIAN(dtype, N) \
+    } else { \
+        bn_select_##dtype(buffer, N, k); \
+        EVEN_ODD(dtype, N) \
+    }
+
+/* copy the non-NaN values to the buffer without a branch per value; n is the
+   number copied */
+#define COMPACT(dtype) \
+    n = 0; \
     for (i = 0; i < LENGTH; i++) { \
         ai = AX(dtype, i); \
-        if (ai == ai) { \
-            B(dtype, l++) = ai; \
+        B(dtype, n) = ai; \
+        n += ai == ai; \
+    }
+
+/* COMPACT over all of `a`, walked by INIT_ALL without a copy; skipna = 0
+   copies every value */
+#define COMPACT_ALL(dtype, skipna) \
+    n = 0; \
+    WHILE { \
+        FOR { \
+            ai = AI(dtype); \
+            B(dtype, n) = ai; \
+            n += skipna ? ai == ai : 1; \
         } \
-    } \
-    if (l != LENGTH) { \
+        NEXT \
+    }
+
+/* median of the n values in the buffer; NaN if there are none */
+#define MEDIAN_ALL(dtype) \
+    if (n == 0) { \
+        med = BN_NAN; \
+    } else { \
+        k = n >> 1; \
+        SELECT(dtype, n) \
+    }
+
+#define MEDIAN(dtype) \
+    npy_intp j, k, n; \
+    bn_##dtype ai; \
+    COMPACT(dtype) \
+    if (n != LENGTH) { \
         med = BN_NAN; \
         goto done; \
     } \
     k = LENGTH >> 1; \
-    l = 0; \
-    r = LENGTH - 1; \
-    PARTITION(dtype) \
-    EVEN_ODD(dtype, LENGTH)
+    SELECT(dtype, LENGTH)
 
 #define MEDIAN_INT(dtype) \
-    npy_intp j, l, r, k; \
-    npy_##dtype ai; \
+    npy_intp j, k; \
+    bn_##dtype ai; \
     for (i = 0; i < LENGTH; i++) { \
         B(dtype, i) = AX(dtype, i); \
     } \
     k = LENGTH >> 1; \
-    l = 0; \
-    r = LENGTH - 1; \
-    PARTITION(dtype) \
-    EVEN_ODD(dtype, LENGTH)
+    SELECT(dtype, LENGTH)
 
 #define NANMEDIAN(dtype) \
-    npy_intp j, l, r, k, n; \
-    npy_##dtype ai; \
-    l = 0; \
-    for (i = 0; i < LENGTH; i++) { \
-        ai = AX(dtype, i); \
-        if (ai == ai) { \
-            B(dtype, l++) = ai; \
-        } \
-    } \
-    n = l; \
+    npy_intp j, k, n; \
+    bn_##dtype ai; \
+    COMPACT(dtype) \
     k = n >> 1; \
-    l = 0; \
-    r = n - 1; \
     if (n == 0) { \
         med = BN_NAN; \
         goto done; \
     } \
-    PARTITION(dtype) \
-    EVEN_ODD(dtype, n)
+    SELECT(dtype, n)
+
+/* call with the GIL held; `cleanup` is run if out of memory */
+#define BUFFER_NEW(dtype, length, cleanup) \
+    bn_##dtype *buffer = bn_scratch_get((length) * sizeof(bn_##dtype)); \
+    if (buffer == NULL) { \
+        cleanup \
+        MEMORY_ERR("Could not allocate memory for median"); \
+        return NULL; \
+    }
 
-#define BUFFER_NEW(dtype, length) \
-        npy_##dtype *buffer = malloc(length * sizeof(npy_##dtype));
+#define BUFFER_DELETE bn_scratch_put(buffer);
+
+/* radix select ---------------------------------------------------------- */
+
+/*
+ median and nanmedian of large arrays along all axes do not copy the input.
+ Each pass histograms the next RADIX_BITS bits of an order preserving
+ unsigned key of the values that share the key prefix found so far, and the
+ bucket that holds the upper middle value becomes the new prefix. Once the
+ bucket holds at most RADIX_BUCKET_MAX values they are copied and selected.
+ In approximate mode float64 input stops after RADIX_APPROX_BITS key bits
+ (sign, exponent and 20 mantissa bits), which bounds the relative error of
+ each middle value by 2**-20, and returns the middle of its bucket. The
+ counting of each pass is split into flat ranges of the input that the
+ thread pool counts at the same time into histograms of their own, which
+ are then summed.
+*/
+
+#define RADIX_BITS 16
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_BUCKET_MAX (1 << 16)
+#define RADIX_MIN_LENGTH (1 << 22)
+#define RADIX_APPROX_BITS 32
+
+/* dtype = [['float64', 'uint64'], ['float32', 'uint32']] */
+static inline bn_DTYPE1
+radix_key_DTYPE0(bn_DTYPE0 x) {
+    const bn_DTYPE1 sign = (bn_DTYPE1)1 << (8 * sizeof(bn_DTYPE1) - 1);
+    bn_DTYPE1 u;
+    memcpy(&u, &x, sizeof(u));
+    return u & sign ? ~u : u | sign;
+}
 
-#define BUFFER_DELETE free(buffer);
+static inline bn_DTYPE0
+radix_value_DTYPE0(bn_DTYPE1 key) {
+    const bn_DTYPE1 sign = (bn_DTYPE1)1 << (8 * sizeof(bn_DTYPE1) - 1);
+    bn_DTYPE0 x;
+    key = key & sign ? key & ~sign : ~key;
+    memcpy(&x, &key, sizeof(x));
+    return x;
+}
 
-/* median, nanmedian ----------------------------------------------------- */
+static inline int
+radix_isnan_DTYPE0(bn_DTYPE0 x) {
+    return x != x;
+}
+/* dtype end */
 
-/* repeat = {'NAME': ['median', 'nanmedian'],
-             'FUNC': ['MEDIAN', 'NANMEDIAN']} */
-/* dtype = [['float64', 'float64'], ['float32', 'float32']] */
+/* float16 uses the float32 key of its value */
+static inline npy_uint32
+radix_key_float16(bn_float16 x) {
+    return radix_key_float32(x);
+}
 
-REDUCE_ALL(NAME, DTYPE0) {
-    npy_intp i;
-    npy_DTYPE1 med;
-    INIT_ALL_RAVEL_ANY_ORDER
-    BN_BEGIN_ALLOW_THREADS
-    BUFFER_NEW(DTYPE0, LENGTH)
-    if (LENGTH == 0) {
-        med = BN_NAN;
-    } else {
-        FUNC(DTYPE0)
-    }
-    done:
-    BUFFER_DELETE
-    BN_END_ALLOW_THREADS
-    DECREF_INIT_ALL_RAVEL
-    return PyFloat_FromDouble(med);
+static inline bn_float16
+radix_value_float16(npy_uint32 key) {
+    return radix_value_float32(key);
 }
 
-REDUCE_ONE(NAME, DTYPE0) {
-    npy_intp i;
-    npy_DTYPE1 med;
-    INIT_ONE(DTYPE1, DTYPE1)
-    BN_BEGIN_ALLOW_THREADS
-    if (LENGTH == 0) {
-        FILL_Y(BN_NAN)
-    } else {
-        BUFFER_NEW(DTYPE0, LENGTH)
-        WHILE {
-            FUNC(DTYPE0)
-            done:
-            YPP = med;
-            NEXT
-        }
-        BUFFER_DELETE
-    }
-    BN_END_ALLOW_THREADS
-    return y;
+static inline int
+radix_isnan_float16(bn_float16 x) {
+    return x != x;
 }
-/* dtype end */
-/* repeat end */
 
-/* dtype = [['int64', 'float64'], ['int32', 'float64']] */
-REDUCE_ALL(median, DTYPE0) {
-    npy_intp i;
-    npy_DTYPE1 med;
-    INIT_ALL_RAVEL_ANY_ORDER
-    BN_BEGIN_ALLOW_THREADS
-    if (LENGTH == 0) {
-        med = BN_NAN;
-    } else {
-        BUFFER_NEW(DTYPE0, LENGTH)
-        MEDIAN_INT(DTYPE0)
-        BUFFER_DELETE
-    }
-    BN_END_ALLOW_THREADS
-    DECREF_INIT_ALL_RAVEL
-    return PyFloat_FromDouble(med);
+/* the small ints are sign extended to 32 bit keys */
+/* dtype = [['int64', 'uint64'], ['int32', 'uint32'], ['int16', 'uint32'],
+            ['int8', 'uint32']] */
+static inline bn_DTYPE1
+radix_key_DTYPE0(bn_DTYPE0 x) {
+    const bn_DTYPE1 sign = (bn_DTYPE1)1 << (8 * sizeof(bn_DTYPE1) - 1);
+    return (bn_DTYPE1)x ^ sign;
 }
 
-REDUCE_ONE(median, DTYPE0) {
-    npy_intp i;
-    npy_DTYPE1 med;
-    INIT_ONE(DTYPE1, DTYPE1)
-    BN_BEGIN_ALLOW_THREADS
-    if (LENGTH == 0) {
-        FILL_Y(BN_NAN)
-    } else {
-        BUFFER_NEW(DTYPE0, LENGTH)
-        WHILE {
-            MEDIAN_INT(DTYPE0)
-            YPP = med;
-            NEXT
-        }
-        BUFFER_DELETE
-    }
-    BN_END_ALLOW_THREADS
-    return y;
+static inline bn_DTYPE0
+radix_value_DTYPE0(bn_DTYPE1 key) {
+    const bn_DTYPE1 sign = (bn_DTYPE1)1 << (8 * sizeof(bn_DTYPE1) - 1);
+    return (bn_DTYPE0)(key ^ sign);
+}
+
+static inline int
+radix_isnan_DTYPE0(bn_DTYPE0 x) {
+    return 0;
 }
 /* dtype end */
 
-REDUCE_MAIN(median, 0)
+/* dtype = [['uint64', 'uint64'], ['uint32', 'uint32'], ['uint16', 'uint32'],
+            ['uint8', 'uint32'], ['bool', 'uint32']] */
+static inline bn_DTYPE1
+radix_key_DTYPE0(bn_DTYPE0 x) {
+    return x;
+}
 
-static PyObject *
-nanmedian(PyObject *self, PyObject *args, PyObject *kwds) {
-    return reducer("nanmedian",
-                   args,
-                   kwds,
-                   nanmedian_all_float64,
-                   nanmedian_all_float32,
-                   median_all_int64,
-                   median_all_int32,
-                   nanmedian_one_float64,
-                   nanmedian_one_float32,
-                   median_one_int64,
-                   median_one_int32,
-                   0);
+static inline bn_DTYPE0
+radix_value_DTYPE0(bn_DTYPE1 key) {
+    return (bn_DTYPE0)key;
 }
 
-/* anynan ---------------------------------------------------------------- */
+static inline int
+radix_isnan_DTYPE0(bn_DTYPE0 x) {
+    return 0;
+}
+/* dtype end */
 
-/* dtype = [['float64'], ['float32']] */
-REDUCE_ALL(anynan, DTYPE0) {
-    int f = 0;
-    npy_DTYPE0 ai;
-    INIT_ALL
-    BN_BEGIN_ALLOW_THREADS
-    WHILE {
-        FOR {
-            ai = AI(DTYPE0);
-            if (ai != ai) {
-                f = 1;
-                goto done;
+/* dtype = [['float64', 'uint64', 'float64'],
+            ['float32', 'uint32', 'float32'],
+            ['int64', 'uint64', 'float64'],
+            ['int32', 'uint32', 'float64'],
+            ['float16', 'uint32', 'float16'],
+            ['int16', 'uint32', 'float64'],
+            ['int8', 'uint32', 'float64'],
+            ['uint64', 'uint64', 'float64'],
+            ['uint32', 'uint32', 'float64'],
+            ['uint16', 'uint32', 'float64'],
+            ['uint8', 'uint32', 'float64'],
+            ['bool', 'uint32', 'float64']] */
+
+/* the counts of one part of a pass */
+typedef struct {
+    npy_intp *hist;
+    npy_intp n, nin;
+    bn_DTYPE1 kmin, kmax, lower;
+    int has_lower;
+} radix_count_DTYPE0_t;
+
+/* a pass over the input, walked by `it`, split into parts */
+typedef struct {
+    iter it;
+    int shift, width;
+    bn_DTYPE1 prefix;
+    radix_count_DTYPE0_t *counts;
+} radix_pass_DTYPE0_t;
+
+/* counts part `part` of the flat range of the input into counts[part] */
+static void
+radix_count_DTYPE0(void *arg, int part, int nparts) {
+    radix_pass_DTYPE0_t *pass = arg;
+    radix_count_DTYPE0_t *c = pass->counts + part;
+    iter it = pass->it;
+    const int shift = pass->shift;
+    const int width = pass->width;
+    const bn_DTYPE1 prefix = pass->prefix;
+    const npy_intp size = it.nits * LENGTH;
+    const npy_intp start = size * part / nparts;
+    const npy_intp end = size * (part + 1) / nparts;
+    npy_intp i, i0, i1;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 key, p;
+    memset(c->hist, 0, ((npy_intp)1 << width) * sizeof(npy_intp));
+    c->n = 0;
+    c->nin = 0;
+    c->has_lower = 0;
+    c->kmin = ~(bn_DTYPE1)0;
+    c->kmax = 0;
+    c->lower = 0;
+    if (start == end) return;
+    iter_seek(&it, start / LENGTH);
+    i0 = start % LENGTH;
+    while (it.its * LENGTH < end) {
+        i1 = end - it.its * LENGTH;
+        if (i1 > LENGTH) i1 = LENGTH;
+        for (i = i0; i < i1; i++) {
+            ai = AX(DTYPE0, i);
+            if (radix_isnan_DTYPE0(ai)) continue;
+            c->n++;
+            key = radix_key_DTYPE0(ai);
+            p = key >> shift;
+            if (p >> width == prefix) {
+                c->hist[p & (((bn_DTYPE1)1 << width) - 1)]++;
+                c->nin++;
+                if (key < c->kmin) c->kmin = key;
+                if (key > c->kmax) c->kmax = key;
+            } else if (p >> width < prefix) {
+                if (!c->has_lower || key > c->lower) c->lower = key;
+                c->has_lower = 1;
             }
         }
+        i0 = 0;
         NEXT
     }
-    done:
-    BN_END_ALLOW_THREADS
-    if (f) Py_RETURN_TRUE;
-    Py_RETURN_FALSE;
 }
 
-REDUCE_ONE(anynan, DTYPE0) {
-    int f;
-    npy_DTYPE0 ai;
-    INIT_ONE(BOOL, uint8)
+/* middle of the values whose keys start with prefix; NaN keys are skipped */
+static inline bn_DTYPE0
+radix_middle_DTYPE0(bn_DTYPE1 prefix, int shift) {
+    const bn_DTYPE1 lo = prefix << shift;
+    const bn_DTYPE1 hi = lo | (((bn_DTYPE1)1 << shift) - 1);
+    bn_DTYPE0 vlo = radix_value_DTYPE0(lo);
+    bn_DTYPE0 vhi = radix_value_DTYPE0(hi);
+    if (radix_isnan_DTYPE0(vlo)) vlo = vhi;
+    if (radix_isnan_DTYPE0(vhi)) vhi = vlo;
+    return vlo == vhi ? vlo : vlo + (vhi - vlo) / 2;
+}
+
+static PyObject *
+radix_median_DTYPE0(PyArrayObject *a, int skipna, int approx) {
+    const int nbits = 8 * sizeof(bn_DTYPE1);
+    const npy_intp size = PyArray_SIZE(a);
+    const int nparts = bn_pool_parts(size, size);
+    int shift = nbits;
+    int width, q;
+    int has_lower = 0;
+    npy_intp i, j, b, k, n = 0, nin, m, r, cum, count = size, below = 0;
+    npy_intp *hist;
+    bn_DTYPE0 ai, amax, *buffer;
+    bn_DTYPE1 key, p, kmin, kmax, prefix = 0, lower = 0;
+    bn_DTYPE2 med = BN_NAN;
+    radix_count_DTYPE0_t counts[BN_POOL_MAX + 1];
+    radix_pass_DTYPE0_t pass;
+    iter it;
+
+    /* a histogram for each part, then the values of the last bucket */
+    hist = bn_scratch_get(nparts * RADIX_SIZE * sizeof(npy_intp) +
+                          RADIX_BUCKET_MAX * sizeof(bn_DTYPE0));
+    if (hist == NULL) {
+        MEMORY_ERR("Could not allocate memory for median");
+        return NULL;
+    }
+    buffer = (bn_DTYPE0 *)(hist + nparts * RADIX_SIZE);
+    for (q = 0; q < nparts; q++) {
+        counts[q].hist = hist + q * RADIX_SIZE;
+    }
+
     BN_BEGIN_ALLOW_THREADS
-    if (LENGTH == 0) {
-        FILL_Y(0)
+    do {
+        width = shift < RADIX_BITS ? shift : RADIX_BITS;
+        shift -= width;
+        init_iter_all(&pass.it, a, 1);
+        pass.shift = shift;
+        pass.width = width;
+        pass.prefix = prefix;
+        pass.counts = counts;
+        bn_pool_run(radix_count_DTYPE0, &pass, nparts);
+        n = 0;
+        nin = 0;
+        has_lower = 0;
+        kmin = ~(bn_DTYPE1)0;
+        kmax = 0;
+        for (q = 0; q < nparts; q++) {
+            if (q > 0) {
+                for (b = 0; b < (npy_intp)1 << width; b++) {
+                    hist[b] += counts[q].hist[b];
+                }
+            }
+            n += counts[q].n;
+            nin += counts[q].nin;
+            if (counts[q].kmin < kmin) kmin = counts[q].kmin;
+            if (counts[q].kmax > kmax) kmax = counts[q].kmax;
+            if (counts[q].has_lower &&
+                (!has_lower || counts[q].lower > lower)) {
+                lower = counts[q].lower;
+                has_lower = 1;
+            }
+        }
+        if (n == 0 || (n != size && !skipna)) {
+            goto done;
+        }
+        k = n >> 1;
+        cum = below;
+        for (b = 0; cum + hist[b] <= k; b++) {
+            cum += hist[b];
+        }
+        if (cum == k && n % 2 == 0) {
+            /* the lower middle value is in the last nonempty bucket below b
+               or, if there is none, it is the largest value below prefix */
+            for (j = b - 1; j >= 0 && hist[j] == 0; j--);
+            if (j >= 0) {
+                lower = (((prefix << width) | j) << shift) |
+                        (shift ? ((bn_DTYPE1)1 << shift) - 1 : 0);
+                has_lower = 1;
+            }
+        }
+        count = hist[b];
+        prefix = (prefix << width) | b;
+        below = cum;
+        if (count == nin) {
+            /* skip the key bits that every value in the bucket shares */
+            while (shift > 0 && kmin >> (shift - 1) == kmax >> (shift - 1)) {
+                shift--;
+            }
+            prefix = kmin >> shift;
+        }
+    } while (shift > 0 && count > RADIX_BUCKET_MAX &&
+             !(approx && nbits - shift >= RADIX_APPROX_BITS));
+    k = n >> 1;
+    r = k - below;
+    if (shift == 0) {
+        /* every value in the bucket is the same */
+        ai = radix_value_DTYPE0(prefix);
+        amax = r > 0 ? ai : radix_value_DTYPE0(lower);
+    } else if (count > RADIX_BUCKET_MAX) {
+        /* approximate */
+        ai = radix_middle_DTYPE0(prefix, shift);
+        if (r > 0 || !has_lower) {
+            amax = ai;
+        } else {
+            amax = radix_middle_DTYPE0(lower >> shift, shift);
+        }
     } else {
+        m = 0;
+        has_lower = 0;
+        init_iter_all(&it, a, 1);
         WHILE {
-            f = 0;
-            FOR {
-                ai = AI(DTYPE0);
-                if (ai != ai) {
-                    f = 1;
-                    break;
+            for (i = 0; i < LENGTH; i++) {
+                ai = AX(DTYPE0, i);
+                if (radix_isnan_DTYPE0(ai)) continue;
+                key = radix_key_DTYPE0(ai);
+                p = key >> shift;
+                if (p == prefix) {
+                    buffer[m++] = ai;
+                } else if (p < prefix) {
+                    if (!has_lower || key > lower) lower = key;
+                    has_lower = 1;
                 }
             }
-            YPP = f;
             NEXT
         }
+        bn_select_DTYPE0(buffer, count, r);
+        ai = buffer[r];
+        if (r > 0) {
+            amax = buffer[0];
+            for (i = 1; i < r; i++) {
+                if (buffer[i] > amax) amax = buffer[i];
+            }
+        } else {
+            amax = has_lower ? radix_value_DTYPE0(lower) : ai;
+        }
+    }
+    if (n % 2 == 0) {
+        med = 0.5 * ((bn_DTYPE2)ai + amax);
+    } else {
+        med = ai;
     }
+    done:
     BN_END_ALLOW_THREADS
-    return y;
+    bn_scratch_put(hist);
+    return PyFloat_FromDouble(med);
 }
 /* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
-BN_OPT_3
-REDUCE_ALL(anynan, DTYPE0) {
-    Py_RETURN_FALSE;
-}
+/* median, nanmedian ----------------------------------------------------- */
 
-BN_OPT_3
-REDUCE_ONE(anynan, DTYPE0) {
-    INIT_ONE(BOOL, uint8)
-    BN_BEGIN_ALLOW_THREADS
-    FILL_Y(0);
-    BN_END_ALLOW_THREADS
+/* ddof is the `approx` flag of median and nanmedian */
+
+/* a median along an axis is split into parts of consecutive outputs that
+   the thread pool runs at the same time, each with a buffer of LENGTH
+   values of its own */
+typedef struct {
+    iter it;
+    char *py;
+    void *buffer;
+} median_part_t;
+
+/* the split is sized by the pool; one part runs on the calling thread */
+#define MEDIAN_ONE(name, dtype0, dtype1) \
+    int nparts; \
+    INIT_ONE(dtype1, dtype1) \
+    nparts = bn_pool_parts(it.nits, it.nits * LENGTH); \
+    BUFFER_NEW(dtype0, nparts * LENGTH, Py_DECREF(y);) \
+    BN_BEGIN_ALLOW_THREADS \
+    if (LENGTH == 0) { \
+        FILL_Y(BN_NAN) \
+    } else { \
+        median_part_t p = {it, (char *)py, buffer}; \
+        bn_pool_run(name##_part_##dtype0, &p, nparts); \
+    } \
+    BN_END_ALLOW_THREADS \
+    BUFFER_DELETE \
     return y;
-}
-/* dtype end */
-
-REDUCE_MAIN(anynan, 0)
-
 
-/* allnan ---------------------------------------------------------------- */
+/* repeat = {'NAME': ['median', 'nanmedian'],
+             'FUNC': ['MEDIAN', 'NANMEDIAN'],
+             'SKIPNA': ['0', '1']} */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float16']] */
 
-/* dtype = [['float64'], ['float32']] */
-REDUCE_ALL(allnan, DTYPE0) {
-    int f = 0;
-    npy_DTYPE0 ai;
+REDUCE_ALL(NAME, DTYPE0) {
+    npy_intp i, j, k, n;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 med;
+    if (ddof || PyArray_SIZE(a) >= RADIX_MIN_LENGTH) {
+        return radix_median_DTYPE0(a, SKIPNA, ddof);
+    }
     INIT_ALL
+    BUFFER_NEW(DTYPE0, SIZE, )
     BN_BEGIN_ALLOW_THREADS
-    WHILE {
-        FOR {
-            ai = AI(DTYPE0);
-            if (ai == ai) {
-                f = 1;
-                goto done;
-            }
-        }
-        NEXT
+    COMPACT_ALL(DTYPE0, 1)
+    if (!SKIPNA && n != SIZE) {
+        /* median is NaN if any value is NaN */
+        n = 0;
     }
-    done:
+    MEDIAN_ALL(DTYPE0)
     BN_END_ALLOW_THREADS
-    if (f) Py_RETURN_FALSE;
-    Py_RETURN_TRUE;
+    BUFFER_DELETE
+    return PyFloat_FromDouble(med);
 }
 
-REDUCE_ONE(allnan, DTYPE0) {
-    int f;
-    npy_DTYPE0 ai;
-    INIT_ONE(BOOL, uint8)
-    BN_BEGIN_ALLOW_THREADS
-    if (LENGTH == 0) {
-        FILL_Y(1)
-    } else {
-        WHILE {
-            f = 1;
-            FOR {
-                ai = AI(DTYPE0);
-                if (ai == ai) {
-                    f = 0;
-                    break;
-                }
-            }
-            YPP = f;
-            NEXT
-        }
+static void
+NAME_part_DTYPE0(void *arg, int part, int nparts) {
+    median_part_t *p = arg;
+    iter it = p->it;
+    npy_intp i, end = it.nits * (part + 1) / nparts;
+    bn_DTYPE1 med;
+    bn_DTYPE1 *py = (bn_DTYPE1 *)p->py;
+    bn_DTYPE0 *buffer = (bn_DTYPE0 *)p->buffer + part * LENGTH;
+    iter_seek(&it, it.nits * part / nparts);
+    py += it.its;
+    while (it.its < end) {
+        FUNC(DTYPE0)
+        done:
+        YPP = med;
+        NEXT
     }
-    BN_END_ALLOW_THREADS
-    return y;
 }
-/* dtype end */
 
-/* dtype = [['int64'], ['int32']] */
-BN_OPT_3
-REDUCE_ALL(allnan, DTYPE0) {
-    if (PyArray_SIZE(a) == 0) Py_RETURN_TRUE;
-    Py_RETURN_FALSE;
+REDUCE_ONE(NAME, DTYPE0) {
+    MEDIAN_ONE(NAME, DTYPE0, DTYPE1)
 }
+/* dtype end */
+/* repeat end */
 
-BN_OPT_3
-REDUCE_ONE(allnan, DTYPE0) {
-    INIT_ONE(BOOL, uint8)
-    BN_BEGIN_ALLOW_THREADS
-    if (SIZE == 0) {
-        FILL_Y(1);
-    } else {
-        FILL_Y(0);
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+REDUCE_ALL(median, DTYPE0) {
+    npy_intp i, j, k, n;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 med;
+    if (PyArray_SIZE(a) >= RADIX_MIN_LENGTH) {
+        return radix_median_DTYPE0(a, 0, 0);
     }
+    INIT_ALL
+    BUFFER_NEW(DTYPE0, SIZE, )
+    BN_BEGIN_ALLOW_THREADS
+    COMPACT_ALL(DTYPE0, 0)
+    MEDIAN_ALL(DTYPE0)
     BN_END_ALLOW_THREADS
-    return y;
+    BUFFER_DELETE
+    return PyFloat_FromDouble(med);
+}
+
+static void
+median_part_DTYPE0(void *arg, int part, int nparts) {
+    median_part_t *p = arg;
+    iter it = p->it;
+    npy_intp i, end = it.nits * (part + 1) / nparts;
+    bn_DTYPE1 med;
+    bn_DTYPE1 *py = (bn_DTYPE1 *)p->py;
+    bn_DTYPE0 *buffer = (bn_DTYPE0 *)p->buffer + part * LENGTH;
+    iter_seek(&it, it.nits * part / nparts);
+    py += it.its;
+    while (it.its < end) {
+        MEDIAN_INT(DTYPE0)
+        YPP = med;
+        NEXT
+    }
+}
+
+REDUCE_ONE(median, DTYPE0) {
+    MEDIAN_ONE(median, DTYPE0, DTYPE1)
 }
 /* dtype end */
 
-REDUCE_MAIN(allnan, 0)
+REDUCE_MAIN(median, BN_ARG_APPROX | BN_WHOLE_INPUT)
 
+/* integers cannot be NaN so nanmedian uses median for them */
+static const fall_t nanmedian_fall[BN_NDTYPES] = {
+    nanmedian_all_float64, nanmedian_all_float32, median_all_int64,
+    median_all_int32, nanmedian_all_float16, median_all_int16,
+    median_all_int8, median_all_uint64, median_all_uint32,
+    median_all_uint16, median_all_uint8, median_all_bool};
+static const fone_t nanmedian_fone[BN_NDTYPES] = {
+    nanmedian_one_float64, nanmedian_one_float32, median_one_int64,
+    median_one_int32, nanmedian_one_float16, median_one_int16,
+    median_one_int8, median_one_uint64, median_one_uint32,
+    median_one_uint16, median_one_uint8, median_one_bool};
+
+static PyObject *
+nanmedian(PyObject *self, PyObject *args, PyObject *kwds) {
+    return reducer(self, "nanmedian", args, kwds, nanmedian_fall,
+                   nanmedian_fone, NULL, NULL,
+                   BN_ARG_APPROX | BN_WHOLE_INPUT);
+}
 
-/* python strings -------------------------------------------------------- */
+/* nanquantile, nanpercentile -------------------------------------------- */
 
-PyObject *pystr_a = NULL;
-PyObject *pystr_axis = NULL;
-PyObject *pystr_ddof = NULL;
+/* interpolation methods done in C; other methods are sent to slow */
+#define QUANTILE_LINEAR   0
+#define QUANTILE_LOWER    1
+#define QUANTILE_HIGHER   2
+#define QUANTILE_NEAREST  3
+#define QUANTILE_MIDPOINT 4
 
-static int
-intern_strings(void) {
-    pystr_a = PyString_InternFromString("a");
-    pystr_axis = PyString_InternFromString("axis");
-    pystr_ddof = PyString_InternFromString("ddof");
-    return pystr_a && pystr_axis && pystr_ddof;
+/* same rounding as NumPy's _lerp, which is exact at g = 0 and g = 1 */
+static inline npy_float64
+quantile_lerp(npy_float64 a, npy_float64 b, npy_float64 g) {
+    const npy_float64 d = b - a;
+    return g >= 0.5 ? b - d * (1 - g) : a + d * g;
 }
 
-/* reducer --------------------------------------------------------------- */
+/*
+ The nq quantiles of the n values in the buffer. q is sorted so each
+ quantile only has to select within the part of the buffer to the right of
+ the previous one: after the selection for q[j], buffer[0] ... buffer[sel]
+ hold the sel + 1 smallest values in sorted order at the positions that
+ were selected, and every value to the right of sel is >= buffer[sel].
+*/
+#define QUANTILES(dtype) \
+    sel = -1; \
+    for (j = 0; j < nq; j++) { \
+        if (n == 0) { \
+            qv = BN_NAN; \
+        } else { \
+            idx = (n - 1) * q[j]; \
+            lo = (npy_intp)idx; \
+            g = idx - lo; \
+            if (lo > sel) { \
+                bn_select_##dtype(buffer + sel + 1, n - sel - 1, \
+                                  lo - sel - 1); \
+                sel = lo; \
+            } \
+            qlo = buffer[lo]; \
+            qhi = qlo; \
+            if (g > 0) { \
+                if (lo == sel) { \
+                    /* the next value up is the smallest one to the right */ \
+                    k = lo + 1; \
+                    for (i = k + 1; i < n; i++) { \
+                        if (buffer[i] < buffer[k]) k = i; \
+                    } \
+                    ai = buffer[k]; \
+                    buffer[k] = buffer[lo + 1]; \
+                    buffer[lo + 1] = ai; \
+                    sel = lo + 1; \
+                } \
+                qhi = buffer[lo + 1]; \
+            } \
+            switch (method) { \
+                case QUANTILE_LOWER: \
+                    qv = qlo; \
+                    break; \
+                case QUANTILE_HIGHER: \
+                    qv = qhi; \
+                    break; \
+                case QUANTILE_NEAREST: \
+                    /* round half to even, as np.around does */ \
+                    qv = g > 0.5 || (g == 0.5 && (lo & 1)) ? qhi : qlo; \
+                    break; \
+                case QUANTILE_MIDPOINT: \
+                    qv = g > 0 ? quantile_lerp(qlo, qhi, 0.5) : qlo; \
+                    break; \
+                default: \
+                    qv = g > 0 ? quantile_lerp(qlo, qhi, g) : qlo; \
+            } \
+        } \
+        py[qpos[j] * it.nits + it.its] = qv; \
+    }
 
-static inline int
-parse_args(PyObject *args,
-           PyObject *kwds,
-           int has_ddof,
-           PyObject **a,
-           PyObject **axis,
-           PyObject **ddof) {
-    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
-    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
-    if (nkwds) {
-        int nkwds_found = 0;
-        PyObject *tmp;
-        switch (nargs) {
-            case 2:
-                if (has_ddof) {
-                    *axis = PyTuple_GET_ITEM(args, 1);
-                } else {
-                    TYPE_ERR("wrong number of arguments");
-                    return 0;
-                }
-            case 1: *a = PyTuple_GET_ITEM(args, 0);
-            case 0: break;
-            default:
-                TYPE_ERR("wrong number of arguments");
-                return 0;
-        }
-        switch (nargs) {
-            case 0:
-                *a = PyDict_GetItem(kwds, pystr_a);
-                if (*a == NULL) {
-                    TYPE_ERR("Cannot find `a` keyword input");
-                    return 0;
-                }
-                nkwds_found += 1;
-            case 1:
-                tmp = PyDict_GetItem(kwds, pystr_axis);
-                if (tmp != NULL) {
-                    *axis = tmp;
-                    nkwds_found++;
-                }
-            case 2:
-                if (has_ddof) {
-                    tmp = PyDict_GetItem(kwds, pystr_ddof);
-                    if (tmp != NULL) {
-                        *ddof = tmp;
-                        nkwds_found++;
-                    }
-                    break;
-                }
-                break;
-            default:
-                TYPE_ERR("wrong number of arguments");
-                return 0;
-        }
-        if (nkwds_found != nkwds) {
-            TYPE_ERR("wrong number of keyword arguments");
-            return 0;
-        }
-        if (nargs + nkwds_found > 2 + has_ddof) {
-            TYPE_ERR("too many arguments");
-            return 0;
-        }
-    } else {
-        switch (nargs) {
-            case 3:
-                if (has_ddof) {
-                    *ddof = PyTuple_GET_ITEM(args, 2);
-                } else {
-                    TYPE_ERR("wrong number of arguments");
-                    return 0;
-                }
-            case 2:
-                *axis = PyTuple_GET_ITEM(args, 1);
-            case 1:
-                *a = PyTuple_GET_ITEM(args, 0);
-                break;
-            default:
-                TYPE_ERR("wrong number of arguments");
-                return 0;
-        }
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float16']] */
+static PyObject *
+nanquantile_DTYPE0(PyArrayObject *a,
+                   int axis,
+                   PyObject *y,
+                   const npy_float64 *q,
+                   const npy_intp *qpos,
+                   npy_intp nq,
+                   int method) {
+    npy_intp i, j, k, n, lo, sel;
+    npy_float64 idx, g, qlo, qhi, qv;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 *py = (bn_DTYPE1 *)PyArray_DATA((PyArrayObject *)y);
+    iter it;
+    init_iter_one(&it, a, axis);
+    BUFFER_NEW(DTYPE0, LENGTH, Py_DECREF(y);)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        COMPACT(DTYPE0)
+        QUANTILES(DTYPE0)
+        NEXT
     }
+    BN_END_ALLOW_THREADS
+    BUFFER_DELETE
+    return y;
+}
+/* dtype end */
 
-    return 1;
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+static PyObject *
+nanquantile_DTYPE0(PyArrayObject *a,
+                   int axis,
+                   PyObject *y,
+                   const npy_float64 *q,
+                   const npy_intp *qpos,
+                   npy_intp nq,
+                   int method) {
+    npy_intp i, j, k, n, lo, sel;
+    npy_float64 idx, g, qlo, qhi, qv;
+    bn_DTYPE0 ai;
+    bn_DTYPE1 *py = (bn_DTYPE1 *)PyArray_DATA((PyArrayObject *)y);
+    iter it;
+    init_iter_one(&it, a, axis);
+    n = LENGTH;
+    BUFFER_NEW(DTYPE0, LENGTH, Py_DECREF(y);)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        for (i = 0; i < LENGTH; i++) {
+            B(DTYPE0, i) = AX(DTYPE0, i);
+        }
+        QUANTILES(DTYPE0)
+        NEXT
+    }
+    BN_END_ALLOW_THREADS
+    BUFFER_DELETE
+    return y;
+}
+/* dtype end */
 
+static PyObject *
+nanquantile(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const fquant_t fquant[BN_NDTYPES] = BN_DTYPE_TABLE(nanquantile_);
+    return quantiler(self, "nanquantile", args, kwds, fquant, 0);
 }
 
 static PyObject *
-reducer(char *name,
-        PyObject *args,
-        PyObject *kwds,
-        fall_t fall_float64,
-        fall_t fall_float32,
-        fall_t fall_int64,
-        fall_t fall_int32,
-        fone_t fone_float64,
-        fone_t fone_float32,
-        fone_t fone_int64,
-        fone_t fone_int32,
-        int has_ddof) {
+nanpercentile(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const fquant_t fquant[BN_NDTYPES] = BN_DTYPE_TABLE(nanquantile_);
+    return quantiler(self, "nanpercentile", args, kwds, fquant, 1);
+}
 
-    int ndim;
-    int axis = 0; /* initialize to avoid compiler error */
-    int dtype;
-    int ddof;
-    int reduce_all = 0;
+/* nanwsum, nanwmean, nanwvar, nanwstd ----------------------------------- */
 
-    PyArrayObject *a;
-    PyObject *y;
+/* `a` and the float64 weights `w` have the same shape and are walked
+   together along `axis`; the functions that reduce over all axes walk every
+   slice along `axis`, the one with the smallest stride */
 
-    PyObject *a_obj = NULL;
-    PyObject *axis_obj = Py_None;
-    PyObject *ddof_obj = NULL;
+#define INIT_W \
+    iter2 it; \
+    init_iter2(&it, a, (PyObject *)w, axis);
 
-    if (!parse_args(args, kwds, has_ddof, &a_obj, &axis_obj, &ddof_obj)) {
-        return NULL;
-    }
+#define INIT_W_ONE(dtype) \
+    INIT_W \
+    PyObject *y = PyArray_EMPTY(NDIM - 1, SHAPE, NPY_##dtype, 0); \
+    bn_##dtype *py = (bn_##dtype *)PyArray_DATA((PyArrayObject *)y);
 
-    /* convert to array if necessary */
-    if (PyArray_Check(a_obj)) {
-        a = (PyArrayObject *)a_obj;
-        Py_INCREF(a);
-    } else {
-        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
-        if (a == NULL) {
-            return NULL;
-        }
-    }
+/* the weight of AI */
+#define WI *(npy_float64 *)(it.py + it.i * it.ystride)
 
-    /* check for byte swapped input array */
-    if (PyArray_ISBYTESWAPPED(a)) {
-        Py_DECREF(a);
-        return slow(name, args, kwds);
+/* divisor of the weighted sum of squared deviations */
+static inline npy_float64
+wvar_divisor(npy_float64 sw, npy_float64 sw2, int ddof, int reliability) {
+    if (reliability) {
+        return sw - ddof * sw2 / sw;
     }
+    return sw - ddof;
+}
 
-    /* does user want to reduce over all axes? */
-    if (axis_obj == Py_None) {
-        reduce_all = 1;
-    } else {
-        axis = PyArray_PyIntAsInt(axis_obj);
-        if (error_converting(axis)) {
-            TYPE_ERR("`axis` must be an integer or None");
-            goto error;
-        }
-        ndim = PyArray_NDIM(a);
-        if (axis < 0) {
-            axis += ndim;
-            if (axis < 0) {
-                PyErr_Format(PyExc_ValueError,
-                             "axis(=%d) out of bounds", axis);
-                goto error;
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float16'], ['int64', 'float64'],
+            ['int32', 'float64'], ['int16', 'float64'], ['int8', 'float64'],
+            ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+WREDUCE_ALL(nanwsum, DTYPE0) {
+    npy_float64 ai, asum = 0;
+    INIT_W
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                asum += ai * WI;
             }
-        } else if (axis >= ndim) {
-            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
-            goto error;
-        }
-        if (ndim == 1) {
-            reduce_all = 1;
         }
+        NEXT2
     }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(asum);
+}
 
-    /* ddof */
-    if (ddof_obj == NULL) {
-        ddof = 0;
-    } else {
-        ddof = PyArray_PyIntAsInt(ddof_obj);
-        if (error_converting(ddof)) {
-            TYPE_ERR("`ddof` must be an integer");
-            goto error;
+WREDUCE_ONE(nanwsum, DTYPE0) {
+    npy_float64 ai, asum;
+    INIT_W_ONE(DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        asum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                asum += ai * WI;
+            }
         }
+        YPP = asum;
+        NEXT2
     }
+    BN_END_ALLOW_THREADS
+    return y;
+}
 
-    dtype = PyArray_TYPE(a);
-
-    if (reduce_all == 1) {
-        /* we are reducing the array along all axes */
-        if (dtype == NPY_FLOAT64) {
-            y = fall_float64(a, ddof);
-        } else if (dtype == NPY_FLOAT32) {
-            y = fall_float32(a, ddof);
-        } else if (dtype == NPY_INT64) {
-            y = fall_int64(a, ddof);
-        } else if (dtype == NPY_INT32) {
-            y = fall_int32(a, ddof);
-        } else {
-            y = slow(name, args, kwds);
-        }
-    } else {
-        /* we are reducing an array with ndim > 1 over a single axis */
-        if (dtype == NPY_FLOAT64) {
-            y = fone_float64(a, axis, ddof);
-        } else if (dtype == NPY_FLOAT32) {
-            y = fone_float32(a, axis, ddof);
-        } else if (dtype == NPY_INT64) {
-            y = fone_int64(a, axis, ddof);
-        } else if (dtype == NPY_INT32) {
-            y = fone_int32(a, axis, ddof);
-        } else {
-            y = slow(name, args, kwds);
+WREDUCE_ALL(nanwmean, DTYPE0) {
+    npy_float64 ai, wi, asum = 0, wsum = 0;
+    INIT_W
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                wi = WI;
+                asum += ai * wi;
+                wsum += wi;
+            }
         }
-
+        NEXT2
     }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(wsum != 0 ? asum / wsum : BN_NAN);
+}
+
+WREDUCE_ONE(nanwmean, DTYPE0) {
+    npy_float64 ai, wi, asum, wsum;
+    INIT_W_ONE(DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        asum = 0;
+        wsum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                wi = WI;
+                asum += ai * wi;
+                wsum += wi;
+            }
+        }
+        YPP = wsum != 0 ? asum / wsum : BN_NAN;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+/* repeat = {'NAME': ['nanwstd', 'nanwvar'],
+             'FUNC': ['sqrt',    '']} */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float16'], ['int64', 'float64'],
+            ['int32', 'float64'], ['int16', 'float64'], ['int8', 'float64'],
+            ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+WREDUCE_ALL(NAME, DTYPE0) {
+    npy_float64 ai, wi, amean, divisor, out;
+    npy_float64 asum = 0, wsum = 0, w2sum = 0;
+    INIT_W
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                wi = WI;
+                asum += ai * wi;
+                wsum += wi;
+                w2sum += wi * wi;
+            }
+        }
+        NEXT2
+    }
+    divisor = wvar_divisor(wsum, w2sum, ddof, reliability);
+    if (wsum != 0 && divisor > 0) {
+        amean = asum / wsum;
+        asum = 0;
+        RESET
+        WHILE {
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    ai -= amean;
+                    asum += WI * ai * ai;
+                }
+            }
+            NEXT2
+        }
+        out = FUNC(asum / divisor);
+    } else {
+        out = BN_NAN;
+    }
+    BN_END_ALLOW_THREADS
+    return PyFloat_FromDouble(out);
+}
+
+WREDUCE_ONE(NAME, DTYPE0) {
+    npy_float64 ai, wi, amean, divisor, asum, wsum, w2sum;
+    INIT_W_ONE(DTYPE1)
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        asum = 0;
+        wsum = 0;
+        w2sum = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                wi = WI;
+                asum += ai * wi;
+                wsum += wi;
+                w2sum += wi * wi;
+            }
+        }
+        divisor = wvar_divisor(wsum, w2sum, ddof, reliability);
+        if (wsum != 0 && divisor > 0) {
+            amean = asum / wsum;
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    ai -= amean;
+                    asum += WI * ai * ai;
+                }
+            }
+            asum = FUNC(asum / divisor);
+        } else {
+            asum = BN_NAN;
+        }
+        YPP = asum;
+        NEXT2
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+/* repeat end */
+
+WREDUCE_MAIN(nanwsum, 0)
+WREDUCE_MAIN(nanwmean, 0)
+WREDUCE_MAIN(nanwstd, 1)
+WREDUCE_MAIN(nanwvar, 1)
+
+/* anynan ---------------------------------------------------------------- */
+
+/* dtype = [['float64'], ['float32'], ['float16']] */
+REDUCE_ALL(anynan, DTYPE0) {
+    int f = 0;
+    bn_DTYPE0 ai;
+    INIT_ALL
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai != ai) {
+                f = 1;
+                goto done;
+            }
+        }
+        NEXT
+    }
+    done:
+    BN_END_ALLOW_THREADS
+    if (f) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+REDUCE_ONE(anynan, DTYPE0) {
+    int f;
+    bn_DTYPE0 ai;
+    INIT_ONE(BOOL, uint8)
+    BN_BEGIN_ALLOW_THREADS
+    if (LENGTH == 0) {
+        FILL_Y(0)
+    } else {
+        WHILE {
+            f = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai != ai) {
+                    f = 1;
+                    break;
+                }
+            }
+            YPP = f;
+            NEXT
+        }
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+BN_OPT_3
+REDUCE_ALL(anynan, DTYPE0) {
+    Py_RETURN_FALSE;
+}
+
+BN_OPT_3
+REDUCE_ONE(anynan, DTYPE0) {
+    INIT_ONE(BOOL, uint8)
+    BN_BEGIN_ALLOW_THREADS
+    FILL_Y(0);
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+REDUCE_MAIN(anynan, 0)
 
-    Py_DECREF(a);
 
+/* allnan ---------------------------------------------------------------- */
+
+/* dtype = [['float64'], ['float32'], ['float16']] */
+REDUCE_ALL(allnan, DTYPE0) {
+    int f = 0;
+    bn_DTYPE0 ai;
+    INIT_ALL
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                f = 1;
+                goto done;
+            }
+        }
+        NEXT
+    }
+    done:
+    BN_END_ALLOW_THREADS
+    if (f) Py_RETURN_FALSE;
+    Py_RETURN_TRUE;
+}
+
+REDUCE_ONE(allnan, DTYPE0) {
+    int f;
+    bn_DTYPE0 ai;
+    INIT_ONE(BOOL, uint8)
+    BN_BEGIN_ALLOW_THREADS
+    if (LENGTH == 0) {
+        FILL_Y(1)
+    } else {
+        WHILE {
+            f = 1;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    f = 0;
+                    break;
+                }
+            }
+            YPP = f;
+            NEXT
+        }
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+BN_OPT_3
+REDUCE_ALL(allnan, DTYPE0) {
+    if (PyArray_SIZE(a) == 0) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+BN_OPT_3
+REDUCE_ONE(allnan, DTYPE0) {
+    INIT_ONE(BOOL, uint8)
+    BN_BEGIN_ALLOW_THREADS
+    if (SIZE == 0) {
+        FILL_Y(1);
+    } else {
+        FILL_Y(0);
+    }
+    BN_END_ALLOW_THREADS
+    return y;
+}
+/* dtype end */
+
+REDUCE_MAIN(allnan, 0)
+
+
+/* _nanmoments ----------------------------------------------------------- */
+
+/*
+ The count, mean and sum of squared deviations from the mean of the non-NaN
+ values, in float64 for every input dtype, which the accumulators in
+ bottleneck/_accumulate.py merge across chunks. The three are the last axis
+ of the output. ddof is the highest moment wanted, as it is the approx flag
+ of median: with 1 the second pass for the squared deviations is skipped
+ and they are left at zero.
+*/
+
+/* output with the shape of `a` without axis, or of a scalar if axis is -1,
+   and a last axis of length 3 */
+static inline PyObject *
+moments_output(PyArrayObject *a, int axis)
+{
+    int i, ndim = 0;
+    npy_intp shape[NPY_MAXDIMS + 1];
+    if (axis >= 0) {
+        for (i = 0; i < PyArray_NDIM(a); i++) {
+            if (i != axis) shape[ndim++] = PyArray_DIM(a, i);
+        }
+    }
+    shape[ndim++] = 3;
+    return PyArray_EMPTY(ndim, shape, NPY_FLOAT64, 0);
+}
+
+/* dtype = [['float64'], ['float32'], ['int64'], ['int32'], ['float16'],
+            ['int16'], ['int8'], ['uint64'], ['uint32'], ['uint16'],
+            ['uint8'], ['bool']] */
+REDUCE_ALL(_nanmoments, DTYPE0) {
+    npy_intp count = 0;
+    npy_float64 ai, amean = 0, assqdm = 0;
+    npy_float64 *py;
+    PyObject *y;
+    INIT_ALL
+    y = moments_output(a, -1);
+    if (y == NULL) return NULL;
+    py = (npy_float64 *)PyArray_DATA((PyArrayObject *)y);
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                amean += ai;
+                count++;
+            }
+        }
+        NEXT
+    }
+    if (count > 0 && ddof > 1) {
+        amean /= count;
+        RESET
+        WHILE {
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    ai -= amean;
+                    assqdm += ai * ai;
+                }
+            }
+            NEXT
+        }
+    } else if (count > 0) {
+        amean /= count;
+    }
+    BN_END_ALLOW_THREADS
+    py[0] = count;
+    py[1] = amean;
+    py[2] = assqdm;
+    return y;
+}
+
+REDUCE_ONE(_nanmoments, DTYPE0) {
+    npy_intp count;
+    npy_float64 ai, amean, assqdm;
+    npy_float64 *py;
+    PyObject *y;
+    iter it;
+    init_iter_one(&it, a, axis);
+    y = moments_output(a, axis);
+    if (y == NULL) return NULL;
+    py = (npy_float64 *)PyArray_DATA((PyArrayObject *)y);
+    BN_BEGIN_ALLOW_THREADS
+    WHILE {
+        count = 0;
+        amean = 0;
+        assqdm = 0;
+        FOR {
+            ai = AI(DTYPE0);
+            if (ai == ai) {
+                amean += ai;
+                count++;
+            }
+        }
+        if (count > 0) {
+            amean /= count;
+            if (ddof > 1) {
+                FOR {
+                    ai = AI(DTYPE0);
+                    if (ai == ai) {
+                        ai -= amean;
+                        assqdm += ai * ai;
+                    }
+                }
+            }
+        }
+        *py++ = count;
+        *py++ = amean;
+        *py++ = assqdm;
+        NEXT
+    }
+    BN_END_ALLOW_THREADS
     return y;
+}
+/* dtype end */
+
+REDUCE_MAIN(_nanmoments, BN_ARG_DDOF)
+
+
+/* segment functions ----------------------------------------------------- */
+
+/*
+ The segment functions reduce each segment [offsets[s], offsets[s + 1]) of
+ `a` along `axis`, the layout of a flat values array and its offsets in an
+ Arrow list. The thread pool runs them in parts: the segments of all slices
+ are split into runs of consecutive segments with about the same work, the
+ length of a segment plus one, so that the parts stay balanced however
+ uneven the segments are. INIT_SEG puts the iterator at the first segment
+ of the part, and WHILE_SEG and FOR_SEGMENTS walk the segments of the part
+ slice by slice. FOR_SEGMENTS points the iterator at each segment in turn,
+ so that LENGTH, FOR, AI and the median macros see the segment as though
+ it were the whole slice; NEXT_SEG goes back to the start of the slice
+ before moving to the next one. SEG_ERR gives up on segment s and ends
+ the part.
+*/
+
+typedef struct {
+    const iter2 *it;
+    const npy_intp *offsets;
+    npy_intp nseg;
+    int ddof;
+    npy_intp wslice;          /* work of the segments of one slice */
+    npy_intp work;            /* and of all slices */
+    char *buffer;             /* the buffer of part q is at */
+    size_t bufsize;           /* buffer + q * bufsize */
+    npy_intp err[BN_POOL_MAX + 1];
+} seg_part_t;
+
+/* the first segment, (slice its, segment s), whose work starts at or after
+   w; the work of a slice is a prefix sum of offsets, so s is found by a
+   binary search */
+static inline void
+seg_locate(const seg_part_t *p, npy_intp w, npy_intp *its, npy_intp *s)
+{
+    const npy_intp *offsets = p->offsets;
+    npy_intp r, mid, lo = 0, hi = p->nseg;
+    if (p->wslice == 0) {
+        *its = p->it->nits;
+        *s = 0;
+        return;
+    }
+    *its = w / p->wslice;
+    r = w % p->wslice;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (offsets[mid] - offsets[0] + mid < r) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == p->nseg) {
+        (*its)++;
+        lo = 0;
+    }
+    *s = lo;
+}
+
+#define INIT_SEG \
+    seg_part_t *p = (seg_part_t *)arg; \
+    const npy_intp *offsets = p->offsets; \
+    const npy_intp nseg = p->nseg; \
+    iter2 it = *p->it; \
+    npy_intp s, its0, its1, s1; \
+    char *pa; \
+    seg_locate(p, p->work * part / nparts, &its0, &s); \
+    seg_locate(p, p->work * (part + 1) / nparts, &its1, &s1); \
+    iter2_seek(&it, its0); \
+    p->err[part] = -1;
+
+/* the buffer of the part, for the median macros */
+#define SEG_BUFFER(dtype) \
+    bn_##dtype *buffer = (bn_##dtype *)(p->buffer + part * p->bufsize);
+
+#define WHILE_SEG while (it.its < its1 || (it.its == its1 && s < s1))
+
+#define FOR_SEGMENTS \
+    for (pa = it.pa; \
+         s < (it.its == its1 ? s1 : nseg) && \
+         (it.pa = pa + offsets[s] * it.astride, \
+          it.length = offsets[s + 1] - offsets[s], 1); \
+         s++)
+
+#define NEXT_SEG \
+    it.pa = pa; \
+    if (p->err[part] >= 0) break; \
+    s = 0; \
+    NEXT2
+
+#define SEG_ERR { \
+    p->err[part] = s; \
+    break; \
+}
+
+/* integer input has no missing value to give an empty segment */
+#define EMPTY_SEGMENT_ERR \
+    "%s: segment %zd is empty; integer input has no missing value to " \
+    "return for it"
+
+/* output with the shape of `a` with nseg along axis */
+static inline PyObject *
+segment_output(PyArrayObject *a, int axis, npy_intp nseg, int type)
+{
+    npy_intp shape[NPY_MAXDIMS];
+    memcpy(shape, PyArray_SHAPE(a), PyArray_NDIM(a) * sizeof(npy_intp));
+    shape[axis] = nseg;
+    return PyArray_EMPTY(PyArray_NDIM(a), shape, type, 0);
+}
+
+/* length of the longest segment */
+static inline npy_intp
+segment_max_length(const npy_intp *offsets, npy_intp nseg)
+{
+    npy_intp s, n = 0;
+    for (s = 0; s < nseg; s++) {
+        if (offsets[s + 1] - offsets[s] > n) n = offsets[s + 1] - offsets[s];
+    }
+    return n;
+}
+
+static PyObject *
+segment_run(PyArrayObject *a,
+            const npy_intp *offsets,
+            npy_intp nseg,
+            int axis,
+            int ddof,
+            int type,
+            bn_part_t fpart,
+            size_t itemsize,
+            const char *name,
+            const char *err) {
+    iter2 it;
+    int q, nparts;
+    npy_intp s = -1;
+    seg_part_t p;
+    PyObject *y = segment_output(a, axis, nseg, type);
+    if (y == NULL) return NULL;
+    init_iter2(&it, a, y, axis);
+    p.it = &it;
+    p.offsets = offsets;
+    p.nseg = nseg;
+    p.ddof = ddof;
+    p.wslice = nseg > 0 ? offsets[nseg] - offsets[0] + nseg : 0;
+    p.work = it.nits * p.wslice;
+    nparts = bn_pool_parts(it.nits * nseg, p.work);
+    p.bufsize = itemsize * segment_max_length(offsets, nseg);
+    p.buffer = NULL;
+    if (itemsize > 0) {
+        p.buffer = bn_scratch_get(nparts * p.bufsize);
+        if (p.buffer == NULL) {
+            Py_DECREF(y);
+            MEMORY_ERR("Could not allocate memory for median");
+            return NULL;
+        }
+    }
+    BN_BEGIN_ALLOW_THREADS
+    bn_pool_run(fpart, &p, nparts);
+    BN_END_ALLOW_THREADS
+    if (p.buffer != NULL) bn_scratch_put(p.buffer);
+    for (q = 0; q < nparts && s < 0; q++) {
+        s = p.err[q];
+    }
+    if (s >= 0) {
+        PyErr_Format(PyExc_ValueError, err, name, s);
+        Py_DECREF(y);
+        return NULL;
+    }
+    return y;
+}
+
+/* segment_nansum -------------------------------------------------------- */
+
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+SEGMENT_PART(segment_nansum, DTYPE0) {
+    bn_DTYPE1 ai, asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) asum += ai;
+            }
+            YX(DTYPE2, s) = asum;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_nansum, DTYPE0, DTYPE2, 0, NULL)
+/* dtype end */
+
+/* dtype = [['int64', 'int64'], ['int32', 'int64'], ['int16', 'int64'],
+            ['int8', 'int64'], ['uint64', 'uint64'], ['uint32', 'uint64'],
+            ['uint16', 'uint64'], ['uint8', 'uint64'], ['bool', 'int64']] */
+SEGMENT_PART(segment_nansum, DTYPE0) {
+    bn_DTYPE1 asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            asum = 0;
+            FOR asum += AI(DTYPE0);
+            YX(DTYPE1, s) = asum;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_nansum, DTYPE0, DTYPE1, 0, NULL)
+/* dtype end */
+
+SEGMENT_MAIN(segment_nansum, 0)
+
+
+/* segment_nanmean ------------------------------------------------------- */
+
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+SEGMENT_PART(segment_nanmean, DTYPE0) {
+    npy_intp count;
+    bn_DTYPE1 ai, asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            count = 0;
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    asum += ai;
+                    count++;
+                }
+            }
+            YX(DTYPE2, s) = count > 0 ? asum / count : BN_NAN;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_nanmean, DTYPE0, DTYPE2, 0, NULL)
+/* dtype end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+SEGMENT_PART(segment_nanmean, DTYPE0) {
+    bn_DTYPE1 asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            asum = 0;
+            FOR asum += AI(DTYPE0);
+            YX(DTYPE1, s) = LENGTH > 0 ? asum / LENGTH : BN_NAN;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_nanmean, DTYPE0, DTYPE1, 0, NULL)
+/* dtype end */
+
+SEGMENT_MAIN(segment_nanmean, 0)
+
+
+/* segment_nanstd, segment_nanvar ---------------------------------------- */
+
+/* repeat = {'NAME': ['segment_nanstd', 'segment_nanvar'],
+             'FUNC': ['sqrt',           '']} */
+/* dtype = [['float64', 'float64', 'float64'],
+            ['float32', 'float32', 'float32'],
+            ['float16', 'float32', 'float16']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    npy_intp count;
+    bn_DTYPE1 ai, amean, assqdm;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            count = 0;
+            amean = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai == ai) {
+                    amean += ai;
+                    count++;
+                }
+            }
+            if (count > p->ddof) {
+                amean /= count;
+                assqdm = 0;
+                FOR {
+                    ai = AI(DTYPE0);
+                    if (ai == ai) {
+                        ai -= amean;
+                        assqdm += ai * ai;
+                    }
+                }
+                YX(DTYPE2, s) = FUNC(assqdm / (count - p->ddof));
+            } else {
+                YX(DTYPE2, s) = BN_NAN;
+            }
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, DTYPE2, 0, NULL)
+/* dtype end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    bn_DTYPE1 ai, amean, assqdm;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            if (LENGTH > p->ddof) {
+                amean = 0;
+                FOR amean += AI(DTYPE0);
+                amean /= LENGTH;
+                assqdm = 0;
+                FOR {
+                    ai = AI(DTYPE0) - amean;
+                    assqdm += ai * ai;
+                }
+                YX(DTYPE1, s) = FUNC(assqdm / (LENGTH - p->ddof));
+            } else {
+                YX(DTYPE1, s) = BN_NAN;
+            }
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, DTYPE1, 0, NULL)
+/* dtype end */
+
+SEGMENT_MAIN(NAME, 1)
+/* repeat end */
+
+
+/* segment_nanmin, segment_nanmax ---------------------------------------- */
+
+/* repeat = {'NAME':      ['segment_nanmin', 'segment_nanmax'],
+             'COMPARE':   ['<=',             '>='],
+             'BIG_FLOAT': ['BN_INFINITY',    '-BN_INFINITY'],
+             'BIG_INT':   ['NPY_MAX_DTYPE0', 'NPY_MIN_DTYPE0']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    int allnan;
+    bn_DTYPE0 ai, extreme;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            allnan = 1;
+            extreme = BIG_FLOAT;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    allnan = 0;
+                }
+            }
+            YX(DTYPE0, s) = allnan ? BN_NAN : extreme;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, DTYPE0, 0, NULL)
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    bn_DTYPE0 ai, extreme;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            if (LENGTH == 0) SEG_ERR
+            extreme = BIG_INT;
+            FOR {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) extreme = ai;
+            }
+            YX(DTYPE0, s) = extreme;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, DTYPE0, 0, EMPTY_SEGMENT_ERR)
+/* dtype end */
+
+SEGMENT_MAIN(NAME, 0)
+/* repeat end */
+
+
+/* segment_nanargmin, segment_nanargmax ---------------------------------- */
+
+/* the index is from the start of the segment; as in nanargmin the slice is
+   walked backwards so that the first of equal extremes is found */
+
+/* repeat = {'NAME':      ['segment_nanargmin', 'segment_nanargmax'],
+             'COMPARE':   ['<=',                '>='],
+             'BIG_FLOAT': ['BN_INFINITY',       '-BN_INFINITY'],
+             'BIG_INT':   ['NPY_MAX_DTYPE0',    'NPY_MIN_DTYPE0']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    npy_intp idx = 0;
+    bn_DTYPE0 ai, extreme;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            idx = -1;
+            extreme = BIG_FLOAT;
+            FOR_REVERSE {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    idx = INDEX;
+                }
+            }
+            if (idx < 0) SEG_ERR
+            YX(intp, s) = idx;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, INTP, 0, "%s: segment %zd is empty or all NaN")
+/* dtype end */
+
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    npy_intp idx = 0;
+    bn_DTYPE0 ai, extreme;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            if (LENGTH == 0) SEG_ERR
+            extreme = BIG_INT;
+            FOR_REVERSE {
+                ai = AI(DTYPE0);
+                if (ai COMPARE extreme) {
+                    extreme = ai;
+                    idx = INDEX;
+                }
+            }
+            YX(intp, s) = idx;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, INTP, 0, "%s: segment %zd is empty")
+/* dtype end */
+
+SEGMENT_MAIN(NAME, 0)
+/* repeat end */
+
+
+/* segment_ss ------------------------------------------------------------ */
+
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float32']] */
+SEGMENT_PART(segment_ss, DTYPE0) {
+    bn_DTYPE1 ai, asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                asum += ai * ai;
+            }
+            YX(DTYPE0, s) = asum;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_ss, DTYPE0, DTYPE0, 0, NULL)
+/* dtype end */
+
+/* the square wraps in the input dtype, as it does in numpy */
+/* dtype = [['int64', 'int64'], ['int32', 'int32'], ['int16', 'int64'],
+            ['int8', 'int64'], ['uint64', 'uint64'], ['uint32', 'uint64'],
+            ['uint16', 'uint64'], ['uint8', 'uint64'], ['bool', 'int64']] */
+SEGMENT_PART(segment_ss, DTYPE0) {
+    bn_DTYPE0 ai;
+    bn_DTYPE1 asum;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            asum = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                asum += (bn_DTYPE0)(ai * ai);
+            }
+            YX(DTYPE1, s) = asum;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_ss, DTYPE0, DTYPE1, 0, NULL)
+/* dtype end */
+
+SEGMENT_MAIN(segment_ss, 0)
+
+
+/* segment_median, segment_nanmedian ------------------------------------- */
+
+/* the segments of a part share one buffer with the length of the longest */
+
+/* repeat = {'NAME': ['segment_median', 'segment_nanmedian'],
+             'FUNC': ['MEDIAN',         'NANMEDIAN']} */
+/* dtype = [['float64', 'float64'], ['float32', 'float32'],
+            ['float16', 'float16']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    npy_intp i;
+    bn_DTYPE1 med;
+    INIT_SEG
+    SEG_BUFFER(DTYPE0)
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            if (LENGTH == 0) {
+                med = BN_NAN;
+            } else {
+                FUNC(DTYPE0)
+            }
+            done:
+            YX(DTYPE1, s) = med;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, DTYPE1, sizeof(bn_DTYPE0), NULL)
+/* dtype end */
+/* repeat end */
+
+/* dtype = [['int64', 'float64'], ['int32', 'float64'], ['int16', 'float64'],
+            ['int8', 'float64'], ['uint64', 'float64'], ['uint32', 'float64'],
+            ['uint16', 'float64'], ['uint8', 'float64'],
+            ['bool', 'float64']] */
+SEGMENT_PART(segment_median, DTYPE0) {
+    npy_intp i;
+    bn_DTYPE1 med;
+    INIT_SEG
+    SEG_BUFFER(DTYPE0)
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            if (LENGTH == 0) {
+                med = BN_NAN;
+            } else {
+                MEDIAN_INT(DTYPE0)
+            }
+            YX(DTYPE1, s) = med;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(segment_median, DTYPE0, DTYPE1, sizeof(bn_DTYPE0), NULL)
+/* dtype end */
+
+SEGMENT_MAIN(segment_median, 0)
+
+/* integers cannot be NaN so segment_nanmedian uses segment_median for them */
+static PyObject *
+segment_nanmedian(PyObject *self, PyObject *args, PyObject *kwds) {
+    static const fseg_t fseg[BN_NDTYPES] = {
+        segment_nanmedian_float64, segment_nanmedian_float32,
+        segment_median_int64, segment_median_int32,
+        segment_nanmedian_float16, segment_median_int16,
+        segment_median_int8, segment_median_uint64, segment_median_uint32,
+        segment_median_uint16, segment_median_uint8, segment_median_bool};
+    return segmenter(self, "segment_nanmedian", args, kwds, fseg, 0);
+}
+
+
+/* segment_anynan, segment_allnan ---------------------------------------- */
+
+/* repeat = {'NAME':  ['segment_anynan', 'segment_allnan'],
+             'FOUND': ['ai != ai',       'ai == ai'],
+             'EMPTY': ['0',              '1']} */
+/* dtype = [['float64'], ['float32'], ['float16']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    int f;
+    bn_DTYPE0 ai;
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS {
+            f = 0;
+            FOR {
+                ai = AI(DTYPE0);
+                if (FOUND) {
+                    f = 1;
+                    break;
+                }
+            }
+            YX(uint8, s) = f ^ EMPTY;
+        }
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, BOOL, 0, NULL)
+/* dtype end */
+
+/* an integer segment has no NaN and is all NaN only if it is empty */
+/* dtype = [['int64'], ['int32'], ['int16'], ['int8'], ['uint64'],
+            ['uint32'], ['uint16'], ['uint8'], ['bool']] */
+SEGMENT_PART(NAME, DTYPE0) {
+    INIT_SEG
+    WHILE_SEG {
+        FOR_SEGMENTS YX(uint8, s) = EMPTY && LENGTH == 0;
+        NEXT_SEG
+    }
+}
+
+SEGMENT(NAME, DTYPE0, BOOL, 0, NULL)
+/* dtype end */
+
+SEGMENT_MAIN(NAME, 0)
+/* repeat end */
+
+
+/* module state ---------------------------------------------------------- */
+
+typedef struct {
+    PyObject *slow;
+    PyObject *pystr_a;
+    PyObject *pystr_axis;
+    PyObject *pystr_ddof;
+    PyObject *pystr_q;
+    PyObject *pystr_method;
+    PyObject *pystr_approx;
+    PyObject *pystr_weights;
+    PyObject *pystr_reliability;
+    PyObject *pystr_where;
+    PyObject *pystr_func;
+    PyObject *pystr_arrays;
+    PyObject *pystr_stack;
+    PyObject *pystr_offsets;
+} module_state;
+
+MODULE_STATE_FUNCS
+
+static int
+intern_strings(module_state *st) {
+    st->pystr_a = PyString_InternFromString("a");
+    st->pystr_axis = PyString_InternFromString("axis");
+    st->pystr_ddof = PyString_InternFromString("ddof");
+    st->pystr_q = PyString_InternFromString("q");
+    st->pystr_method = PyString_InternFromString("method");
+    st->pystr_approx = PyString_InternFromString("approx");
+    st->pystr_weights = PyString_InternFromString("weights");
+    st->pystr_reliability = PyString_InternFromString("reliability");
+    st->pystr_where = PyString_InternFromString("where");
+    st->pystr_func = PyString_InternFromString("func");
+    st->pystr_arrays = PyString_InternFromString("arrays");
+    st->pystr_stack = PyString_InternFromString("stack");
+    st->pystr_offsets = PyString_InternFromString("offsets");
+    return st->pystr_a && st->pystr_axis && st->pystr_ddof && st->pystr_q &&
+           st->pystr_method && st->pystr_approx && st->pystr_weights &&
+           st->pystr_reliability && st->pystr_where && st->pystr_func &&
+           st->pystr_arrays && st->pystr_stack && st->pystr_offsets;
+}
+
+/* out-of-core input ----------------------------------------------------- */
+
+/*
+ Reductions of mapped files (bn_file_backed) of at least bn_ooc_bytes bytes
+ are handed to bottleneck/_outofcore.py, which walks the file in large blocks
+ in the order they are laid out on disk, with readahead advice, and calls
+ the C functions on each block. bn_ooc_active is set while it runs so that
+ those calls take the usual path. bn_ooc_bytes is set from Python with
+ _set_outofcore_bytes; a negative value, the default, turns the out-of-core
+ mode off.
+*/
+
+static Py_ssize_t bn_ooc_bytes = -1;
+static BN_THREAD_LOCAL int bn_ooc_active = 0;
+
+/* should the reduction of `a` be done out of core? */
+static inline int
+bn_out_of_core(PyArrayObject *a)
+{
+    Py_ssize_t nbytes = BN_LOAD(bn_ooc_bytes);
+    return nbytes >= 0 && !bn_ooc_active && PyArray_NBYTES(a) >= nbytes &&
+           bn_file_backed(a);
+}
+
+/* calls bottleneck._outofcore.<func>(*args) with bn_ooc_active set */
+static PyObject *
+bn_ooc_call(const char *func, PyObject *args)
+{
+    PyObject *m, *f, *y;
+    /* not cached: input this large takes far longer than the import */
+    m = PyImport_ImportModule("bottleneck._outofcore");
+    if (m == NULL) return NULL;
+    f = PyObject_GetAttrString(m, func);
+    Py_DECREF(m);
+    if (f == NULL) return NULL;
+    bn_ooc_active = 1;
+    y = PyObject_Call(f, args, NULL);
+    bn_ooc_active = 0;
+    Py_DECREF(f);
+    return y;
+}
+
+static PyObject *
+set_outofcore_bytes(PyObject *self, PyObject *arg)
+{
+    Py_ssize_t old = BN_LOAD(bn_ooc_bytes);
+    Py_ssize_t n = PyArray_PyIntAsIntp(arg);
+    if (error_converting(n)) return NULL;
+    BN_STORE(bn_ooc_bytes, n);
+    return PyLong_FromSsize_t(old);
+}
+
+/* reduces `a`, which is file backed, in bottleneck/_outofcore.py; axis is
+   -1 to reduce over all axes */
+static PyObject *
+reduce_out_of_core(char *name,
+                   PyArrayObject *a,
+                   int axis,
+                   int flags,
+                   int ddof)
+{
+    PyObject *args, *y;
+    PyObject *axis_obj = Py_None;
+    if (axis >= 0) {
+        axis_obj = PyLong_FromLong(axis);
+        if (axis_obj == NULL) return NULL;
+    } else {
+        Py_INCREF(axis_obj);
+    }
+    if (!(flags & BN_ARGS)) {
+        args = Py_BuildValue("(sON{})", name, a, axis_obj);
+    } else {
+        args = Py_BuildValue("(sON{si})", name, a, axis_obj,
+                             flags & BN_ARG_APPROX ? "approx" : "ddof", ddof);
+    }
+    if (args == NULL) return NULL;
+    y = bn_ooc_call("reduce", args);
+    Py_DECREF(args);
+    return y;
+}
+
+/* reduces `a`, which has to be converted (bn_convert), over all axes in
+   bottleneck/_convert.py, which converts it BN_BLOCK_BYTES at a time and
+   combines the block results */
+static PyObject *
+reduce_converted(char *name, PyArrayObject *a, int flags, int ddof)
+{
+    PyObject *m, *f, *args, *y;
+    PyArray_Descr *descr = bn_work_descr(a);
+    if (descr == NULL) return NULL;
+    if (!(flags & BN_ARG_DDOF)) {
+        args = Py_BuildValue("(sONi{})", name, a, descr, BN_BLOCK_BYTES);
+    } else {
+        args = Py_BuildValue("(sONi{si})", name, a, descr, BN_BLOCK_BYTES,
+                             "ddof", ddof);
+    }
+    if (args == NULL) return NULL;
+    m = PyImport_ImportModule("bottleneck._convert");
+    if (m == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+    f = PyObject_GetAttrString(m, "reduce");
+    Py_DECREF(m);
+    if (f == NULL) {
+        Py_DECREF(args);
+        return NULL;
+    }
+    y = PyObject_Call(f, args, NULL);
+    Py_DECREF(f);
+    Py_DECREF(args);
+    return y;
+}
+
+/* reducer --------------------------------------------------------------- */
+
+/* `flags` says which argument, if any, follows `axis` (BN_ARG_DDOF or
+   BN_ARG_APPROX), which is returned as `ddof`; `where` is NULL for
+   functions that do not take it */
+
+static inline int
+parse_args(module_state *st,
+           PyObject *args,
+           PyObject *kwds,
+           int flags,
+           PyObject **a,
+           PyObject **axis,
+           PyObject **ddof,
+           PyObject **where) {
+    const int takes_arg = (flags & BN_ARGS) != 0;
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    if (nkwds) {
+        int nkwds_found = 0;
+        int nwhere = 0;
+        PyObject *tmp;
+        /* where can only be given by keyword */
+        if (where != NULL) {
+            tmp = PyDict_GetItem(kwds, st->pystr_where);
+            if (tmp != NULL) {
+                *where = tmp;
+                nwhere = 1;
+                nkwds_found++;
+            }
+        }
+        switch (nargs) {
+            case 2:
+                if (takes_arg || nwhere) {
+                    *axis = PyTuple_GET_ITEM(args, 1);
+                } else {
+                    TYPE_ERR("wrong number of arguments");
+                    return 0;
+                }
+            /* fall through */
+            case 1: *a = PyTuple_GET_ITEM(args, 0);
+            case 0: break;
+            default:
+                TYPE_ERR("wrong number of arguments");
+                return 0;
+        }
+        switch (nargs) {
+            case 0:
+                *a = PyDict_GetItem(kwds, st->pystr_a);
+                if (*a == NULL) {
+                    TYPE_ERR("Cannot find `a` keyword input");
+                    return 0;
+                }
+                nkwds_found += 1;
+            /* fall through */
+            case 1:
+                tmp = PyDict_GetItem(kwds, st->pystr_axis);
+                if (tmp != NULL) {
+                    *axis = tmp;
+                    nkwds_found++;
+                }
+            /* fall through */
+            case 2:
+                if (takes_arg) {
+                    tmp = PyDict_GetItem(kwds, flags & BN_ARG_APPROX ?
+                                               st->pystr_approx :
+                                               st->pystr_ddof);
+                    if (tmp != NULL) {
+                        *ddof = tmp;
+                        nkwds_found++;
+                    }
+                    break;
+                }
+                break;
+            default:
+                TYPE_ERR("wrong number of arguments");
+                return 0;
+        }
+        if (nkwds_found != nkwds) {
+            TYPE_ERR("wrong number of keyword arguments");
+            return 0;
+        }
+        if (nargs + nkwds_found > 2 + takes_arg + nwhere) {
+            TYPE_ERR("too many arguments");
+            return 0;
+        }
+    } else {
+        switch (nargs) {
+            case 3:
+                if (takes_arg) {
+                    *ddof = PyTuple_GET_ITEM(args, 2);
+                } else {
+                    TYPE_ERR("wrong number of arguments");
+                    return 0;
+                }
+            /* fall through */
+            case 2:
+                *axis = PyTuple_GET_ITEM(args, 1);
+            /* fall through */
+            case 1:
+                *a = PyTuple_GET_ITEM(args, 0);
+                break;
+            default:
+                TYPE_ERR("wrong number of arguments");
+                return 0;
+        }
+    }
+
+    return 1;
+
+}
+
+/* the arguments of a fone_t, for bn_blocks */
+typedef struct {
+    fone_t fone;
+    int axis;
+    int ddof;
+} fone_args;
+
+static PyObject *
+fone_block(PyArrayObject *a, void *args) {
+    fone_args *fa = (fone_args *)args;
+    return fa->fone(a, fa->axis, fa->ddof);
+}
+
+/* Reduce the elements of `a` that the bool array `where_obj`, broadcast to
+   the shape of `a`, includes. The broadcast uses zero strides, so memory
+   use does not grow with the size of `a`. axis < 0 reduces over all axes,
+   walking the axis of `a` with the smallest stride. */
+static PyObject *
+reduce_where(PyArrayObject *a,
+             PyObject *where_obj,
+             int axis,
+             int ddof,
+             fm_t mall,
+             fm_t mone) {
+    int i, j, ndim, mdim;
+    npy_intp stride, stride_min;
+    npy_intp strides[NPY_MAXDIMS];
+    const int out_type = PyArray_TYPE(a);
+    PyArrayObject *m;
+    PyObject *view, *y;
+
+    /* `where` is walked along with `a`, so input that has to be converted
+       is converted in one piece */
+    if (bn_convert(a)) {
+        a = bn_converted(a);
+        if (a == NULL) {
+            return NULL;
+        }
+    } else {
+        Py_INCREF(a);
+    }
+
+    m = (PyArrayObject *)PyArray_FROM_OTF(where_obj, NPY_BOOL,
+                                          NPY_ARRAY_ALIGNED);
+    if (m == NULL) {
+        Py_DECREF(a);
+        return NULL;
+    }
+    if (PyArray_NDIM(a) == 0) {
+        PyArrayObject *a_ravel = (PyArrayObject *)PyArray_Ravel(a,
+                                                               NPY_ANYORDER);
+        Py_DECREF(a);
+        if (a_ravel == NULL) {
+            Py_DECREF(m);
+            return NULL;
+        }
+        a = a_ravel;
+    }
+    ndim = PyArray_NDIM(a);
+    mdim = PyArray_NDIM(m);
+    for (i = 0; i < ndim; i++) {
+        j = i - (ndim - mdim);
+        if (j < 0 || PyArray_DIM(m, j) == 1) {
+            strides[i] = 0;
+        } else if (PyArray_DIM(m, j) == PyArray_DIM(a, i)) {
+            strides[i] = PyArray_STRIDE(m, j);
+        } else {
+            break;
+        }
+    }
+    if (i < ndim || mdim > ndim) {
+        VALUE_ERR("`where` cannot be broadcast to the shape of `a`");
+        Py_DECREF(m);
+        Py_DECREF(a);
+        return NULL;
+    }
+    Py_INCREF(PyArray_DESCR(m));
+    view = PyArray_NewFromDescr(&PyArray_Type, PyArray_DESCR(m), ndim,
+                                PyArray_SHAPE(a), strides, PyArray_DATA(m),
+                                0, NULL);
+    if (view == NULL) {
+        Py_DECREF(m);
+        Py_DECREF(a);
+        return NULL;
+    }
+    /* the view takes the reference to m, even on failure */
+    if (PyArray_SetBaseObject((PyArrayObject *)view, (PyObject *)m) < 0) {
+        Py_DECREF(view);
+        Py_DECREF(a);
+        return NULL;
+    }
+    m = (PyArrayObject *)view;
+
+    if (axis < 0) {
+        stride_min = NPY_MAX_INTP;
+        for (i = ndim - 1; i >= 0; i--) {
+            stride = PyArray_STRIDE(a, i);
+            stride = stride < 0 ? -stride : stride;
+            if (stride < stride_min) {
+                stride_min = stride;
+                axis = i;
+            }
+        }
+        y = mall(a, m, axis, ddof);
+    } else {
+        y = mone(a, m, axis, ddof);
+    }
+
+    Py_DECREF(m);
+    Py_DECREF(a);
+
+    if (y != NULL && out_type == NPY_FLOAT16 && PyArray_Check(y) &&
+        PyArray_TYPE((PyArrayObject *)y) != NPY_FLOAT16) {
+        /* float16 converted to float32 goes back to float16 */
+        PyObject *y16 = PyArray_Cast((PyArrayObject *)y, NPY_FLOAT16);
+        Py_DECREF(y);
+        y = y16;
+    }
+
+    return y;
+}
+
+static PyObject *
+reducer(PyObject *self,
+        char *name,
+        PyObject *args,
+        PyObject *kwds,
+        const fall_t *fall,
+        const fone_t *fone,
+        const fm_t *mall,
+        const fm_t *mone,
+        int flags) {
+
+    module_state *st = STATE(self);
+    int ndim;
+    int axis = 0; /* initialize to avoid compiler error */
+    int dtype;
+    int ddof;
+    int reduce_all = 0;
+
+    PyArrayObject *a;
+    PyObject *y;
+
+    PyObject *a_obj = NULL;
+    PyObject *axis_obj = Py_None;
+    PyObject *ddof_obj = NULL;
+    PyObject *where_obj = Py_None;
+
+    if (!parse_args(st, args, kwds, flags, &a_obj, &axis_obj, &ddof_obj,
+                    mall == NULL ? NULL : &where_obj)) {
+        return NULL;
+    }
+
+    /* convert to array if necessary */
+    if (PyArray_Check(a_obj)) {
+        a = (PyArrayObject *)a_obj;
+        Py_INCREF(a);
+    } else {
+        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
+        if (a == NULL) {
+            return NULL;
+        }
+    }
+
+    /* dtypes without a C function go to slow */
+    dtype = bn_dtype_index(a);
+    if (dtype < 0 || fall[dtype] == NULL ||
+        (where_obj != Py_None && mall[dtype] == NULL)) {
+        Py_DECREF(a);
+        return slow(st->slow, name, args, kwds);
+    }
+
+    /* does user want to reduce over all axes? */
+    if (axis_obj == Py_None) {
+        reduce_all = 1;
+    } else {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer or None");
+            goto error;
+        }
+        ndim = PyArray_NDIM(a);
+        if (axis < 0) {
+            axis += ndim;
+            if (axis < 0) {
+                PyErr_Format(PyExc_ValueError,
+                             "axis(=%d) out of bounds", axis);
+                goto error;
+            }
+        } else if (axis >= ndim) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+        if (ndim == 1) {
+            reduce_all = 1;
+        }
+    }
+
+    /* ddof */
+    if (ddof_obj == NULL) {
+        ddof = 0;
+    } else if (flags & BN_ARG_APPROX) {
+        ddof = PyObject_IsTrue(ddof_obj);
+        if (ddof == -1) {
+            goto error;
+        }
+    } else {
+        ddof = PyArray_PyIntAsInt(ddof_obj);
+        if (error_converting(ddof)) {
+            TYPE_ERR("`ddof` must be an integer");
+            goto error;
+        }
+    }
+
+    if (where_obj == Py_None && bn_out_of_core(a)) {
+        /* mapped file larger than bn_ooc_bytes */
+        y = reduce_out_of_core(name, a, reduce_all ? -1 : axis, flags, ddof);
+    } else if (where_obj != Py_None) {
+        y = reduce_where(a, where_obj, reduce_all ? -1 : axis, ddof,
+                         mall[dtype], mone[dtype]);
+    } else if (bn_convert(a)) {
+        /* byte swapped, unaligned, or float16 without _Float16 */
+        if (reduce_all == 1 && !(flags & BN_WHOLE_INPUT) &&
+            dtype < BN_NUMERIC_DTYPES && PyArray_NBYTES(a) > BN_BLOCK_BYTES) {
+            y = reduce_converted(name, a, flags, ddof);
+        } else if (reduce_all == 1) {
+            /* one converted copy */
+            PyArrayObject *b = bn_converted(a);
+            y = b == NULL ? NULL : fall[dtype](b, ddof);
+            Py_XDECREF(b);
+        } else {
+            fone_args fa = {fone[dtype], axis, ddof};
+            y = bn_blocks(a, axis, BN_BLOCK_REDUCE, fone_block, &fa);
+        }
+    } else if (reduce_all == 1) {
+        /* we are reducing the array along all axes */
+        y = fall[dtype](a, ddof);
+    } else {
+        /* we are reducing an array with ndim > 1 over a single axis */
+        y = fone[dtype](a, axis, ddof);
+    }
+
+    Py_DECREF(a);
+
+    return y;
+
+error:
+    Py_DECREF(a);
+    return NULL;
+
+}
+
+/* quantiler ------------------------------------------------------------- */
+
+static inline int
+parse_quantile_args(module_state *st,
+                    PyObject *args,
+                    PyObject *kwds,
+                    PyObject **a,
+                    PyObject **q,
+                    PyObject **axis,
+                    PyObject **method) {
+    PyObject **dest[4] = {a, q, axis, method};
+    PyObject *names[4] = {st->pystr_a, st->pystr_q, st->pystr_axis,
+                          st->pystr_method};
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    Py_ssize_t i, nkwds_found = 0;
+    PyObject *tmp;
+    if (nargs > 4) {
+        TYPE_ERR("wrong number of arguments");
+        return 0;
+    }
+    for (i = 0; i < nargs; i++) {
+        *dest[i] = PyTuple_GET_ITEM(args, i);
+    }
+    for (i = nargs; i < 4 && nkwds_found < nkwds; i++) {
+        tmp = PyDict_GetItem(kwds, names[i]);
+        if (tmp != NULL) {
+            *dest[i] = tmp;
+            nkwds_found++;
+        }
+    }
+    if (nkwds_found != nkwds) {
+        TYPE_ERR("wrong number of keyword arguments");
+        return 0;
+    }
+    if (*a == NULL) {
+        TYPE_ERR("Cannot find `a` keyword input");
+        return 0;
+    }
+    if (*q == NULL) {
+        TYPE_ERR("Cannot find `q` keyword input");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *
+quantiler(PyObject *self,
+          char *name,
+          PyObject *args,
+          PyObject *kwds,
+          const fquant_t *fquant_table,
+          int percent) {
+
+    module_state *st = STATE(self);
+    int i, ndim, qndim;
+    int axis = 0;
+    int dtype, out_type;
+    int method = QUANTILE_LINEAR;
+    npy_intp j, k, nq;
+    npy_intp shape[NPY_MAXDIMS];
+    npy_float64 qj;
+    npy_float64 *pq;
+    npy_float64 *q = NULL;
+    npy_intp *qpos = NULL;
+    fquant_t fquant;
+
+    PyArrayObject *a;
+    PyArrayObject *q_arr = NULL;
+    PyObject *y = NULL;
+
+    PyObject *a_obj = NULL;
+    PyObject *q_obj = NULL;
+    PyObject *axis_obj = Py_None;
+    PyObject *method_obj = NULL;
+
+    if (!parse_quantile_args(st, args, kwds, &a_obj, &q_obj, &axis_obj,
+                             &method_obj)) {
+        return NULL;
+    }
+
+    /* methods other than these five are left to numpy */
+    if (method_obj != NULL) {
+        if (!PyUnicode_Check(method_obj)) {
+            TYPE_ERR("`method` must be a string");
+            return NULL;
+        }
+        if (PyUnicode_CompareWithASCIIString(method_obj, "linear") == 0) {
+            method = QUANTILE_LINEAR;
+        } else if (PyUnicode_CompareWithASCIIString(method_obj,
+                                                    "lower") == 0) {
+            method = QUANTILE_LOWER;
+        } else if (PyUnicode_CompareWithASCIIString(method_obj,
+                                                    "higher") == 0) {
+            method = QUANTILE_HIGHER;
+        } else if (PyUnicode_CompareWithASCIIString(method_obj,
+                                                    "nearest") == 0) {
+            method = QUANTILE_NEAREST;
+        } else if (PyUnicode_CompareWithASCIIString(method_obj,
+                                                    "midpoint") == 0) {
+            method = QUANTILE_MIDPOINT;
+        } else {
+            return slow(st->slow, name, args, kwds);
+        }
+    }
+
+    /* convert to array if necessary */
+    if (PyArray_Check(a_obj)) {
+        a = (PyArrayObject *)a_obj;
+        Py_INCREF(a);
+    } else {
+        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
+        if (a == NULL) {
+            return NULL;
+        }
+    }
+
+    /* dtypes without a C function go to slow */
+    i = bn_dtype_index(a);
+    if (i < 0 || fquant_table[i] == NULL) {
+        Py_DECREF(a);
+        return slow(st->slow, name, args, kwds);
+    }
+
+    /* the quantiles copy each slice anyway, so input that has to be converted
+       is converted in one piece */
+    out_type = PyArray_TYPE(a);
+    if (bn_convert(a)) {
+        PyArrayObject *b = bn_converted(a);
+        Py_DECREF(a);
+        if (b == NULL) {
+            return NULL;
+        }
+        a = b;
+    }
+    fquant = fquant_table[i];
+    dtype = PyArray_TYPE(a);
+    if (dtype != NPY_FLOAT32 && dtype != NPY_FLOAT16) {
+        dtype = NPY_FLOAT64;
+    }
+
+    /* does user want to reduce over all axes? */
+    if (axis_obj == Py_None) {
+        PyArrayObject *a_ravel;
+        a_ravel = (PyArrayObject *)PyArray_Ravel(a, NPY_ANYORDER);
+        Py_DECREF(a);
+        if (a_ravel == NULL) {
+            return NULL;
+        }
+        a = a_ravel;
+    } else {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer or None");
+            goto error;
+        }
+        ndim = PyArray_NDIM(a);
+        if (axis < 0) {
+            axis += ndim;
+            if (axis < 0) {
+                PyErr_Format(PyExc_ValueError,
+                             "axis(=%d) out of bounds", axis);
+                goto error;
+            }
+        } else if (axis >= ndim) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+    }
+
+    /* q */
+    q_arr = (PyArrayObject *)PyArray_FROM_OTF(q_obj, NPY_FLOAT64,
+                                              NPY_ARRAY_IN_ARRAY);
+    if (q_arr == NULL) {
+        goto error;
+    }
+    qndim = PyArray_NDIM(q_arr);
+    ndim = PyArray_NDIM(a);
+    if (qndim + ndim - 1 > NPY_MAXDIMS) {
+        VALUE_ERR("too many dimensions in `q`");
+        goto error;
+    }
+    nq = PyArray_SIZE(q_arr);
+    q = malloc((nq + 1) * sizeof(npy_float64));
+    qpos = malloc((nq + 1) * sizeof(npy_intp));
+    if (q == NULL || qpos == NULL) {
+        MEMORY_ERR("Could not allocate memory for quantiles");
+        goto error;
+    }
+
+    /* sort q, keeping track of where each quantile goes in the output */
+    pq = (npy_float64 *)PyArray_DATA(q_arr);
+    for (j = 0; j < nq; j++) {
+        qj = percent ? pq[j] / 100 : pq[j];
+        if (!(qj >= 0 && qj <= 1)) {
+            if (percent) {
+                VALUE_ERR("Percentiles must be in the range [0, 100]");
+            } else {
+                VALUE_ERR("Quantiles must be in the range [0, 1]");
+            }
+            goto error;
+        }
+        for (k = j; k > 0 && q[k - 1] > qj; k--) {
+            q[k] = q[k - 1];
+            qpos[k] = qpos[k - 1];
+        }
+        q[k] = qj;
+        qpos[k] = j;
+    }
+
+    /* output shape is q.shape followed by a.shape with axis removed */
+    for (i = 0; i < qndim; i++) {
+        shape[i] = PyArray_DIM(q_arr, i);
+    }
+    for (i = 0; i < ndim; i++) {
+        if (i != axis) {
+            shape[qndim++] = PyArray_DIM(a, i);
+        }
+    }
+    y = PyArray_EMPTY(qndim, shape, dtype, 0);
+    if (y == NULL) {
+        goto error;
+    }
+
+    y = fquant(a, axis, y, q, qpos, nq, method);
+
+    free(q);
+    free(qpos);
+    Py_DECREF(q_arr);
+    Py_DECREF(a);
+
+    if (y != NULL && PyArray_NDIM((PyArrayObject *)y) == 0) {
+        npy_float64 value;
+        if (dtype == NPY_FLOAT32) {
+            value = *(npy_float32 *)PyArray_DATA((PyArrayObject *)y);
+        } else if (dtype == NPY_FLOAT16) {
+            value = *(bn_float16 *)PyArray_DATA((PyArrayObject *)y);
+        } else {
+            value = *(npy_float64 *)PyArray_DATA((PyArrayObject *)y);
+        }
+        Py_DECREF(y);
+        return PyFloat_FromDouble(value);
+    }
+
+    if (y != NULL && out_type == NPY_FLOAT16 && dtype != NPY_FLOAT16) {
+        /* float16 converted to float32 goes back to float16 */
+        PyObject *y16 = PyArray_Cast((PyArrayObject *)y, NPY_FLOAT16);
+        Py_DECREF(y);
+        y = y16;
+    }
+
+    return y;
+
+error:
+    free(q);
+    free(qpos);
+    Py_XDECREF(q_arr);
+    Py_DECREF(a);
+    return NULL;
+
+}
+
+/* weighter -------------------------------------------------------------- */
+
+/* a, weights, axis and, if has_ddof, ddof and reliability */
+static inline int
+parse_weighted_args(module_state *st,
+                    PyObject *args,
+                    PyObject *kwds,
+                    int has_ddof,
+                    PyObject **a,
+                    PyObject **weights,
+                    PyObject **axis,
+                    PyObject **ddof,
+                    PyObject **reliability) {
+    PyObject **dest[5] = {a, weights, axis, ddof, reliability};
+    PyObject *names[5] = {st->pystr_a, st->pystr_weights, st->pystr_axis,
+                          st->pystr_ddof, st->pystr_reliability};
+    const Py_ssize_t nparams = has_ddof ? 5 : 3;
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    Py_ssize_t i, nkwds_found = 0;
+    PyObject *tmp;
+    if (nargs > nparams) {
+        TYPE_ERR("wrong number of arguments");
+        return 0;
+    }
+    for (i = 0; i < nargs; i++) {
+        *dest[i] = PyTuple_GET_ITEM(args, i);
+    }
+    for (i = nargs; i < nparams && nkwds_found < nkwds; i++) {
+        tmp = PyDict_GetItem(kwds, names[i]);
+        if (tmp != NULL) {
+            *dest[i] = tmp;
+            nkwds_found++;
+        }
+    }
+    if (nkwds_found != nkwds) {
+        TYPE_ERR("wrong number of keyword arguments");
+        return 0;
+    }
+    if (*a == NULL) {
+        TYPE_ERR("Cannot find `a` keyword input");
+        return 0;
+    }
+    if (*weights == NULL) {
+        TYPE_ERR("Cannot find `weights` keyword input");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *
+weighter(PyObject *self,
+         char *name,
+         PyObject *args,
+         PyObject *kwds,
+         const fw_t *fall,
+         const fw_t *fone,
+         int has_ddof) {
+
+    module_state *st = STATE(self);
+    int i, ndim;
+    int axis = 0;
+    int dtype, out_type;
+    int ddof = 0;
+    int reliability = 0;
+    int reduce_all = 0;
+    npy_intp stride, stride_min;
+    npy_intp strides[NPY_MAXDIMS];
+
+    PyArrayObject *a;
+    PyArrayObject *w = NULL;
+    PyObject *y;
+
+    PyObject *a_obj = NULL;
+    PyObject *w_obj = NULL;
+    PyObject *axis_obj = Py_None;
+    PyObject *ddof_obj = NULL;
+    PyObject *reliability_obj = NULL;
+
+    if (!parse_weighted_args(st, args, kwds, has_ddof, &a_obj, &w_obj,
+                             &axis_obj, &ddof_obj, &reliability_obj)) {
+        return NULL;
+    }
+
+    /* convert to array if necessary */
+    if (PyArray_Check(a_obj)) {
+        a = (PyArrayObject *)a_obj;
+        Py_INCREF(a);
+    } else {
+        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
+        if (a == NULL) {
+            return NULL;
+        }
+    }
+
+    /* dtypes without a C function go to slow */
+    dtype = bn_dtype_index(a);
+    if (dtype < 0 || fall[dtype] == NULL) {
+        Py_DECREF(a);
+        return slow(st->slow, name, args, kwds);
+    }
+
+    /* the weights are walked along with `a`, so input that has to be
+       converted is converted in one piece */
+    out_type = PyArray_TYPE(a);
+    if (bn_convert(a)) {
+        PyArrayObject *b = bn_converted(a);
+        Py_DECREF(a);
+        if (b == NULL) {
+            return NULL;
+        }
+        a = b;
+    }
+    ndim = PyArray_NDIM(a);
+
+    /* does user want to reduce over all axes? */
+    if (axis_obj == Py_None) {
+        reduce_all = 1;
+    } else {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer or None");
+            goto error;
+        }
+        if (axis < 0) {
+            axis += ndim;
+            if (axis < 0) {
+                PyErr_Format(PyExc_ValueError,
+                             "axis(=%d) out of bounds", axis);
+                goto error;
+            }
+        } else if (axis >= ndim) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+        if (ndim == 1) {
+            reduce_all = 1;
+        }
+    }
+
+    /* ddof and reliability */
+    if (ddof_obj != NULL) {
+        ddof = PyArray_PyIntAsInt(ddof_obj);
+        if (error_converting(ddof)) {
+            TYPE_ERR("`ddof` must be an integer");
+            goto error;
+        }
+    }
+    if (reliability_obj != NULL) {
+        reliability = PyObject_IsTrue(reliability_obj);
+        if (reliability == -1) {
+            goto error;
+        }
+    }
+
+    /* weights have the shape of `a` or, as in np.average, are 1d with the
+       length of `a` along axis */
+    w = (PyArrayObject *)PyArray_FROM_OTF(w_obj, NPY_FLOAT64,
+                                          NPY_ARRAY_ALIGNED |
+                                          NPY_ARRAY_NOTSWAPPED);
+    if (w == NULL) {
+        goto error;
+    }
+    if (!PyArray_SAMESHAPE(a, w)) {
+        PyObject *view;
+        if (axis_obj == Py_None) {
+            TYPE_ERR("Axis must be specified when shapes of a and weights "
+                     "differ.");
+            goto error;
+        }
+        if (PyArray_NDIM(w) != 1) {
+            TYPE_ERR("1D weights expected when shapes of a and weights "
+                     "differ.");
+            goto error;
+        }
+        if (PyArray_DIM(w, 0) != PyArray_DIM(a, axis)) {
+            VALUE_ERR("Length of weights not compatible with specified "
+                      "axis.");
+            goto error;
+        }
+        /* repeat the weights along the other axes with zero strides */
+        for (i = 0; i < ndim; i++) {
+            strides[i] = i == axis ? PyArray_STRIDE(w, 0) : 0;
+        }
+        Py_INCREF(PyArray_DESCR(w));
+        view = PyArray_NewFromDescr(&PyArray_Type, PyArray_DESCR(w), ndim,
+                                    PyArray_SHAPE(a), strides,
+                                    PyArray_DATA(w), 0, NULL);
+        if (view == NULL) {
+            goto error;
+        }
+        if (PyArray_SetBaseObject((PyArrayObject *)view,
+                                  (PyObject *)w) < 0) {
+            w = NULL;
+            Py_DECREF(view);
+            goto error;
+        }
+        w = (PyArrayObject *)view;
+    }
+
+    if (reduce_all == 1) {
+        /* walk the slices along the axis of `a` with the smallest stride */
+        if (ndim == 0) {
+            PyArrayObject *a_ravel, *w_ravel;
+            a_ravel = (PyArrayObject *)PyArray_Ravel(a, NPY_ANYORDER);
+            w_ravel = (PyArrayObject *)PyArray_Ravel(w, NPY_ANYORDER);
+            Py_DECREF(a);
+            Py_DECREF(w);
+            a = a_ravel;
+            w = w_ravel;
+            if (a == NULL || w == NULL) {
+                goto error;
+            }
+            ndim = 1;
+        }
+        stride_min = NPY_MAX_INTP;
+        for (i = ndim - 1; i >= 0; i--) {
+            stride = PyArray_STRIDE(a, i);
+            stride = stride < 0 ? -stride : stride;
+            if (stride < stride_min) {
+                stride_min = stride;
+                axis = i;
+            }
+        }
+        y = fall[dtype](a, w, axis, ddof, reliability);
+    } else {
+        y = fone[dtype](a, w, axis, ddof, reliability);
+    }
+
+    Py_DECREF(w);
+    Py_DECREF(a);
+
+    if (y != NULL && out_type == NPY_FLOAT16 && PyArray_Check(y) &&
+        PyArray_TYPE((PyArrayObject *)y) != NPY_FLOAT16) {
+        /* float16 converted to float32 goes back to float16 */
+        PyObject *y16 = PyArray_Cast((PyArrayObject *)y, NPY_FLOAT16);
+        Py_DECREF(y);
+        y = y16;
+    }
+
+    return y;
+
+error:
+    Py_XDECREF(w);
+    Py_XDECREF(a);
+    return NULL;
+
+}
+
+/* segmenter ------------------------------------------------------------- */
+
+/* a, offsets, axis and, if has_ddof, ddof */
+static inline int
+parse_segment_args(module_state *st,
+                   PyObject *args,
+                   PyObject *kwds,
+                   int has_ddof,
+                   PyObject **a,
+                   PyObject **offsets,
+                   PyObject **axis,
+                   PyObject **ddof) {
+    PyObject **dest[4] = {a, offsets, axis, ddof};
+    PyObject *names[4] = {st->pystr_a, st->pystr_offsets, st->pystr_axis,
+                          st->pystr_ddof};
+    const Py_ssize_t nparams = has_ddof ? 4 : 3;
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    Py_ssize_t i, nkwds_found = 0;
+    PyObject *tmp;
+    if (nargs > nparams) {
+        TYPE_ERR("wrong number of arguments");
+        return 0;
+    }
+    for (i = 0; i < nargs; i++) {
+        *dest[i] = PyTuple_GET_ITEM(args, i);
+    }
+    for (i = nargs; i < nparams && nkwds_found < nkwds; i++) {
+        tmp = PyDict_GetItem(kwds, names[i]);
+        if (tmp != NULL) {
+            *dest[i] = tmp;
+            nkwds_found++;
+        }
+    }
+    if (nkwds_found != nkwds) {
+        TYPE_ERR("wrong number of keyword arguments");
+        return 0;
+    }
+    if (*a == NULL) {
+        TYPE_ERR("Cannot find `a` keyword input");
+        return 0;
+    }
+    if (*offsets == NULL) {
+        TYPE_ERR("Cannot find `offsets` keyword input");
+        return 0;
+    }
+    return 1;
+}
+
+/* the arguments of a fseg_t, for bn_blocks */
+typedef struct {
+    fseg_t fseg;
+    const npy_intp *offsets;
+    npy_intp nseg;
+    int axis;
+    int ddof;
+} seg_args;
+
+static PyObject *
+seg_block(PyArrayObject *a, void *args) {
+    seg_args *sa = (seg_args *)args;
+    return sa->fseg(a, sa->offsets, sa->nseg, sa->axis, sa->ddof);
+}
+
+static PyObject *
+segmenter(PyObject *self,
+          char *name,
+          PyObject *args,
+          PyObject *kwds,
+          const fseg_t *fseg,
+          int has_ddof) {
+
+    module_state *st = STATE(self);
+    int ndim;
+    int axis;
+    int dtype;
+    int ddof = 0;
+    npy_intp i, nseg;
+    const npy_intp *poffsets;
+
+    PyArrayObject *a;
+    PyArrayObject *offsets = NULL;
+    PyObject *y;
+
+    PyObject *a_obj = NULL;
+    PyObject *offsets_obj = NULL;
+    PyObject *axis_obj = NULL;
+    PyObject *ddof_obj = NULL;
+
+    if (!parse_segment_args(st, args, kwds, has_ddof, &a_obj, &offsets_obj,
+                            &axis_obj, &ddof_obj)) {
+        return NULL;
+    }
+
+    /* convert to array if necessary */
+    if (PyArray_Check(a_obj)) {
+        a = (PyArrayObject *)a_obj;
+        Py_INCREF(a);
+    } else {
+        a = (PyArrayObject *)PyArray_FROM_O(a_obj);
+        if (a == NULL) {
+            return NULL;
+        }
+    }
+
+    /* dtypes without a C function go to slow */
+    dtype = bn_dtype_index(a);
+    if (dtype < 0 || fseg[dtype] == NULL) {
+        Py_DECREF(a);
+        return slow(st->slow, name, args, kwds);
+    }
+
+    /* defend against the axis of negativity */
+    ndim = PyArray_NDIM(a);
+    if (axis_obj == NULL) {
+        axis = ndim - 1;
+        if (axis < 0) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+    } else if (axis_obj == Py_None) {
+        VALUE_ERR("`axis` cannot be None");
+        goto error;
+    } else {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer");
+            goto error;
+        }
+        if (axis < 0) {
+            axis += ndim;
+            if (axis < 0) {
+                PyErr_Format(PyExc_ValueError,
+                             "axis(=%d) out of bounds", axis);
+                goto error;
+            }
+        } else if (axis >= ndim) {
+            PyErr_Format(PyExc_ValueError, "axis(=%d) out of bounds", axis);
+            goto error;
+        }
+    }
+
+    /* ddof */
+    if (ddof_obj != NULL) {
+        ddof = PyArray_PyIntAsInt(ddof_obj);
+        if (error_converting(ddof)) {
+            TYPE_ERR("`ddof` must be an integer");
+            goto error;
+        }
+    }
+
+    /* offsets */
+    offsets = (PyArrayObject *)PyArray_FROM_OTF(offsets_obj, NPY_INTP,
+                                                NPY_ARRAY_IN_ARRAY);
+    if (offsets == NULL) {
+        goto error;
+    }
+    if (PyArray_NDIM(offsets) != 1 || PyArray_SIZE(offsets) == 0) {
+        VALUE_ERR("`offsets` must be 1d with at least one element");
+        goto error;
+    }
+    nseg = PyArray_SIZE(offsets) - 1;
+    poffsets = (const npy_intp *)PyArray_DATA(offsets);
+    if (poffsets[0] < 0 || poffsets[nseg] > PyArray_DIM(a, axis)) {
+        VALUE_ERR("`offsets` must be within the length of `a` along `axis`");
+        goto error;
+    }
+    for (i = 0; i < nseg; i++) {
+        if (poffsets[i + 1] < poffsets[i]) {
+            VALUE_ERR("`offsets` must be nondecreasing");
+            goto error;
+        }
+    }
+
+    if (bn_convert(a)) {
+        seg_args sa = {fseg[dtype], poffsets, nseg, axis, ddof};
+        y = bn_blocks(a, axis, BN_BLOCK_KEEP, seg_block, &sa);
+    } else {
+        y = fseg[dtype](a, poffsets, nseg, axis, ddof);
+    }
+
+    Py_DECREF(offsets);
+    Py_DECREF(a);
+
+    return y;
+
+error:
+    Py_XDECREF(offsets);
+    Py_DECREF(a);
+    return NULL;
+
+}
+
+/* batch ----------------------------------------------------------------- */
+
+/* a reducer that batch can apply */
+typedef struct {
+    const char *name;
+    PyCFunctionWithKeywords func;
+    const fall_t *fall;
+    const fone_t *fone;
+    int flags;                  /* BN_ARG_DDOF or BN_ARG_APPROX, if any */
+} batch_func;
+
+static const batch_func batch_funcs[] = {
+    {"nansum",    nansum,    nansum_fall,    nansum_fone,    0},
+    {"nanmean",   nanmean,   nanmean_fall,   nanmean_fone,   0},
+    {"nanstd",    nanstd,    nanstd_fall,    nanstd_fone,    BN_ARG_DDOF},
+    {"nanvar",    nanvar,    nanvar_fall,    nanvar_fone,    BN_ARG_DDOF},
+    {"nanmin",    nanmin,    nanmin_fall,    nanmin_fone,    0},
+    {"nanmax",    nanmax,    nanmax_fall,    nanmax_fone,    0},
+    {"nanargmin", nanargmin, nanargmin_fall, nanargmin_fone, 0},
+    {"nanargmax", nanargmax, nanargmax_fall, nanargmax_fone, 0},
+    {"ss",        ss,        ss_fall,        ss_fone,        0},
+    {"median",    median,    median_fall,    median_fone,    BN_ARG_APPROX},
+    {"nanmedian", nanmedian, nanmedian_fall, nanmedian_fone, BN_ARG_APPROX},
+    {"anynan",    anynan,    anynan_fall,    anynan_fone,    0},
+    {"allnan",    allnan,    allnan_fall,    allnan_fone,    0},
+    {NULL, NULL, NULL, NULL, 0}
+};
+
+/* `func` is a function name or a function with that __name__ */
+static const batch_func *
+batch_lookup(PyObject *func) {
+    const batch_func *f;
+    const char *name = NULL;
+    PyObject *name_obj;
+    if (PyUnicode_Check(func)) {
+        name_obj = func;
+        Py_INCREF(name_obj);
+    } else {
+        name_obj = PyObject_GetAttrString(func, "__name__");
+        if (name_obj == NULL) {
+            PyErr_Clear();
+        }
+    }
+    if (name_obj != NULL && PyUnicode_Check(name_obj)) {
+        name = PyUnicode_AsUTF8(name_obj);
+        if (name == NULL) {
+            Py_DECREF(name_obj);
+            return NULL;
+        }
+    }
+    for (f = batch_funcs; name != NULL && f->name != NULL; f++) {
+        if (strcmp(f->name, name) == 0) {
+            break;
+        }
+    }
+    Py_XDECREF(name_obj);
+    if (name == NULL || f->name == NULL) {
+        PyErr_Format(PyExc_ValueError, "batch does not support `func`=%R",
+                     func);
+        return NULL;
+    }
+    return f;
+}
+
+/* func, arrays, axis, ddof and stack */
+static inline int
+parse_batch_args(module_state *st,
+                 PyObject *args,
+                 PyObject *kwds,
+                 PyObject **func,
+                 PyObject **arrays,
+                 PyObject **axis,
+                 PyObject **ddof,
+                 PyObject **stack) {
+    PyObject **dest[5] = {func, arrays, axis, ddof, stack};
+    PyObject *names[5] = {st->pystr_func, st->pystr_arrays, st->pystr_axis,
+                          st->pystr_ddof, st->pystr_stack};
+    const Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+    const Py_ssize_t nkwds = kwds == NULL ? 0 : PyDict_Size(kwds);
+    Py_ssize_t i, nkwds_found = 0;
+    PyObject *tmp;
+    if (nargs > 5) {
+        TYPE_ERR("wrong number of arguments");
+        return 0;
+    }
+    for (i = 0; i < nargs; i++) {
+        *dest[i] = PyTuple_GET_ITEM(args, i);
+    }
+    for (i = nargs; i < 5 && nkwds_found < nkwds; i++) {
+        tmp = PyDict_GetItem(kwds, names[i]);
+        if (tmp != NULL) {
+            *dest[i] = tmp;
+            nkwds_found++;
+        }
+    }
+    if (nkwds_found != nkwds) {
+        TYPE_ERR("wrong number of keyword arguments");
+        return 0;
+    }
+    if (*func == NULL) {
+        TYPE_ERR("Cannot find `func` keyword input");
+        return 0;
+    }
+    if (*arrays == NULL) {
+        TYPE_ERR("Cannot find `arrays` keyword input");
+        return 0;
+    }
+    return 1;
+}
+
+/* f applied to one array through its top-level function, which takes care
+   of the slow functions, converted input and errors */
+static PyObject *
+batch_call(PyObject *self,
+           const batch_func *f,
+           PyArrayObject *a,
+           PyObject *axis,
+           PyObject *ddof) {
+    PyObject *y;
+    PyObject *args = ddof == NULL ? PyTuple_Pack(2, a, axis) :
+                                    PyTuple_Pack(3, a, axis, ddof);
+    if (args == NULL) {
+        return NULL;
+    }
+    y = f->func(self, args, NULL);
+    Py_DECREF(args);
+    return y;
+}
+
+/*
+ batch runs on the thread pool in parts, each a run of consecutive arrays
+ with about the same number of elements. A part takes the GIL to call the
+ low-level functions, which release it while they work on arrays of at
+ least the GIL threshold, so only those arrays count to size the split
+ unless the build of Python has no GIL. A part stops at the first array
+ that fails; the calling thread then does the rest of that part, which
+ raises the error again, if it recurs, in the order of the arrays.
+*/
+
+typedef struct {
+    PyObject *self;
+    const batch_func *f;
+    PyObject *arrays;           /* the input, converted to arrays */
+    PyObject *out;
+    PyObject *axis_obj;
+    PyObject *ddof_obj;
+    int axis;
+    int ddof;
+    PyInterpreterState *interp;
+    Py_ssize_t bounds[BN_POOL_MAX + 2];
+    Py_ssize_t done[BN_POOL_MAX + 1];
+} batch_part_t;
+
+/* f applied to arrays [start, end) into out; call with the GIL held.
+   Returns end or the array that failed, with the error set. */
+static Py_ssize_t
+batch_items(const batch_part_t *b, Py_ssize_t start, Py_ssize_t end) {
+    int ndim, ax;
+    int dtype = -1;
+    int direct = 0;
+    Py_ssize_t i;
+    PyArray_Descr *descr = NULL;
+    PyArrayObject *a;
+    PyObject *y;
+    for (i = start; i < end; i++) {
+        a = (PyArrayObject *)PyList_GET_ITEM(b->arrays, i);
+
+        /* the dispatch depends only on the dtype so it is redone only
+           when the dtype changes */
+        if (PyArray_DESCR(a) != descr) {
+            descr = PyArray_DESCR(a);
+            dtype = bn_dtype_index(a);
+            direct = dtype >= 0 && b->f->fall[dtype] != NULL &&
+                     !bn_convert(a);
+        }
+
+        ndim = PyArray_NDIM(a);
+        ax = b->axis < 0 ? b->axis + ndim : b->axis;
+        if (direct && (b->axis_obj == Py_None || (ndim == 1 && ax == 0))) {
+            y = b->f->fall[dtype](a, b->ddof);
+        } else if (direct && ax >= 0 && ax < ndim) {
+            y = b->f->fone[dtype](a, ax, b->ddof);
+        } else {
+            y = batch_call(b->self, b->f, a, b->axis_obj, b->ddof_obj);
+        }
+        if (y == NULL) {
+            return i;
+        }
+        PyList_SetItem(b->out, i, y);
+    }
+    return end;
+}
+
+static void
+batch_part(void *arg, int part, int nparts) {
+    batch_part_t *b = (batch_part_t *)arg;
+    PyThreadState *ts = PyThreadState_New(b->interp);
+    PyEval_RestoreThread(ts);
+    b->done[part] = batch_items(b, b->bounds[part], b->bounds[part + 1]);
+    PyErr_Clear();
+    PyThreadState_Clear(ts);
+    PyThreadState_DeleteCurrent();
+}
+
+static PyObject *
+batch(PyObject *self, PyObject *args, PyObject *kwds) {
+
+    module_state *st = STATE(self);
+    int axis = 0;
+    int ddof = 0;
+    int stack = 0;
+    int q, nparts;
+    Py_ssize_t i, n, size, work = 0, total = 0, cum = 0;
+    Py_ssize_t gil = BN_LOAD(bn_gil_threshold);
+
+    const batch_func *f;
+    batch_part_t b;
+    PyObject *seq, *item, *y;
+    PyObject *arrays = NULL;
+    PyObject *out = NULL;
+
+    PyObject *func_obj = NULL;
+    PyObject *arrays_obj = NULL;
+    PyObject *axis_obj = Py_None;
+    PyObject *ddof_obj = NULL;
+    PyObject *stack_obj = NULL;
+
+    if (!parse_batch_args(st, args, kwds, &func_obj, &arrays_obj, &axis_obj,
+                          &ddof_obj, &stack_obj)) {
+        return NULL;
+    }
+
+    f = batch_lookup(func_obj);
+    if (f == NULL) {
+        return NULL;
+    }
+
+    if (axis_obj != Py_None) {
+        axis = PyArray_PyIntAsInt(axis_obj);
+        if (error_converting(axis)) {
+            TYPE_ERR("`axis` must be an integer or None");
+            return NULL;
+        }
+    }
+
+    if (ddof_obj != NULL) {
+        if (!(f->flags & BN_ARG_DDOF)) {
+            PyErr_Format(PyExc_TypeError, "%s does not take `ddof`",
+                         f->name);
+            return NULL;
+        }
+        ddof = PyArray_PyIntAsInt(ddof_obj);
+        if (error_converting(ddof)) {
+            TYPE_ERR("`ddof` must be an integer");
+            return NULL;
+        }
+    }
+
+    if (stack_obj != NULL) {
+        stack = PyObject_IsTrue(stack_obj);
+        if (stack == -1) {
+            return NULL;
+        }
+    }
+
+    seq = PySequence_Fast(arrays_obj, "`arrays` must be a sequence");
+    if (seq == NULL) {
+        return NULL;
+    }
+    n = PySequence_Fast_GET_SIZE(seq);
+    arrays = PyList_New(n);
+    out = PyList_New(n);
+    if (arrays == NULL || out == NULL) {
+        goto error;
+    }
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyArray_Check(item)) {
+            Py_INCREF(item);
+        } else {
+            item = PyArray_FROM_O(item);
+            if (item == NULL) {
+                goto error;
+            }
+        }
+        PyList_SET_ITEM(arrays, i, item);
+        Py_INCREF(Py_None);
+        PyList_SET_ITEM(out, i, Py_None);
+        size = PyArray_SIZE((PyArrayObject *)item);
+        total += size + 1;
+#ifndef Py_GIL_DISABLED
+        if (gil < 0 || size < gil) continue;
+#endif
+        work += size;
+    }
+
+    b.self = self;
+    b.f = f;
+    b.arrays = arrays;
+    b.out = out;
+    b.axis_obj = axis_obj;
+    b.ddof_obj = ddof_obj;
+    b.axis = axis;
+    b.ddof = ddof;
+    nparts = bn_pool_parts(n, work);
+    if (nparts > 1) {
+        /* part q takes the arrays that start in the q-th of nparts equal
+           shares of the elements, counting one more for each array */
+        b.interp = PyInterpreterState_Get();
+        for (i = 0, q = 0; i < n; i++) {
+            while (q <= nparts && cum >= total * q / nparts) {
+                b.bounds[q++] = i;
+            }
+            item = PyList_GET_ITEM(arrays, i);
+            cum += PyArray_SIZE((PyArrayObject *)item) + 1;
+        }
+        while (q <= nparts) {
+            b.bounds[q++] = n;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        bn_pool_run(batch_part, &b, nparts);
+        Py_END_ALLOW_THREADS
+        for (q = 0; q < nparts; q++) {
+            i = b.bounds[q + 1];
+            if (batch_items(&b, b.done[q], i) < i) {
+                goto error;
+            }
+        }
+    } else if (batch_items(&b, 0, n) < n) {
+        goto error;
+    }
+
+    Py_DECREF(arrays);
+    Py_DECREF(seq);
+
+    if (stack) {
+        y = PyArray_FROM_O(out);
+        Py_DECREF(out);
+        return y;
+    }
+    return out;
+
+error:
+    Py_XDECREF(arrays);
+    Py_XDECREF(out);
+    Py_DECREF(seq);
+    return NULL;
+
+}
+
+/* docstrings ------------------------------------------------------------- */
+
+static char reduce_doc[] =
+"Bottleneck functions that reduce the input array along a specified axis.";
+
+static char nansum_doc[] =
+/* MULTILINE STRING BEGIN
+nansum(a, axis=None, where=None)
+
+Sum of array elements along given axis treating NaNs as zero.
+
+The data type (dtype) of the output is the same as the input. On 64-bit
+operating systems, 32-bit input is NOT upcast to 64-bit accumulator and
+return values.
+
+Parameters
+----------
+a : array_like
+    Array containing numbers whose sum is desired. If `a` is not an
+    array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the sum is computed. The default (axis=None) is to
+    compute the sum of the flattened array.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. By default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+
+Notes
+-----
+No error is raised on overflow.
+
+If positive or negative infinity are present the result is positive or
+negative infinity. But if both positive and negative infinity are present,
+the result is Not A Number (NaN).
+
+Examples
+--------
+>>> bn.nansum(1)
+1
+>>> bn.nansum([1])
+1
+>>> bn.nansum([1, np.nan])
+1.0
+>>> a = np.array([[1, 1], [1, np.nan]])
+>>> bn.nansum(a)
+3.0
+>>> bn.nansum(a, axis=0)
+array([ 2.,  1.])
+
+When positive infinity and negative infinity are present:
+
+>>> bn.nansum([1, np.nan, np.inf])
+inf
+>>> bn.nansum([1, np.nan, np.NINF])
+-inf
+>>> bn.nansum([1, np.nan, np.inf, np.NINF])
+nan
+
+MULTILINE STRING END */
+
+static char nanmean_doc[] =
+/* MULTILINE STRING BEGIN
+nanmean(a, axis=None, where=None)
+
+Mean of array elements along given axis ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs.
+
+Parameters
+----------
+a : array_like
+    Array containing numbers whose mean is desired. If `a` is not an
+    array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the means are computed. The default (axis=None) is to
+    compute the mean of the flattened array.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. By default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` intermediate and return values are used for integer inputs.
+
+See also
+--------
+bottleneck.nanmedian: Median along specified axis, ignoring NaNs.
+
+Notes
+-----
+No error is raised on overflow. (The sum is computed and then the result
+is divided by the number of non-NaN elements.)
+
+If positive or negative infinity are present the result is positive or
+negative infinity. But if both positive and negative infinity are present,
+the result is Not A Number (NaN).
+
+Examples
+--------
+>>> bn.nanmean(1)
+1.0
+>>> bn.nanmean([1])
+1.0
+>>> bn.nanmean([1, np.nan])
+1.0
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.nanmean(a)
+2.0
+>>> bn.nanmean(a, axis=0)
+array([ 1.,  4.])
+
+Skip the elements of the second column:
+
+>>> bn.nanmean(a, axis=1, where=[True, False])
+array([ 1.,  1.])
+
+When positive infinity and negative infinity are present:
+
+>>> bn.nanmean([1, np.nan, np.inf])
+inf
+>>> bn.nanmean([1, np.nan, np.NINF])
+-inf
+>>> bn.nanmean([1, np.nan, np.inf, np.NINF])
+nan
+
+MULTILINE STRING END */
+
+static char nanstd_doc[] =
+/* MULTILINE STRING BEGIN
+nanstd(a, axis=None, ddof=0, where=None)
+
+Standard deviation along the specified axis, ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs.
+
+Instead of a faster one-pass algorithm, a more stable two-pass algorithm
+is used.
+
+An example of a one-pass algorithm:
+
+    >>> np.sqrt((a*a).mean() - a.mean()**2)
+
+An example of a two-pass algorithm:
+
+    >>> np.sqrt(((a - a.mean())**2).mean())
+
+Note in the two-pass algorithm the mean must be found (first pass) before
+the squared deviation (second pass) can be found.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the standard deviation is computed. The default
+    (axis=None) is to compute the standard deviation of the flattened
+    array.
+ddof : int, optional
+    Means Delta Degrees of Freedom. The divisor used in calculations
+    is ``N - ddof``, where ``N`` represents the number of non-NaN elements.
+    By default `ddof` is zero.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. By default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` intermediate and return values are used for integer inputs.
+    If ddof is >= the number of non-NaN elements in a slice or the slice
+    contains only NaNs, then the result for that slice is NaN.
+
+See also
+--------
+bottleneck.nanvar: Variance along specified axis ignoring NaNs
+
+Notes
+-----
+If positive or negative infinity are present the result is Not A Number
+(NaN).
+
+Examples
+--------
+>>> bn.nanstd(1)
+0.0
+>>> bn.nanstd([1])
+0.0
+>>> bn.nanstd([1, np.nan])
+0.0
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.nanstd(a)
+1.4142135623730951
+>>> bn.nanstd(a, axis=0)
+array([ 0.,  0.])
+
+When positive infinity or negative infinity are present NaN is returned:
+
+>>> bn.nanstd([1, np.nan, np.inf])
+nan
+
+MULTILINE STRING END */
+
+static char nanvar_doc[] =
+/* MULTILINE STRING BEGIN
+nanvar(a, axis=None, ddof=0, where=None)
+
+Variance along the specified axis, ignoring NaNs.
+
+`float64` intermediate and return values are used for integer inputs.
+
+Instead of a faster one-pass algorithm, a more stable two-pass algorithm
+is used.
+
+An example of a one-pass algorithm:
+
+    >>> (a*a).mean() - a.mean()**2
+
+An example of a two-pass algorithm:
+
+    >>> ((a - a.mean())**2).mean()
+
+Note in the two-pass algorithm the mean must be found (first pass) before
+the squared deviation (second pass) can be found.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the variance is computed. The default (axis=None) is
+    to compute the variance of the flattened array.
+ddof : int, optional
+    Means Delta Degrees of Freedom. The divisor used in calculations
+    is ``N - ddof``, where ``N`` represents the number of non_NaN elements.
+    By default `ddof` is zero.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. By default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis
+    removed. If `a` is a 0-d array, or if axis is None, a scalar is
+    returned. `float64` intermediate and return values are used for
+    integer inputs. If ddof is >= the number of non-NaN elements in a
+    slice or the slice contains only NaNs, then the result for that slice
+    is NaN.
+
+See also
+--------
+bottleneck.nanstd: Standard deviation along specified axis ignoring NaNs.
+
+Notes
+-----
+If positive or negative infinity are present the result is Not A Number
+(NaN).
+
+Examples
+--------
+>>> bn.nanvar(1)
+0.0
+>>> bn.nanvar([1])
+0.0
+>>> bn.nanvar([1, np.nan])
+0.0
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.nanvar(a)
+2.0
+>>> bn.nanvar(a, axis=0)
+array([ 0.,  0.])
+
+When positive infinity or negative infinity are present NaN is returned:
+
+>>> bn.nanvar([1, np.nan, np.inf])
+nan
+
+MULTILINE STRING END */
+
+static char nanmin_doc[] =
+/* MULTILINE STRING BEGIN
+nanmin(a, axis=None, where=None)
+
+Minimum values along specified axis, ignoring NaNs.
+
+When all-NaN slices are encountered, NaN is returned for that slice.
+NaT in datetime64 and timedelta64 input is ignored in the same way.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the minimum is computed. The default (axis=None) is
+    to compute the minimum of the flattened array.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. A slice of integer input must keep at least one element. By
+    default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned. The
+    same dtype as `a` is returned.
+
+See also
+--------
+bottleneck.nanmax: Maximum along specified axis, ignoring NaNs.
+bottleneck.nanargmin: Indices of minimum values along axis, ignoring NaNs.
+
+Examples
+--------
+>>> bn.nanmin(1)
+1
+>>> bn.nanmin([1])
+1
+>>> bn.nanmin([1, np.nan])
+1.0
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.nanmin(a)
+1.0
+>>> bn.nanmin(a, axis=0)
+array([ 1.,  4.])
+
+MULTILINE STRING END */
+
+static char nanmax_doc[] =
+/* MULTILINE STRING BEGIN
+nanmax(a, axis=None, where=None)
+
+Maximum values along specified axis, ignoring NaNs.
+
+When all-NaN slices are encountered, NaN is returned for that slice.
+NaT in datetime64 and timedelta64 input is ignored in the same way.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the maximum is computed. The default (axis=None) is
+    to compute the maximum of the flattened array.
+where : array_like of bool, optional
+    Elements to include, broadcast to the shape of `a`. Elements where
+    `where` is False are skipped like NaNs, without a NaN-filled copy of
+    `a`. A slice of integer input must keep at least one element. By
+    default (None) all elements are included.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned. The
+    same dtype as `a` is returned.
+
+See also
+--------
+bottleneck.nanmin: Minimum along specified axis, ignoring NaNs.
+bottleneck.nanargmax: Indices of maximum values along axis, ignoring NaNs.
+
+Examples
+--------
+>>> bn.nanmax(1)
+1
+>>> bn.nanmax([1])
+1
+>>> bn.nanmax([1, np.nan])
+1.0
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.nanmax(a)
+4.0
+>>> bn.nanmax(a, axis=0)
+array([ 1.,  4.])
+
+MULTILINE STRING END */
+
+static char nanargmin_doc[] =
+/* MULTILINE STRING BEGIN
+nanargmin(a, axis=None)
+
+Indices of the minimum values along an axis, ignoring NaNs.
+
+For all-NaN slices ``ValueError`` is raised. Unlike NumPy, the results
+can be trusted if a slice contains only NaNs and Infs.
+NaT in datetime64 and timedelta64 input is ignored like NaN.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which to operate. By default (axis=None) flattened input
+    is used.
+
+See also
+--------
+bottleneck.nanargmax: Indices of the maximum values along an axis.
+bottleneck.nanmin: Minimum values along specified axis, ignoring NaNs.
+
+Returns
+-------
+index_array : ndarray
+    An array of indices or a single index value.
+
+Examples
+--------
+>>> a = np.array([[np.nan, 4], [2, 3]])
+>>> bn.nanargmin(a)
+2
+>>> a.flat[2]
+2.0
+>>> bn.nanargmin(a, axis=0)
+array([1, 1])
+>>> bn.nanargmin(a, axis=1)
+array([1, 0])
+
+MULTILINE STRING END */
+
+static char nanargmax_doc[] =
+/* MULTILINE STRING BEGIN
+nanargmax(a, axis=None)
+
+Indices of the maximum values along an axis, ignoring NaNs.
+
+For all-NaN slices ``ValueError`` is raised. Unlike NumPy, the results
+can be trusted if a slice contains only NaNs and Infs.
+NaT in datetime64 and timedelta64 input is ignored like NaN.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which to operate. By default (axis=None) flattened input
+    is used.
+
+See also
+--------
+bottleneck.nanargmin: Indices of the minimum values along an axis.
+bottleneck.nanmax: Maximum values along specified axis, ignoring NaNs.
+
+Returns
+-------
+index_array : ndarray
+    An array of indices or a single index value.
+
+Examples
+--------
+>>> a = np.array([[np.nan, 4], [2, 3]])
+>>> bn.nanargmax(a)
+1
+>>> a.flat[1]
+4.0
+>>> bn.nanargmax(a, axis=0)
+array([1, 0])
+>>> bn.nanargmax(a, axis=1)
+array([1, 1])
+
+MULTILINE STRING END */
+
+static char ss_doc[] =
+/* MULTILINE STRING BEGIN
+ss(a, axis=None)
+
+Sum of the square of each element along the specified axis.
+
+Parameters
+----------
+a : array_like
+    Array whose sum of squares is desired. If `a` is not an array, a
+    conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the sum of squares is computed. The default
+    (axis=None) is to sum the squares of the flattened array.
+
+Returns
+-------
+y : ndarray
+    The sum of a**2 along the given axis.
+
+Examples
+--------
+>>> a = np.array([1., 2., 5.])
+>>> bn.ss(a)
+30.0
+
+And calculating along an axis:
+
+>>> b = np.array([[1., 2., 5.], [2., 5., 6.]])
+>>> bn.ss(b, axis=1)
+array([ 30., 65.])
+
+MULTILINE STRING END */
+
+static char median_doc[] =
+/* MULTILINE STRING BEGIN
+median(a, axis=None, approx=False)
+
+Median of array elements along given axis.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the median is computed. The default (axis=None) is to
+    compute the median of the flattened array.
+approx : bool, optional
+    If True, the median of all values of float64 input (axis=None or 1d
+    input) may be returned with a relative error of up to 2**-20, which
+    saves a pass over the data for large arrays. Other results are exact.
+    Default is False.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, except that the specified axis
+    has been removed. If `a` is a 0d array, or if axis is None, a scalar
+    is returned. `float64` return values are used for integer inputs. NaN
+    is returned for a slice that contains one or more NaNs.
+
+See also
+--------
+bottleneck.nanmedian: Median along specified axis ignoring NaNs.
+
+Notes
+-----
+The median of 4194304 or more values along all axes is found without
+copying the input: histograms of the leading bits of the values narrow the
+search down to the few values near the middle, which are then copied.
+
+Examples
+--------
+>>> a = np.array([[10, 7, 4], [3, 2, 1]])
+>>> bn.median(a)
+    3.5
+>>> bn.median(a, axis=0)
+    array([ 6.5,  4.5,  2.5])
+>>> bn.median(a, axis=1)
+    array([ 7.,  2.])
+
+MULTILINE STRING END */
+
+static char nanmedian_doc[] =
+/* MULTILINE STRING BEGIN
+nanmedian(a, axis=None, approx=False)
+
+Median of array elements along given axis ignoring NaNs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which the median is computed. The default (axis=None) is to
+    compute the median of the flattened array.
+approx : bool, optional
+    If True, the median of all values of float64 input (axis=None or 1d
+    input) may be returned with a relative error of up to 2**-20, which
+    saves a pass over the data for large arrays. Other results are exact.
+    Default is False.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, except that the specified axis
+    has been removed. If `a` is a 0d array, or if axis is None, a scalar
+    is returned. `float64` return values are used for integer inputs.
+
+See also
+--------
+bottleneck.median: Median along specified axis.
+
+Notes
+-----
+The median of 4194304 or more values along all axes is found without
+copying the input: histograms of the leading bits of the values narrow the
+search down to the few values near the middle, which are then copied.
+
+Examples
+--------
+>>> a = np.array([[np.nan, 7, 4], [3, 2, 1]])
+>>> a
+array([[ nan,   7.,   4.],
+       [  3.,   2.,   1.]])
+>>> bn.nanmedian(a)
+3.0
+>> bn.nanmedian(a, axis=0)
+array([ 3. ,  4.5,  2.5])
+>> bn.nanmedian(a, axis=1)
+array([ 5.5,  2. ])
+
+MULTILINE STRING END */
+
+static char nanquantile_doc[] =
+/* MULTILINE STRING BEGIN
+nanquantile(a, q, axis=None, method='linear')
+
+Quantiles of array elements along given axis ignoring NaNs.
+
+Each slice is copied once and the quantiles are found, in increasing
+order, by partial selection on a shrinking part of the copy, so asking for
+several quantiles costs little more than asking for one.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+q : array_like of float
+    Quantile or sequence of quantiles to compute, which must be between
+    0 and 1 inclusive.
+axis : {int, None}, optional
+    Axis along which the quantiles are computed. The default (axis=None)
+    is to compute the quantiles of the flattened array.
+method : str, optional
+    One of 'linear' (default), 'lower', 'higher', 'nearest' or 'midpoint',
+    with the same meaning as in `numpy.nanquantile`. Other methods are
+    passed on to `numpy.nanquantile`.
+
+Returns
+-------
+y : ndarray
+    If `q` is a scalar, an array with the same shape as `a`, except that
+    the specified axis has been removed; if `q` is an array, the shape of
+    `q` is prepended. If the result is 0d a scalar is returned.
+    `float64` return values are used for integer inputs. NaN is returned
+    for a slice that contains only NaNs.
+
+See also
+--------
+bottleneck.nanpercentile: Percentiles along specified axis ignoring NaNs.
+bottleneck.nanmedian: Median along specified axis ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[np.nan, 7, 4], [3, 2, 1]])
+>>> bn.nanquantile(a, 0.5)
+3.0
+>>> bn.nanquantile(a, [0.25, 0.75], axis=1)
+array([[ 4.75,  1.5 ],
+       [ 6.25,  2.5 ]])
+>>> bn.nanquantile(a, 0.5, axis=0, method='lower')
+array([ 3.,  2.,  1.])
+
+MULTILINE STRING END */
+
+static char nanpercentile_doc[] =
+/* MULTILINE STRING BEGIN
+nanpercentile(a, q, axis=None, method='linear')
+
+Percentiles of array elements along given axis ignoring NaNs.
+
+Same as `bottleneck.nanquantile` with `q` given in percent.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+q : array_like of float
+    Percentile or sequence of percentiles to compute, which must be
+    between 0 and 100 inclusive.
+axis : {int, None}, optional
+    Axis along which the percentiles are computed. The default
+    (axis=None) is to compute the percentiles of the flattened array.
+method : str, optional
+    One of 'linear' (default), 'lower', 'higher', 'nearest' or 'midpoint',
+    with the same meaning as in `numpy.nanpercentile`. Other methods are
+    passed on to `numpy.nanpercentile`.
+
+Returns
+-------
+y : ndarray
+    If `q` is a scalar, an array with the same shape as `a`, except that
+    the specified axis has been removed; if `q` is an array, the shape of
+    `q` is prepended. If the result is 0d a scalar is returned.
+    `float64` return values are used for integer inputs. NaN is returned
+    for a slice that contains only NaNs.
+
+See also
+--------
+bottleneck.nanquantile: Quantiles along specified axis ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[np.nan, 7, 4], [3, 2, 1]])
+>>> bn.nanpercentile(a, 50)
+3.0
+>>> bn.nanpercentile(a, [25, 75], axis=1)
+array([[ 4.75,  1.5 ],
+       [ 6.25,  2.5 ]])
+
+MULTILINE STRING END */
+
+static char nanwsum_doc[] =
+/* MULTILINE STRING BEGIN
+nanwsum(a, weights, axis=None)
+
+Weighted sum along the specified axis, ignoring NaNs.
+
+The equivalent numpy code:
+
+    >>> np.where(np.isnan(a), 0, a * weights).sum(axis)
+
+`float64` intermediate values are used for all inputs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+weights : array_like
+    Weights with the shape of `a` or, if `axis` is given, a 1d array with
+    the length of `a` along `axis`. The weights of NaNs in `a` are skipped.
+axis : {int, None}, optional
+    Axis along which the weighted sum is computed. The default (axis=None)
+    is to compute the weighted sum of the flattened array.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` return values are used for integer inputs. Zero is returned
+    for a slice that contains only NaNs.
+
+See also
+--------
+bottleneck.nanwmean: Weighted mean along specified axis, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[1, 2, np.nan], [3, 4, 5]])
+>>> bn.nanwsum(a, [1, 2, 3], axis=1)
+array([ 5., 26.])
+
+MULTILINE STRING END */
+
+static char nanwmean_doc[] =
+/* MULTILINE STRING BEGIN
+nanwmean(a, weights, axis=None)
+
+Weighted mean along the specified axis, ignoring NaNs.
+
+The weights of NaNs in `a` are left out of the sum of the weights, so the
+result is the weighted mean of the non-NaN elements; with the equivalent
+numpy code:
+
+    >>> mask = np.isnan(a)
+    >>> w = np.where(mask, 0, weights)
+    >>> np.where(mask, 0, a * w).sum(axis) / w.sum(axis)
+
+The data and the weights are walked together in one pass without
+temporary arrays. `float64` intermediate values are used for all inputs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+weights : array_like
+    Weights with the shape of `a` or, if `axis` is given, a 1d array with
+    the length of `a` along `axis`.
+axis : {int, None}, optional
+    Axis along which the weighted mean is computed. The default
+    (axis=None) is to compute the weighted mean of the flattened array.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` return values are used for integer inputs. NaN is returned
+    for a slice that contains only NaNs or whose weights sum to zero.
+
+See also
+--------
+bottleneck.nanmean: Mean along specified axis, ignoring NaNs.
+bottleneck.nanwvar: Weighted variance along specified axis, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[1, 2, np.nan], [3, 4, 5]])
+>>> bn.nanwmean(a, [1, 2, 3], axis=1)
+array([1.66666667, 4.33333333])
+
+MULTILINE STRING END */
+
+static char nanwstd_doc[] =
+/* MULTILINE STRING BEGIN
+nanwstd(a, weights, axis=None, ddof=0, reliability=False)
+
+Weighted standard deviation along the specified axis, ignoring NaNs.
+
+The square root of `bottleneck.nanwvar`; see there for the meaning of
+`ddof` and `reliability`.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+weights : array_like
+    Weights with the shape of `a` or, if `axis` is given, a 1d array with
+    the length of `a` along `axis`.
+axis : {int, None}, optional
+    Axis along which the standard deviation is computed. The default
+    (axis=None) is to compute the standard deviation of the flattened
+    array.
+ddof : int, optional
+    Means Delta Degrees of Freedom. By default `ddof` is zero.
+reliability : bool, optional
+    If True the weights are reliability weights; by default they are
+    frequency weights.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` return values are used for integer inputs. NaN is returned
+    for a slice that contains only NaNs, whose weights sum to zero or
+    whose divisor is not positive.
+
+See also
+--------
+bottleneck.nanwvar: Weighted variance along specified axis, ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[1, 2, np.nan], [3, 4, 5]])
+>>> bn.nanwstd(a, [1, 2, 3], axis=1)
+array([0.47140452, 0.74535599])
+
+MULTILINE STRING END */
+
+static char nanwvar_doc[] =
+/* MULTILINE STRING BEGIN
+nanwvar(a, weights, axis=None, ddof=0, reliability=False)
+
+Weighted variance along the specified axis, ignoring NaNs.
+
+With the sums taken over the non-NaN elements of a slice, the weighted
+mean is ``m = sum(w * a) / V1`` where ``V1 = sum(w)`` and the variance is
+``sum(w * (a - m)**2)`` divided by
+
+    ``V1 - ddof`` for frequency weights (the default), where a weight is
+    the number of times a value was observed, or
+    ``V1 - ddof * V2 / V1`` for reliability weights, where ``V2 =
+    sum(w**2)`` and the weights only have to be relative.
+
+With ddof=1 both give an unbiased estimate; with ddof=0 they are the same.
+As in `bottleneck.nanvar` the mean is found in a first pass and the
+squared deviations in a second pass. `float64` intermediate values are
+used for all inputs.
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+weights : array_like
+    Weights with the shape of `a` or, if `axis` is given, a 1d array with
+    the length of `a` along `axis`.
+axis : {int, None}, optional
+    Axis along which the variance is computed. The default (axis=None) is
+    to compute the variance of the flattened array.
+ddof : int, optional
+    Means Delta Degrees of Freedom. By default `ddof` is zero.
+reliability : bool, optional
+    If True the weights are reliability weights; by default they are
+    frequency weights.
+
+Returns
+-------
+y : ndarray
+    An array with the same shape as `a`, with the specified axis removed.
+    If `a` is a 0-d array, or if axis is None, a scalar is returned.
+    `float64` return values are used for integer inputs. NaN is returned
+    for a slice that contains only NaNs, whose weights sum to zero or
+    whose divisor is not positive.
+
+See also
+--------
+bottleneck.nanvar: Variance along specified axis, ignoring NaNs.
+bottleneck.nanwstd: Weighted standard deviation along specified axis,
+    ignoring NaNs.
+
+Examples
+--------
+>>> a = np.array([[1, 2, np.nan], [3, 4, 5]])
+>>> bn.nanwvar(a, [1, 2, 3], axis=1)
+array([0.22222222, 0.55555556])
+>>> bn.nanwvar(a, [1, 2, 3], axis=1, ddof=1)
+array([0.33333333, 0.66666667])
+>>> bn.nanwvar(a, [1, 2, 3], axis=1, ddof=1, reliability=True)
+array([0.5       , 0.90909091])
+
+MULTILINE STRING END */
+
+static char anynan_doc[] =
+/* MULTILINE STRING BEGIN
+anynan(a, axis=None)
+
+Test whether any array element along a given axis is NaN.
+
+Returns the same output as np.isnan(a).any(axis)
+
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+axis : {int, None}, optional
+    Axis along which NaNs are searched. The default (`axis` = ``None``)
+    is to search for NaNs over a flattened input array.
 
-error:
-    Py_DECREF(a);
-    return NULL;
+Returns
+-------
+y : bool or ndarray
+    A boolean or new `ndarray` is returned.
 
-}
+See also
+--------
+bottleneck.allnan: Test if all array elements along given axis are NaN
 
-/* docstrings ------------------------------------------------------------- */
+Examples
+--------
+>>> bn.anynan(1)
+False
+>>> bn.anynan(np.nan)
+True
+>>> bn.anynan([1, np.nan])
+True
+>>> a = np.array([[1, 4], [1, np.nan]])
+>>> bn.anynan(a)
+True
+>>> bn.anynan(a, axis=0)
+array([False,  True], dtype=bool)
 
-static char reduce_doc[] =
-"Bottleneck functions that reduce the input array along a specified axis.";
+MULTILINE STRING END */
 
-static char nansum_doc[] =
+static char allnan_doc[] =
 /* MULTILINE STRING BEGIN
-nansum(a, axis=None)
+allnan(a, axis=None)
 
-Sum of array elements along given axis treating NaNs as zero.
+Test whether all array elements along a given axis are NaN.
 
-The data type (dtype) of the output is the same as the input. On 64-bit
-operating systems, 32-bit input is NOT upcast to 64-bit accumulator and
-return values.
+Returns the same output as np.isnan(a).all(axis)
+
+Note that allnan([]) is True to match np.isnan([]).all() and all([])
 
 Parameters
 ----------
 a : array_like
-    Array containing numbers whose sum is desired. If `a` is not an
-    array, a conversion is attempted.
+    Input array. If `a` is not an array, a conversion is attempted.
 axis : {int, None}, optional
-    Axis along which the sum is computed. The default (axis=None) is to
-    compute the sum of the flattened array.
+    Axis along which NaNs are searched. The default (`axis` = ``None``)
+    is to search for NaNs over a flattened input array.
 
 Returns
 -------
-y : ndarray
-    An array with the same shape as `a`, with the specified axis removed.
-    If `a` is a 0-d array, or if axis is None, a scalar is returned.
-
-Notes
------
-No error is raised on overflow.
+y : bool or ndarray
+    A boolean or new `ndarray` is returned.
 
-If positive or negative infinity are present the result is positive or
-negative infinity. But if both positive and negative infinity are present,
-the result is Not A Number (NaN).
+See also
+--------
+bottleneck.anynan: Test if any array element along given axis is NaN
 
 Examples
 --------
->>> bn.nansum(1)
-1
->>> bn.nansum([1])
-1
->>> bn.nansum([1, np.nan])
-1.0
->>> a = np.array([[1, 1], [1, np.nan]])
->>> bn.nansum(a)
-3.0
->>> bn.nansum(a, axis=0)
-array([ 2.,  1.])
+>>> bn.allnan(1)
+False
+>>> bn.allnan(np.nan)
+True
+>>> bn.allnan([1, np.nan])
+False
+>>> a = np.array([[1, np.nan], [1, np.nan]])
+>>> bn.allnan(a)
+False
+>>> bn.allnan(a, axis=0)
+array([False,  True], dtype=bool)
 
-When positive infinity and negative infinity are present:
+An empty array returns True:
 
->>> bn.nansum([1, np.nan, np.inf])
-inf
->>> bn.nansum([1, np.nan, np.NINF])
--inf
->>> bn.nansum([1, np.nan, np.inf, np.NINF])
-nan
+>>> bn.allnan([])
+True
+
+which is similar to:
+
+>>> all([])
+True
+>>> np.isnan([]).all()
+True
 
 MULTILINE STRING END */
 
-static char nanmean_doc[] =
+static char segment_nansum_doc[] =
 /* MULTILINE STRING BEGIN
-nanmean(a, axis=None)
+segment_nansum(a, offsets, axis=-1)
 
-Mean of array elements along given axis ignoring NaNs.
+Sum of each segment along the specified axis, ignoring NaNs.
 
-`float64` intermediate and return values are used for integer inputs.
+The equivalent numpy code, for each segment s:
+
+    >>> np.nansum(a[..., offsets[s]:offsets[s + 1]], axis=-1)
+
+where `axis` is the last axis. This is the layout of an Arrow list array:
+one flat array of values and the offsets at which each list starts.
 
 Parameters
 ----------
 a : array_like
-    Array containing numbers whose mean is desired. If `a` is not an
-    array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the means are computed. The default (axis=None) is to
-    compute the mean of the flattened array.
+    Input array. If `a` is not an array, a conversion is attempted.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, with the specified axis removed.
-    If `a` is a 0-d array, or if axis is None, a scalar is returned.
-    `float64` intermediate and return values are used for integer inputs.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. Integer sums are
+    int64 (uint64 for unsigned input), and the sum of an empty segment or
+    of a segment of NaNs is zero.
 
 See also
 --------
-bottleneck.nanmedian: Median along specified axis, ignoring NaNs.
-
-Notes
------
-No error is raised on overflow. (The sum is computed and then the result
-is divided by the number of non-NaN elements.)
-
-If positive or negative infinity are present the result is positive or
-negative infinity. But if both positive and negative infinity are present,
-the result is Not A Number (NaN).
+bottleneck.nansum: Sum along specified axis, ignoring NaNs.
+bottleneck.group_nansum: Sum of each group, ignoring NaNs.
 
 Examples
 --------
->>> bn.nanmean(1)
-1.0
->>> bn.nanmean([1])
-1.0
->>> bn.nanmean([1, np.nan])
-1.0
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.nanmean(a)
-2.0
->>> bn.nanmean(a, axis=0)
-array([ 1.,  4.])
-
-When positive infinity and negative infinity are present:
-
->>> bn.nanmean([1, np.nan, np.inf])
-inf
->>> bn.nanmean([1, np.nan, np.NINF])
--inf
->>> bn.nanmean([1, np.nan, np.inf, np.NINF])
-nan
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> bn.segment_nansum(a, [0, 2, 2, 5])
+array([3., 0., 9.])
 
 MULTILINE STRING END */
 
-static char nanstd_doc[] =
+static char segment_nanmean_doc[] =
 /* MULTILINE STRING BEGIN
-nanstd(a, axis=None, ddof=0)
+segment_nanmean(a, offsets, axis=-1)
 
-Standard deviation along the specified axis, ignoring NaNs.
+Mean of each segment along the specified axis, ignoring NaNs.
 
 `float64` intermediate and return values are used for integer inputs.
 
-Instead of a faster one-pass algorithm, a more stable two-pass algorithm
-is used.
+Parameters
+----------
+a : array_like
+    Input array. If `a` is not an array, a conversion is attempted.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
-An example of a one-pass algorithm:
+Returns
+-------
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. NaN is returned
+    for an empty segment or a segment of NaNs.
 
-    >>> np.sqrt((a*a).mean() - a.mean()**2)
+See also
+--------
+bottleneck.nanmean: Mean along specified axis, ignoring NaNs.
 
-An example of a two-pass algorithm:
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> bn.segment_nanmean(a, [0, 2, 2, 5])
+array([1.5, nan, 4.5])
 
-    >>> np.sqrt(((a - a.mean())**2).mean())
+MULTILINE STRING END */
 
-Note in the two-pass algorithm the mean must be found (first pass) before
-the squared deviation (second pass) can be found.
+static char segment_nanstd_doc[] =
+/* MULTILINE STRING BEGIN
+segment_nanstd(a, offsets, axis=-1, ddof=0)
+
+Standard deviation of each segment along the specified axis, ignoring
+NaNs.
+
+`float64` intermediate and return values are used for integer inputs.
+As in `bottleneck.nanstd` the mean of each segment is found first and the
+squared deviations from it in a second pass over the segment.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the standard deviation is computed. The default
-    (axis=None) is to compute the standard deviation of the flattened
-    array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 ddof : int, optional
     Means Delta Degrees of Freedom. The divisor used in calculations
-    is ``N - ddof``, where ``N`` represents the number of non-NaN elements.
-    By default `ddof` is zero.
+    is ``N - ddof``, where ``N`` represents the number of non-NaN elements
+    of the segment. By default `ddof` is zero.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, with the specified axis removed.
-    If `a` is a 0-d array, or if axis is None, a scalar is returned.
-    `float64` intermediate and return values are used for integer inputs.
-    If ddof is >= the number of non-NaN elements in a slice or the slice
-    contains only NaNs, then the result for that slice is NaN.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. NaN is returned
+    for a segment with ddof or fewer non-NaN elements.
 
 See also
 --------
-bottleneck.nanvar: Variance along specified axis ignoring NaNs
-
-Notes
------
-If positive or negative infinity are present the result is Not A Number
-(NaN).
+bottleneck.nanstd: Standard deviation along specified axis, ignoring NaNs.
+bottleneck.segment_nanvar: Variance of each segment, ignoring NaNs.
 
 Examples
 --------
->>> bn.nanstd(1)
-0.0
->>> bn.nanstd([1])
-0.0
->>> bn.nanstd([1, np.nan])
-0.0
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.nanstd(a)
-1.4142135623730951
->>> bn.nanstd(a, axis=0)
-array([ 0.,  0.])
-
-When positive infinity or negative infinity are present NaN is returned:
-
->>> bn.nanstd([1, np.nan, np.inf])
-nan
+>>> a = np.array([1, 2, np.nan, 4, 6])
+>>> bn.segment_nanstd(a, [0, 2, 5])
+array([0.5, 1. ])
 
 MULTILINE STRING END */
 
-static char nanvar_doc[] =
+static char segment_nanvar_doc[] =
 /* MULTILINE STRING BEGIN
-nanvar(a, axis=None, ddof=0)
+segment_nanvar(a, offsets, axis=-1, ddof=0)
 
-Variance along the specified axis, ignoring NaNs.
+Variance of each segment along the specified axis, ignoring NaNs.
 
 `float64` intermediate and return values are used for integer inputs.
-
-Instead of a faster one-pass algorithm, a more stable two-pass algorithm
-is used.
-
-An example of a one-pass algorithm:
-
-    >>> (a*a).mean() - a.mean()**2
-
-An example of a two-pass algorithm:
-
-    >>> ((a - a.mean())**2).mean()
-
-Note in the two-pass algorithm the mean must be found (first pass) before
-the squared deviation (second pass) can be found.
+As in `bottleneck.nanvar` the mean of each segment is found first and the
+squared deviations from it in a second pass over the segment.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the variance is computed. The default (axis=None) is
-    to compute the variance of the flattened array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 ddof : int, optional
     Means Delta Degrees of Freedom. The divisor used in calculations
-    is ``N - ddof``, where ``N`` represents the number of non_NaN elements.
-    By default `ddof` is zero.
+    is ``N - ddof``, where ``N`` represents the number of non-NaN elements
+    of the segment. By default `ddof` is zero.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, with the specified axis
-    removed. If `a` is a 0-d array, or if axis is None, a scalar is
-    returned. `float64` intermediate and return values are used for
-    integer inputs. If ddof is >= the number of non-NaN elements in a
-    slice or the slice contains only NaNs, then the result for that slice
-    is NaN.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. NaN is returned
+    for a segment with ddof or fewer non-NaN elements.
 
 See also
---------
-bottleneck.nanstd: Standard deviation along specified axis ignoring NaNs.
-
-Notes
------
-If positive or negative infinity are present the result is Not A Number
-(NaN).
-
-Examples
---------
->>> bn.nanvar(1)
-0.0
->>> bn.nanvar([1])
-0.0
->>> bn.nanvar([1, np.nan])
-0.0
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.nanvar(a)
-2.0
->>> bn.nanvar(a, axis=0)
-array([ 0.,  0.])
-
-When positive infinity or negative infinity are present NaN is returned:
+--------
+bottleneck.nanvar: Variance along specified axis, ignoring NaNs.
+bottleneck.segment_nanstd: Standard deviation of each segment, ignoring NaNs.
 
->>> bn.nanvar([1, np.nan, np.inf])
-nan
+Examples
+--------
+>>> a = np.array([1, 2, np.nan, 4, 6])
+>>> bn.segment_nanvar(a, [0, 2, 5])
+array([0.25, 1.  ])
+>>> bn.segment_nanvar(a, [0, 2, 5], ddof=1)
+array([0.5, 2. ])
 
 MULTILINE STRING END */
 
-static char nanmin_doc[] =
+static char segment_nanmin_doc[] =
 /* MULTILINE STRING BEGIN
-nanmin(a, axis=None)
-
-Minimum values along specified axis, ignoring NaNs.
+segment_nanmin(a, offsets, axis=-1)
 
-When all-NaN slices are encountered, NaN is returned for that slice.
+Minimum of each segment along the specified axis, ignoring NaNs.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the minimum is computed. The default (axis=None) is
-    to compute the minimum of the flattened array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, with the specified axis removed.
-    If `a` is a 0-d array, or if axis is None, a scalar is returned. The
-    same dtype as `a` is returned.
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is the number of segments, len(offsets) - 1. For float input
+    NaN is returned for an empty segment or a segment of NaNs.
+
+Raises
+------
+ValueError
+    If a segment of integer input is empty.
 
 See also
 --------
-bottleneck.nanmax: Maximum along specified axis, ignoring NaNs.
-bottleneck.nanargmin: Indices of minimum values along axis, ignoring NaNs.
+bottleneck.nanmin: Minimum along specified axis, ignoring NaNs.
+bottleneck.segment_nanmax: Maximum of each segment, ignoring NaNs.
 
 Examples
 --------
->>> bn.nanmin(1)
-1
->>> bn.nanmin([1])
-1
->>> bn.nanmin([1, np.nan])
-1.0
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.nanmin(a)
-1.0
->>> bn.nanmin(a, axis=0)
-array([ 1.,  4.])
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> bn.segment_nanmin(a, [0, 2, 5])
+array([1., 4.])
 
 MULTILINE STRING END */
 
-static char nanmax_doc[] =
+static char segment_nanmax_doc[] =
 /* MULTILINE STRING BEGIN
-nanmax(a, axis=None)
-
-Maximum values along specified axis, ignoring NaNs.
+segment_nanmax(a, offsets, axis=-1)
 
-When all-NaN slices are encountered, NaN is returned for that slice.
+Maximum of each segment along the specified axis, ignoring NaNs.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the maximum is computed. The default (axis=None) is
-    to compute the maximum of the flattened array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, with the specified axis removed.
-    If `a` is a 0-d array, or if axis is None, a scalar is returned. The
-    same dtype as `a` is returned.
+    An array with the shape and dtype of `a` except that the length along
+    `axis` is the number of segments, len(offsets) - 1. For float input
+    NaN is returned for an empty segment or a segment of NaNs.
+
+Raises
+------
+ValueError
+    If a segment of integer input is empty.
 
 See also
 --------
-bottleneck.nanmin: Minimum along specified axis, ignoring NaNs.
-bottleneck.nanargmax: Indices of maximum values along axis, ignoring NaNs.
+bottleneck.nanmax: Maximum along specified axis, ignoring NaNs.
+bottleneck.segment_nanmin: Minimum of each segment, ignoring NaNs.
 
 Examples
 --------
->>> bn.nanmax(1)
-1
->>> bn.nanmax([1])
-1
->>> bn.nanmax([1, np.nan])
-1.0
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.nanmax(a)
-4.0
->>> bn.nanmax(a, axis=0)
-array([ 1.,  4.])
+>>> a = np.array([1, 2, np.nan, 4, 5])
+>>> bn.segment_nanmax(a, [0, 2, 5])
+array([2., 5.])
 
 MULTILINE STRING END */
 
-static char nanargmin_doc[] =
+static char segment_nanargmin_doc[] =
 /* MULTILINE STRING BEGIN
-nanargmin(a, axis=None)
+segment_nanargmin(a, offsets, axis=-1)
 
-Indices of the minimum values along an axis, ignoring NaNs.
+Index of the minimum of each segment along the specified axis, ignoring
+NaNs.
 
-For all-NaN slices ``ValueError`` is raised. Unlike NumPy, the results
-can be trusted if a slice contains only NaNs and Infs.
+The index is counted from the start of the segment. Of equal minima the
+first is returned.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which to operate. By default (axis=None) flattened input
-    is used.
-
-See also
---------
-bottleneck.nanargmax: Indices of the maximum values along an axis.
-bottleneck.nanmin: Minimum values along specified axis, ignoring NaNs.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
-index_array : ndarray
-    An array of indices or a single index value.
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. The indices are
+    of dtype intp.
+
+Raises
+------
+ValueError
+    If a segment is empty or all NaN.
+
+See also
+--------
+bottleneck.nanargmin: Indices of minimum values along an axis, ignoring NaNs.
+bottleneck.segment_nanargmax: Index of the maximum of each segment.
 
 Examples
 --------
->>> a = np.array([[np.nan, 4], [2, 3]])
->>> bn.nanargmin(a)
-2
->>> a.flat[2]
-2.0
->>> bn.nanargmin(a, axis=0)
-array([1, 1])
->>> bn.nanargmin(a, axis=1)
-array([1, 0])
+>>> a = np.array([1, 2, np.nan, 4, 3])
+>>> bn.segment_nanargmin(a, [0, 2, 5])
+array([0, 2])
 
 MULTILINE STRING END */
 
-static char nanargmax_doc[] =
+static char segment_nanargmax_doc[] =
 /* MULTILINE STRING BEGIN
-nanargmax(a, axis=None)
+segment_nanargmax(a, offsets, axis=-1)
 
-Indices of the maximum values along an axis, ignoring NaNs.
+Index of the maximum of each segment along the specified axis, ignoring
+NaNs.
 
-For all-NaN slices ``ValueError`` is raised. Unlike NumPy, the results
-can be trusted if a slice contains only NaNs and Infs.
+The index is counted from the start of the segment. Of equal maxima the
+first is returned.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which to operate. By default (axis=None) flattened input
-    is used.
-
-See also
---------
-bottleneck.nanargmin: Indices of the minimum values along an axis.
-bottleneck.nanmax: Maximum values along specified axis, ignoring NaNs.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
-index_array : ndarray
-    An array of indices or a single index value.
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. The indices are
+    of dtype intp.
+
+Raises
+------
+ValueError
+    If a segment is empty or all NaN.
+
+See also
+--------
+bottleneck.nanargmax: Indices of maximum values along an axis, ignoring NaNs.
+bottleneck.segment_nanargmin: Index of the minimum of each segment.
 
 Examples
 --------
->>> a = np.array([[np.nan, 4], [2, 3]])
->>> bn.nanargmax(a)
-1
->>> a.flat[1]
-4.0
->>> bn.nanargmax(a, axis=0)
-array([1, 0])
->>> bn.nanargmax(a, axis=1)
+>>> a = np.array([1, 2, np.nan, 4, 3])
+>>> bn.segment_nanargmax(a, [0, 2, 5])
 array([1, 1])
 
 MULTILINE STRING END */
 
-static char ss_doc[] =
+static char segment_ss_doc[] =
 /* MULTILINE STRING BEGIN
-ss(a, axis=None)
+segment_ss(a, offsets, axis=-1)
 
-Sum of the square of each element along the specified axis.
+Sum of the square of each element of each segment along the specified
+axis.
 
 Parameters
 ----------
 a : array_like
-    Array whose sum of squares is desired. If `a` is not an array, a
-    conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the sum of squares is computed. The default
-    (axis=None) is to sum the squares of the flattened array.
+    Input array. If `a` is not an array, a conversion is attempted.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    The sum of a**2 along the given axis.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. The sum of an
+    empty segment is zero.
 
-Examples
+See also
 --------
->>> a = np.array([1., 2., 5.])
->>> bn.ss(a)
-30.0
-
-And calculating along an axis:
+bottleneck.ss: Sum of squares along specified axis.
 
->>> b = np.array([[1., 2., 5.], [2., 5., 6.]])
->>> bn.ss(b, axis=1)
-array([ 30., 65.])
+Examples
+--------
+>>> a = np.array([1, 2, 3, 4, 5])
+>>> bn.segment_ss(a, [0, 2, 5])
+array([ 5, 50])
 
 MULTILINE STRING END */
 
-static char median_doc[] =
+static char segment_median_doc[] =
 /* MULTILINE STRING BEGIN
-median(a, axis=None)
+segment_median(a, offsets, axis=-1)
 
-Median of array elements along given axis.
+Median of each segment along the specified axis.
+
+All the segments share one buffer with the length of the longest
+segment, taken from the scratch memory of the module.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the median is computed. The default (axis=None) is to
-    compute the median of the flattened array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, except that the specified axis
-    has been removed. If `a` is a 0d array, or if axis is None, a scalar
-    is returned. `float64` return values are used for integer inputs. NaN
-    is returned for a slice that contains one or more NaNs.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. `float64` is
+    returned for integer input. NaN is returned for an empty segment or a
+    segment that contains NaN.
 
 See also
 --------
-bottleneck.nanmedian: Median along specified axis ignoring NaNs.
+bottleneck.median: Median along specified axis.
+bottleneck.segment_nanmedian: Median of each segment, ignoring NaNs.
 
 Examples
 --------
->>> a = np.array([[10, 7, 4], [3, 2, 1]])
->>> bn.median(a)
-    3.5
->>> bn.median(a, axis=0)
-    array([ 6.5,  4.5,  2.5])
->>> bn.median(a, axis=1)
-    array([ 7.,  2.])
+>>> a = np.array([1, 2, np.nan, 4, 3])
+>>> bn.segment_median(a, [0, 2, 5])
+array([1.5, nan])
 
 MULTILINE STRING END */
 
-static char nanmedian_doc[] =
+static char segment_nanmedian_doc[] =
 /* MULTILINE STRING BEGIN
-nanmedian(a, axis=None)
+segment_nanmedian(a, offsets, axis=-1)
 
-Median of array elements along given axis ignoring NaNs.
+Median of each segment along the specified axis, ignoring NaNs.
+
+All the segments share one buffer with the length of the longest
+segment, taken from the scratch memory of the module.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which the median is computed. The default (axis=None) is to
-    compute the median of the flattened array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
 y : ndarray
-    An array with the same shape as `a`, except that the specified axis
-    has been removed. If `a` is a 0d array, or if axis is None, a scalar
-    is returned. `float64` return values are used for integer inputs.
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. `float64` is
+    returned for integer input. NaN is returned for an empty segment or a
+    segment of NaNs.
 
 See also
 --------
-bottleneck.median: Median along specified axis.
+bottleneck.nanmedian: Median along specified axis, ignoring NaNs.
+bottleneck.segment_median: Median of each segment.
 
 Examples
 --------
->>> a = np.array([[np.nan, 7, 4], [3, 2, 1]])
->>> a
-array([[ nan,   7.,   4.],
-       [  3.,   2.,   1.]])
->>> bn.nanmedian(a)
-3.0
->> bn.nanmedian(a, axis=0)
-array([ 3. ,  4.5,  2.5])
->> bn.nanmedian(a, axis=1)
-array([ 5.5,  2. ])
+>>> a = np.array([1, 2, np.nan, 4, 3])
+>>> bn.segment_nanmedian(a, [0, 2, 5])
+array([1.5, 3.5])
 
 MULTILINE STRING END */
 
-static char anynan_doc[] =
+static char segment_anynan_doc[] =
 /* MULTILINE STRING BEGIN
-anynan(a, axis=None)
+segment_anynan(a, offsets, axis=-1)
 
-Test whether any array element along a given axis is NaN.
-
-Returns the same output as np.isnan(a).any(axis)
+Test whether any element of each segment along the specified axis is
+NaN.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which NaNs are searched. The default (`axis` = ``None``)
-    is to search for NaNs over a flattened input array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
-y : bool or ndarray
-    A boolean or new `ndarray` is returned.
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. An empty segment
+    gives False.
 
 See also
 --------
-bottleneck.allnan: Test if all array elements along given axis are NaN
+bottleneck.anynan: Test if any array element along given axis is NaN.
+bottleneck.segment_allnan: Test if all elements of each segment are NaN.
 
 Examples
 --------
->>> bn.anynan(1)
-False
->>> bn.anynan(np.nan)
-True
->>> bn.anynan([1, np.nan])
-True
->>> a = np.array([[1, 4], [1, np.nan]])
->>> bn.anynan(a)
-True
->>> bn.anynan(a, axis=0)
-array([False,  True], dtype=bool)
+>>> a = np.array([1, 2, np.nan, 4, 3])
+>>> bn.segment_anynan(a, [0, 2, 5, 5])
+array([False,  True, False])
 
 MULTILINE STRING END */
 
-static char allnan_doc[] =
+static char segment_allnan_doc[] =
 /* MULTILINE STRING BEGIN
-allnan(a, axis=None)
-
-Test whether all array elements along a given axis are NaN.
-
-Returns the same output as np.isnan(a).all(axis)
+segment_allnan(a, offsets, axis=-1)
 
-Note that allnan([]) is True to match np.isnan([]).all() and all([])
+Test whether all elements of each segment along the specified axis are
+NaN.
 
 Parameters
 ----------
 a : array_like
     Input array. If `a` is not an array, a conversion is attempted.
-axis : {int, None}, optional
-    Axis along which NaNs are searched. The default (`axis` = ``None``)
-    is to search for NaNs over a flattened input array.
+offsets : array_like of int
+    1d array of nseg + 1 nondecreasing positions along `axis`; segment s
+    is ``a[..., offsets[s]:offsets[s + 1]]``. Elements before offsets[0]
+    or from offsets[-1] on are not in any segment.
+axis : int, optional
+    Axis along which the segments are reduced. The default (axis=-1) is
+    the last axis.
 
 Returns
 -------
-y : bool or ndarray
-    A boolean or new `ndarray` is returned.
+y : ndarray
+    An array with the shape of `a` except that the length along `axis` is
+    the number of segments, len(offsets) - 1. An empty segment
+    gives True, as np.isnan([]).all() does.
 
 See also
 --------
-bottleneck.anynan: Test if any array element along given axis is NaN
+bottleneck.allnan: Test if all array elements along given axis are NaN.
+bottleneck.segment_anynan: Test if any element of each segment is NaN.
 
 Examples
 --------
->>> bn.allnan(1)
-False
->>> bn.allnan(np.nan)
-True
->>> bn.allnan([1, np.nan])
-False
->>> a = np.array([[1, np.nan], [1, np.nan]])
->>> bn.allnan(a)
-False
->>> bn.allnan(a, axis=0)
-array([False,  True], dtype=bool)
+>>> a = np.array([1, np.nan, np.nan, 4, 3])
+>>> bn.segment_allnan(a, [1, 3, 5, 5])
+array([ True, False,  True])
 
-An empty array returns True:
+MULTILINE STRING END */
 
->>> bn.allnan([])
-True
+static char batch_doc[] =
+/* MULTILINE STRING BEGIN
+batch(func, arrays, axis=None, ddof=0, stack=False)
 
-which is similar to:
+Apply a reducing function to each array in a sequence.
 
->>> all([])
-True
->>> np.isnan([]).all()
-True
+The equivalent python code:
+
+    [func(a, axis=axis) for a in arrays]
+
+The loop is in C and the choice of the low-level function for the dtype
+of an array is reused by the arrays that follow it with the same dtype,
+which matters when `arrays` holds many small arrays. Arrays large enough
+to be reduced without the GIL are split across the thread pool sized by
+`bn.set_num_threads`, in runs of consecutive arrays.
+
+Parameters
+----------
+func : {str, function}
+    The name of a reducing function, or the function itself: nansum,
+    nanmean, nanstd, nanvar, nanmin, nanmax, nanargmin, nanargmax, ss,
+    median, nanmedian, anynan or allnan.
+arrays : sequence of array_like
+    The input arrays. Arrays in the sequence that are not arrays are
+    converted.
+axis : {int, None}, optional
+    Axis along which each array is reduced. The default (axis=None) is
+    to reduce each flattened array.
+ddof : int, optional
+    Means Delta Degrees of Freedom, for nanstd and nanvar only. By
+    default `ddof` is zero.
+stack : bool, optional
+    If True the results are stacked into one array. The default is to
+    return a list.
+
+Returns
+-------
+y : list or ndarray
+    The result of `func` for each array in `arrays`.
+
+Examples
+--------
+>>> bn.batch('nanmean', [[1, np.nan, 3], [4, 5]])
+[2.0, 4.5]
+>>> a = np.array([[1.0, 2.0], [3.0, np.nan]])
+>>> bn.batch(bn.nansum, [a, 2 * a], axis=1, stack=True)
+array([[  3.,   3.],
+       [  6.,   6.]])
 
 MULTILINE STRING END */
 
@@ -1945,42 +6848,91 @@ reduce_methods[] = {
     {"ss",        (PyCFunction)ss,        VARKEY, ss_doc},
     {"median",    (PyCFunction)median,    VARKEY, median_doc},
     {"nanmedian", (PyCFunction)nanmedian, VARKEY, nanmedian_doc},
+    {"nanquantile", (PyCFunction)nanquantile, VARKEY, nanquantile_doc},
+    {"nanpercentile", (PyCFunction)nanpercentile, VARKEY, nanpercentile_doc},
+    {"nanwsum",   (PyCFunction)nanwsum,   VARKEY, nanwsum_doc},
+    {"nanwmean",  (PyCFunction)nanwmean,  VARKEY, nanwmean_doc},
+    {"nanwstd",   (PyCFunction)nanwstd,   VARKEY, nanwstd_doc},
+    {"nanwvar",   (PyCFunction)nanwvar,   VARKEY, nanwvar_doc},
     {"anynan",    (PyCFunction)anynan,    VARKEY, anynan_doc},
     {"allnan",    (PyCFunction)allnan,    VARKEY, allnan_doc},
+    {"segment_nansum", (PyCFunction)segment_nansum, VARKEY,
+     segment_nansum_doc},
+    {"segment_nanmean", (PyCFunction)segment_nanmean, VARKEY,
+     segment_nanmean_doc},
+    {"segment_nanstd", (PyCFunction)segment_nanstd, VARKEY,
+     segment_nanstd_doc},
+    {"segment_nanvar", (PyCFunction)segment_nanvar, VARKEY,
+     segment_nanvar_doc},
+    {"segment_nanmin", (PyCFunction)segment_nanmin, VARKEY,
+     segment_nanmin_doc},
+    {"segment_nanmax", (PyCFunction)segment_nanmax, VARKEY,
+     segment_nanmax_doc},
+    {"segment_nanargmin", (PyCFunction)segment_nanargmin, VARKEY,
+     segment_nanargmin_doc},
+    {"segment_nanargmax", (PyCFunction)segment_nanargmax, VARKEY,
+     segment_nanargmax_doc},
+    {"segment_ss", (PyCFunction)segment_ss, VARKEY,
+     segment_ss_doc},
+    {"segment_median", (PyCFunction)segment_median, VARKEY,
+     segment_median_doc},
+    {"segment_nanmedian", (PyCFunction)segment_nanmedian, VARKEY,
+     segment_nanmedian_doc},
+    {"segment_anynan", (PyCFunction)segment_anynan, VARKEY,
+     segment_anynan_doc},
+    {"segment_allnan", (PyCFunction)segment_allnan, VARKEY,
+     segment_allnan_doc},
+    {"batch",     (PyCFunction)batch,     VARKEY, batch_doc},
+    {"_nanmoments", (PyCFunction)_nanmoments, VARKEY, NULL},
+    SCRATCH_METHODS
+    THREAD_METHODS
+    {"_set_outofcore_bytes", (PyCFunction)set_outofcore_bytes, METH_O,
+     NULL},
     {NULL, NULL, 0, NULL}
 };
 
 
-#if PY_MAJOR_VERSION >= 3
+static int
+reduce_exec(PyObject *m)
+{
+    module_state *st = STATE(m);
+    import_array1(-1);
+    if (!intern_strings(st)) {
+        return -1;
+    }
+    st->slow = PyImport_ImportModule("bottleneck.slow");
+    if (st->slow == NULL) {
+        return -1;
+    }
+    if (bn_pool_init() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static PyModuleDef_Slot
+reduce_slots[] = {
+    {Py_mod_exec, (void *)reduce_exec},
+    MODULE_SLOTS
+    {0, NULL}
+};
+
 static struct PyModuleDef
 reduce_def = {
    PyModuleDef_HEAD_INIT,
    "reduce",
    reduce_doc,
-   -1,
-   reduce_methods
+   sizeof(module_state),
+   reduce_methods,
+   reduce_slots,
+   module_traverse,
+   module_clear,
+   module_free
 };
-#endif
 
 
 PyMODINIT_FUNC
-#if PY_MAJOR_VERSION >= 3
-#define RETVAL m
 PyInit_reduce(void)
-#else
-#define RETVAL
-initreduce(void)
-#endif
 {
-    #if PY_MAJOR_VERSION >=3
-        PyObject *m = PyModule_Create(&reduce_def);
-    #else
-        PyObject *m = Py_InitModule3("reduce", reduce_methods, reduce_doc);
-    #endif
-    if (m == NULL) return RETVAL;
-    import_array();
-    if (!intern_strings()) {
-        return RETVAL;
-    }
-    return RETVAL;
+    return PyModuleDef_Init(&reduce_def);
 }
@@ -0,0 +1,105 @@
+"""Test accumulators."""
+
+import pickle
+
+import numpy as np
+from numpy.testing import assert_allclose, assert_equal, assert_raises
+
+import bottleneck as bn
+from .util import arrays, array_order, DTYPES
+import pytest
+
+ACCUMULATORS = (
+    (bn.NanSumAcc, bn.nansum),
+    (bn.NanMeanAcc, bn.nanmean),
+    (bn.NanVarAcc, bn.nanvar),
+    (bn.NanStdAcc, bn.nanstd),
+    (bn.NanMinAcc, bn.nanmin),
+    (bn.NanMaxAcc, bn.nanmax),
+    (bn.NanArgminAcc, bn.nanargmin),
+    (bn.NanArgmaxAcc, bn.nanargmax),
+)
+
+
+def call(func, *args):
+    """Call func, returning the exception type instead of raising"""
+    try:
+        with np.errstate(invalid="ignore", over="ignore"):
+            return func(*args)
+    except ValueError:
+        return ValueError
+
+
+def accumulate(cls, a, axis, nchunks, rs):
+    """Feed a to cls in chunks, merging two halves through pickle"""
+    if axis is None:
+        b = a.ravel()
+        n = b.size
+    else:
+        b = a
+        n = a.shape[axis]
+    cuts = np.sort(rs.randint(0, n + 1, nchunks - 1))
+    chunks = np.split(b, cuts, axis or 0)
+    half = len(chunks) // 2
+    acc1 = cls()
+    acc2 = cls()
+    for chunk in chunks[:half]:
+        acc1.update(chunk, axis)
+    for chunk in chunks[half:]:
+        acc2.update(chunk, axis)
+    acc2 = pickle.loads(pickle.dumps(acc2))
+    return acc1.merge(acc2).result()
+
+
+@pytest.mark.parametrize("cls, func", ACCUMULATORS, ids=lambda x: x.__name__)
+def test_accumulate(cls, func):
+    """Test accumulators against a single call of the reduction function"""
+    name = func.__name__
+    msg = "\nfunc %s | input %s (%s) | shape %s | axis %s | order %s\n"
+    msg += "nchunks %s\n"
+    rs = np.random.RandomState([1, 2, 3])
+    for i, a in enumerate(arrays(name, DTYPES)):
+        if a.ndim == 0:
+            continue
+        for axis in [None] + list(range(a.ndim)):
+            for nchunks in (1, 2, 5):
+                actual = call(accumulate, cls, a, axis, nchunks, rs)
+                desired = call(func, a, axis)
+                tup = (name, i, a.dtype, a.shape, axis, array_order(a))
+                err_msg = msg % (tup + (nchunks,))
+                if desired is ValueError:
+                    assert actual is ValueError, err_msg
+                    continue
+                assert actual is not ValueError, err_msg
+                # the moments are combined in float64 for every dtype
+                rtol = {np.float16: 1e-2, np.float32: 1e-5}.get(a.dtype.type, 1e-7)
+                assert_allclose(actual, desired, rtol, 1e-12, True, err_msg)
+                assert np.asarray(actual).dtype == np.asarray(desired).dtype, err_msg
+
+
+def test_accumulate_ddof():
+    """Test ddof of NanVarAcc and NanStdAcc"""
+    a = np.array([[1.0, 2, 5, np.nan, 4, 6], [3, 1, 4, 1, 5, 9]])
+    for cls, func in ((bn.NanVarAcc, bn.nanvar), (bn.NanStdAcc, bn.nanstd)):
+        for ddof in range(4):
+            acc = cls(ddof).update(a[:, :2], 1).update(a[:, 2:], 1)
+            desired = func(a, 1, ddof=ddof)
+            assert_allclose(acc.result(), desired, 1e-7, 0, True)
+
+
+def test_accumulate_raises():
+    """Test accumulator argument checking"""
+    a = np.array([[1.0, 2, 3], [4, 5, 6]])
+    acc = bn.NanSumAcc()
+    assert_raises(ValueError, acc.result)
+    assert_raises(ValueError, acc.update, a, 2)
+    assert_raises(ValueError, acc.update, np.array(1.0), 0)
+    acc.update(a, 1)
+    assert_raises(ValueError, acc.update, a, 0)
+    assert_raises(ValueError, acc.update, a[:1], 1)
+    assert_raises(ValueError, acc.merge, bn.NanSumAcc().update(a))
+    assert_raises(TypeError, acc.merge, bn.NanMeanAcc())
+    assert_equal(acc.merge(bn.NanSumAcc()).result(), [6.0, 15.0])
+    assert_raises(ValueError, bn.NanMinAcc().update([]).result)
+    assert_raises(ValueError, bn.NanArgminAcc().update([np.nan]).result)
+    assert_equal(bn.NanArgminAcc().update([np.nan]).update([2, 1]).result(), 2)
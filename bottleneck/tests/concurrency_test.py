@@ -0,0 +1,338 @@
+"""Test calls made at the same time from many threads."""
+
+import importlib.util
+import os
+import subprocess
+import sys
+import sysconfig
+import threading
+import time
+
+import numpy as np
+from numpy.testing import assert_array_equal
+
+import bottleneck as bn
+import pytest
+
+NTHREADS = 8
+
+# (function, positional arguments after the input, keyword arguments)
+CALLS = (
+    (bn.nansum, (), {"axis": 0}),
+    (bn.nanmean, (), {}),
+    (bn.nanstd, (), {"axis": 1, "ddof": 1}),
+    (bn.nanargmax, (), {"axis": 1}),
+    (bn.median, (), {}),
+    (bn.nanmedian, (), {"axis": 0}),
+    (bn.nanquantile, (), {"q": [0.25, 0.5], "axis": 1}),
+    (bn.nanwmean, (), {"weights": None, "axis": 0}),
+    (bn.segment_nanmedian, ([0, 3, 30, 60],), {"axis": 1}),
+    (bn.move_mean, (5,), {"axis": 1}),
+    (bn.move_median, (), {"window": 7, "min_count": 1}),
+    (bn.move_rank, (4,), {}),
+    (bn.partition, (3,), {"axis": 0}),
+    (bn.rankdata, (), {"axis": 1}),
+    (bn.push, (), {"n": 2}),
+    (bn.group_nanmean, (np.arange(60) % 7,), {"axis": 1}),
+    (bn.replace, (np.nan, 0.0), {}),
+)
+
+
+def inputs(seed):
+    """A few arrays with NaNs, different for each seed"""
+    rs = np.random.RandomState(seed)
+    a = rs.rand(40, 60)
+    a[a < 0.1] = np.nan
+    return [a, np.asfortranarray(a), a[::2], a.astype(np.float32)]
+
+
+def call(func, a, args, kwargs):
+    if kwargs.get("weights", 0) is None:
+        kwargs = dict(kwargs, weights=np.ones_like(a))
+    if func is bn.replace:
+        a = a.copy()
+        func(a, *args, **kwargs)
+        return a
+    with np.errstate(invalid="ignore"):
+        return func(a, *args, **kwargs)
+
+
+def run_threads(target, nthreads=NTHREADS):
+    """Run target(i) in nthreads threads that start together; returns the
+    exceptions raised"""
+    barrier = threading.Barrier(nthreads)
+    errors = []
+
+    def worker(i):
+        barrier.wait()
+        try:
+            target(i)
+        except Exception as e:  # noqa: BLE001
+            errors.append(e)
+
+    threads = [threading.Thread(target=worker, args=(i,))
+               for i in range(nthreads)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    return errors
+
+
+@pytest.mark.parametrize(
+    "func, args, kwargs", CALLS, ids=lambda x: getattr(x, "__name__", "")
+)
+def test_concurrent_calls(func, args, kwargs):
+    """Test that threads calling a function at once get the results of
+    calls made one at a time"""
+    desired = {}
+    for seed in range(NTHREADS):
+        for j, a in enumerate(inputs(seed)):
+            desired[seed, j] = call(func, a, args, kwargs)
+
+    def target(seed):
+        for repeat in range(5):
+            for j, a in enumerate(inputs(seed)):
+                actual = call(func, a, args, kwargs)
+                assert_array_equal(actual, desired[seed, j])
+
+    errors = run_threads(target)
+    assert not errors, errors[0]
+
+
+def test_concurrent_settings():
+    """Test that changing the settings while other threads compute does not
+    change their results"""
+    a = np.random.RandomState(49).rand(300, 301)
+    a[::5, ::3] = np.nan
+    desired = bn.nanmedian(a, axis=1)
+    old_threads = bn.get_num_threads()
+    old_gil = bn.get_gil_threshold()
+
+    def target(i):
+        for repeat in range(10):
+            if i % 2:
+                bn.set_num_threads(1 + (repeat + i) % 4)
+                bn.set_gil_threshold((-1, 0, 1000)[repeat % 3])
+                bn.release_scratch()
+            else:
+                assert_array_equal(bn.nanmedian(a, axis=1), desired)
+
+    try:
+        errors = run_threads(target)
+    finally:
+        bn.set_num_threads(old_threads)
+        bn.set_gil_threshold(old_gil)
+    assert not errors, errors[0]
+
+
+@pytest.mark.parametrize(
+    "name", ("reduce", "nonreduce", "nonreduce_axis", "move", "group")
+)
+def test_module_state(name):
+    """Test that a second copy of a module parses keywords with its own
+    state"""
+    spec = getattr(bn, name).__spec__
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    assert module is not getattr(bn, name)
+    a = np.array([[1.0, np.nan, 3.0], [4.0, 5.0, 6.0]])
+    if name == "reduce":
+        assert_array_equal(module.nansum(a=a, axis=1), [4.0, 15.0])
+        assert_array_equal(module.nansum(a=a.astype(complex)), bn.slow.nansum(a))
+    elif name == "nonreduce":
+        module.replace(a=a, old=np.nan, new=2.0)
+        assert_array_equal(a[0], [1.0, 2.0, 3.0])
+    elif name == "nonreduce_axis":
+        actual = module.push(a=[np.nan, 1.0, np.nan], n=1)
+        assert_array_equal(actual, [np.nan, 1.0, 1.0])
+    elif name == "move":
+        assert_array_equal(module.move_sum(a=a[1], window=2), [np.nan, 9.0, 11.0])
+    else:
+        actual = module.group_nansum(a=a[1], labels=[0, 1, 0])
+        assert_array_equal(actual, [10.0, 5.0])
+
+
+@pytest.mark.skipif(
+    not sysconfig.get_config_var("Py_GIL_DISABLED"),
+    reason="needs a free-threaded build of Python",
+)
+def test_gil_stays_disabled():
+    """Test that importing bottleneck does not turn the GIL back on"""
+    code = "import sys, bottleneck; print(sys._is_gil_enabled())"
+    out = subprocess.check_output([sys.executable, "-c", code], text=True)
+    assert out.strip() == "False"
+
+
+def test_subinterpreter():
+    """Test that a sub-interpreter that shares the GIL can import and call
+    bottleneck"""
+    _testcapi = pytest.importorskip("_testcapi")
+    if not hasattr(_testcapi, "run_in_subinterp"):
+        pytest.skip("needs _testcapi.run_in_subinterp")
+    code = (
+        "import warnings\n"
+        "warnings.simplefilter('ignore')\n"
+        "import numpy as np, bottleneck as bn\n"
+        "assert bn.nanmedian(np.arange(5.0)) == 2.0\n"
+        "assert bn.move_sum(np.ones(3), 2)[-1] == 2.0\n"
+    )
+    # numpy can only be loaded by one interpreter of a process, so the
+    # main interpreter of a new process must not import it
+    main = "import _testcapi; print(_testcapi.run_in_subinterp(%r))" % code
+    path = os.path.dirname(os.path.dirname(bn.__file__))
+    env = dict(os.environ, PYTHONPATH=path)
+    out = subprocess.check_output([sys.executable, "-c", main], env=env, text=True)
+    assert out.strip() == "0"
+
+
+@pytest.mark.skipif(
+    not os.path.isdir("/proc/self/task"), reason="needs /proc/self/task"
+)
+def test_one_pool():
+    """Test that the parallel functions of all modules share one pool of
+    workers"""
+    code = (
+        "import os, numpy as np, bottleneck as bn\n"
+        "before = len(os.listdir('/proc/self/task'))\n"
+        "bn.set_num_threads(4)\n"
+        "a = np.random.RandomState(0).rand(8, 100000)\n"
+        "bn.median(a, axis=1)\n"
+        "bn.group_nansum(a.ravel(), np.arange(a.size) % 5)\n"
+        "bn.segment_nanmean(a, [0, 50000, 100000], axis=1)\n"
+        "print(len(os.listdir('/proc/self/task')) - before)\n"
+    )
+    path = os.path.dirname(os.path.dirname(bn.__file__))
+    env = dict(os.environ, PYTHONPATH=path)
+    out = subprocess.check_output([sys.executable, "-c", code], env=env, text=True)
+    assert out.strip() == "3"
+
+
+@pytest.fixture
+def gil_threshold(request):
+    """Set the GIL threshold for one test"""
+    old = bn.set_gil_threshold(request.param)
+    yield request.param
+    bn.set_gil_threshold(old)
+
+
+@pytest.mark.parametrize("gil_threshold", (0, -1), indirect=True)
+def test_submit(gil_threshold):
+    """Test that submitted calls give the results of direct calls"""
+    futures = []
+    desired = []
+    for seed in range(NTHREADS):
+        for a in inputs(seed):
+            for func, args, kwargs in CALLS:
+                if func is bn.replace:
+                    continue
+                if kwargs.get("weights", 0) is None:
+                    kwargs = dict(kwargs, weights=np.ones_like(a))
+                desired.append(call(func, a, args, kwargs))
+                name = func.__name__ if seed % 2 else func
+                futures.append(bn.submit(name, a, *args, **kwargs))
+    for future, y in zip(futures, desired):
+        assert_array_equal(future.result(), y)
+    a = np.array([1.0, np.nan, 3.0])
+    bn.submit("replace", a, np.nan, 2.0).result()
+    assert_array_equal(a, [1.0, 2.0, 3.0])
+    with pytest.raises(TypeError):
+        bn.submit("nansum", a, bad_keyword=1).result()
+    pytest.raises(ValueError, bn.submit, "sum", a)
+    pytest.raises(ValueError, bn.submit, np.nansum, a)
+
+
+@pytest.mark.skipif(sys.platform == "win32", reason="needs pthreads")
+@pytest.mark.parametrize("nthreads", (1, 3))
+def test_submit_pool(monkeypatch, nthreads):
+    """Test that submitted calls, however small, run on the workers of the
+    thread pool and no more of them at once"""
+    import bottleneck._submit
+
+    lock = threading.Lock()
+    running = [0, 0]
+    threads = set()
+    release = threading.Event()
+
+    def wait_sum(a):
+        with lock:
+            running[0] += 1
+            running[1] = max(running)
+            threads.add(threading.get_ident())
+        release.wait(10)
+        with lock:
+            running[0] -= 1
+        return a.sum()
+
+    monkeypatch.setitem(bottleneck._submit._functions, "nansum", wait_sum)
+    a = np.ones(3)
+    nworkers = max(nthreads - 1, 1)
+    with bn.num_threads(nthreads):
+        futures = [bn.submit("nansum", a) for i in range(8)]
+        try:
+            assert not any(future.done() for future in futures)
+            for i in range(1000):
+                if running[0] == nworkers:
+                    break
+                time.sleep(0.01)
+        finally:
+            release.set()
+        assert [future.result() for future in futures] == [3.0] * 8
+    assert running[1] == nworkers
+    assert threading.get_ident() not in threads
+    assert len(threads) == nworkers
+
+
+@pytest.mark.parametrize("gil_threshold", (0, -1), indirect=True)
+def test_submit_hazards(monkeypatch, gil_threshold):
+    """Test that calls that write to their input do not overlap with other
+    calls on the same memory"""
+    import bottleneck._submit
+
+    release = threading.Event()
+
+    def wait_sum(a):
+        release.wait(10)
+        return a.sum()
+
+    def wait_replace(a, old, new):
+        release.wait(10)
+        bn.replace(a, old, new)
+
+    functions = bottleneck._submit._functions
+    monkeypatch.setitem(functions, "nansum", wait_sum)
+    monkeypatch.setitem(functions, "replace", wait_replace)
+    a = np.arange(12.0).reshape(3, 4)
+    b = np.zeros(5)
+    future = bn.submit("nansum", a)
+    future_b = bn.submit("replace", b, 0.0, 1.0)
+    try:
+        assert a.flags.writeable
+        assert not future.done()
+        pytest.raises(ValueError, bn.submit, "replace", a, 0.0, 1.0)
+        pytest.raises(ValueError, bn.submit, "replace", a[1:], 0.0, 1.0)
+        pytest.raises(ValueError, bn.submit, "nanmean", b[2:])
+    finally:
+        release.set()
+    assert future.result() == 66.0
+    future_b.result()
+    assert_array_equal(b, np.ones(5))
+    bn.submit("replace", a, 0.0, 1.0).result()
+    assert a[0, 0] == 1.0
+
+
+@pytest.mark.parametrize("gil_threshold", (0, -1), indirect=True)
+def test_submit_async(gil_threshold):
+    """Test the asyncio futures of submitted calls"""
+    import asyncio
+
+    chunks = [np.random.RandomState(i).rand(50, 20) for i in range(6)]
+
+    async def pipeline():
+        pending = [bn.submit_async("nanmedian", c, axis=1) for c in chunks]
+        return [await future for future in pending]
+
+    actual = asyncio.run(pipeline())
+    for y, c in zip(actual, chunks):
+        assert_array_equal(y, bn.nanmedian(c, axis=1))
+    pytest.raises(RuntimeError, bn.submit_async, "nansum", chunks[0])
@@ -0,0 +1,140 @@
+"""Test group functions."""
+
+import numpy as np
+from numpy.testing import assert_allclose, assert_equal, assert_raises
+
+import bottleneck as bn
+from .util import arrays, array_order, DTYPES, OTHER_DTYPES
+import pytest
+
+GROUP_FUNCS = (
+    bn.group_nansum,
+    bn.group_nanmean,
+    bn.group_nanstd,
+    bn.group_nanvar,
+    bn.group_nanmin,
+    bn.group_nanmax,
+    bn.group_nanfirst,
+    bn.group_nanlast,
+    bn.group_count,
+)
+
+
+def call(func, a, labels, ngroups, axis):
+    """Call func, returning the exception type instead of raising"""
+    try:
+        with np.errstate(invalid="ignore", over="ignore"):
+            return func(a, labels, ngroups, axis)
+    except ValueError:
+        return ValueError
+
+
+@pytest.mark.parametrize("func", GROUP_FUNCS, ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtypes", (DTYPES, OTHER_DTYPES), ids=("default", "other"))
+def test_group(func, dtypes):
+    """Test group functions against the slow functions"""
+    name = func.__name__
+    func0 = getattr(bn.slow, name)
+    msg = "\nfunc %s | input %s (%s) | shape %s | axis %s | order %s\n"
+    msg += "labels %s | ngroups %s\n"
+    rs = np.random.RandomState([1, 2, 3])
+    for i, a in enumerate(arrays(name, dtypes)):
+        if a.ndim == 0:
+            continue
+        for axis in range(-1, a.ndim):
+            n = a.shape[axis]
+            for ngroups in (None, 1, 3):
+                labels = rs.randint(-1, ngroups or 3, n)
+                actual = call(func, a, labels, ngroups, axis)
+                desired = call(func0, a, labels, ngroups, axis)
+                tup = (name, i, a.dtype, a.shape, axis, array_order(a))
+                err_msg = msg % (tup + (labels, ngroups))
+                if desired is ValueError:
+                    assert actual is ValueError, err_msg
+                    continue
+                assert actual is not ValueError, err_msg
+                rtol = 1e-2 if a.dtype == np.float16 else 1e-7
+                assert_allclose(actual, desired, rtol, 1e-12, True, err_msg)
+                assert actual.dtype == np.dtype(desired.dtype).newbyteorder("=")
+
+
+@pytest.mark.parametrize("func", GROUP_FUNCS, ids=lambda x: x.__name__)
+def test_group_many(func):
+    """Test group functions on more groups than labels and 2d input"""
+    func0 = getattr(bn.slow, func.__name__)
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.rand(7, 1000)
+    a[a < 0.1] = np.nan
+    labels = rs.randint(0, 300, 1000)
+    labels[labels == 7] = 8
+    for axis, b in ((1, a), (0, a.T)):
+        actual = func(b, labels, 400, axis)
+        desired = func0(b, labels, 400, axis)
+        assert_allclose(actual, desired, 1e-7, 1e-12, True)
+
+
+def test_group_ddof():
+    """Test ddof of group_nanstd and group_nanvar"""
+    a = np.array([[1.0, 2, 5, np.nan, 4, 6], [3, 1, 4, 1, 5, 9]])
+    labels = np.array([0, 1, 0, 1, 0, 1])
+    for func in (bn.group_nanstd, bn.group_nanvar):
+        func0 = getattr(bn.slow, func.__name__)
+        for ddof in range(4):
+            actual = func(a, labels, ddof=ddof)
+            desired = func0(a, labels, ddof=ddof)
+            assert_allclose(actual, desired, 1e-7, 0, True)
+
+
+def test_group_raises():
+    """Test group function argument checking"""
+    a = np.array([1.0, 2, 3])
+    labels = np.array([0, 1, 0])
+    func = bn.group_nansum
+    assert_raises(TypeError, func, a)
+    assert_raises(TypeError, func, a, labels, 2, 0, 0)
+    assert_raises(TypeError, func, a, labels, ddof=0)
+    assert_raises(TypeError, func, a, labels, extra=0)
+    assert_raises(TypeError, func, a, labels.astype(np.float64))
+    assert_raises(ValueError, func, a, labels, axis=None)
+    assert_raises(ValueError, func, a, labels, axis=1)
+    assert_raises(ValueError, func, a, labels[:2])
+    assert_raises(ValueError, func, a, labels[None])
+    assert_raises(ValueError, func, a, labels, 1)
+    assert_raises(ValueError, func, a, labels, -1)
+    assert_raises(ValueError, func, np.array(1.0), np.array([0]))
+    assert_raises(ValueError, bn.group_nanmin, labels, labels, 3)
+    assert_equal(func(a, labels), func(a=a, labels=labels, ngroups=2, axis=0))
+    assert_equal(func([], []), np.zeros(0))
+
+
+@pytest.mark.parametrize("func", GROUP_FUNCS, ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtype", ("float64", "float32", "int64"))
+def test_group_threads(func, dtype):
+    """Test that splitting the groups across the thread pool, by slices or
+    by ranges along axis, gives the results of one thread"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randn(300000)
+    a[a > 1.5] = np.nan
+    if dtype == "int64":
+        a = np.nan_to_num(100 * a)
+    a = a.astype(dtype)
+    for b, axis in ((a, 0), (a.reshape(3, -1), 1), (a.reshape(-1, 4), 0)):
+        labels = rs.randint(0 if dtype == "int64" else -1, 9, b.shape[axis])
+        with bn.num_threads(1):
+            desired = func(b, labels, axis=axis)
+        for nthreads in (2, 4):
+            with bn.num_threads(nthreads):
+                actual = func(b, labels, axis=axis)
+            rtol = 1e-4 if dtype == "float32" else 1e-12
+            assert_allclose(actual, desired, rtol, 0, True)
+            assert actual.dtype == desired.dtype
+    labels = np.zeros(a.size, np.intp)
+    labels[-1] = 2
+    with bn.num_threads(4):
+        if dtype == "int64" and func in (
+            bn.group_nanmin, bn.group_nanmax, bn.group_nanfirst, bn.group_nanlast
+        ):
+            with pytest.raises(ValueError, match="group 1 is empty"):
+                func(a, labels)
+        else:
+            assert func(a, labels).shape == (3,)
@@ -33,3 +33,208 @@ def test_memory_leak():
     print(diff_bytes)
     # For 1.3.0 release, this had value of ~100kB
     assert diff_bytes == 0
+
+
+def test_scratch():
+    """Test that scratch buffers are reused and can be released"""
+    import threading
+
+    a = np.arange(1000.0)
+    expected = bn.slow.median(a)
+    assert bn.median(a) == expected
+    assert bn.scratch_high_water() >= a.nbytes
+    assert bn.release_scratch() is None
+    assert bn.median(a) == expected
+
+    # a buffer too large to be kept is freed after each call
+    b = np.arange(300000.0)
+    assert bn.median(b) == bn.slow.median(b)
+    assert bn.scratch_high_water() >= b.nbytes
+
+    def worker(results):
+        results.append(bn.move_median(a, 100))
+        bn.release_scratch()
+
+    results = []
+    thread = threading.Thread(target=worker, args=(results,))
+    thread.start()
+    thread.join()
+    np.testing.assert_array_equal(results[0], bn.slow.move_median(a, 100))
+    np.testing.assert_array_equal(bn.move_median(a, 100), results[0])
+
+
+@pytest.mark.skipif(
+    sys.platform.startswith("win"), reason="the arena is freed by pthreads"
+)
+def test_scratch_thread_exit():
+    """Test that the scratch arena of a thread is freed when it exits"""
+    import subprocess
+
+    code = """if 1:
+        import resource, sys, threading
+        import numpy as np
+        import bottleneck as bn
+
+        a = np.random.RandomState(0).rand(100000)
+        bn.median(a)
+        start = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        for i in range(200):
+            thread = threading.Thread(target=bn.median, args=(a,))
+            thread.start()
+            thread.join()
+        end = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        # kilobytes, or bytes on macOS
+        print((end - start) // (1024 if sys.platform == "darwin" else 1))
+    """
+    out = subprocess.check_output([sys.executable, "-c", code])
+    # 200 leaked arenas would take 160 MB
+    assert int(out) < 40000
+
+
+def test_threads():
+    """Test that the thread pool gives the results of the calling thread"""
+    import threading
+
+    rs = np.random.RandomState(47)
+    a = rs.rand(3, 700, 101)
+    a[:, ::7, ::3] = np.nan
+    b = rs.randint(0, 50, (3, 700, 101))
+    inputs = [(a, "median"), (a, "nanmedian"), (b, "median")]
+    desired = {}
+    with bn.num_threads(1):
+        assert bn.get_num_threads() == 1
+        for x, name in inputs:
+            for axis in range(3):
+                desired[name, x.dtype, axis] = getattr(bn, name)(x, axis)
+    old = bn.get_num_threads()
+    with bn.num_threads(4, pin=True):
+        assert bn.get_num_threads() == 4
+        for x, name in inputs:
+            for axis in range(3):
+                actual = getattr(bn, name)(x, axis)
+                expected = desired[name, x.dtype, axis]
+                np.testing.assert_array_equal(actual, expected)
+
+        # calls made while the pool is busy run in their own thread
+        def worker(results):
+            results.append(bn.nanmedian(a, 2))
+
+        results = []
+        threads = [threading.Thread(target=worker, args=(results,))
+                   for i in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for result in results:
+            np.testing.assert_array_equal(result, desired["nanmedian",
+                                                          a.dtype, 2])
+    assert bn.get_num_threads() == old
+    assert bn.set_num_threads(old) == old
+    pytest.raises(ValueError, bn.set_num_threads, 0)
+
+
+def test_gil_threshold():
+    """Test that results do not depend on whether the GIL is released"""
+    a = np.arange(5000.0).reshape(50, 100)
+    a[::3, ::7] = np.nan
+    old = bn.get_gil_threshold()
+    desired = [bn.nanmean(a), bn.nanmedian(a, 1), bn.move_sum(a, 5)]
+    try:
+        for n in (-1, 0, a.size, a.size + 1):
+            bn.set_gil_threshold(n)
+            assert bn.get_gil_threshold() == n
+            actual = [bn.nanmean(a), bn.nanmedian(a, 1), bn.move_sum(a, 5)]
+            for x, y in zip(actual, desired):
+                np.testing.assert_array_equal(x, y)
+        bn.set_gil_threshold()
+        assert 1 << 10 <= bn.get_gil_threshold() <= 1 << 20
+    finally:
+        bn.set_gil_threshold(old)
+    assert bn.get_gil_threshold() == old
+
+
+@pytest.mark.parametrize("env, desired", ((None, 4096), ("100", 100)))
+def test_gil_threshold_import(env, desired):
+    """Test that importing bottleneck sets the GIL threshold without
+    calibrating it"""
+    import os
+    import subprocess
+
+    code = "import bottleneck as bn; print(bn.get_gil_threshold())"
+    environ = dict(os.environ)
+    environ.pop("BN_GIL_THRESHOLD", None)
+    if env is not None:
+        environ["BN_GIL_THRESHOLD"] = env
+    out = subprocess.check_output([sys.executable, "-c", code], env=environ)
+    assert int(out) == desired
+
+
+def test_threadpoolctl():
+    """Test that threadpoolctl finds and limits the thread pool"""
+    threadpoolctl = pytest.importorskip("threadpoolctl")
+    if not hasattr(threadpoolctl, "register"):
+        pytest.skip("threadpoolctl is too old to take controllers")
+    old = bn.set_num_threads(3)
+    try:
+        info = threadpoolctl.threadpool_info()
+        assert [i["num_threads"] for i in info
+                if i["user_api"] == "bottleneck"] == [3]
+        with threadpoolctl.threadpool_limits(1, user_api="bottleneck"):
+            assert bn.get_num_threads() == 1
+        assert bn.get_num_threads() == 3
+    finally:
+        bn.set_num_threads(old)
+
+
+@pytest.mark.parametrize("order", "CF")
+def test_outofcore(tmp_path, order):
+    """Test reductions of memory-mapped arrays split into blocks"""
+    import bottleneck._outofcore as outofcore
+
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.rand(37, 23)
+    a[a < 0.2] = np.nan
+    a[:, 3] = np.nan
+    filename = str(tmp_path / "a.dat")
+    m = np.memmap(filename, a.dtype, "w+", shape=a.shape, order=order)
+    m[:] = a
+    m.flush()
+    r = np.memmap(filename, a.dtype, "r", shape=a.shape, order=order)
+    names = []
+    reduce = outofcore.reduce
+
+    def spy(*args):
+        names.append(args[0])
+        return reduce(*args)
+
+    old = bn.set_outofcore(min_bytes=0, block_bytes=512, drop_behind=True)
+    outofcore.reduce = spy
+    try:
+        # off by default
+        assert not old["enabled"]
+        bn.nanmean(r)
+        assert names == []
+        bn.set_outofcore(enabled=True)
+        for func in bn.get_functions("reduce"):
+            name = func.__name__
+            if name in ("nanquantile", "nanpercentile") or "nanw" in name:
+                continue
+            for axis in (None, 0, 1):
+                for b in (m, r, r[::2, 1:]):
+                    try:
+                        desired = func(np.array(b), axis)
+                    except ValueError:
+                        pytest.raises(ValueError, func, b, axis)
+                        continue
+                    actual = func(b, axis)
+                    err_msg = "%s axis=%s" % (name, axis)
+                    np.testing.assert_allclose(actual, desired, 1e-10, 0, True, err_msg)
+                    assert type(actual) is type(desired), err_msg
+    finally:
+        outofcore.reduce = reduce
+        bn.set_outofcore(**old)
+    assert "nanmean" in names and "median" in names
+    names.clear()
+    bn.nanmean(r)
+    assert names == []
@@ -1,15 +1,33 @@
 """Test moving window functions."""
 
 import numpy as np
-from numpy.testing import assert_equal, assert_array_almost_equal, assert_raises
+from numpy.testing import (
+    assert_equal,
+    assert_array_almost_equal,
+    assert_raises,
+    assert_allclose,
+)
 import bottleneck as bn
-from .util import arrays, array_order
+from .util import arrays, array_order, DTYPES, OTHER_DTYPES
 import pytest
 
 
 @pytest.mark.parametrize("func", bn.get_functions("move"), ids=lambda x: x.__name__)
 def test_move(func):
     """Test that bn.xxx gives the same output as a reference function."""
+    return unit_maker(func)
+
+
+@pytest.mark.parametrize("func", bn.get_functions("move"), ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtype", OTHER_DTYPES, ids=lambda x: np.dtype(x).name)
+def test_move_other_dtypes(func, dtype):
+    """Test the dtypes beyond float64/32 and int64/32."""
+    rtol = 1e-2 if dtype == np.float16 else None
+    return unit_maker(func, dtypes=(dtype,), rtol=rtol, all_min_counts=False)
+
+
+def unit_maker(func, dtypes=DTYPES, rtol=None, all_min_counts=True):
+    """Test that bn.xxx gives the same output as bn.slow.xxx."""
     fmt = (
         "\nfunc %s | window %d | min_count %s | input %s (%s) | shape %s | "
         "axis %s | order %s\n"
@@ -22,12 +40,15 @@ def test_move(func):
         decimal = 3
     else:
         decimal = 5
-    for i, a in enumerate(arrays(func_name)):
+    for i, a in enumerate(arrays(func_name, dtypes)):
         axes = range(-1, a.ndim)
         for axis in axes:
             windows = range(1, a.shape[axis])
             for window in windows:
-                min_counts = list(range(1, window + 1)) + [None]
+                if all_min_counts:
+                    min_counts = list(range(1, window + 1)) + [None]
+                else:
+                    min_counts = [1, None]
                 for min_count in min_counts:
                     actual = func(a, window, min_count, axis=axis)
                     desired = func0(a, window, min_count, axis=axis)
@@ -43,10 +64,14 @@ def test_move(func):
                         a,
                     )
                     err_msg = fmt % tup
-                    aaae(actual, desired, decimal, err_msg)
+                    if rtol is None:
+                        aaae(actual, desired, decimal, err_msg)
+                    else:
+                        assert_allclose(actual, desired, rtol, rtol, err_msg=err_msg)
                     err_msg += "\n dtype mismatch %s %s"
+                    # the output of byte swapped input is in native byte order
                     da = actual.dtype
-                    dd = desired.dtype
+                    dd = desired.dtype.newbyteorder("=")
                     assert_equal(da, dd, err_msg % (da, dd))
 
 
@@ -134,6 +159,45 @@ def test_arg_parse_raises(func):
         assert_raises(TypeError, func, a, 2, ddof=0)
 
 
+@pytest.mark.parametrize("func", bn.get_functions("move"), ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtype", ("float64", "int64", "int32", "float16", ">f8"))
+def test_move_groups(func, dtype):
+    """test groups against bn.slow and against calling func on each group"""
+    func0 = getattr(bn.slow, func.__name__)
+    rs = np.random.RandomState([1, 2, 3])
+    a = (10 * rs.rand(3, 60)).astype(dtype)
+    if a.dtype.kind == "f":
+        a[a > 8] = np.nan
+    groups = np.repeat([4, 1, 4, 7, 0, 2], [12, 1, 7, 20, 3, 17])
+    tol = 1e-2 if dtype == "float16" else 1e-5
+    for axis, b in ((1, a), (0, a.T)):
+        for window, min_count in ((1, None), (3, None), (3, 1), (9, 2), (60, 1)):
+            err_msg = "axis %d | window %d | min_count %s"
+            err_msg = err_msg % (axis, window, min_count)
+            actual = func(b, window, min_count, axis=axis, groups=groups)
+            desired = func0(b, window, min_count, axis=axis, groups=groups)
+            assert_allclose(actual, desired, tol, tol, err_msg=err_msg)
+            assert_equal(actual.dtype, desired.dtype.newbyteorder("="))
+            ends = np.flatnonzero(np.diff(groups)) + 1
+            for c, d in zip(np.split(b, ends, axis), np.split(actual, ends, axis)):
+                if c.shape[axis] >= window:
+                    desired = func(c, window, min_count, axis=axis)
+                    assert_equal(d, desired, err_msg)
+
+
+def test_move_groups_raises():
+    """test the groups argument checking of the moving window functions"""
+    a = np.array([1.0, 2, 3])
+    for func in (bn.move_mean, bn.slow.move_mean):
+        assert_raises(TypeError, func, a, 2, groups=np.array([0.0, 0, 1]))
+        assert_raises(ValueError, func, a, 2, groups=[0, 1])
+        assert_raises(ValueError, func, a, 2, groups=[[0, 0, 1]])
+        assert_raises(ValueError, func, a, 4, groups=[0, 0, 1])
+    assert_raises(TypeError, bn.move_mean, a, 2, 1, -1, [0, 0, 1])
+    assert_equal(bn.move_mean(a, 2, groups=None), bn.move_mean(a, 2))
+    assert_equal(bn.move_mean(a, 2, groups=[3, 3, 3]), bn.move_mean(a, 2))
+
+
 # ---------------------------------------------------------------------------
 # move_median.c is complicated. Let's do some more testing.
 #
@@ -143,6 +207,19 @@ def test_arg_parse_raises(func):
 # LONG time to run.
 
 
+@pytest.mark.parametrize("func", bn.get_functions("move"), ids=lambda x: x.__name__)
+def test_move_byte_swapped_blocks(func):
+    """test byte swapped input large enough to be split into blocks"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randn(700, 300)
+    a[a > 1] = np.nan
+    b = a.astype(">f8")
+    for axis in (0, 1):
+        actual = func(b, 10, min_count=2, axis=axis)
+        desired = func(a, 10, min_count=2, axis=axis)
+        assert_array_almost_equal(actual, desired, err_msg="axis %s" % axis)
+
+
 def test_move_median_with_nans():
     """test move_median.c with nans"""
     fmt = "\nfunc %s | window %d | min_count %s\n\nInput array:\n%s\n"
@@ -185,6 +262,66 @@ def test_move_median_without_nans():
             aaae(actual, desired, decimal=5, err_msg=err_msg)
 
 
+def test_move_median_native_dtypes():
+    """test move_median.c with values stored in float32, int32, int64"""
+    fmt = "\nfunc %s | window %d | dtype %s\n\nInput array:\n%s\n"
+    aaae = assert_array_almost_equal
+    size = 300
+    func = bn.move_median
+    func0 = bn.slow.move_median
+    rs = np.random.RandomState([1, 2, 3])
+    for dtype in ("float32", "int32", "int64"):
+        a = rs.randint(-50, 50, size).astype(dtype)
+        if dtype == "float32":
+            a[rs.rand(size) < 0.1] = np.nan
+        for window in (2, 3, 9, 64, 65, 200, size):
+            actual = func(a, window=window, min_count=1)
+            desired = func0(a, window=window, min_count=1)
+            err_msg = fmt % (func.__name__, window, dtype, a)
+            aaae(actual, desired, decimal=5, err_msg=err_msg)
+
+
+def test_move_median_narrow_dtypes():
+    """test move_median.c with 1 and 2 byte values and odd windows, which
+    leave the heaps after the values on an odd address unless padded"""
+    fmt = "\nfunc %s | window %d | dtype %s\n\nInput array:\n%s\n"
+    aaae = assert_array_almost_equal
+    size = 300
+    func = bn.move_median
+    func0 = bn.slow.move_median
+    rs = np.random.RandomState([1, 2, 3])
+    for dtype in ("int8", "uint8", "bool", "int16", "uint16", "float16"):
+        a = rs.randint(0, 50, size).astype(dtype)
+        if dtype == "float16":
+            a[rs.rand(size) < 0.1] = np.nan
+        for window in (11, 13, 65, 201):
+            actual = func(a, window=window, min_count=1)
+            desired = func0(a, window=window, min_count=1)
+            err_msg = fmt % (func.__name__, window, dtype, a)
+            aaae(actual, desired, decimal=2, err_msg=err_msg)
+
+
+def test_move_median_small_windows():
+    """test the median networks used for windows of 3, 5, 7 and 9"""
+    fmt = "\nfunc %s | window %d | dtype %s\n\nInput array:\n%s\n"
+    aaae = assert_array_almost_equal
+    func = bn.move_median
+    func0 = bn.slow.move_median
+    rs = np.random.RandomState([1, 2, 3])
+    for dtype in ("float64", "float32", "int64", "int32"):
+        a = rs.randint(-5, 5, (3, 40)).astype(dtype)
+        if dtype.startswith("float"):
+            a[rs.rand(*a.shape) < 0.05] = np.nan
+        for window in (3, 5, 7, 9):
+            for axis in (0, 1):
+                if window > a.shape[axis]:
+                    continue
+                actual = func(a, window=window, axis=axis)
+                desired = func0(a, window=window, axis=axis)
+                err_msg = fmt % (func.__name__, window, dtype, a)
+                aaae(actual, desired, decimal=5, err_msg=err_msg)
+
+
 # ----------------------------------------------------------------------------
 # Regression test for square roots of negative numbers
 
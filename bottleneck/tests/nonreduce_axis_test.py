@@ -11,7 +11,7 @@ from .reduce_test import (
     unit_maker as reduce_unit_maker,
     unit_maker_argparse as unit_maker_parse_rankdata,
 )
-from .util import arrays, array_order, DTYPES
+from .util import arrays, array_order, time_arrays, DTYPES, OTHER_DTYPES, TIME_DTYPES
 import pytest
 
 # ---------------------------------------------------------------------------
@@ -21,7 +21,8 @@ import pytest
 @pytest.mark.parametrize(
     "func", (bn.partition, bn.argpartition), ids=lambda x: x.__name__
 )
-def test_partition_and_argpartition(func):
+@pytest.mark.parametrize("dtypes", (DTYPES, OTHER_DTYPES), ids=("default", "other"))
+def test_partition_and_argpartition(func, dtypes):
     """test partition or argpartition"""
 
     msg = "\nfunc %s | input %s (%s) | shape %s | n %d | axis %s | order %s\n"
@@ -31,7 +32,7 @@ def test_partition_and_argpartition(func):
     func0 = eval("bn.slow.%s" % name)
 
     rs = np.random.RandomState([1, 2, 3])
-    for i, a in enumerate(arrays(name)):
+    for i, a in enumerate(arrays(name, dtypes)):
         if a.ndim == 0 or a.size == 0 or a.ndim > 3:
             continue
         for axis in list(range(-1, a.ndim)) + [None]:
@@ -137,6 +138,51 @@ def test_transpose():
     assert_equal(actual, desired, "partition transpose test")
 
 
+@pytest.mark.parametrize("dtype", DTYPES)
+def test_partition_patterns(dtype):
+    """test partition and argpartition on inputs that defeat simple pivots"""
+    n = 1000
+    patterns = [
+        np.arange(n),
+        np.arange(n)[::-1],
+        np.r_[np.arange(n // 2), np.arange(n // 2)[::-1]],
+        np.arange(n) % 3,
+        np.zeros(n),
+        (np.arange(n) * 7919) % n,
+    ]
+    for a in patterns:
+        a = a.astype(dtype)
+        desired = np.sort(a)
+        for k in (0, 1, n // 2, n - 1):
+            for axis, b in ((0, a), (1, a.reshape(1, -1)), (0, a.reshape(-1, 1))):
+                p = bn.partition(b, k, axis).reshape(-1)
+                assert_equal(p[k], desired[k])
+                assert (p[:k] <= p[k]).all() and (p[k + 1 :] >= p[k]).all()
+                idx = bn.argpartition(b, k, axis).reshape(-1)
+                assert_equal(np.sort(idx), np.arange(n))
+                assert_equal(a[idx][k], desired[k])
+
+
+@pytest.mark.parametrize("dtype", ("float64", "float32"))
+def test_partition_vector_step(dtype):
+    """test partition and median on float lengths around those of the
+    vector partition step, with and without ties"""
+    rs = np.random.RandomState(29)
+    for n in (127, 128, 129, 135, 1000, 4099):
+        for a in (rs.rand(n), rs.randint(0, 4, n), np.ones(n)):
+            a = a.astype(dtype)
+            desired = np.sort(a)
+            for k in (0, 1, n // 3, n // 2, n - 1):
+                p = bn.partition(a, k)
+                assert_equal(p[k], desired[k])
+                assert (p[:k] <= p[k]).all() and (p[k + 1 :] >= p[k]).all()
+                assert_equal(np.sort(p), desired)
+            assert_equal(bn.median(a.reshape(1, -1), axis=1), np.median(a))
+    a = rs.rand(1000).astype(dtype)
+    a[::3] = np.nan
+    assert bn.partition(a, 500).shape == a.shape
+
+
 # ---------------------------------------------------------------------------
 # rankdata, nanrankdata, push
 
@@ -144,9 +190,10 @@ def test_transpose():
 @pytest.mark.parametrize(
     "func", (bn.rankdata, bn.nanrankdata, bn.push), ids=lambda x: x.__name__
 )
-def test_nonreduce_axis(func):
+@pytest.mark.parametrize("dtypes", (DTYPES, OTHER_DTYPES), ids=("default", "other"))
+def test_nonreduce_axis(func, dtypes):
     """Test nonreduce axis functions"""
-    return reduce_unit_maker(func)
+    return reduce_unit_maker(func, dtypes=dtypes)
 
 
 def test_push():
@@ -159,6 +206,19 @@ def test_push():
         assert_array_equal(actual, desired, "failed on n=%s" % str(n))
 
 
+@pytest.mark.parametrize("dtype", TIME_DTYPES)
+def test_push_datetime(dtype):
+    """Test push forward fills NaT"""
+    for a in time_arrays(dtype):
+        for axis in range(-a.ndim, a.ndim):
+            for n in (None, 0, 1, 2):
+                actual = bn.push(a, n, axis)
+                desired = bn.slow.push(a, n, axis)
+                err_msg = "n %s | axis %s | input\n%s" % (n, axis, a)
+                assert_equal(actual.dtype, desired.dtype, err_msg)
+                assert_array_equal(actual, desired, err_msg)
+
+
 # ---------------------------------------------------------------------------
 # Test argument parsing
 
@@ -5,14 +5,15 @@ import warnings
 import numpy as np
 from numpy.testing import assert_equal, assert_array_equal, assert_raises
 import bottleneck as bn
-from .util import arrays, array_order, DTYPES, INT_DTYPES
+from .util import arrays, array_order, DTYPES, INT_DTYPES, OTHER_DTYPES
 import pytest
 
 
 @pytest.mark.parametrize(
     "func", bn.get_functions("nonreduce"), ids=lambda x: x.__name__
 )
-def test_nonreduce(func):
+@pytest.mark.parametrize("dtypes", (DTYPES, OTHER_DTYPES), ids=("default", "other"))
+def test_nonreduce(func, dtypes):
     """Test that bn.xxx gives the same output as np.xxx."""
     msg = "\nfunc %s | input %s (%s) | shape %s | old %f | new %f | order %s\n"
     msg += "\nInput array:\n%s\n"
@@ -20,7 +21,7 @@ def test_nonreduce(func):
     func0 = eval("bn.slow.%s" % name)
     rs = np.random.RandomState([1, 2, 3])
     news = [1, 0, np.nan, -np.inf]
-    for i, arr in enumerate(arrays(name)):
+    for i, arr in enumerate(arrays(name, dtypes)):
         for idx in range(2):
             if arr.size == 0:
                 old = 0
@@ -66,6 +67,32 @@ def test_nonreduce(func):
 # Check that exceptions are raised
 
 
+def test_replace_byte_swapped_blocks():
+    """test replace on byte swapped input large enough to be split"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randn(700, 300)
+    a[a > 1] = np.nan
+    b = a.astype(">f8")
+    bn.replace(a, np.nan, 0)
+    bn.replace(b, np.nan, 0)
+    assert_equal(b.dtype, np.dtype(">f8"))
+    assert_array_equal(b, a)
+
+
+def test_replace_unaligned():
+    """test replace on a field of a packed structured array"""
+    a = np.arange(100000.0)
+    a[::7] = np.nan
+    packed = np.zeros(a.shape, [("pad", np.uint8), ("x", a.dtype)])
+    packed["x"] = a
+    b = packed["x"]
+    assert not b.flags.aligned
+    bn.replace(a, np.nan, -1)
+    bn.replace(b, np.nan, -1)
+    assert_array_equal(b, a)
+    assert_array_equal(packed["pad"], 0)
+
+
 def test_replace_unsafe_cast():
     """Test replace for unsafe casts"""
     dtypes = INT_DTYPES
@@ -77,6 +104,21 @@ def test_replace_unsafe_cast():
         assert_raises(ValueError, bn.slow.replace, a.copy(), 0, 0.1)
 
 
+def test_replace_overflow():
+    """Test replace for a `new` out of the range of the dtype"""
+    for dtype in ("int8", "uint16", "uint64"):
+        a = np.array([1, 2, 3], dtype=dtype)
+        assert_raises(OverflowError, bn.replace, a, 1, 2**70)
+        assert_raises(OverflowError, bn.replace, a, 1, -1 if "u" in dtype else 300)
+        assert_raises(OverflowError, bn.slow.replace, a, 1, 2**70)
+        assert_array_equal(a, [1, 2, 3])
+    for dtype in ("int64", "int32"):
+        assert_raises(ValueError, bn.replace, np.ones(3, dtype), 1, 2**70)
+    a = np.array([True, False])
+    bn.replace(a, 0, 300)
+    assert_array_equal(a, [True, True])
+
+
 def test_non_array():
     """Test that non-array input raises"""
     a = [1, 2, 3]
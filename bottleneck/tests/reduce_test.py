@@ -1,13 +1,27 @@
 """Test reduce functions."""
 
+import subprocess
+import sys
 import warnings
 import traceback
 
 import numpy as np
-from numpy.testing import assert_equal, assert_raises, assert_array_almost_equal
+from numpy.testing import (
+    assert_equal,
+    assert_raises,
+    assert_array_almost_equal,
+    assert_allclose,
+)
 
 import bottleneck as bn
-from .util import arrays, array_order, DTYPES
+from .util import (
+    arrays,
+    array_order,
+    time_arrays,
+    DTYPES,
+    OTHER_DTYPES,
+    TIME_DTYPES,
+)
 import pytest
 
 
@@ -17,13 +31,48 @@ def test_reduce(func):
     return unit_maker(func)
 
 
-def unit_maker(func, decimal=5, skip_dtype=("nansum", "ss")):
+@pytest.mark.parametrize("func", bn.get_functions("reduce"), ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtype", OTHER_DTYPES, ids=lambda x: np.dtype(x).name)
+def test_reduce_other_dtypes(func, dtype):
+    """test reduce functions on the dtypes beyond float64/32 and int64/32"""
+    # float16 is summed in float32 but numpy rounds to float16 as it goes
+    rtol = 1e-2 if dtype == np.float16 else None
+    return unit_maker(func, dtypes=(dtype,), rtol=rtol)
+
+
+@pytest.mark.parametrize(
+    "func",
+    (bn.nanmin, bn.nanmax, bn.nanargmin, bn.nanargmax),
+    ids=lambda x: x.__name__,
+)
+@pytest.mark.parametrize("dtype", TIME_DTYPES)
+def test_reduce_datetime(func, dtype):
+    """test reduce functions that treat NaT as missing"""
+    func0 = getattr(bn.slow, func.__name__)
+    for a in time_arrays(dtype):
+        for axis in [None] + list(range(-a.ndim, a.ndim)):
+            err_msg = "axis %s | input\n%s" % (axis, a)
+            try:
+                desired = func0(a, axis=axis)
+            except ValueError:
+                assert_raises(ValueError, func, a, axis=axis)
+                continue
+            actual = func(a, axis=axis)
+            if func in (bn.nanmin, bn.nanmax):
+                assert_equal(type(actual), type(desired), err_msg)
+                assert_equal(actual.dtype, desired.dtype, err_msg)
+            assert_equal(actual, desired, err_msg)
+
+
+def unit_maker(
+    func, decimal=5, skip_dtype=("nansum", "ss"), dtypes=DTYPES, rtol=None
+):
     """Test that bn.xxx gives the same output as bn.slow.xxx."""
     fmt = "\nfunc %s | input %s (%s) | shape %s | axis %s | order %s\n"
     fmt += "\nInput array:\n%s\n"
     name = func.__name__
     func0 = eval("bn.slow.%s" % name)
-    for i, a in enumerate(arrays(name)):
+    for i, a in enumerate(arrays(name, dtypes)):
         if a.ndim == 0:
             axes = [None]  # numpy can't handle e.g. np.nanmean(9, axis=-1)
         else:
@@ -65,12 +114,16 @@ def unit_maker(func, decimal=5, skip_dtype=("nansum", "ss")):
                     msg = fmt2 % (name, name, traceback.format_exc())
                     err_msg += msg
                     assert False, err_msg
-                assert_array_almost_equal(actual, desired, decimal, err_msg)
+                if rtol is None:
+                    assert_array_almost_equal(actual, desired, decimal, err_msg)
+                else:
+                    assert_allclose(actual, desired, rtol, rtol, err_msg=err_msg)
                 err_msg += "\n dtype mismatch %s %s"
                 if name not in skip_dtype:
                     if hasattr(actual, "dtype") and hasattr(desired, "dtype"):
+                        # the output of byte swapped input is in native byte order
                         da = actual.dtype
-                        dd = desired.dtype
+                        dd = desired.dtype.newbyteorder("=")
                         assert_equal(da, dd, err_msg % (da, dd))
 
 
@@ -153,6 +206,124 @@ def unit_maker_argparse_raises(func):
     # assert_raises(TypeError, func, None) results vary
 
 
+def unaligned(a):
+    """copy of `a` whose data is not aligned to its itemsize"""
+    packed = np.zeros(a.shape, [("pad", np.uint8), ("x", a.dtype)])
+    packed["x"] = a
+    assert not packed["x"].flags.aligned
+    return packed["x"]
+
+
+@pytest.mark.parametrize("func", bn.get_functions("reduce"), ids=lambda x: x.__name__)
+def test_byte_swapped_blocks(func):
+    """test byte swapped and unaligned input large enough to be split into
+    blocks"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randn(700, 3, 200)
+    a[a > 1] = np.nan
+    b = a.astype(">f8")
+    c = unaligned(a)
+    cases = [(a, b, axis) for axis in (None, 0, 1, 2)]
+    cases += [(a, c, axis) for axis in (None, 0, 1, 2)]
+    # 1d input and views that are not in C order are streamed in flat blocks
+    cases += [(a.ravel(), b.ravel(), 0), (a.T, b.T, None), (a[::-2], b[::-2], None)]
+    cases += [(a[::-2], c[::-2], None), (a[0, 0], c[0, 0], 0)]
+    for x, y, axis in cases:
+        err_msg = "axis %s shape %s" % (axis, x.shape)
+        try:
+            desired = func(x, axis=axis)
+        except ValueError:
+            assert_raises(ValueError, func, y, axis=axis)
+            continue
+        actual = func(y, axis=axis)
+        assert_array_almost_equal(actual, desired, err_msg=err_msg)
+        assert type(actual) is type(desired), err_msg
+
+
+def test_byte_swapped_memory():
+    """test that reducing large byte swapped input does not copy it"""
+    code = "\n".join(
+        [
+            "import tracemalloc",
+            "import numpy as np",
+            "import bottleneck as bn",
+            "a = np.arange(4000000.0).astype('>f8')",
+            "tracemalloc.start()",
+            "for func in (bn.nansum, bn.nanmean, bn.nanvar, bn.nanmin,",
+            "             bn.nanargmax, bn.anynan, bn.ss):",
+            "    func(a)",
+            "    func(a, axis=0)",
+            "print(tracemalloc.get_traced_memory()[1], bn.scratch_high_water())",
+        ]
+    )
+    out = subprocess.check_output([sys.executable, "-c", code], text=True)
+    peak, high_water = map(int, out.split())
+    # the input is 32 MB
+    assert peak < 4 << 20
+    assert high_water < 4 << 20
+
+
+@pytest.mark.parametrize("func", bn.get_functions("reduce"), ids=lambda x: x.__name__)
+def test_strided_views(func):
+    """test views whose dimensions the iterators coalesce"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randn(6, 8, 10)
+    a[a > 1] = np.nan
+    views = (
+        a[:, ::2],
+        a[..., None],
+        a[None, :, ::-1],
+        a[::-1, ::2, ::3],
+        a.transpose(2, 0, 1)[::2],
+        a[:, None, :, None, :],
+        np.broadcast_to(a[:1], (4, 8, 10)),
+    )
+    for i, b in enumerate(views):
+        for axis in [None] + list(range(b.ndim)):
+            err_msg = "view %d axis %s" % (i, axis)
+            try:
+                desired = func(b.copy(), axis=axis)
+            except ValueError:
+                assert_raises(ValueError, func, b, axis=axis)
+                continue
+            actual = func(b, axis=axis)
+            assert_array_almost_equal(actual, desired, err_msg=err_msg)
+
+
+@pytest.mark.parametrize("func", bn.get_functions("reduce"), ids=lambda x: x.__name__)
+def test_tiled_axis(func):
+    """test reducing large arrays along an axis that is not the innermost"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.randint(0, 4, (300, 40, 30)).astype(np.float64)
+    a[a == 3] = np.nan
+    a[:, 0] = np.nan
+    for dtype in ("float64", "float32", "int32"):
+        b = a if dtype == "float64" else np.nan_to_num(a).astype(dtype)
+        for c in (b, b[:, :, ::-1], b[::2, :, :15]):
+            for axis in range(c.ndim - 1):
+                err_msg = "%s %s axis %d" % (dtype, c.strides, axis)
+                d = np.ascontiguousarray(np.moveaxis(c, axis, -1))
+                try:
+                    desired = func(d, axis=-1)
+                except ValueError:
+                    assert_raises(ValueError, func, c, axis=axis)
+                    continue
+                actual = func(c, axis=axis)
+                assert_equal(actual, desired, err_msg=err_msg)
+                assert_equal(actual.dtype, desired.dtype, err_msg=err_msg)
+
+
+@pytest.mark.parametrize("func", (bn.nanargmin, bn.nanargmax), ids=lambda x: x.__name__)
+def test_nanarg_strided_ties(func):
+    """test that ties in views that are not one run go to the first index"""
+    rs = np.random.RandomState([1, 2, 3])
+    for dtype in ("float64", "int32", "bool"):
+        a = rs.randint(0, 2, (5, 6, 7)).astype(dtype)
+        for b in (a[:, ::2], a.T, a[::-1, :, 1:]):
+            desired = func(b.copy())
+            assert_equal(func(b), desired, err_msg=str(b.strides))
+
+
 # ---------------------------------------------------------------------------
 # Check that exceptions are raised
 
@@ -236,3 +407,273 @@ def test_ddof_nans(func, dtype):
     for axis in [None, 0, 1, -1]:
         result = func(array, axis=axis, ddof=3)
         assert np.isnan(result)
+
+
+@pytest.mark.parametrize("dtype", DTYPES)
+@pytest.mark.parametrize("func", (bn.median, bn.nanmedian), ids=lambda x: x.__name__)
+def test_median_short_rows(func, dtype):
+    """Test median networks and insertion sort used for short rows"""
+    rs = np.random.RandomState([1, 2, 3])
+    for n in range(1, 20):
+        a = rs.randint(-9, 9, (50, n)).astype(dtype)
+        if issubclass(a.dtype.type, np.inexact):
+            a[rs.rand(*a.shape) < 0.1] = np.nan
+        actual = func(a, axis=1)
+        desired = getattr(bn.slow, func.__name__)(a, axis=1)
+        err_msg = "%s failed with n=%d" % (func.__name__, n)
+        assert_array_almost_equal(actual, desired, err_msg=err_msg)
+
+
+@pytest.mark.parametrize("dtype", DTYPES + OTHER_DTYPES)
+@pytest.mark.parametrize(
+    "method", ("linear", "lower", "higher", "nearest", "midpoint")
+)
+def test_nanquantile(method, dtype):
+    """Test nanquantile against numpy for several q at once"""
+    rs = np.random.RandomState([1, 2, 3])
+    qs = (0.5, [0.1, 0.5, 0.9], [1, 0, 0.25, 0.25, 0.75], [[0.3, 0.7], [0, 1]])
+    if dtype == np.bool_:
+        pytest.skip("numpy cannot interpolate between booleans")
+    decimal = 2 if dtype == np.float16 else 6
+    for n in (1, 2, 3, 10, 33):
+        a = rs.randint(-9, 9, (4, n)).astype(dtype)
+        if issubclass(a.dtype.type, np.inexact):
+            a[rs.rand(*a.shape) < 0.2] = np.nan
+            a[0] = np.nan
+        for q in qs:
+            for axis in (None, 0, 1, -1):
+                actual = bn.nanquantile(a, q, axis=axis, method=method)
+                desired = bn.slow.nanquantile(a, q, axis=axis, method=method)
+                err_msg = "nanquantile failed with n=%d q=%s axis=%s"
+                err_msg = err_msg % (n, q, axis)
+                assert_array_almost_equal(actual, desired, decimal, err_msg)
+                q100 = np.multiply(q, 100)
+                actual = bn.nanpercentile(a, q100, axis=axis, method=method)
+                assert_array_almost_equal(actual, desired, decimal, err_msg)
+
+
+def test_nanquantile_raises():
+    """Test nanquantile argument checking"""
+    a = np.array([1.0, 2, 3])
+    assert_raises(TypeError, bn.nanquantile, a)
+    assert_raises(TypeError, bn.nanquantile, a, 0.5, 0, "linear", 0)
+    assert_raises(TypeError, bn.nanquantile, a, 0.5, extra=0)
+    assert_raises(TypeError, bn.nanquantile, a, 0.5, method=1)
+    assert_raises(ValueError, bn.nanquantile, a, 1.5)
+    assert_raises(ValueError, bn.nanquantile, a, [0.5, np.nan])
+    assert_raises(ValueError, bn.nanpercentile, a, -1)
+    assert_raises(ValueError, bn.nanquantile, a, 0.5, axis=1)
+
+
+WEIGHTED = (bn.nanwsum, bn.nanwmean, bn.nanwstd, bn.nanwvar)
+
+
+@pytest.mark.parametrize("dtype", DTYPES + OTHER_DTYPES)
+@pytest.mark.parametrize("func", WEIGHTED, ids=lambda x: x.__name__)
+def test_weighted(func, dtype):
+    """Test weighted reductions against the slow functions"""
+    rs = np.random.RandomState([1, 2, 3])
+    func0 = getattr(bn.slow, func.__name__)
+    kwargs = [{}]
+    if func in (bn.nanwstd, bn.nanwvar):
+        kwargs += [{"ddof": 1}, {"ddof": 1, "reliability": True}, {"ddof": 9}]
+    rtol, atol = (2e-3, 1e-3) if dtype == np.float16 else (1e-6, 1e-12)
+    for shape in ((), (0,), (1,), (7,), (0, 3), (3, 5), (2, 3, 4)):
+        a = rs.randint(0, 9, shape).astype(dtype)
+        if issubclass(a.dtype.type, np.inexact):
+            a[rs.rand(*shape) < 0.3] = np.nan
+        w = rs.rand(*shape)
+        for b in (a, a.T, a.astype(a.dtype.newbyteorder())):
+            wb = w.T if b is not a and b.shape != a.shape else w
+            for axis in [None] + list(range(-b.ndim, b.ndim)):
+                for kw in kwargs:
+                    actual = func(b, wb, axis=axis, **kw)
+                    desired = func0(b, wb, axis=axis, **kw)
+                    err_msg = "%s failed with shape=%s axis=%s %s"
+                    err_msg = err_msg % (func.__name__, b.shape, axis, kw)
+                    assert_allclose(actual, desired, rtol, atol, True, err_msg)
+                    if axis is not None:
+                        # 1d weights along axis
+                        w1 = rs.rand(b.shape[axis])
+                        actual = func(b, w1, axis, **kw)
+                        desired = func0(b, w1, axis, **kw)
+                        assert_allclose(actual, desired, rtol, atol, True, err_msg)
+                        if b.ndim > 1:
+                            assert actual.dtype == np.dtype(desired.dtype)
+
+
+def test_weighted_raises():
+    """Test weighted reduction argument checking"""
+    a = np.array([[1.0, 2, 3], [4, 5, 6]])
+    w = np.ones(3)
+    assert_raises(TypeError, bn.nanwmean, a)
+    assert_raises(TypeError, bn.nanwmean, a, w, 1, 0)
+    assert_raises(TypeError, bn.nanwsum, a, w, ddof=1)
+    assert_raises(TypeError, bn.nanwvar, a, w, 1, 0, False, 0)
+    assert_raises(TypeError, bn.nanwvar, a, weights=w, a=a)
+    assert_raises(TypeError, bn.nanwmean, a, w)
+    assert_raises(TypeError, bn.nanwmean, a, np.ones((3, 1)), axis=1)
+    assert_raises(ValueError, bn.nanwmean, a, w, axis=0)
+    assert_raises(ValueError, bn.nanwmean, a, a, axis=2)
+    assert_equal(bn.nanwmean(a, w, axis=1), bn.nanwmean(a, weights=w, axis=1))
+
+
+WHERE = (bn.nansum, bn.nanmean, bn.nanstd, bn.nanvar, bn.nanmin, bn.nanmax)
+
+
+def call_where(func, *args, **kwargs):
+    """Call func, returning ValueError instead of raising it"""
+    try:
+        return func(*args, **kwargs)
+    except ValueError:
+        return ValueError
+
+
+@pytest.mark.parametrize("dtype", DTYPES + OTHER_DTYPES)
+@pytest.mark.parametrize("func", WHERE, ids=lambda x: x.__name__)
+def test_where(func, dtype):
+    """Test the where argument of reductions against the slow functions"""
+    rs = np.random.RandomState([1, 2, 3])
+    func0 = getattr(bn.slow, func.__name__)
+    rtol, atol = (2e-3, 1e-3) if dtype == np.float16 else (1e-6, 1e-12)
+    for shape in ((), (0,), (1,), (7,), (0, 3), (3, 5), (2, 3, 4)):
+        a = rs.randint(0, 9, shape).astype(dtype)
+        if issubclass(a.dtype.type, np.inexact):
+            a[rs.rand(*shape) < 0.3] = np.nan
+        for b in (a, a.T, a.astype(a.dtype.newbyteorder())):
+            wheres = [rs.rand(*b.shape) < 0.8, rs.rand() < 0.8]
+            if b.ndim:
+                wheres.append(rs.rand(b.shape[-1]) < 0.8)
+            if b.ndim > 1:
+                wheres.append(rs.rand(b.shape[0], 1) < 0.8)
+            for where in wheres:
+                for axis in [None] + list(range(-b.ndim, b.ndim)):
+                    actual = call_where(func, b, axis, where=where)
+                    desired = call_where(func0, b, axis, where=where)
+                    err_msg = "%s failed with shape=%s axis=%s where=%s"
+                    err_msg = err_msg % (func.__name__, b.shape, axis, where)
+                    if desired is ValueError:
+                        assert actual is ValueError, err_msg
+                        continue
+                    assert actual is not ValueError, err_msg
+                    assert_allclose(actual, desired, rtol, atol, True, err_msg)
+                    if func is not bn.nansum and hasattr(actual, "dtype"):
+                        dd = np.dtype(desired.dtype).newbyteorder("=")
+                        assert actual.dtype == dd, err_msg
+
+
+def test_where_raises():
+    """Test the checking of the where argument of reductions"""
+    a = np.array([[1.0, 2, 3], [4, 5, 6]])
+    assert_raises(TypeError, bn.nansum, a, 0, True)
+    assert_raises(TypeError, bn.nansum, a, where=np.ones(3, np.int64))
+    assert_raises(TypeError, bn.median, a, where=True)
+    assert_raises(ValueError, bn.nansum, a, where=np.ones(2, bool))
+    assert_raises(ValueError, bn.nansum, a, where=np.ones((1, 2, 3), bool))
+    assert_raises(ValueError, bn.nanmin, a.astype(int), 0, where=[True, False, False])
+    assert_equal(bn.nansum(a, 1, where=None), bn.nansum(a, 1))
+    assert_equal(bn.nansum(a, 1, where=[True, False, True]), [4.0, 10.0])
+
+
+BATCH_FUNCS = [
+    func
+    for func in bn.get_functions("reduce")
+    if func.__name__ not in ("nanquantile", "nanpercentile")
+    and not func.__name__.startswith("nanw")
+]
+
+
+@pytest.mark.parametrize("func", BATCH_FUNCS, ids=lambda x: x.__name__)
+def test_batch(func):
+    """Test batch against a loop over the arrays"""
+    name = func.__name__
+    rs = np.random.RandomState([1, 2, 3])
+    arrays = [rs.rand(2, 3), rs.rand(2, 3).astype(np.float32), rs.rand(2, 3)]
+    arrays += [rs.randint(0, 9, (2, 4)), np.ones((2, 1), ">f8"), [[1.0, 2.0]]]
+    arrays[0][0, 0] = np.nan
+    for axis in (None, 0, -1):
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore")
+            desired = [func(a, axis=axis) for a in arrays]
+            actual = bn.batch(name, arrays, axis=axis)
+            assert_equal(bn.slow.batch(name, arrays, axis=axis), actual)
+        assert len(actual) == len(desired)
+        for y, y0 in zip(actual, desired):
+            assert_equal(y, y0)
+            assert np.asarray(y).dtype == np.asarray(y0).dtype
+    actual = bn.batch(func, arrays[:1] * 3, axis=1, stack=True)
+    assert_equal(actual, np.array([func(arrays[0], axis=1)] * 3))
+
+
+def test_batch_threads():
+    """Test that batch split across the thread pool gives the results of one
+    thread and raises the error of the first array that fails"""
+    rs = np.random.RandomState([1, 2, 3])
+    arrays = [rs.rand(rs.randint(1, 200000)) for i in range(12)]
+    arrays += [rs.rand(3, 4), [1.0, np.nan], np.ones(70000, ">f8")]
+    arrays += [rs.rand(200000).astype(np.float32), rs.randint(0, 9, 90000)]
+    for name in ("nansum", "nanmean", "median", "nanargmax"):
+        with bn.num_threads(1):
+            desired = bn.batch(name, arrays)
+        for nthreads in (2, 4):
+            with bn.num_threads(nthreads):
+                actual = bn.batch(name, arrays)
+            assert_equal(actual, desired)
+    # the error of the first array that fails, not that of a later one
+    bad = arrays[:3] + [np.array(1.0)] + arrays[3:] + [np.array(["a"])]
+    with bn.num_threads(4):
+        with pytest.raises(ValueError, match="out of bounds"):
+            bn.batch("nansum", bad, axis=-1)
+
+
+def test_batch_raises():
+    """Test the argument checking of batch"""
+    a = np.array([[1.0, 2, 3], [4, 5, np.nan]])
+    for batch in (bn.batch, bn.slow.batch):
+        assert_raises(ValueError, batch, "nanwmean", [a])
+        assert_raises(ValueError, batch, np.sort, [a])
+        assert_raises(TypeError, batch, "nansum", [a], ddof=1)
+        assert_raises(TypeError, batch, "nansum", 1)
+        assert_raises(ValueError, batch, "nansum", [a], axis=2)
+        assert_equal(batch("nanstd", [a], 1, ddof=1), [bn.nanstd(a, 1, ddof=1)])
+        assert_equal(batch(func="nansum", arrays=[], axis=0), [])
+    assert_raises(TypeError, bn.batch)
+    assert_raises(TypeError, bn.batch, "nansum", [a], None, 0, False, 1)
+    assert_raises(TypeError, bn.batch, "nansum", [a], extra=0)
+
+
+@pytest.mark.parametrize(
+    "dtype", DTYPES + (np.float16, np.int16, np.uint64, np.uint8)
+)
+@pytest.mark.parametrize("func", (bn.median, bn.nanmedian), ids=lambda x: x.__name__)
+def test_median_radix(func, dtype):
+    """Test the radix select used for the median of large arrays"""
+    rs = np.random.RandomState([1, 2, 3])
+    size = 1 << 22
+    func0 = getattr(bn.slow, func.__name__)
+    hi = 2 ** min(30, 8 * np.dtype(dtype).itemsize - 1)
+    for a in (
+        rs.randint(-9, 9, size + 1),
+        rs.randint(-hi, hi, size),
+        np.arange(size)[::-1] % hi,
+    ):
+        a = a.astype(dtype)
+        if issubclass(a.dtype.type, np.inexact):
+            a[rs.rand(a.size) < 0.1] = np.nan
+            a[:9] = np.inf
+        desired = func0(a)
+        b = a[:size].reshape(1024, -1)[:, ::-1]
+        desired_b = func0(b)
+        approx = []
+        # the counting passes are split across the thread pool
+        for nthreads in (1, 4):
+            with bn.num_threads(nthreads):
+                assert_equal(func(a), desired)
+                assert_equal(func(b), desired_b)
+                approx.append(func(a, approx=True))
+        assert_equal(approx[1], approx[0])
+        actual = approx[0]
+        if np.isnan(desired):
+            assert np.isnan(actual)
+        else:
+            assert abs(actual - desired) <= 2 ** -20 * abs(desired)
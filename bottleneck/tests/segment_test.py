@@ -0,0 +1,144 @@
+"""Test segment functions."""
+
+import numpy as np
+from numpy.testing import assert_allclose, assert_equal, assert_raises
+
+import bottleneck as bn
+from .util import arrays, array_order, DTYPES, OTHER_DTYPES
+import pytest
+
+SEGMENT_FUNCS = (
+    bn.segment_nansum,
+    bn.segment_nanmean,
+    bn.segment_nanstd,
+    bn.segment_nanvar,
+    bn.segment_nanmin,
+    bn.segment_nanmax,
+    bn.segment_nanargmin,
+    bn.segment_nanargmax,
+    bn.segment_ss,
+    bn.segment_median,
+    bn.segment_nanmedian,
+    bn.segment_anynan,
+    bn.segment_allnan,
+)
+
+
+def call(func, a, offsets, axis):
+    """Call func, returning the exception type instead of raising"""
+    try:
+        with np.errstate(invalid="ignore", over="ignore"):
+            return func(a, offsets, axis)
+    except ValueError:
+        return ValueError
+
+
+@pytest.mark.parametrize("func", SEGMENT_FUNCS, ids=lambda x: x.__name__)
+@pytest.mark.parametrize("dtypes", (DTYPES, OTHER_DTYPES), ids=("default", "other"))
+def test_segment(func, dtypes):
+    """Test segment functions against the slow functions"""
+    name = func.__name__
+    func0 = getattr(bn.slow, name)
+    msg = "\nfunc %s | input %s (%s) | shape %s | axis %s | order %s\n"
+    msg += "offsets %s\n"
+    rs = np.random.RandomState([1, 2, 3])
+    for i, a in enumerate(arrays(name, dtypes)):
+        if a.ndim == 0:
+            continue
+        for axis in range(-1, a.ndim):
+            n = a.shape[axis]
+            for nseg in (0, 1, 3):
+                offsets = np.sort(rs.randint(0, n + 1, nseg + 1))
+                actual = call(func, a, offsets, axis)
+                desired = call(func0, a, offsets, axis)
+                tup = (name, i, a.dtype, a.shape, axis, array_order(a))
+                err_msg = msg % (tup + (offsets,))
+                if desired is ValueError:
+                    assert actual is ValueError, err_msg
+                    continue
+                assert actual is not ValueError, err_msg
+                rtol = 1e-2 if a.dtype == np.float16 else 1e-7
+                assert_allclose(actual, desired, rtol, 1e-12, True, err_msg)
+                assert actual.dtype == np.dtype(desired.dtype).newbyteorder("=")
+
+
+@pytest.mark.parametrize("func", SEGMENT_FUNCS, ids=lambda x: x.__name__)
+def test_segment_many(func):
+    """Test segment functions on many short segments and 2d input"""
+    func0 = getattr(bn.slow, func.__name__)
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.rand(3, 1000)
+    a[a < 0.1] = np.nan
+    offsets = np.r_[0, np.sort(rs.randint(0, 1000, 200)), 1000]
+    if func in (bn.segment_nanargmin, bn.segment_nanargmax):
+        offsets = np.unique(offsets)
+        a[:, offsets[:-1]] = rs.rand(3, offsets.size - 1)
+    for axis, b in ((1, a), (0, a.T)):
+        actual = func(b, offsets, axis)
+        desired = func0(b, offsets, axis)
+        assert_allclose(actual, desired, 1e-7, 1e-12, True)
+
+
+def test_segment_ddof():
+    """Test ddof of segment_nanstd and segment_nanvar"""
+    a = np.array([[1.0, 2, 5, np.nan, 4, 6], [3, 1, 4, 1, 5, 9]])
+    offsets = [0, 3, 6]
+    for func in (bn.segment_nanstd, bn.segment_nanvar):
+        func0 = getattr(bn.slow, func.__name__)
+        for ddof in range(4):
+            actual = func(a, offsets, ddof=ddof)
+            desired = func0(a, offsets, ddof=ddof)
+            assert_allclose(actual, desired, 1e-7, 0, True)
+
+
+def test_segment_raises():
+    """Test segment function argument checking"""
+    a = np.array([1.0, 2, 3])
+    offsets = np.array([0, 1, 3])
+    func = bn.segment_nansum
+    assert_raises(TypeError, func, a)
+    assert_raises(TypeError, func, a, offsets, 0, 0)
+    assert_raises(TypeError, func, a, offsets, ddof=0)
+    assert_raises(TypeError, func, a, offsets, extra=0)
+    assert_raises(TypeError, func, a, offsets.astype(np.float64))
+    assert_raises(ValueError, func, a, offsets, axis=None)
+    assert_raises(ValueError, func, a, offsets, axis=1)
+    assert_raises(ValueError, func, a, [])
+    assert_raises(ValueError, func, a, offsets[None])
+    assert_raises(ValueError, func, a, [0, 4])
+    assert_raises(ValueError, func, a, [-1, 2])
+    assert_raises(ValueError, func, a, [0, 2, 1])
+    assert_raises(ValueError, func, np.array(1.0), [0])
+    assert_raises(ValueError, bn.segment_nanmin, offsets, [0, 0, 3])
+    assert_raises(ValueError, bn.segment_nanargmin, [1.0, np.nan], [0, 1, 2])
+    assert_equal(func(a, offsets), func(a=a, offsets=offsets, axis=0))
+    assert_equal(func(a, [1]), np.zeros(0))
+    assert_equal(func([], [0, 0]), [0.0])
+
+
+@pytest.mark.parametrize("func", SEGMENT_FUNCS, ids=lambda x: x.__name__)
+def test_segment_threads(func):
+    """Test that splitting uneven segments across the thread pool gives the
+    results of one thread"""
+    rs = np.random.RandomState([1, 2, 3])
+    a = rs.rand(400000)
+    a[a < 0.1] = np.nan
+    # a few long segments among many short ones, not covering all of `a`
+    cuts = np.r_[rs.randint(10, 390000, 3000), 100000, 100001, 300000]
+    offsets = np.r_[10, np.sort(cuts), 390000]
+    for b, axis in ((a, 0), (a.reshape(4, -1)[:, :95000], 1)):
+        off = offsets if axis == 0 else offsets[offsets <= 95000]
+        if func in (bn.segment_nanargmin, bn.segment_nanargmax):
+            off = np.unique(off)
+            b = b.copy()
+            b[..., off[:-1]] = 0.5
+        with bn.num_threads(1):
+            desired = func(b, off, axis=axis)
+        for nthreads in (2, 4):
+            with bn.num_threads(nthreads):
+                assert_equal(func(b, off, axis=axis), desired)
+    if func in (bn.segment_nanmin, bn.segment_nanargmin):
+        c = np.arange(a.size)
+        with bn.num_threads(4):
+            with pytest.raises(ValueError, match="segment 2 is empty"):
+                func(c, [0, 5, 200000, 200000, 200000, 400000])
@@ -5,6 +5,22 @@ INT_DTYPES = [np.int64, np.int32]
 FLOAT_DTYPES = [np.float64, np.float32]
 DTYPES = tuple(FLOAT_DTYPES + INT_DTYPES)
 
+# the remaining dtypes with C functions; float16 needs compiler support
+OTHER_DTYPES = (
+    np.float16,
+    np.int16,
+    np.int8,
+    np.uint64,
+    np.uint32,
+    np.uint16,
+    np.uint8,
+    np.bool_,
+)
+
+# datetime64 and timedelta64 are accepted by nanmin, nanmax, nanargmin,
+# nanargmax and push, which treat NaT as missing
+TIME_DTYPES = ("datetime64[ns]", "datetime64[s]", "timedelta64[ns]", "timedelta64[D]")
+
 
 def get_functions(module_name, as_string=False):
     """Returns a list of functions, optionally as string function names"""
@@ -85,7 +101,7 @@ def array_iter(arrays_func, *args):
 def array_generator(func_name, dtypes):
     """Iterator that yields arrays to use for unit testing."""
 
-    f_dtypes = list(set(dtypes) & set(FLOAT_DTYPES))
+    f_dtypes = [d for d in dtypes if issubclass(np.dtype(d).type, np.inexact)]
 
     # define nan and inf
     if func_name in ("partition", "argpartition"):
@@ -104,19 +120,27 @@ def array_generator(func_name, dtypes):
         yield np.array([inf, -inf], dtype=dtype)
         yield np.array([nan, 2, 3], dtype=dtype)
         yield np.array([-inf, 2, 3], dtype=dtype)
-        if func_name != "nanargmin":
+        if not func_name.endswith("nanargmin"):
             yield np.array([nan, inf], dtype=dtype)
 
     # byte swapped
     yield np.array([1, 2, 3], dtype=">f4")
     yield np.array([1, 2, 3], dtype="<f4")
+    for dtype in dtypes:
+        a = np.array([[1, 2, 3], [4, 5, 6]], dtype=dtype)
+        if dtype in f_dtypes:
+            a[0, 2] = nan
+        a = a.astype(a.dtype.newbyteorder())
+        yield a
+        yield a.T
 
     # make sure slow is callable
-    yield np.array([1, 2, 3], dtype=np.float16)
+    yield np.array([1, 2, 3], dtype=np.longdouble)
 
     # regression tests
     for dtype in dtypes:
-        yield np.array([1, 2, 3], dtype=dtype) + 1e9  # check that move_std is robust
+        if dtype != np.float16:  # 1e9 overflows float16
+            yield np.array([1, 2, 3], dtype=dtype) + 1e9  # move_std is robust
         yield np.array([0, 0, 0], dtype=dtype)  # nanargmax/nanargmin
 
     for dtype in f_dtypes:
@@ -135,7 +159,8 @@ def array_generator(func_name, dtypes):
     # 0d input
     if not func_name.startswith("move"):
         for dtype in dtypes:
-            yield np.array(-9, dtype=dtype)
+            if np.dtype(dtype).kind not in "ub":
+                yield np.array(-9, dtype=dtype)
             yield np.array(0, dtype=dtype)
             yield np.array(9, dtype=dtype)
             if dtype in f_dtypes:
@@ -156,7 +181,7 @@ def array_generator(func_name, dtypes):
             size = ss[ndim]["size"]
             shapes = ss[ndim]["shapes"]
             for dtype in dtypes:
-                a = np.arange(size, dtype=dtype)
+                a = np.arange(size).astype(dtype)
                 if issubclass(a.dtype.type, np.inexact):
                     if func_name not in ("nanargmin", "nanargmax"):
                         # numpy can't handle eg np.nanargmin([np.nan, np.inf])
@@ -198,6 +223,25 @@ def array_generator(func_name, dtypes):
                 yield a[start::step][::2][:, ::2]
 
 
+def time_arrays(dtype):
+    """Iterator that yields datetime64 or timedelta64 arrays with NaT"""
+    rs = np.random.RandomState([1, 2, 3])
+    nat = np.array("NaT", dtype)
+    for shape in ((0,), (1,), (9,), (3, 4), (2, 3, 4)):
+        a = rs.randint(-(10**9), 10**9, shape).astype(dtype)
+        yield a
+        if a.size == 0:
+            continue
+        b = a.copy()
+        b[rs.rand(*shape) < 0.5] = nat
+        yield b
+        b = b.copy()
+        b.flat[0] = nat
+        b.flat[-1] = nat
+        yield b
+        yield np.full(shape, nat)
+
+
 def array_order(a):
     f = a.flags
     string = []
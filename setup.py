@@ -84,8 +84,10 @@ class build_ext(_build_ext):
 
         self.run_command("config")
         dirpath = "bottleneck/src"
-        modules = ["reduce", "move", "nonreduce", "nonreduce_axis"]
+        modules = ["reduce", "move", "nonreduce", "nonreduce_axis", "group"]
         make_c_files(dirpath, modules)
+        make_c_files(os.path.join(dirpath, "move_median"), ["move_median"])
+        make_c_files(os.path.join(dirpath, "introselect"), ["introselect"])
 
         _build_ext.build_extensions(self)
 
@@ -104,13 +106,23 @@ def prepare_modules():
     base_includes = [
         "bottleneck/src/bottleneck.h",
         "bottleneck/src/bn_config.h",
+        "bottleneck/src/bn_float16.h",
+        "bottleneck/src/bn_types.h",
+        "bottleneck/src/bn_pool.h",
         "bottleneck/src/iterators.h",
     ]
+    introselect_includes = [
+        "bottleneck/src/introselect/introselect.h",
+        "bottleneck/src/introselect/introselect_template.c",
+    ]
     ext = [
         Extension(
             "bottleneck.reduce",
-            sources=["bottleneck/src/reduce.c"],
-            depends=base_includes,
+            sources=[
+                "bottleneck/src/reduce.c",
+                "bottleneck/src/introselect/introselect.c",
+            ],
+            depends=base_includes + introselect_includes,
             extra_compile_args=["-O2"],
         )
     ]
@@ -121,7 +133,11 @@ def prepare_modules():
                 "bottleneck/src/move.c",
                 "bottleneck/src/move_median/move_median.c",
             ],
-            depends=base_includes + ["bottleneck/src/move_median/move_median.h"],
+            depends=base_includes
+            + [
+                "bottleneck/src/move_median/move_median.h",
+                "bottleneck/src/move_median/move_median_template.c",
+            ],
             extra_compile_args=["-O2"],
         )
     ]
@@ -136,7 +152,26 @@ def prepare_modules():
     ext += [
         Extension(
             "bottleneck.nonreduce_axis",
-            sources=["bottleneck/src/nonreduce_axis.c"],
+            sources=[
+                "bottleneck/src/nonreduce_axis.c",
+                "bottleneck/src/introselect/introselect.c",
+            ],
+            depends=base_includes + introselect_includes,
+            extra_compile_args=["-O2"],
+        )
+    ]
+    ext += [
+        Extension(
+            "bottleneck._pool",
+            sources=["bottleneck/src/pool.c"],
+            depends=["bottleneck/src/bn_pool.h"],
+            extra_compile_args=["-O2"],
+        )
+    ]
+    ext += [
+        Extension(
+            "bottleneck.group",
+            sources=["bottleneck/src/group.c"],
             depends=base_includes,
             extra_compile_args=["-O2"],
         )
@@ -167,6 +202,7 @@ CLASSIFIERS = [
     "Programming Language :: Python :: 3.11",
     "Programming Language :: Python :: 3.12",
     "Programming Language :: Python :: 3.13",
+    "Programming Language :: Python :: Free Threading :: 2 - Beta",
     "Topic :: Scientific/Engineering",
 ]
 